@@ -0,0 +1,283 @@
+/*
+ * Runs the ARTI programs of corpus/ on the recording strip of arti_wled.h and compares the leds after every
+ * frame with expected/<program>.txt. Each program is compiled first and then run again from its saved .artic.
+ * Setup, parse and frame times and memory use are reported for every run, --bench runs on larger segments.
+ *
+ * arti_test <expected dir> [--update] [--bench]
+ *   --update  write the output of this build as expected output
+ *   --bench   only report times and memory, for 1D 1500 and 2D 32x32 segments
+ */
+
+#include <chrono>
+#include <cstdarg>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __GLIBC__
+  #include <malloc.h>
+  #define HOST_HEAP 0x40000000UL
+  static unsigned int hostFreeHeap() { struct mallinfo2 info = mallinfo2(); return HOST_HEAP - info.uordblks - info.hblkhd; }
+  #define FREE_SIZE hostFreeHeap()
+#endif
+#define ARTI_NO_TRACE
+#include "wled/arti_wled.h"
+
+struct Segment {
+  const char * program;
+  uint16_t width, height;
+};
+
+// conformance: 1D and 2D, renderFrame and renderLed, 2D not square to catch mixed up x and y
+static const Segment corpus[] = {
+  {"frame1d", 16, 1}, {"led1d", 16, 1}, {"ops", 16, 1},
+  {"frame2d", 8, 6}, {"led2d", 8, 6},
+};
+static const Segment bench[] = {
+  {"frame1d", 1500, 1}, {"led1d", 1500, 1}, {"ops", 16, 1},
+  {"frame2d", 32, 32}, {"led2d", 32, 32},
+};
+#define TEST_FRAMES 12
+#define BENCH_FRAMES 200
+#define FRAME_MILLIS 40
+
+// runs a program for a number of frames, output gets the leds of every frame, values with 6 significant digits
+static bool runProgram(const Segment &segment, uint16_t frames, std::string &output, ArtiStats &stats, unsigned int &heapUsed)
+{
+  char programName[fileNameLength];
+  snprintf(programName, sizeof(programName), "corpus/%s.wled", segment.program);
+
+  strip.resize(segment.width, segment.height);
+  strip.now = 1000;
+  srand(1);
+
+  unsigned int freeBefore = FREE_SIZE;
+  ARTI *arti = new ARTI();
+  bool ok = arti->setup("corpus/wled.json", programName);
+
+  std::ostringstream out;
+  char value[24];
+  for (uint16_t frame = 0; ok && frame < frames; frame++)
+  {
+    ok = arti->loop();
+    out << "frame " << frame << ":";
+    for (float pixel : strip.pixels)
+    {
+      snprintf(value, sizeof(value), " %g", pixel);
+      out << value;
+    }
+    out << "\n";
+    strip.now += FRAME_MILLIS;
+  }
+
+  stats = arti->stats;
+  heapUsed = (stats.minFreeHeap != UINT32_MAX && freeBefore > stats.minFreeHeap) ? freeBefore - stats.minFreeHeap : 0;
+  arti->close();
+  delete arti;
+
+  output = out.str();
+  return ok;
+}
+
+static void report(const Segment &segment, const ArtiStats &stats, unsigned int heapUsed)
+{
+  printf("%-8s %4ux%-3u %-7s setup %6u us  parse %6u us  parseTree %6u B  heap %7u B  frame %6u us  max %6u us  calls %2u  variables %3u\n",
+         segment.program, segment.width, segment.height, stats.loaded ? "load" : "compile", stats.setupMicros, stats.parseMicros,
+         stats.parseTreeBytes, heapUsed, stats.frames ? stats.frameMicros / stats.frames : 0, stats.maxFrameMicros, stats.maxFrames, stats.maxVariables);
+}
+
+// overwrites a byte of a compiled program, at offset or counted from the end if negative
+static void corruptFile(const char * fileName, long offset, uint8_t value)
+{
+  std::fstream file(fileName, std::ios::in | std::ios::out | std::ios::binary);
+  file.seekp(offset, offset < 0 ? std::ios::end : std::ios::beg);
+  file.put((char)value);
+}
+
+// offset of the first variable load in the code of a compiled program, -1 if there is none
+static long firstLoad(const char * fileName, uint8_t &opcode)
+{
+  std::ifstream file(fileName, std::ios::binary);
+  ArtiCodeHeader header;
+  if (!file.read((char *)&header, sizeof(header))) return -1;
+  long codeOffset = sizeof(header) + header.functionsIndex * sizeof(ArtiFunction) + header.constantsIndex * sizeof(float);
+  std::vector<uint8_t> code(header.codeSize);
+  file.seekg(codeOffset);
+  if (!file.read((char *)code.data(), code.size())) return -1;
+  ARTI arti;
+  for (uint16_t pc = 0; pc < code.size() && arti.instructionLength(code[pc]) > 0; pc += arti.instructionLength(code[pc]))
+  {
+    opcode = code[pc];
+    if (opcode == OP_LoadGlobal || opcode == OP_LoadLocal) return codeOffset + pc;
+  }
+  return -1;
+}
+
+static std::string readFile(const std::string &name)
+{
+  std::ifstream file(name);
+  std::stringstream text;
+  text << file.rdbuf();
+  return text.str();
+}
+
+// first line which differs, to show what changed
+static void showDifference(const std::string &expected, const std::string &output)
+{
+  std::istringstream e(expected), o(output);
+  std::string expectedLine, outputLine;
+  while (true)
+  {
+    bool moreExpected = (bool)std::getline(e, expectedLine);
+    bool moreOutput = (bool)std::getline(o, outputLine);
+    if (!moreExpected && !moreOutput) return;
+    if (expectedLine != outputLine || moreExpected != moreOutput)
+    {
+      printf("  expected %s\n  got      %s\n", moreExpected ? expectedLine.c_str() : "<end>", moreOutput ? outputLine.c_str() : "<end>");
+      return;
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2)
+  {
+    printf("usage: %s <expected dir> [--update] [--bench]\n", argv[0]);
+    return 2;
+  }
+  std::string expectedDir = argv[1];
+  bool update = false, benchmark = false;
+  for (int i = 2; i < argc; i++)
+  {
+    update = update || strcmp(argv[i], "--update") == 0;
+    benchmark = benchmark || strcmp(argv[i], "--bench") == 0;
+  }
+
+  int failures = 0;
+  std::string output, loadedOutput;
+  ArtiStats stats;
+  unsigned int heapUsed;
+
+  if (benchmark)
+  {
+    for (const Segment &segment : bench)
+    {
+      char codeFileName[fileNameLength];
+      snprintf(codeFileName, sizeof(codeFileName), "corpus/%s.artic", segment.program);
+      remove(codeFileName);
+      for (uint8_t run = 0; run < 2; run++) // compile, then load
+      {
+        if (!runProgram(segment, BENCH_FRAMES, output, stats, heapUsed))
+        {
+          printf("%s failed, see corpus/%s.wled.log\n", segment.program, segment.program);
+          failures++;
+        }
+        report(segment, stats, heapUsed);
+      }
+    }
+    return failures ? 1 : 0;
+  }
+
+  for (const Segment &segment : corpus)
+  {
+    char codeFileName[fileNameLength];
+    snprintf(codeFileName, sizeof(codeFileName), "corpus/%s.artic", segment.program);
+    remove(codeFileName);
+
+    bool ok = runProgram(segment, TEST_FRAMES, output, stats, heapUsed);
+    report(segment, stats, heapUsed);
+    if (!ok || stats.loaded)
+    {
+      printf("%s: compile and run failed, see corpus/%s.wled.log\n", segment.program, segment.program);
+      failures++;
+      continue;
+    }
+
+    std::string expectedName = expectedDir + "/" + segment.program + ".txt";
+    if (update)
+    {
+      std::ofstream(expectedName) << output;
+      printf("%s: written to %s\n", segment.program, expectedName.c_str());
+    }
+    else
+    {
+      std::string expected = readFile(expectedName);
+      if (output != expected)
+      {
+        printf("%s: leds differ from %s\n", segment.program, expectedName.c_str());
+        showDifference(expected, output);
+        failures++;
+      }
+    }
+
+    // the same program loaded from the compiled file
+    ok = runProgram(segment, TEST_FRAMES, loadedOutput, stats, heapUsed);
+    report(segment, stats, heapUsed);
+    if (!ok || !stats.loaded)
+    {
+      printf("%s: %s not loaded or run failed\n", segment.program, codeFileName);
+      failures++;
+    }
+    else if (loadedOutput != output)
+    {
+      printf("%s: leds differ when loaded from %s\n", segment.program, codeFileName);
+      showDifference(output, loadedOutput);
+      failures++;
+    }
+
+    // a damaged compiled file is not run but compiled again: more globals than ArtiState has, an unknown last opcode,
+    // a smaller stack than the code needs and a load turned into a store (valid operands, but it takes a value instead of pushing one)
+    uint8_t load = OP_LoadGlobal;
+    long loadOffset = firstLoad(codeFileName, load);
+    std::vector<std::vector<long>> damages = {{(long)offsetof(ArtiCodeHeader, nrOfGlobals), nrOfStateVariables + 1}, {-1, 0xFF},
+                                              {(long)offsetof(ArtiCodeHeader, maxStack), 0}};
+    if (loadOffset >= 0) damages.push_back({loadOffset, load == OP_LoadGlobal ? OP_StoreGlobal : OP_StoreLocal});
+    for (const std::vector<long> &damage : damages)
+    {
+      corruptFile(codeFileName, damage[0], damage[1]);
+      ok = runProgram(segment, TEST_FRAMES, loadedOutput, stats, heapUsed);
+      if (!ok || stats.loaded || loadedOutput != output)
+      {
+        printf("%s: damaged %s (byte %ld = %ld) %s\n", segment.program, codeFileName, damage[0], damage[1], stats.loaded ? "loaded" : "not compiled again");
+        failures++;
+      }
+    }
+  }
+
+  // two programs side by side, like custom effects on two segments: each keeps its own log until it is closed
+  {
+    strip.resize(16, 1);
+    ARTI *first = new ARTI(), *second = new ARTI();
+    bool ok = first->setup("corpus/wled.json", "corpus/frame1d.wled") && second->setup("corpus/wled.json", "corpus/led1d.wled");
+    for (uint16_t frame = 0; ok && frame < TEST_FRAMES; frame++)
+    {
+      ok = first->loop() && second->loop();
+      strip.now += FRAME_MILLIS;
+    }
+    first->close();
+    second->close();
+    delete first;
+    delete second;
+    for (const char *program : {"frame1d", "led1d"})
+    {
+      std::string log = readFile(std::string("corpus/") + program + ".wled.log");
+      if (!ok || log.find("closed Arti") == std::string::npos)
+      {
+        printf("%s: run side by side failed or log not complete, see corpus/%s.wled.log\n", program, program);
+        failures++;
+      }
+    }
+  }
+
+  if (failures)
+  {
+    printf("%d program run(s) failed\n", failures);
+    return 1;
+  }
+  printf("arti programs OK\n");
+  return 0;
+}
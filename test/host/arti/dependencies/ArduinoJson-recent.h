@@ -0,0 +1,3 @@
+#pragma once
+// arti.h includes ArduinoJson from here when not built for Arduino, use the version WLED ships
+#include "src/dependencies/json/ArduinoJson-v6.h"
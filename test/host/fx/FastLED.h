@@ -0,0 +1,413 @@
+#pragma once
+/*
+ * Host stand-in for the parts of FastLED 3.5 that the effects use: lib8tion math, noise, CRGB/CHSV,
+ * 16 entry palettes and the colour utilities. The portable C code paths of FastLED with
+ * FASTLED_SCALE8_FIXED and FASTLED_BLEND_FIXED, so effects render like on a controller apart from
+ * floating point differences. Written for the host tests, not a replacement for the library.
+ */
+
+#include "Arduino.h"
+
+typedef uint8_t  fract8;
+typedef uint16_t fract16;
+typedef uint16_t accum88;
+typedef int16_t  saccum87;
+
+uint32_t get_millisecond_timer(); // USE_GET_MILLISECOND_TIMER, the strip clock
+#define GET_MILLIS get_millisecond_timer
+
+//
+// lib8tion math
+//
+inline uint8_t qadd8(uint8_t i, uint8_t j) { unsigned t = i + j; return t > 255 ? 255 : t; }
+inline int8_t  qadd7(int8_t i, int8_t j) { int t = i + j; return t > 127 ? 127 : t; }
+inline uint8_t qsub8(uint8_t i, uint8_t j) { int t = i - j; return t < 0 ? 0 : t; }
+inline uint8_t add8(uint8_t i, uint8_t j) { return i + j; }
+inline uint16_t add8to16(uint8_t i, uint16_t j) { return i + j; }
+inline uint8_t sub8(uint8_t i, uint8_t j) { return i - j; }
+inline uint8_t avg8(uint8_t i, uint8_t j) { return (i + j) >> 1; }
+inline uint16_t avg16(uint16_t i, uint16_t j) { return (uint32_t)((uint32_t)i + (uint32_t)j) >> 1; }
+inline int8_t  avg7(int8_t i, int8_t j) { return (i >> 1) + (j >> 1) + (i & 0x1); }
+inline int16_t avg15(int16_t i, int16_t j) { return (i >> 1) + (j >> 1) + (i & 0x1); }
+inline uint8_t mul8(uint8_t i, uint8_t j) { return ((int)i * (int)j) & 0xFF; }
+inline uint8_t qmul8(uint8_t i, uint8_t j) { unsigned p = (unsigned)i * j; return p > 255 ? 255 : p; }
+inline int8_t  abs8(int8_t i) { return i < 0 ? -i : i; }
+inline uint8_t mod8(uint8_t a, uint8_t m) { while (a >= m) a -= m; return a; }
+inline uint8_t addmod8(uint8_t a, uint8_t b, uint8_t m) { a += b; while (a >= m) a -= m; return a; }
+
+inline uint8_t scale8(uint8_t i, fract8 scale) { return ((uint16_t)i * (1 + (uint16_t)scale)) >> 8; }
+inline uint8_t scale8_video(uint8_t i, fract8 scale) { return (((int)i * (int)scale) >> 8) + ((i && scale) ? 1 : 0); }
+#define scale8_LEAVING_R1_DIRTY scale8
+#define scale8_video_LEAVING_R1_DIRTY scale8_video
+inline void nscale8x3(uint8_t& r, uint8_t& g, uint8_t& b, fract8 scale) {
+  uint16_t s = scale + 1;
+  r = (r * s) >> 8; g = (g * s) >> 8; b = (b * s) >> 8;
+}
+inline void nscale8x3_video(uint8_t& r, uint8_t& g, uint8_t& b, fract8 scale) {
+  uint8_t nz = scale ? 1 : 0;
+  r = (r == 0) ? 0 : (((int)r * (int)scale) >> 8) + nz;
+  g = (g == 0) ? 0 : (((int)g * (int)scale) >> 8) + nz;
+  b = (b == 0) ? 0 : (((int)b * (int)scale) >> 8) + nz;
+}
+inline uint16_t scale16by8(uint16_t i, fract8 scale) { return (i * (1 + (uint32_t)scale)) >> 8; }
+inline uint16_t scale16(uint16_t i, fract16 scale) { return ((uint32_t)i * (1 + (uint32_t)scale)) >> 16; }
+
+inline uint8_t dim8_raw(uint8_t x) { return scale8(x, x); }
+inline uint8_t dim8_video(uint8_t x) { return scale8_video(x, x); }
+inline uint8_t dim8_lin(uint8_t x) { if (x & 0x80) x = scale8(x, x); else { x += 1; x /= 2; } return x; }
+inline uint8_t brighten8_raw(uint8_t x) { uint8_t ix = 255 - x; return 255 - scale8(ix, ix); }
+inline uint8_t brighten8_video(uint8_t x) { uint8_t ix = 255 - x; return 255 - scale8_video(ix, ix); }
+
+inline uint8_t lerp8by8(uint8_t a, uint8_t b, fract8 frac) {
+  if (b > a) return a + scale8(b - a, frac);
+  return a - scale8(a - b, frac);
+}
+inline uint16_t lerp16by16(uint16_t a, uint16_t b, fract16 frac) {
+  if (b > a) return a + scale16(b - a, frac);
+  return a - scale16(a - b, frac);
+}
+inline uint16_t lerp16by8(uint16_t a, uint16_t b, fract8 frac) {
+  if (b > a) return a + scale16by8(b - a, frac);
+  return a - scale16by8(a - b, frac);
+}
+inline int16_t lerp15by8(int16_t a, int16_t b, fract8 frac) {
+  if (b > a) return a + scale16by8((uint16_t)(b - a), frac);
+  return a - scale16by8((uint16_t)(a - b), frac);
+}
+inline int16_t lerp15by16(int16_t a, int16_t b, fract16 frac) {
+  if (b > a) return a + scale16((uint16_t)(b - a), frac);
+  return a - scale16((uint16_t)(a - b), frac);
+}
+inline uint8_t map8(uint8_t in, uint8_t rangeStart, uint8_t rangeEnd) {
+  return rangeStart + scale8(in, rangeEnd - rangeStart);
+}
+
+inline uint8_t sqrt16(uint16_t x) {
+  if (x <= 1) return x;
+  uint8_t low = 1, hi, mid;
+  hi = x > 7904 ? 255 : (x >> 5) + 8;
+  do {
+    mid = (low + hi) >> 1;
+    if ((uint16_t)(mid * mid) > x) hi = mid - 1;
+    else {
+      if (mid == 255) return 255;
+      low = mid + 1;
+    }
+  } while (hi >= low);
+  return low - 1;
+}
+
+inline uint8_t ease8InOutQuad(uint8_t i) {
+  uint8_t j = i;
+  if (j & 0x80) j = 255 - j;
+  uint8_t jj = scale8(j, j);
+  uint8_t jj2 = jj << 1;
+  if (i & 0x80) jj2 = 255 - jj2;
+  return jj2;
+}
+inline uint16_t ease16InOutQuad(uint16_t i) {
+  uint16_t j = i;
+  if (j & 0x8000) j = 65535 - j;
+  uint16_t jj = scale16(j, j);
+  uint16_t jj2 = jj << 1;
+  if (i & 0x8000) jj2 = 65535 - jj2;
+  return jj2;
+}
+inline fract8 ease8InOutCubic(fract8 i) {
+  uint8_t ii = scale8(i, i);
+  uint8_t iii = scale8(ii, i);
+  uint16_t r1 = (3 * (uint16_t)ii) - (2 * (uint16_t)iii);
+  uint8_t result = r1;
+  if (r1 & 0x100) result = 255;
+  return result;
+}
+inline fract8 ease8InOutApprox(fract8 i) {
+  if (i < 64) i /= 2;
+  else if (i > (255 - 64)) { i = 255 - i; i /= 2; i = 255 - i; }
+  else { i -= 64; i += i / 2; i += 32; }
+  return i;
+}
+inline uint8_t triwave8(uint8_t in) { if (in & 0x80) in = 255 - in; return in << 1; }
+inline uint8_t quadwave8(uint8_t in) { return ease8InOutQuad(triwave8(in)); }
+inline uint8_t cubicwave8(uint8_t in) { return ease8InOutCubic(triwave8(in)); }
+inline uint8_t squarewave8(uint8_t in, uint8_t pulsewidth = 128) { return in < pulsewidth || pulsewidth == 255 ? 255 : 0; }
+
+inline int16_t sin16(uint16_t theta) {
+  static const uint16_t base[] = {0, 6393, 12539, 18204, 23170, 27245, 30273, 32137};
+  static const uint8_t slope[] = {49, 48, 44, 38, 31, 23, 14, 4};
+  uint16_t offset = (theta & 0x3FFF) >> 3; // 0..2047
+  if (theta & 0x4000) offset = 2047 - offset;
+  uint8_t section = offset / 256; // 0..7
+  uint16_t b = base[section];
+  uint8_t m = slope[section];
+  uint8_t secoffset8 = (uint8_t)(offset) / 2;
+  uint16_t mx = m * secoffset8;
+  int16_t y = mx + b;
+  if (theta & 0x8000) y = -y;
+  return y;
+}
+inline int16_t cos16(uint16_t theta) { return sin16(theta + 16384); }
+
+inline uint8_t sin8(uint8_t theta) {
+  static const uint8_t b_m16_interleave[] = {0, 49, 49, 41, 90, 27, 117, 10};
+  uint8_t offset = theta;
+  if (theta & 0x40) offset = (uint8_t)255 - offset;
+  offset &= 0x3F; // 0..63
+  uint8_t secoffset = offset & 0x0F; // 0..15
+  if (theta & 0x40) secoffset++;
+  uint8_t section = offset >> 4; // 0..3
+  uint8_t b   = b_m16_interleave[section * 2];
+  uint8_t m16 = b_m16_interleave[section * 2 + 1];
+  uint8_t mx = (m16 * secoffset) >> 4;
+  int8_t y = mx + b;
+  if (theta & 0x80) y = -y;
+  y += 128;
+  return y;
+}
+inline uint8_t cos8(uint8_t theta) { return sin8(theta + 64); }
+
+//
+// random numbers
+//
+#define FASTLED_RAND16_2053  ((uint16_t)(2053))
+#define FASTLED_RAND16_13849 ((uint16_t)(13849))
+extern uint16_t rand16seed;
+inline uint8_t random8() {
+  rand16seed = (rand16seed * FASTLED_RAND16_2053) + FASTLED_RAND16_13849;
+  return (uint8_t)(((uint8_t)(rand16seed & 0xFF)) + ((uint8_t)(rand16seed >> 8)));
+}
+inline uint16_t random16() {
+  rand16seed = (rand16seed * FASTLED_RAND16_2053) + FASTLED_RAND16_13849;
+  return rand16seed;
+}
+inline uint8_t random8(uint8_t lim) { uint8_t r = random8(); return (r * lim) >> 8; }
+inline uint8_t random8(uint8_t min, uint8_t lim) { uint8_t delta = lim - min; return random8(delta) + min; }
+inline uint16_t random16(uint16_t lim) { uint16_t r = random16(); uint32_t p = (uint32_t)lim * (uint32_t)r; return p >> 16; }
+inline uint16_t random16(uint16_t min, uint16_t lim) { uint16_t delta = lim - min; return random16(delta) + min; }
+inline void random16_set_seed(uint16_t seed) { rand16seed = seed; }
+inline uint16_t random16_get_seed() { return rand16seed; }
+inline void random16_add_entropy(uint16_t entropy) { rand16seed += entropy; }
+
+//
+// beat generators, on the strip clock
+//
+inline uint16_t beat88(accum88 beats_per_minute_88, uint32_t timebase = 0) {
+  return ((GET_MILLIS() - timebase) * beats_per_minute_88 * 280) >> 16;
+}
+inline uint16_t beat16(accum88 beats_per_minute, uint32_t timebase = 0) {
+  if (beats_per_minute < 256) beats_per_minute <<= 8;
+  return beat88(beats_per_minute, timebase);
+}
+inline uint8_t beat8(accum88 beats_per_minute, uint32_t timebase = 0) { return beat16(beats_per_minute, timebase) >> 8; }
+inline uint16_t beatsin88(accum88 beats_per_minute_88, uint16_t lowest = 0, uint16_t highest = 65535, uint32_t timebase = 0, uint16_t phase_offset = 0) {
+  uint16_t beat = beat88(beats_per_minute_88, timebase);
+  uint16_t beatsin = (sin16(beat + phase_offset) + 32768);
+  uint16_t rangewidth = highest - lowest;
+  uint16_t scaledbeat = scale16(beatsin, rangewidth);
+  return lowest + scaledbeat;
+}
+inline uint16_t beatsin16(accum88 beats_per_minute, uint16_t lowest = 0, uint16_t highest = 65535, uint32_t timebase = 0, uint16_t phase_offset = 0) {
+  uint16_t beat = beat16(beats_per_minute, timebase);
+  uint16_t beatsin = (sin16(beat + phase_offset) + 32768);
+  uint16_t rangewidth = highest - lowest;
+  uint16_t scaledbeat = scale16(beatsin, rangewidth);
+  return lowest + scaledbeat;
+}
+inline uint8_t beatsin8(accum88 beats_per_minute, uint8_t lowest = 0, uint8_t highest = 255, uint32_t timebase = 0, uint8_t phase_offset = 0) {
+  uint8_t beat = beat8(beats_per_minute, timebase);
+  uint8_t beatsin = sin8(beat + phase_offset);
+  uint8_t rangewidth = highest - lowest;
+  uint8_t scaledbeat = scale8(beatsin, rangewidth);
+  return lowest + scaledbeat;
+}
+
+//
+// Perlin noise (noise.cpp)
+//
+int16_t inoise16_raw(uint32_t x, uint32_t y, uint32_t z);
+int16_t inoise16_raw(uint32_t x, uint32_t y);
+int16_t inoise16_raw(uint32_t x);
+int8_t inoise8_raw(uint16_t x, uint16_t y, uint16_t z);
+int8_t inoise8_raw(uint16_t x, uint16_t y);
+int8_t inoise8_raw(uint16_t x);
+uint16_t inoise16(uint32_t x, uint32_t y, uint32_t z);
+uint16_t inoise16(uint32_t x, uint32_t y);
+uint16_t inoise16(uint32_t x);
+uint8_t inoise8(uint16_t x, uint16_t y, uint16_t z);
+uint8_t inoise8(uint16_t x, uint16_t y);
+uint8_t inoise8(uint16_t x);
+
+//
+// colours
+//
+struct CRGB;
+struct CHSV {
+  union {
+    struct { union { uint8_t hue; uint8_t h; }; union { uint8_t saturation; uint8_t sat; uint8_t s; }; union { uint8_t value; uint8_t val; uint8_t v; }; };
+    uint8_t raw[3];
+  };
+  CHSV() {}
+  CHSV(uint8_t ih, uint8_t is, uint8_t iv) : h(ih), s(is), v(iv) {}
+  CHSV& setHSV(uint8_t ih, uint8_t is, uint8_t iv) { h = ih; s = is; v = iv; return *this; }
+};
+
+void hsv2rgb_rainbow(const CHSV& hsv, CRGB& rgb);
+
+struct CRGB {
+  union {
+    struct { union { uint8_t r; uint8_t red; }; union { uint8_t g; uint8_t green; }; union { uint8_t b; uint8_t blue; }; };
+    uint8_t raw[3];
+  };
+  uint8_t& operator[](uint8_t x) { return raw[x]; }
+  const uint8_t& operator[](uint8_t x) const { return raw[x]; }
+
+  CRGB() {}
+  constexpr CRGB(uint8_t ir, uint8_t ig, uint8_t ib) : r(ir), g(ig), b(ib) {}
+  constexpr CRGB(uint32_t colorcode) : r((colorcode >> 16) & 0xFF), g((colorcode >> 8) & 0xFF), b((colorcode >> 0) & 0xFF) {}
+  CRGB(const CHSV& rhs) { hsv2rgb_rainbow(rhs, *this); }
+  CRGB& operator=(const CHSV& rhs) { hsv2rgb_rainbow(rhs, *this); return *this; }
+  CRGB& operator=(const uint32_t colorcode) { r = (colorcode >> 16) & 0xFF; g = (colorcode >> 8) & 0xFF; b = (colorcode >> 0) & 0xFF; return *this; }
+  CRGB& setRGB(uint8_t nr, uint8_t ng, uint8_t nb) { r = nr; g = ng; b = nb; return *this; }
+  CRGB& setHSV(uint8_t hue, uint8_t sat, uint8_t val) { hsv2rgb_rainbow(CHSV(hue, sat, val), *this); return *this; }
+  CRGB& setHue(uint8_t hue) { hsv2rgb_rainbow(CHSV(hue, 255, 255), *this); return *this; }
+  CRGB& setColorCode(uint32_t colorcode) { return *this = colorcode; }
+
+  CRGB& operator+=(const CRGB& rhs) { r = qadd8(r, rhs.r); g = qadd8(g, rhs.g); b = qadd8(b, rhs.b); return *this; }
+  CRGB& addToRGB(uint8_t d) { r = qadd8(r, d); g = qadd8(g, d); b = qadd8(b, d); return *this; }
+  CRGB& operator-=(const CRGB& rhs) { r = qsub8(r, rhs.r); g = qsub8(g, rhs.g); b = qsub8(b, rhs.b); return *this; }
+  CRGB& subtractFromRGB(uint8_t d) { r = qsub8(r, d); g = qsub8(g, d); b = qsub8(b, d); return *this; }
+  CRGB& operator--() { subtractFromRGB(1); return *this; }
+  CRGB operator--(int) { CRGB retval(*this); --(*this); return retval; }
+  CRGB& operator++() { addToRGB(1); return *this; }
+  CRGB operator++(int) { CRGB retval(*this); ++(*this); return retval; }
+  CRGB& operator/=(uint8_t d) { r /= d; g /= d; b /= d; return *this; }
+  CRGB& operator>>=(uint8_t d) { r >>= d; g >>= d; b >>= d; return *this; }
+  CRGB& operator*=(uint8_t d) { r = qmul8(r, d); g = qmul8(g, d); b = qmul8(b, d); return *this; }
+  CRGB& nscale8_video(uint8_t scaledown) { nscale8x3_video(r, g, b, scaledown); return *this; }
+  CRGB& operator%=(uint8_t scaledown) { nscale8x3_video(r, g, b, scaledown); return *this; }
+  CRGB& fadeLightBy(uint8_t fadefactor) { nscale8x3_video(r, g, b, 255 - fadefactor); return *this; }
+  CRGB& nscale8(uint8_t scaledown) { nscale8x3(r, g, b, scaledown); return *this; }
+  CRGB& nscale8(const CRGB& scaledown) { r = ::scale8(r, scaledown.r); g = ::scale8(g, scaledown.g); b = ::scale8(b, scaledown.b); return *this; }
+  CRGB scale8(const CRGB& scaledown) const { return CRGB(::scale8(r, scaledown.r), ::scale8(g, scaledown.g), ::scale8(b, scaledown.b)); }
+  CRGB& fadeToBlackBy(uint8_t fadefactor) { nscale8x3(r, g, b, 255 - fadefactor); return *this; }
+  CRGB& operator|=(const CRGB& rhs) { if (rhs.r > r) r = rhs.r; if (rhs.g > g) g = rhs.g; if (rhs.b > b) b = rhs.b; return *this; }
+  CRGB& operator|=(uint8_t d) { if (d > r) r = d; if (d > g) g = d; if (d > b) b = d; return *this; }
+  CRGB& operator&=(const CRGB& rhs) { if (rhs.r < r) r = rhs.r; if (rhs.g < g) g = rhs.g; if (rhs.b < b) b = rhs.b; return *this; }
+  CRGB& operator&=(uint8_t d) { if (d < r) r = d; if (d < g) g = d; if (d < b) b = d; return *this; }
+  explicit operator bool() const { return r || g || b; }
+  CRGB operator-() const { return CRGB(255 - r, 255 - g, 255 - b); }
+
+  uint8_t getLuma() const { return ::scale8(r, 54) + ::scale8(g, 183) + ::scale8(b, 18); }
+  uint8_t getAverageLight() const { return ::scale8(r, 85) + ::scale8(g, 85) + ::scale8(b, 85); }
+  void maximizeBrightness(uint8_t limit = 255) {
+    uint8_t max = r;
+    if (g > max) max = g;
+    if (b > max) max = b;
+    if (max == 0) return;
+    uint16_t factor = ((uint16_t)(limit) * 256) / max;
+    r = (r * factor) / 256; g = (g * factor) / 256; b = (b * factor) / 256;
+  }
+  CRGB lerp8(const CRGB& other, fract8 frac) const {
+    return CRGB(lerp8by8(r, other.r, frac), lerp8by8(g, other.g, frac), lerp8by8(b, other.b, frac));
+  }
+
+  typedef enum {
+    Aqua = 0x00FFFF, Aquamarine = 0x7FFFD4, Black = 0x000000, Blue = 0x0000FF, CadetBlue = 0x5F9EA0,
+    CornflowerBlue = 0x6495ED, DarkBlue = 0x00008B, DarkCyan = 0x008B8B, DarkGreen = 0x006400,
+    DarkOliveGreen = 0x556B2F, DarkOrange = 0xFF8C00, DarkRed = 0x8B0000, DarkSlateGray = 0x2F4F4F,
+    ForestGreen = 0x228B22, Gray = 0x808080, Green = 0x008000, LawnGreen = 0x7CFC00, LightBlue = 0xADD8E6,
+    LightGreen = 0x90EE90, LightSkyBlue = 0x87CEFA, LimeGreen = 0x32CD32, Maroon = 0x800000,
+    MediumAquamarine = 0x66CDAA, MediumBlue = 0x0000CD, MidnightBlue = 0x191970, Navy = 0x000080,
+    OliveDrab = 0x6B8E23, Orange = 0xFFA500, Red = 0xFF0000, SeaGreen = 0x2E8B57, SkyBlue = 0x87CEEB,
+    Teal = 0x008080, White = 0xFFFFFF, Yellow = 0xFFFF00, YellowGreen = 0x9ACD32
+  } HTMLColorCode;
+};
+
+inline bool operator==(const CRGB& lhs, const CRGB& rhs) { return lhs.r == rhs.r && lhs.g == rhs.g && lhs.b == rhs.b; }
+inline bool operator!=(const CRGB& lhs, const CRGB& rhs) { return !(lhs == rhs); }
+inline CRGB operator+(const CRGB& p1, const CRGB& p2) { return CRGB(qadd8(p1.r, p2.r), qadd8(p1.g, p2.g), qadd8(p1.b, p2.b)); }
+inline CRGB operator-(const CRGB& p1, const CRGB& p2) { return CRGB(qsub8(p1.r, p2.r), qsub8(p1.g, p2.g), qsub8(p1.b, p2.b)); }
+inline CRGB operator*(const CRGB& p1, uint8_t d) { return CRGB(qmul8(p1.r, d), qmul8(p1.g, d), qmul8(p1.b, d)); }
+inline CRGB operator/(const CRGB& p1, uint8_t d) { return CRGB(p1.r / d, p1.g / d, p1.b / d); }
+inline CRGB operator%(const CRGB& p1, uint8_t d) { CRGB retval(p1); retval.nscale8_video(d); return retval; }
+inline CRGB operator&(const CRGB& p1, const CRGB& p2) {
+  return CRGB(p1.r < p2.r ? p1.r : p2.r, p1.g < p2.g ? p1.g : p2.g, p1.b < p2.b ? p1.b : p2.b);
+}
+inline CRGB operator|(const CRGB& p1, const CRGB& p2) {
+  return CRGB(p1.r > p2.r ? p1.r : p2.r, p1.g > p2.g ? p1.g : p2.g, p1.b > p2.b ? p1.b : p2.b);
+}
+
+enum LEDColorCorrection { TypicalSMD5050 = 0xFFB0F0, TypicalLEDStrip = 0xFFB0F0, UncorrectedColor = 0xFFFFFF };
+enum ColorTemperature { UncorrectedTemperature = 0xFFFFFF };
+
+void hsv2rgb_spectrum(const CHSV& hsv, CRGB& rgb);
+CHSV rgb2hsv_approximate(const CRGB& rgb);
+
+CRGB& nblend(CRGB& existing, const CRGB& overlay, fract8 amount);
+CRGB blend(const CRGB& p1, const CRGB& p2, fract8 amount);
+CHSV blend(const CHSV& p1, const CHSV& p2, fract8 amount);
+void fill_solid(CRGB* leds, int numToFill, const CRGB& color);
+void fill_rainbow(CRGB* leds, int numToFill, uint8_t initialhue, uint8_t deltahue = 5);
+void fill_gradient_RGB(CRGB* leds, uint16_t startpos, CRGB startcolor, uint16_t endpos, CRGB endcolor);
+void nscale8(CRGB* leds, uint16_t num_leds, uint8_t scale);
+void fadeToBlackBy(CRGB* leds, uint16_t num_leds, uint8_t fadeBy);
+void fade_raw(CRGB* leds, uint16_t num_leds, uint8_t fadeBy);
+CRGB HeatColor(uint8_t temperature);
+
+//
+// palettes
+//
+typedef uint32_t TProgmemRGBPalette16[16];
+typedef const uint8_t* TProgmemRGBGradientPalettePtr;
+typedef const uint8_t TProgmemRGBGradientPalette_byte;
+typedef const uint8_t* TDynamicRGBGradientPalette_bytes;
+typedef enum { NOBLEND = 0, LINEARBLEND = 1 } TBlendType;
+typedef union {
+  struct { uint8_t index, r, g, b; };
+  uint32_t dword;
+  uint8_t bytes[4];
+} TRGBGradientPaletteEntryUnion;
+
+class CRGBPalette16 {
+  public:
+  CRGB entries[16];
+  CRGBPalette16() { for (CRGB& c : entries) c = CRGB(0, 0, 0); }
+  CRGBPalette16(const CRGB& c00, const CRGB& c01, const CRGB& c02, const CRGB& c03, const CRGB& c04, const CRGB& c05,
+                const CRGB& c06, const CRGB& c07, const CRGB& c08, const CRGB& c09, const CRGB& c10, const CRGB& c11,
+                const CRGB& c12, const CRGB& c13, const CRGB& c14, const CRGB& c15)
+    : entries{c00, c01, c02, c03, c04, c05, c06, c07, c08, c09, c10, c11, c12, c13, c14, c15} {}
+  CRGBPalette16(const CRGB rhs[16]) { memcpy(entries, rhs, sizeof(entries)); }
+  CRGBPalette16(const TProgmemRGBPalette16& rhs) { for (uint8_t i = 0; i < 16; i++) entries[i] = rhs[i]; }
+  CRGBPalette16(const CRGB& c1) { fill_solid(entries, 16, c1); }
+  CRGBPalette16(const CRGB& c1, const CRGB& c2) { fill_gradient_RGB(entries, 0, c1, 15, c2); }
+  CRGBPalette16(const CRGB& c1, const CRGB& c2, const CRGB& c3) {
+    fill_gradient_RGB(entries, 0, c1, 7, c2);
+    fill_gradient_RGB(entries, 7, c2, 15, c3);
+  }
+  CRGBPalette16(const CRGB& c1, const CRGB& c2, const CRGB& c3, const CRGB& c4) {
+    fill_gradient_RGB(entries, 0, c1, 5, c2);
+    fill_gradient_RGB(entries, 5, c2, 10, c3);
+    fill_gradient_RGB(entries, 10, c3, 15, c4);
+  }
+  CRGBPalette16(const CHSV& c1, const CHSV& c2, const CHSV& c3, const CHSV& c4) : CRGBPalette16(CRGB(c1), CRGB(c2), CRGB(c3), CRGB(c4)) {}
+  CRGBPalette16& operator=(const TProgmemRGBPalette16& rhs) { for (uint8_t i = 0; i < 16; i++) entries[i] = rhs[i]; return *this; }
+  CRGBPalette16& loadDynamicGradientPalette(TDynamicRGBGradientPalette_bytes gpal);
+  bool operator==(const CRGBPalette16& rhs) const { return memcmp(entries, rhs.entries, sizeof(entries)) == 0; }
+  bool operator!=(const CRGBPalette16& rhs) const { return !(*this == rhs); }
+  CRGB& operator[](uint8_t x) { return entries[x]; }
+  const CRGB& operator[](uint8_t x) const { return entries[x]; }
+};
+
+CRGB ColorFromPalette(const CRGBPalette16& pal, uint8_t index, uint8_t brightness = 255, TBlendType blendType = LINEARBLEND);
+void nblendPaletteTowardPalette(CRGBPalette16& currentPalette, CRGBPalette16& targetPalette, uint8_t maxChanges);
+
+extern const TProgmemRGBPalette16 CloudColors_p, LavaColors_p, OceanColors_p, ForestColors_p, RainbowColors_p,
+                                  RainbowStripeColors_p, PartyColors_p, HeatColors_p;
+
+// the FastLED controller object, the effects only clear the leds they were given anyway
+class CFastLED {
+  public:
+  void clear(bool = false) {}
+  void show() {}
+};
+extern CFastLED FastLED;
@@ -0,0 +1,14 @@
+#pragma once
+/*
+ * Host stand-in for src/dependencies/arti/arti_wled.h, copied next to FX.cpp's include of it.
+ * Custom effects need a program file, they are covered by arti_test. Here the custom effect renders black.
+ */
+
+float WS2812FX::arti_external_function(uint8_t function, float par1, float par2, float par3, float par4, float par5) { return floatNull; }
+float WS2812FX::arti_get_external_variable(uint8_t variable, float par1, float par2, float par3) { return floatNull; }
+void WS2812FX::arti_set_external_variable(float value, uint8_t variable, float par1, float par2, float par3) {}
+
+uint16_t WS2812FX::mode_customEffect(void) {
+  fill(BLACK);
+  return FRAMETIME;
+}
@@ -0,0 +1,143 @@
+#pragma once
+/*
+ * Host stand-in for bus_manager.h: the Bus interface WS2812FX uses and a capture bus which keeps the
+ * last frame in memory, so the harness can read back what the effects rendered.
+ */
+
+#include "Arduino.h"
+#include "const.h"
+#include <vector>
+
+#define DEBUG_PRINT(x)
+#define DEBUG_PRINTLN(x)
+#define DEBUG_PRINTF(x...)
+
+#define R(c) (byte((c) >> 16))
+#define G(c) (byte((c) >> 8))
+#define B(c) (byte(c))
+#define W(c) (byte((c) >> 24))
+#define GET_BIT(var,bit) (((var)>>(bit))&0x01)
+
+uint32_t colorBalanceFromKelvin(uint16_t kelvin, uint32_t rgb);
+
+struct BusConfig {
+  uint8_t type = TYPE_WS2812_RGB;
+  uint16_t count;
+  uint16_t start;
+  uint8_t colorOrder;
+  bool reversed;
+  uint8_t skipAmount;
+  bool refreshReq;
+  uint8_t pins[5] = {LEDPIN, 255, 255, 255, 255};
+  BusConfig(uint8_t busType, uint8_t* ppins, uint16_t pstart, uint16_t len = 1, uint8_t pcolorOrder = COL_ORDER_GRB, bool rev = false, uint8_t skip = 0) {
+    refreshReq = (bool) GET_BIT(busType,7);
+    type = busType & 0x7F;
+    count = len; start = pstart; colorOrder = pcolorOrder; reversed = rev; skipAmount = skip;
+    pins[0] = ppins[0];
+  }
+};
+
+class Bus {
+  public:
+    Bus(uint8_t type, uint16_t start) { _type = type; _start = start; }
+    virtual ~Bus() {}
+
+    virtual void     show() {}
+    virtual bool     canShow() { return true; }
+    virtual void     setPixelColor(uint16_t pix, uint32_t c) {}
+    virtual uint32_t getPixelColor(uint16_t pix) { return 0; }
+    virtual void     setBrightness(uint8_t b) {}
+    virtual uint8_t  getPins(uint8_t* pinArray) { return 0; }
+    virtual uint16_t getLength() { return _len; }
+    inline  uint16_t getStart() { return _start; }
+    inline  uint8_t  getType() { return _type; }
+    inline  bool     isOffRefreshRequired() { return _needsRefresh; }
+    virtual bool     isRgbw() { return Bus::isRgbw(_type); }
+    static  bool     isRgbw(uint8_t type) {
+      if (type == TYPE_SK6812_RGBW || type == TYPE_TM1814) return true;
+      if (type > TYPE_ONOFF && type <= TYPE_ANALOG_5CH && type != TYPE_ANALOG_3CH) return true;
+      return false;
+    }
+    static void setCCT(uint16_t cct) { _cct = cct; }
+    inline static void    setAutoWhiteMode(uint8_t m) { if (m < 4) _autoWhiteMode = m; }
+    inline static uint8_t getAutoWhiteMode() { return _autoWhiteMode; }
+
+    bool reversed = false;
+
+  protected:
+    uint8_t  _type = TYPE_NONE;
+    uint16_t _start = 0;
+    uint16_t _len = 1;
+    bool     _needsRefresh = false;
+    static uint8_t _autoWhiteMode;
+    static int16_t _cct;
+    static uint8_t _cctBlend;
+};
+
+// keeps the colors as set by WS2812FX (before brightness, which real busses apply on output)
+class BusCapture : public Bus {
+  public:
+  BusCapture(BusConfig &bc) : Bus(bc.type, bc.start), pixels(bc.count) { _len = bc.count; }
+  void     setPixelColor(uint16_t pix, uint32_t c) { if (pix < _len) pixels[pix] = c; }
+  uint32_t getPixelColor(uint16_t pix) { return pix < _len ? pixels[pix] : 0; }
+  void     setBrightness(uint8_t b) { bri = b; }
+  void     show() { shows++; }
+
+  std::vector<uint32_t> pixels;
+  uint8_t  bri = 255;
+  uint32_t shows = 0;
+};
+
+class BusManager {
+  public:
+  int add(BusConfig &bc) {
+    if (numBusses >= WLED_MAX_BUSSES) return -1;
+    busses[numBusses] = new BusCapture(bc);
+    return numBusses++;
+  }
+
+  void removeAll() {
+    for (uint8_t i = 0; i < numBusses; i++) delete busses[i];
+    numBusses = 0;
+  }
+
+  void show() { for (uint8_t i = 0; i < numBusses; i++) busses[i]->show(); }
+
+  void setPixelColor(uint16_t pix, uint32_t c, int16_t cct=-1) {
+    for (uint8_t i = 0; i < numBusses; i++) {
+      Bus* b = busses[i];
+      uint16_t bstart = b->getStart();
+      if (pix < bstart || pix >= bstart + b->getLength()) continue;
+      b->setPixelColor(pix - bstart, c);
+    }
+  }
+
+  void setBrightness(uint8_t b) { for (uint8_t i = 0; i < numBusses; i++) busses[i]->setBrightness(b); }
+
+  void setSegmentCCT(int16_t cct, bool allowWBCorrection = false) {
+    if (cct > 255) cct = 255;
+    if (cct >= 0) {
+      if (allowWBCorrection) cct = 1900 + (cct << 5);
+    } else cct = -1;
+    Bus::setCCT(cct);
+  }
+
+  uint32_t getPixelColor(uint16_t pix) {
+    for (uint8_t i = 0; i < numBusses; i++) {
+      Bus* b = busses[i];
+      uint16_t bstart = b->getStart();
+      if (pix < bstart || pix >= bstart + b->getLength()) continue;
+      return b->getPixelColor(pix - bstart);
+    }
+    return 0;
+  }
+
+  bool canAllShow() { return true; }
+  Bus* getBus(uint8_t busNr) { return busNr < numBusses ? busses[busNr] : nullptr; }
+  inline uint8_t getNumBusses() { return numBusses; }
+  inline bool hasOverlap() { return false; }
+
+  private:
+  uint8_t numBusses = 0;
+  Bus* busses[WLED_MAX_BUSSES];
+};
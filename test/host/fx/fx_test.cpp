@@ -0,0 +1,378 @@
+/*
+ * Runs the effects of FX.cpp through the effect benchmark of WS2812FX (startBenchmark() and service()),
+ * rendering onto a capture bus. FastLED is replaced by the stand-in of this directory.
+ *
+ * fx_test [--bench] [--frames N] [--json]
+ * fx_test --golden <expected dir> [--update]
+ * fx_test --record <dir> | --compare <dir> [--tolerance N]
+ * fx_test --crossfade
+ *   default    short runs on a 1D and a 2D segment: every mode is rendered, and no service() call renders more
+ *              than FX_BENCH_SLICE_FRAMES frames, so the main loop keeps running on a controller
+ *   --bench    ns per frame and per pixel of every mode on 1D 300, 1500, 8192 and 2D 16x16, 32x32, 64x64
+ *              segments, timed with the host clock. CSV on stdout, --json for JSON
+ *   --frames   frames per mode of --bench (default 200)
+ *   --golden   golden runs on the 1D and 2D segment, the hash of every mode against <expected dir>/<size>.txt.
+ *              Fails for modes which render different frames on the second run (static state)
+ *   --update   write the hashes of this build as expected hashes
+ *   --record   golden runs, all frames of every mode to <dir>/<size>.frames
+ *   --compare  golden runs, every channel of every frame against the frames recorded by --record, fails for
+ *              modes which differ by more than --tolerance (default 0), e.g. for a fixed point port
+ *   --crossfade  cross-fades between two effects which keep their state in leds[], the incoming one must show the
+ *              same frames after the fade as after an instant change
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "wled.h"
+
+uint64_t host::micros = 0;
+WS2812FX strip;
+BusManager busses;
+StaticJsonDocument<JSON_BUFFER_SIZE> doc;
+HostFS hostFS;
+bool autoSegments = false, correctWB = false, cctFromRgb = false, useMainSegmentOnly = false;
+byte realtimeMode = REALTIME_MODE_INACTIVE, sampleGain = 40, inputLevel = 128, lastRandomIndex = 0;
+
+// sound reactive globals of audio_reactive.h, silence unless scripted by a golden run
+int sampleRaw = 0, rawSampleAgc = 0;
+float sampleAvg = 0, sampleAgc = 0, sampleReal = 0, multAgc = 1.0f;
+bool samplePeak = false;
+uint8_t myVals[32];
+uint8_t squelch = 10, maxVol = 10, binNum = 8;
+byte soundSquelch = 10, soundAgc = 0;
+double FFT_MajorPeak = 0, FFT_Magnitude = 0;
+double fftBin[512];
+int fftResult[16];
+float fftAvg[16];
+
+uint32_t syncedMillis() { return millis(); }
+uint32_t get_millisecond_timer() { return strip.now; }
+// mode names only tell the load balancer which segments are audio reactive, it does not run while benchmarking
+uint8_t extractModeName(uint8_t mode, const char *src, char *dest, uint8_t maxLen) { dest[0] = '\0'; return 0; }
+
+// more than one slice, so resuming the clock and PRNG of a golden run between slices is covered
+#define GOLDEN_FRAMES (FX_BENCH_SLICE_FRAMES + 8)
+
+struct Size {
+  const char * name;
+  uint16_t width, height;
+};
+
+static const Size quick[] = {{"1d30", 30, 1}, {"2d8x8", 8, 8}};
+static const Size bench[] = {
+  {"1d300", 300, 1}, {"1d1500", 1500, 1}, {"1d8192", 8192, 1},
+  {"2d16x16", 16, 16}, {"2d32x32", 32, 32}, {"2d64x64", 64, 64},
+};
+
+// one capture bus and one segment covering it, 2D as a single matrix panel
+static void setup(const Size &size) {
+  busses.removeAll();
+  uint8_t pins[] = {2};
+  BusConfig bc(TYPE_WS2812_RGB, pins, 0, size.width * size.height, COL_ORDER_RGB);
+  busses.add(bc);
+  strip.stripOrMatrixPanel = size.height > 1;
+  strip.matrixWidth = size.width;
+  strip.matrixHeight = size.height;
+  strip.matrixPanels = strip.matrixHorizontalPanels = strip.matrixVerticalPanels = 1;
+  strip.finalizeInit();
+  strip.resetSegments();
+  strip.makeAutoSegments(true);
+  strip.setBrightness(255);
+}
+
+// runs the benchmark to the end, returns the number of service() calls it took
+static uint32_t runBenchmark(uint16_t frames) {
+  strip.startBenchmark(frames);
+  uint32_t calls = 0;
+  while (strip.isBenchmarkRunning()) {
+    strip.service();
+    calls++;
+    if (!host::wallClock) host::micros += 1000;
+  }
+  return calls;
+}
+
+// frames of a golden run, as kept by the benchmark callback
+struct Frame {
+  uint8_t mode;
+  uint16_t frame;
+  std::vector<uint32_t> pixels;
+};
+static std::vector<Frame> kept;
+
+static void keepFrame(uint8_t mode, uint16_t frame) {
+  BusCapture *bus = static_cast<BusCapture*>(busses.getBus(0));
+  kept.push_back({mode, frame, bus->pixels});
+}
+
+// golden run on a size, the benchmark seeds random() and random16 for every mode
+static void runGolden(const Size &size, bool keep) {
+  setup(size);
+  kept.clear();
+  strip.setBenchmarkCallback(keep ? keepFrame : nullptr);
+  strip.startBenchmark(GOLDEN_FRAMES, true);
+  while (strip.isBenchmarkRunning()) {
+    strip.service();
+    host::micros += 1000;
+  }
+  strip.setBenchmarkCallback(nullptr);
+}
+
+static std::string goldenHashes() {
+  std::ostringstream out;
+  char line[32];
+  for (uint8_t m = 0; m < strip.getModeCount(); m++) {
+    if (!strip.getGoldenHash(m)) continue; // not rendered, no times on the harness clock
+    snprintf(line, sizeof(line), "%u %08x\n", m, strip.getGoldenHash(m));
+    out << line;
+  }
+  return out.str();
+}
+
+// hashes of all modes against the expected file, lines of "<mode> <hash>"
+static int checkGolden(const Size &size, const std::string &dir, bool update) {
+  runGolden(size, false);
+  std::string hashes = goldenHashes();
+  std::string fileName = dir + "/" + size.name + ".txt";
+  if (update) {
+    std::ofstream(fileName) << hashes;
+    printf("%-6s written to %s\n", size.name, fileName.c_str());
+    return 0;
+  }
+  std::ifstream file(fileName);
+  if (!file) {
+    printf("%s: missing, run with --update\n", fileName.c_str());
+    return 1;
+  }
+  int failures = 0, compared = 0;
+  std::istringstream actual(hashes);
+  std::string expectedLine, actualLine;
+  while (true) {
+    bool e = (bool)std::getline(file, expectedLine), a = (bool)std::getline(actual, actualLine);
+    if (!e && !a) break;
+    unsigned em = 0, am = 0, eh = 0, ah = 0;
+    if (!e || !a || sscanf(expectedLine.c_str(), "%u %x", &em, &eh) != 2 || sscanf(actualLine.c_str(), "%u %x", &am, &ah) != 2 || em != am) {
+      printf("%s: modes differ, expected '%s', got '%s'\n", size.name, e ? expectedLine.c_str() : "", a ? actualLine.c_str() : "");
+      return failures + 1;
+    }
+    compared++;
+    if (!strip.isGoldenStable(am)) {
+      printf("%s: mode %u renders different frames on a second run\n", size.name, am);
+      failures++;
+    } else if (eh != ah) {
+      printf("%s: mode %u hash %08x, expected %08x\n", size.name, am, ah, eh);
+      failures++;
+    }
+  }
+  printf("%-6s %d modes against %s\n", size.name, compared, fileName.c_str());
+  if (compared < MODE_COUNT * 3 / 4) {
+    printf("%s: only %d modes rendered\n", size.name, compared);
+    failures++;
+  }
+  return failures;
+}
+
+// all frames as records of mode, frame, pixel count and pixels
+static int recordFrames(const Size &size, const std::string &dir) {
+  runGolden(size, true);
+  std::string fileName = dir + "/" + size.name + ".frames";
+  FILE *file = fopen(fileName.c_str(), "wb");
+  if (!file) {
+    printf("%s: can't write\n", fileName.c_str());
+    return 1;
+  }
+  for (const Frame &f : kept) {
+    uint32_t len = f.pixels.size();
+    fwrite(&f.mode, sizeof(f.mode), 1, file);
+    fwrite(&f.frame, sizeof(f.frame), 1, file);
+    fwrite(&len, sizeof(len), 1, file);
+    fwrite(f.pixels.data(), sizeof(uint32_t), len, file);
+  }
+  fclose(file);
+  printf("%-6s %zu frames written to %s\n", size.name, kept.size(), fileName.c_str());
+  return 0;
+}
+
+// largest difference of a channel per mode, against the recorded frames
+static int compareFrames(const Size &size, const std::string &dir, uint8_t tolerance) {
+  runGolden(size, true);
+  std::string fileName = dir + "/" + size.name + ".frames";
+  FILE *file = fopen(fileName.c_str(), "rb");
+  if (!file) {
+    printf("%s: missing, run with --record\n", fileName.c_str());
+    return 1;
+  }
+  int failures = 0, compared = 0;
+  uint8_t maxDiff[MODE_COUNT] = {0};
+  Frame recorded;
+  uint32_t len;
+  size_t i = 0;
+  while (fread(&recorded.mode, sizeof(recorded.mode), 1, file) == 1) {
+    if (fread(&recorded.frame, sizeof(recorded.frame), 1, file) != 1 || fread(&len, sizeof(len), 1, file) != 1) break;
+    recorded.pixels.resize(len);
+    if (fread(recorded.pixels.data(), sizeof(uint32_t), len, file) != len) break;
+    if (i >= kept.size() || kept[i].mode != recorded.mode || kept[i].frame != recorded.frame || kept[i].pixels.size() != len) {
+      printf("%s: frame %zu is not mode %u frame %u\n", size.name, i, recorded.mode, recorded.frame);
+      fclose(file);
+      return failures + 1;
+    }
+    for (uint32_t p = 0; p < len; p++) {
+      for (uint8_t b = 0; b < 32; b += 8) {
+        uint8_t d = abs((int)(uint8_t)(kept[i].pixels[p] >> b) - (int)(uint8_t)(recorded.pixels[p] >> b));
+        if (d > maxDiff[recorded.mode]) maxDiff[recorded.mode] = d;
+      }
+    }
+    i++;
+  }
+  fclose(file);
+  if (i != kept.size()) {
+    printf("%s: %zu frames recorded, %zu rendered\n", size.name, i, kept.size());
+    return failures + 1;
+  }
+  for (uint8_t m = 0; m < strip.getModeCount(); m++) {
+    if (!strip.getGoldenHash(m)) continue;
+    compared++;
+    if (maxDiff[m] > tolerance) {
+      printf("%s: mode %u differs by %u\n", size.name, m, maxDiff[m]);
+      failures++;
+    }
+  }
+  printf("%-6s %d modes within %u of %s\n", size.name, compared, tolerance, fileName.c_str());
+  return failures;
+}
+
+// mode change on the 2D segment at frame CROSSFADE_CHANGE, instant or as a cross-fade of transition ms.
+// Both effects draw trails into leds[] and use no random numbers, so their frames only depend on the clock and leds[].
+#define CROSSFADE_FROM   FX_MODE_2DFRIZZLES
+#define CROSSFADE_TO     FX_MODE_2DDNA
+#define CROSSFADE_STEP   50 // ms between frames, more than a frame time
+#define CROSSFADE_CHANGE 20
+#define CROSSFADE_FRAMES 60
+static std::vector<std::vector<uint32_t>> runModeChange(uint16_t transition) {
+  setup(quick[1]);
+  for (CRGB &led : strip.leds) led = CRGB::Black;
+  host::micros = 1000000;
+  strip.setTransition(0);
+  strip.setMode(0, CROSSFADE_FROM);
+  std::vector<std::vector<uint32_t>> frames;
+  for (uint16_t f = 0; f < CROSSFADE_FRAMES; f++) {
+    if (f == CROSSFADE_CHANGE) {
+      strip.setTransition(transition);
+      strip.setMode(0, CROSSFADE_TO);
+    }
+    strip.service();
+    frames.push_back(static_cast<BusCapture*>(busses.getBus(0))->pixels);
+    host::micros += CROSSFADE_STEP * 1000;
+  }
+  strip.setTransition(0);
+  return frames;
+}
+
+static int checkCrossfade() {
+  const uint16_t transition = 500;
+  std::vector<std::vector<uint32_t>> instant = runModeChange(0);
+  std::vector<std::vector<uint32_t>> faded = runModeChange(transition);
+  int failures = 0;
+  uint16_t first = CROSSFADE_CHANGE + transition / CROSSFADE_STEP; // first frame after the fade
+  for (uint16_t f = 0; f < CROSSFADE_FRAMES; f++) {
+    bool same = instant[f] == faded[f];
+    if (f < CROSSFADE_CHANGE && !same) {
+      printf("crossfade: frame %u before the mode change differs\n", f);
+      failures++;
+    } else if (f > CROSSFADE_CHANGE && f < first && same) {
+      printf("crossfade: frame %u is not faded\n", f);
+      failures++;
+    } else if (f >= first && !same) {
+      printf("crossfade: frame %u after the fade differs from an instant mode change\n", f);
+      failures++;
+    }
+  }
+  if (!failures) printf("crossfade %u -> %u, %u ms OK\n", CROSSFADE_FROM, CROSSFADE_TO, transition);
+  return failures;
+}
+
+int main(int argc, char **argv) {
+  bool benchmark = false, json = false, update = false, crossfade = false;
+  uint16_t frames = 0;
+  uint8_t tolerance = 0;
+  std::string golden, record, compare;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--bench") == 0) benchmark = true;
+    else if (strcmp(argv[i], "--json") == 0) json = true;
+    else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) frames = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--golden") == 0 && i + 1 < argc) golden = argv[++i];
+    else if (strcmp(argv[i], "--update") == 0) update = true;
+    else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) record = argv[++i];
+    else if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc) compare = argv[++i];
+    else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) tolerance = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--crossfade") == 0) crossfade = true;
+    else {
+      printf("usage: %s [--bench] [--frames N] [--json]\n", argv[0]);
+      printf("       %s --golden <expected dir> [--update]\n", argv[0]);
+      printf("       %s --record <dir> | --compare <dir> [--tolerance N]\n", argv[0]);
+      printf("       %s --crossfade\n", argv[0]);
+      return 2;
+    }
+  }
+
+  if (crossfade) return checkCrossfade() ? 1 : 0;
+
+  if (!golden.empty() || !record.empty() || !compare.empty()) {
+    int failures = 0;
+    for (const Size &size : quick) {
+      if (!golden.empty()) failures += checkGolden(size, golden, update);
+      else if (!record.empty()) failures += recordFrames(size, record);
+      else failures += compareFrames(size, compare, tolerance);
+    }
+    if (failures) return 1;
+    printf("fx golden OK\n");
+    return 0;
+  }
+
+  if (benchmark) {
+    host::wallClock = true;
+    if (!frames) frames = 200;
+    if (json) printf("[\n");
+    else printf("size,leds,mode,ns_frame,ns_pixel\n");
+    bool first = true;
+    for (const Size &size : bench) {
+      setup(size);
+      runBenchmark(frames);
+      uint32_t leds = size.width * size.height;
+      for (uint8_t m = 0; m < strip.getModeCount(); m++) {
+        uint32_t ns = strip.getBenchmarkResult(m);
+        if (!ns) continue;
+        if (json) printf("%s  {\"size\":\"%s\",\"leds\":%u,\"mode\":%u,\"ns_frame\":%u,\"ns_pixel\":%u}", first ? "" : ",\n", size.name, leds, m, ns, ns / leds);
+        else printf("%s,%u,%u,%u,%u\n", size.name, leds, m, ns, ns / leds);
+        first = false;
+      }
+    }
+    if (json) printf("\n]\n");
+    return 0;
+  }
+
+  // the harness clock stands still within service(), so only FX_BENCH_SLICE_FRAMES ends a slice
+  int failures = 0;
+  for (const Size &size : quick) {
+    setup(size);
+    uint32_t modes = runBenchmark(FX_BENCH_SLICE_FRAMES) - 1; // one slice per mode, one call to finish
+    uint32_t calls = runBenchmark(3 * FX_BENCH_SLICE_FRAMES);
+    printf("%-6s %u modes, %u service() calls for %u frames each\n", size.name, modes, calls, 3 * FX_BENCH_SLICE_FRAMES);
+    if (modes < MODE_COUNT * 3 / 4) {
+      printf("%s: only %u modes rendered\n", size.name, modes);
+      failures++;
+    }
+    if (calls != 3 * modes + 1) {
+      printf("%s: expected %u service() calls, at most %u frames per call\n", size.name, 3 * modes + 1, FX_BENCH_SLICE_FRAMES);
+      failures++;
+    }
+  }
+
+  if (failures) return 1;
+  printf("fx benchmark OK\n");
+  return 0;
+}
@@ -0,0 +1,49 @@
+#pragma once
+/*
+ * Host stand-in for wled.h, just enough to compile FX.cpp and FX_fcn.cpp.
+ * FastLED is replaced by FastLED.h of this directory, the busses by the capture busses of bus_manager.h.
+ */
+
+#include "Arduino.h"
+
+#define IRAM_ATTR
+
+#define ARDUINOJSON_ENABLE_ARDUINO_STRING 0
+#define ARDUINOJSON_ENABLE_ARDUINO_STREAM 0
+#define ARDUINOJSON_ENABLE_ARDUINO_PRINT 0
+#define ARDUINOJSON_ENABLE_PROGMEM 0
+#include "src/dependencies/json/ArduinoJson-v6.h"
+#include "const.h"
+#include "FX.h"
+#include "bus_manager.h"
+
+// no ledmap files on the host
+class HostFS {
+  public:
+  bool exists(const char*) { return false; }
+};
+extern HostFS hostFS;
+#define WLED_FS hostFS
+
+extern WS2812FX strip;
+extern BusManager busses;
+extern StaticJsonDocument<JSON_BUFFER_SIZE> doc;
+extern bool autoSegments, correctWB, cctFromRgb, useMainSegmentOnly;
+extern byte realtimeMode, sampleGain, inputLevel, lastRandomIndex;
+
+//colors.cpp
+void colorHStoRGB(uint16_t hue, byte sat, byte* rgb);
+void colorKtoRGB(uint16_t kelvin, byte* rgb);
+void colorCTtoRGB(uint16_t mired, byte* rgb);
+void colorXYtoRGB(float x, float y, byte* rgb);
+void colorRGBtoXY(byte* rgb, float* xy);
+void colorFromDecOrHexString(byte* rgb, char* in);
+bool colorFromHexString(byte* rgb, const char* in);
+uint16_t approximateKelvinFromRGB(uint32_t rgb);
+void setRandomColor(byte* rgb);
+
+uint32_t syncedMillis();
+uint8_t extractModeName(uint8_t mode, const char *src, char *dest, uint8_t maxLen);
+inline bool requestJSONBufferLock(uint8_t module=255) { return true; }
+inline void releaseJSONBufferLock() {}
+inline bool readObjectFromFile(const char* file, const char* key, JsonDocument* dest) { return false; }
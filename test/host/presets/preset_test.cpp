@@ -0,0 +1,330 @@
+/*
+ * Applies presets through applyPreset() of presets.cpp, once from presets.json through deserializeState() and
+ * deserializeSegment() and once from the binary snapshot compiled on the first run, from the same start state,
+ * and compares the resulting segments and state. presets.json is kept in memory, every read is counted.
+ * Also checks that saved, deleted and replaced presets are read from the file again.
+ */
+
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "wled.h"
+
+uint64_t host::micros = 0;
+WS2812FX strip;
+BusManager busses;
+StaticJsonDocument<JSON_BUFFER_SIZE> doc;
+HostFS hostFS;
+bool autoSegments = false, correctWB = false, cctFromRgb = false, useMainSegmentOnly = false;
+byte realtimeMode = REALTIME_MODE_INACTIVE, sampleGain = 40, inputLevel = 128, lastRandomIndex = 0;
+
+// sound reactive globals of audio_reactive.h, FX.cpp links against them
+int sampleRaw = 0, rawSampleAgc = 0;
+float sampleAvg = 0, sampleAgc = 0, sampleReal = 0, multAgc = 1.0f;
+bool samplePeak = false;
+uint8_t myVals[32];
+uint8_t squelch = 10, maxVol = 10, binNum = 8;
+byte soundSquelch = 10, soundAgc = 0;
+double FFT_MajorPeak = 0, FFT_Magnitude = 0;
+double fftBin[512];
+int fftResult[16];
+float fftAvg[16];
+
+JsonDocument* fileDoc = nullptr;
+byte bri = 128, briLast = 128, currentPreset = 0, errorFlag = ERR_NONE, interfaceUpdateCallMode = 0;
+byte presetCycCurr = 1, presetCycMin = 1, presetCycMax = 5;
+byte nightlightDelayMins = 60, nightlightMode = NL_MODE_FADE, nightlightTargetBri = 0, realtimeOverride = 0;
+uint16_t udpPort = 21324;
+bool stateChanged = false, jsonTransitionOnce = false, nightlightActive = false, notifyDirect = false, receiveNotifications = true;
+bool doReboot = false, syncToggleReceive = true, clockSyncEnabled = false, nodeListEnabled = false;
+int8_t loadLedmap = -1, currentPlaylist = -1;
+uint16_t transitionDelay = 700, transitionDelayTemp = 700;
+unsigned long presetsModifiedTime = 0, nightlightDelayMs = 10, nightlightStartTime = 0;
+uint32_t e131FramesComplete = 0, e131FramesIncomplete = 0, e131FramesLate = 0, fsBytesUsed = 0, fsBytesTotal = 0, rolloverMillis = 0;
+IPAddress realtimeIP;
+char versionString[] = "host", serverDescription[] = "WLED", escapedMac[] = "000000000000";
+HostWiFi WiFi;
+HostESP ESP;
+HostNetwork Network;
+NodesMap Nodes;
+UsermodManager usermods;
+HostToki toki;
+
+uint32_t syncedMillis() { return millis(); }
+uint32_t get_millisecond_timer() { return strip.now; }
+uint8_t extractModeName(uint8_t mode, const char *src, char *dest, uint8_t maxLen) { dest[0] = '\0'; return 0; }
+
+// presets.json, object text by id
+static std::map<uint16_t, std::string> presetsFile;
+static unsigned presetReads = 0;
+
+bool writeObjectToFileUsingId(const char* file, uint16_t id, JsonDocument* content)
+{
+  if (strcmp(file, "/presets.json")) return true;
+  if (content->as<JsonObject>().size() == 0) presetsFile.erase(id);
+  else {
+    std::string text;
+    serializeJson(*content, text);
+    presetsFile[id] = text;
+  }
+  return true;
+}
+
+bool readObjectFromFileUsingId(const char* file, uint16_t id, JsonDocument* dest)
+{
+  if (strcmp(file, "/presets.json")) return false;
+  presetReads++;
+  auto preset = presetsFile.find(id);
+  if (preset == presetsFile.end()) return false;
+  return deserializeJson(*dest, preset->second) == DeserializationError::Ok;
+}
+
+// the JSON buffer is never busy here, work deferred by savePreset() runs when the harness calls runDeferred()
+static std::vector<std::pair<void (*)(uint32_t), uint32_t>> deferred;
+bool tryJSONBufferLock(uint8_t module) { return true; }
+JsonDocument* requestJSONBuffer(uint8_t module, uint16_t waitMs) { return &doc; }
+void releaseJSONBuffer(JsonDocument* pDoc) {}
+bool deferJSONWork(void (*fn)(uint32_t), uint32_t arg) { deferred.push_back({fn, arg}); return true; }
+static void runDeferred()
+{
+  std::vector<std::pair<void (*)(uint32_t), uint32_t>> pending;
+  pending.swap(deferred);
+  for (auto &work : pending) work.first(work.second);
+}
+void serializeJSONBufferStats(JsonObject root) {}
+
+bool handleFileRead(AsyncWebServerRequest*, String path) { return false; }
+void updateFSInfo() {}
+
+// led.cpp
+void toggleOnOff()
+{
+  if (bri == 0) bri = briLast;
+  else {
+    briLast = bri;
+    bri = 0;
+  }
+}
+byte scaledBri(byte in) { return in; }
+
+// what stateUpdated() was called with, the notifications it would send depend on nothing else
+static byte updatedCallMode = 0;
+static bool updatedChanged = false;
+static unsigned updates = 0;
+void stateUpdated(byte callMode)
+{
+  updatedCallMode = callMode;
+  updatedChanged = stateChanged;
+  updates++;
+  if (stateChanged) currentPreset = 0;
+  stateChanged = false;
+  if (bri > 0) briLast = bri;
+}
+
+void parseNumber(const char* str, byte* val, byte minv, byte maxv) { *val = atoi(str); }
+bool handleSet(AsyncWebServerRequest* request, const String& req, bool apply) { return false; }
+void setTimeFromAPI(uint32_t timein) {}
+void unloadPlaylist() { currentPlaylist = -1; }
+bool loadPlaylist(JsonObject playlistObject, byte presetId) { return false; }
+void realtimeLock(uint32_t timeoutMs, byte md) { realtimeMode = md; }
+void exitRealtime() { realtimeMode = REALTIME_MODE_INACTIVE; }
+void serializeClockSync(JsonObject root) {}
+void serializeRealtimeStats(JsonObject root) {}
+uint32_t getUdpQueueDropped() { return 0; }
+
+#define LED_COUNT 60
+
+static void setupStrip()
+{
+  uint8_t pins[] = {2};
+  BusConfig bc(TYPE_WS2812_RGB, pins, 0, LED_COUNT);
+  busses.add(bc);
+  strip.finalizeInit();
+  strip.resetSegments();
+  strip.setBrightness(255);
+}
+
+// state set up before each preset is applied, as JSON for deserializeState()
+static const char* startStates[] = {
+  // one segment, on
+  R"({"on":true,"bri":200,"transition":7,"mainseg":0,"seg":[{"id":0,"start":0,"stop":60,"fx":0,"sx":128,"ix":128,"pal":0,"col":[[255,160,0],[0,0,0],[0,0,0]],"sel":true},{"id":1,"stop":0},{"id":2,"stop":0}]})",
+  // off, three segments with names, other options
+  R"({"on":false,"bri":90,"transition":0,"mainseg":1,"seg":[{"id":0,"start":0,"stop":20,"n":"left","fx":9,"rev":true,"frz":true,"col":[[1,2,3],[4,5,6],[7,8,9]]},{"id":1,"start":20,"stop":40,"n":"middle","grp":2,"spc":1,"of":3,"bri":0,"mi":true,"cct":40},{"id":2,"start":40,"stop":60,"fx":2,"pal":6,"c1x":10,"c2x":20,"c3x":30,"sel":false}]})",
+};
+
+// presets as savePreset() writes them (a copy of the state) and as written by hand or by older versions
+struct Preset {
+  uint8_t id;
+  const char* state; // applied before saving, nullptr if json is the preset
+  const char* json;
+  bool snapshot;     // expected to be applied from a snapshot
+};
+static const Preset presets[] = {
+  {1, R"({"on":true,"bri":255,"transition":3,"seg":[{"id":0,"start":0,"stop":30,"n":"first","fx":8,"sx":30,"ix":220,"pal":11,"col":[[0,0,255],[255,0,0],[0,255,0]],"rev":true,"sel":true},{"id":1,"start":30,"stop":60,"fx":0,"grp":3,"spc":2,"of":-4,"bri":120,"col":[[10,20,30],[0,0,0],[0,0,0]]}]})", nullptr, true},
+  {2, R"({"on":false,"bri":40,"transition":12,"mainseg":2,"seg":[{"id":0,"start":0,"stop":10},{"id":1,"stop":0},{"id":2,"start":10,"stop":60,"n":"rest","fx":66,"c1x":1,"c2x":2,"c3x":3,"rot2D":true,"rev2D":true,"frz":true,"on":false}]})", nullptr, true},
+  {3, nullptr, R"({"n":"brightness","bri":30})", true},
+  {4, nullptr, R"({"n":"off","on":false,"transition":0})", true},
+  {5, nullptr, R"({"n":"segments","seg":[{"stop":0},{"id":2,"stop":0},{"id":1,"start":5,"stop":15,"grp":1,"spc":0,"of":0,"on":true,"frz":false,"bri":255,"cct":127,"col":[[],[9,9,9],[]],"fx":1,"sx":1,"ix":2,"c1x":3,"c2x":4,"c3x":5,"pal":7,"sel":true,"rev":false,"rev2D":false,"mi":false,"rot2D":false}]})", true},
+  // applied as JSON every time: a nested preset, a toggle, a single segment object and a hex color
+  {6, nullptr, R"({"n":"nested","bri":10,"ps":3})", false},
+  {7, nullptr, R"({"n":"toggle","on":"t"})", false},
+  {8, nullptr, R"({"n":"selected","seg":{"fx":5}})", false},
+  {9, nullptr, R"({"n":"hex","seg":[{"id":0,"start":0,"stop":60,"grp":1,"spc":0,"of":0,"on":true,"frz":false,"bri":255,"cct":127,"col":["FF0000",[],[]],"fx":0,"sx":128,"ix":128,"c1x":0,"c2x":0,"c3x":0,"pal":0,"sel":true,"rev":false,"rev2D":false,"mi":false,"rot2D":false}]})", false},
+};
+
+static void applyState(const char* json)
+{
+  DynamicJsonDocument state(JSON_BUFFER_SIZE);
+  deserializeJson(state, json);
+  deserializeState(state.as<JsonObject>(), CALL_MODE_INIT);
+}
+
+static void setStartState(const char* json)
+{
+  strip.resetSegments();
+  currentPreset = 0;
+  currentPlaylist = -1;
+  applyState(json);
+  strip.setTransition(0);
+  strip.service(); // end transitions
+  stateChanged = false;
+  updates = 0;
+}
+
+// everything a preset may change: the full state with all segments (also inactive ones) and the globals stateUpdated() gets
+static std::string describeState()
+{
+  DynamicJsonDocument state(JSON_BUFFER_SIZE);
+  JsonObject root = state.to<JsonObject>();
+  byte error = errorFlag;
+  serializeState(root, false, true, true, true);
+  JsonArray all = root.createNestedArray("all");
+  for (byte s = 0; s < strip.getMaxSegments(); s++) {
+    JsonObject seg = all.createNestedObject();
+    serializeSegment(seg, strip.getSegment(s), s, false, true);
+  }
+  root["briLast"] = briLast;
+  root["bri"] = bri;
+  root["tr"] = transitionDelay;
+  root["trTemp"] = transitionDelayTemp;
+  root["ledmap"] = loadLedmap;
+  root["input"] = inputLevel;
+  root["preset"] = currentPreset;
+  root["error"] = error;
+  root["ui"] = interfaceUpdateCallMode;
+  root["updates"] = updates;
+  root["callMode"] = updatedCallMode;
+  root["changed"] = updatedChanged;
+  std::string text;
+  serializeJson(state, text);
+  return text;
+}
+
+// first difference of two describeState() texts
+static void showDifference(const std::string &expected, const std::string &output)
+{
+  size_t i = 0;
+  while (i < expected.size() && i < output.size() && expected[i] == output[i]) i++;
+  size_t from = i > 40 ? i - 40 : 0;
+  printf("  json     ...%s\n  snapshot ...%s\n", expected.substr(from, 100).c_str(), output.substr(from, 100).c_str());
+}
+
+// applies a preset from the given start state, reports if it was read from the file
+static std::string applyFrom(const char* start, uint8_t id, bool &read)
+{
+  setStartState(start);
+  unsigned reads = presetReads;
+  applyPreset(id, CALL_MODE_BUTTON_PRESET);
+  read = presetReads != reads;
+  return describeState();
+}
+
+int main()
+{
+  setupStrip();
+  int failures = 0;
+
+  // write presets.json: saved from a state like the UI does, or as given
+  for (const Preset &preset : presets) {
+    if (preset.state) {
+      applyState(preset.state);
+      char name[12];
+      snprintf(name, sizeof(name), "Preset %d", preset.id);
+      savePreset(preset.id, name);
+    } else {
+      DynamicJsonDocument json(JSON_BUFFER_SIZE);
+      deserializeJson(json, preset.json);
+      writeObjectToFileUsingId("/presets.json", preset.id, &json);
+    }
+  }
+  runDeferred(); // snapshots of saved presets are compiled here
+
+  for (const Preset &preset : presets) {
+    for (const char* start : startStates) {
+      bool read;
+      invalidatePresetSnapshots(); // as after an upload, the first apply reads the file
+      std::string json = applyFrom(start, preset.id, read);
+      if (!read) {
+        printf("preset %d: not read from presets.json after the snapshots were dropped\n", preset.id);
+        failures++;
+      }
+      std::string snapshot = applyFrom(start, preset.id, read);
+      if (read == preset.snapshot) {
+        printf("preset %d: %s\n", preset.id, preset.snapshot ? "read from presets.json again, no snapshot" : "applied from a snapshot");
+        failures++;
+      }
+      if (snapshot != json) {
+        printf("preset %d: state differs after applying the snapshot\n", preset.id);
+        showDifference(json, snapshot);
+        failures++;
+      }
+    }
+  }
+
+  // snapshots follow the file: a saved, a deleted and a replaced preset are read again
+  bool read;
+  applyFrom(startStates[0], 1, read);
+  applyState(R"({"bri":17})");
+  savePreset(1, "again");
+  applyFrom(startStates[0], 1, read);
+  if (!read || bri != 17) {
+    printf("preset 1: saved again, but %s\n", read ? "the old state was applied" : "not read from presets.json");
+    failures++;
+  }
+  runDeferred();
+  applyFrom(startStates[0], 1, read);
+  if (read || bri != 17) {
+    printf("preset 1: saved again, but the snapshot %s\n", read ? "was not compiled" : "has the old state");
+    failures++;
+  }
+
+  applyFrom(startStates[0], 3, read);
+  {
+    DynamicJsonDocument state(JSON_BUFFER_SIZE);
+    deserializeJson(state, R"({"pdel":3})");
+    deserializeState(state.as<JsonObject>(), CALL_MODE_DIRECT_CHANGE);
+  }
+  errorFlag = ERR_NONE;
+  if (applyPreset(3)) {
+    printf("preset 3: applied after it was deleted\n");
+    failures++;
+  }
+
+  applyFrom(startStates[0], 4, read);
+  presetsFile[4] = R"({"n":"uploaded","bri":66})"; // replaced behind presets.cpp, e.g. by /edit
+  invalidatePresetSnapshots();
+  applyFrom(startStates[0], 4, read);
+  if (!read || bri != 66) {
+    printf("preset 4: replaced, but %s\n", read ? "the old state was applied" : "not read from presets.json");
+    failures++;
+  }
+
+  if (failures) {
+    printf("%d preset check(s) failed\n", failures);
+    return 1;
+  }
+  printf("presets OK\n");
+  return 0;
+}
@@ -0,0 +1,204 @@
+#pragma once
+/*
+ * Host stand-in for wled.h, just enough to compile json.cpp and presets.cpp on top of the FX harness.
+ * presets.json is kept in memory by the harness, the web server and network parts of json.cpp are stubs.
+ */
+
+#include "../fx/wled.h"
+#include <functional>
+#include <map>
+
+// the Arduino String of the shim is a std::string, ArduinoJson takes it like one
+namespace ARDUINOJSON_NAMESPACE {
+template <> struct IsString<::String> : true_type {};
+inline StdStringAdapter<std::string> adaptString(const ::String& str) { return StdStringAdapter<std::string>(str); }
+}
+
+#ifndef __GLIBC_PREREQ
+  #define __GLIBC_PREREQ(a, b) 0
+#endif
+#if !__GLIBC_PREREQ(2, 38)
+inline size_t strlcpy(char* dst, const char* src, size_t size)
+{
+  size_t len = strlen(src);
+  if (size) {
+    size_t n = len < size - 1 ? len : size - 1;
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+  }
+  return len;
+}
+#endif
+
+#define WLED_PRESET_SNAPSHOTS 1
+#define VERSION 2211010
+#define LWIP_VERSION_MAJOR 2
+#define DEBUGFS_PRINT(x)
+#define DEBUGFS_PRINTLN(x)
+#define DEBUGFS_PRINTF(x...)
+
+class IPAddress {
+  uint8_t _b[4] = {0, 0, 0, 0};
+  public:
+  uint8_t operator[](int i) const { return _b[i]; }
+  String toString() const { return String("0.0.0.0"); }
+};
+
+class BusNetwork : public Bus {
+  public:
+  IPAddress getClient() { return IPAddress(); }
+  uint32_t getSendMicros() { return 0; }
+  uint32_t getSendFrames() { return 0; }
+  uint32_t getSendErrors() { return 0; }
+};
+
+// the parts of the web server json.cpp refers to, never called by the harness
+class AsyncWebParameter {
+  public:
+  const String& value() const { return _value; }
+  private:
+  String _value;
+};
+class AsyncWebServerResponse {
+  public:
+  virtual ~AsyncWebServerResponse() {}
+};
+class AsyncJsonResponse : public AsyncWebServerResponse {
+  public:
+  AsyncJsonResponse(JsonDocument* doc) : _doc(doc) {}
+  JsonObject getRoot() { return _doc->to<JsonObject>(); }
+  void setLength() {}
+  private:
+  JsonDocument* _doc;
+};
+typedef std::function<size_t(uint8_t*, size_t, size_t)> AwsResponseFiller;
+#define RESPONSE_TRY_AGAIN 0xFFFFFFFF
+class AsyncWebServerRequest {
+  public:
+  const String& url() const { return _url; }
+  bool hasParam(const char*) const { return false; }
+  AsyncWebParameter* getParam(const char*) { return &_param; }
+  void send(int, const char*, const char*) {}
+  void send(AsyncWebServerResponse* response) { delete response; }
+  void send_P(int, const char*, const char*) {}
+  AsyncWebServerResponse* beginChunkedResponse(const char*, AwsResponseFiller) { return new AsyncWebServerResponse(); }
+  private:
+  String _url;
+  AsyncWebParameter _param;
+};
+
+class HostWiFi {
+  public:
+  String BSSIDstr() { return String(); }
+  int RSSI() { return 0; }
+  int channel() { return 0; }
+};
+extern HostWiFi WiFi;
+class HostESP {
+  public:
+  const char* getCoreVersion() { return "host"; }
+  uint32_t getFreeHeap() { return 0; }
+};
+extern HostESP ESP;
+class HostNetwork {
+  public:
+  bool isConnected() { return false; }
+  IPAddress localIP() { return IPAddress(); }
+};
+extern HostNetwork Network;
+
+struct NodeStruct {
+  String nodeName;
+  IPAddress ip;
+  uint8_t age, nodeType;
+  uint32_t build;
+};
+typedef std::map<uint8_t, NodeStruct> NodesMap;
+extern NodesMap Nodes;
+
+class UsermodManager {
+  public:
+  void readFromJsonState(JsonObject) {}
+  void addToJsonState(JsonObject) {}
+  void addToJsonInfo(JsonObject) {}
+};
+extern UsermodManager usermods;
+
+class JsonStreamer {
+  public:
+    JsonStreamer(uint8_t content) : _content(content) {}
+    ~JsonStreamer() { free(_part); }
+    size_t read(uint8_t* dest, size_t maxLen);
+    size_t length();
+    bool done() const { return _step == JSON_STREAM_DONE && _srcPos >= _srcLen; }
+  private:
+    bool nextPart();
+    bool buildPart(uint8_t step, bool comma);
+    void setSource(const char* src, size_t len, bool flash);
+    uint8_t _content;
+    uint8_t _step = 0;
+    uint8_t _seg = 0;
+    bool _comma = false;
+    char* _part = nullptr;
+    const char* _src = nullptr;
+    bool _srcFlash = false;
+    size_t _srcLen = 0;
+    size_t _srcPos = 0;
+};
+
+extern JsonDocument* fileDoc;
+extern byte bri, briLast, currentPreset, errorFlag, interfaceUpdateCallMode, presetCycCurr, presetCycMin, presetCycMax;
+extern byte nightlightDelayMins, nightlightMode, nightlightTargetBri, realtimeOverride, soundAgc;
+extern uint16_t udpPort;
+extern bool stateChanged, jsonTransitionOnce, nightlightActive, notifyDirect, receiveNotifications, doReboot;
+extern bool syncToggleReceive, clockSyncEnabled, nodeListEnabled;
+extern int8_t loadLedmap, currentPlaylist;
+extern uint16_t transitionDelay, transitionDelayTemp;
+extern unsigned long presetsModifiedTime, nightlightDelayMs, nightlightStartTime;
+extern uint32_t e131FramesComplete, e131FramesIncomplete, e131FramesLate, fsBytesUsed, fsBytesTotal, rolloverMillis;
+extern IPAddress realtimeIP;
+extern char versionString[], serverDescription[], escapedMac[];
+
+//json.cpp
+void deserializeSegment(JsonObject elem, byte it, byte presetId = 0);
+bool deserializeState(JsonObject root, byte callMode = CALL_MODE_DIRECT_CHANGE, byte presetId = 0);
+void serializeSegment(JsonObject& root, WS2812FX::Segment& seg, byte id, bool forPreset = false, bool segmentBounds = true);
+void serializeState(JsonObject root, bool forPreset = false, bool includeBri = true, bool segmentBounds = true, bool includeSegments = true);
+void serializeInfo(JsonObject root);
+void serveJson(AsyncWebServerRequest* request);
+
+//presets.cpp
+bool applyPreset(byte index, byte callMode = CALL_MODE_DIRECT_CHANGE);
+void savePreset(byte index, const char* pname = nullptr, JsonObject saveobj = JsonObject());
+void deletePreset(byte index);
+void invalidatePresetSnapshots();
+
+// the harness, presets.json in memory, state changes recorded
+bool tryJSONBufferLock(uint8_t module = 255);
+JsonDocument* requestJSONBuffer(uint8_t module = 255, uint16_t waitMs = 0);
+void releaseJSONBuffer(JsonDocument* pDoc);
+bool deferJSONWork(void (*fn)(uint32_t), uint32_t arg);
+void serializeJSONBufferStats(JsonObject root);
+bool writeObjectToFileUsingId(const char* file, uint16_t id, JsonDocument* content);
+bool readObjectFromFileUsingId(const char* file, uint16_t id, JsonDocument* dest);
+bool handleFileRead(AsyncWebServerRequest*, String path);
+void updateFSInfo();
+void toggleOnOff();
+byte scaledBri(byte in);
+void stateUpdated(byte callMode);
+void parseNumber(const char* str, byte* val, byte minv = 0, byte maxv = 255);
+bool handleSet(AsyncWebServerRequest* request, const String& req, bool apply = true);
+void setTimeFromAPI(uint32_t timein);
+void unloadPlaylist();
+bool loadPlaylist(JsonObject playlistObject, byte presetId = 0);
+void realtimeLock(uint32_t timeoutMs, byte md = REALTIME_MODE_GENERIC);
+void exitRealtime();
+void serializeClockSync(JsonObject root);
+void serializeRealtimeStats(JsonObject root);
+uint32_t getUdpQueueDropped();
+
+class HostToki {
+  public:
+  uint32_t second() { return millis() / 1000; }
+};
+extern HostToki toki;
@@ -0,0 +1,54 @@
+#pragma once
+/*
+ * Host stand-in for the AsyncUDP of the ESP32 core. There is no socket: a listener registers its port and
+ * hostUdpDeliver() calls its packet handler with a datagram, like the AsyncUDP task does for a received one.
+ */
+
+#include <functional>
+#include <cstddef>
+#include "WiFi.h"
+
+class AsyncUDPPacket {
+  uint8_t* _data;
+  size_t _len;
+  uint16_t _localPort;
+  IPAddress _remoteIP;
+  public:
+  AsyncUDPPacket(uint8_t* data, size_t len, uint16_t localPort, IPAddress remoteIP)
+    : _data(data), _len(len), _localPort(localPort), _remoteIP(remoteIP) {}
+  uint8_t* data() { return _data; }
+  size_t length() { return _len; }
+  uint16_t localPort() { return _localPort; }
+  IPAddress remoteIP() { return _remoteIP; }
+};
+
+typedef std::function<void(AsyncUDPPacket)> AuPacketHandlerFunction;
+
+class AsyncUDP {
+  uint16_t _port = 0;
+  AuPacketHandlerFunction _handler;
+  AsyncUDP* _next = nullptr;
+  static AsyncUDP*& listeners() { static AsyncUDP* first = nullptr; return first; }
+  public:
+  ~AsyncUDP() { for (AsyncUDP** l = &listeners(); *l; l = &(*l)->_next) if (*l == this) { *l = _next; break; } }
+  bool listen(uint16_t port) {
+    _port = port;
+    _next = listeners();
+    listeners() = this;
+    return true;
+  }
+  bool listenMulticast(const IPAddress&, uint16_t port) { return listen(port); }
+  void onPacket(AuPacketHandlerFunction handler) { _handler = handler; }
+
+  // data must hold at least sizeof(e131_packet_t) bytes, parsers read the whole packet union
+  static bool deliver(uint16_t port, uint8_t* data, size_t len, IPAddress from) {
+    for (AsyncUDP* l = listeners(); l; l = l->_next) {
+      if (l->_port != port || !l->_handler) continue;
+      l->_handler(AsyncUDPPacket(data, len, port, from));
+      return true;
+    }
+    return false;
+  }
+};
+
+inline bool hostUdpDeliver(uint16_t port, uint8_t* data, size_t len, IPAddress from) { return AsyncUDP::deliver(port, data, len, from); }
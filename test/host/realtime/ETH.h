@@ -0,0 +1,2 @@
+#pragma once
+// Host stand-in for the ETH.h of the ESP32 core, nothing is used
@@ -0,0 +1,15 @@
+#pragma once
+// Host stand-in for the WiFi.h of the ESP32 core, only IPAddress
+
+#include <cstdint>
+
+class IPAddress {
+  uint8_t _b[4] = {0, 0, 0, 0};
+  public:
+  IPAddress() {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _b{a, b, c, d} {}
+  IPAddress(uint32_t address) { for (int i = 0; i < 4; i++) _b[i] = address >> (8 * i); } // network order like lwIP
+  operator uint32_t() const { return _b[0] | _b[1] << 8 | _b[2] << 16 | (uint32_t)_b[3] << 24; }
+  uint8_t operator[](int i) const { return _b[i]; }
+  bool operator==(const IPAddress& o) const { return (uint32_t)*this == (uint32_t)o; }
+};
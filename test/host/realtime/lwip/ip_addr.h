@@ -0,0 +1,7 @@
+#pragma once
+// Host stand-in for lwIP addresses and byte order
+
+#include <arpa/inet.h>
+#include <cstdint>
+
+typedef struct { uint32_t addr; } ip4_addr_t;
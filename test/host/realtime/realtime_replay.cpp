@@ -0,0 +1,367 @@
+/*
+ * Replays synthetic E1.31, Art-Net and DDP streams through ESPAsyncE131::parsePacket() and e131.cpp at a set
+ * frame rate, with the loop of handleNotifications() showing a frame whenever e131NewData is set.
+ * Every pixel carries the number of the source frame it belongs to, so each shown frame can be checked:
+ * complete (all leds from one source frame) or torn (leds from different frames).
+ * Throughput and cost per packet are wall clock times of the packet handler on this machine.
+ *
+ * realtime_replay [--fps N]
+ *   --fps  replay all streams at N frames per second, the checks still apply
+ */
+
+#include "wled.h"
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace host { uint64_t micros = 0; }
+HostStrip strip;
+
+uint16_t e131Universe = 1;
+byte DMXMode = DMX_MODE_MULTIPLE_RGB;
+uint16_t DMXAddress = 1;
+byte DMXOldDimmer = 0;
+byte e131LastSequenceNumber[E131_MAX_UNIVERSE_COUNT];
+bool e131SkipOutOfSequence = false;
+uint16_t e131FrameTimeout = 50;
+bool e131NewData = false;
+uint32_t e131FramesComplete = 0, e131FramesIncomplete = 0, e131FramesLate = 0;
+IPAddress realtimeIP;
+bool realtimeOverride = false;
+uint32_t realtimeTimeoutMs = 2500;
+byte bri = 128, effectCurrent = 0, effectSpeed = 128, effectIntensity = 128, effectPalette = 0;
+byte col[4], colSec[4];
+uint16_t transitionDelayTemp = 0;
+
+#include "src/dependencies/network/Network.h"
+NetworkClass Network;
+IPAddress NetworkClass::localIP() { return IPAddress(192, 168, 1, 2); }
+
+static ESPAsyncE131 e131(handleE131Packet), artnet(handleE131Packet), ddp(handleE131Packet);
+static const IPAddress sender(192, 168, 1, 10);
+
+// capture bus: the source frame every led was last written by, 0 before the first write
+static std::vector<uint16_t> bus;
+
+void realtimeLock(uint32_t, byte) {}
+void setRealtimePixel(uint16_t i, byte r, byte g, byte, byte) {
+  if (i < bus.size()) bus[i] = r | g << 8;
+}
+void setRealtimePixels(uint16_t start, const byte* data, uint16_t count, byte channels) {
+  for (uint16_t i = 0; i < count && start + i < bus.size(); i++) bus[start + i] = data[i * channels] | data[i * channels + 1] << 8;
+}
+
+struct Scenario {
+  const char* name;
+  uint8_t protocol;    // P_E131, P_ARTNET or P_DDP
+  uint16_t leds;       // 170 per E1.31/Art-Net universe, 480 per DDP packet
+  uint16_t fps;
+  uint32_t spacingUs;  // between the packets of a frame
+  uint32_t loopUs;     // between two runs of handleNotifications()
+  bool sync;           // E1.31 universe sync / ArtSync after the universes of each frame
+  bool shuffle;        // universes of a frame in random order
+  uint16_t dropEvery;  // a universe of every nth frame is lost
+  bool check;          // every frame is shown complete, apart from those with a lost universe
+};
+
+// the loop normally runs every few ms, "slow loop" is a render loop busy with a large strip
+static const Scenario scenarios[] = {
+  {"in order",     P_E131,   680,  40, 200,  1000, false, false,  0, true},
+  {"out of order", P_E131,   680,  40, 200,  1000, false, true,   0, true},
+  {"lost packets", P_E131,   680,  40, 200,  1000, false, false, 10, true},
+  {"e131 sync",    P_E131,   1360, 40, 200,  1000, true,  true,   0, true},
+  {"artnet",       P_ARTNET, 680,  40, 200,  1000, false, false,  0, true},
+  {"artsync",      P_ARTNET, 1360, 40, 200,  1000, true,  true,   0, true},
+  {"ddp",          P_DDP,    1360, 40, 200,  1000, false, false,  0, true},
+  {"burst 100fps", P_E131,   1360, 100, 20,  12000, false, false, 0, false},
+  {"paced 100fps", P_E131,   1360, 100, 1100, 12000, false, false, 0, false},
+  {"paced sync",   P_E131,   1360, 100, 1100, 12000, true,  false, 0, false},
+};
+
+#define WARMUP_US   1500000 // e131.cpp learns the universes of a frame during the first second of a stream
+#define MEASURE_US  3000000
+#define GAP_US      5000000 // between streams: pending frames time out, ArtSync is forgotten
+#define DDP_LEDS_PER_PACKET 480
+
+struct Datagram {
+  uint64_t at;
+  uint16_t port;
+  uint16_t frame;
+  std::vector<uint8_t> data; // at least sizeof(e131_packet_t), like a receive buffer
+  size_t len;
+};
+
+static void pixels(uint8_t* data, uint16_t count, uint16_t frame, uint8_t part) {
+  for (uint16_t i = 0; i < count; i++) {
+    data[i * 3]     = frame & 0xFF;
+    data[i * 3 + 1] = frame >> 8;
+    data[i * 3 + 2] = part;
+  }
+}
+
+static Datagram e131Packet(uint16_t universe, uint8_t seq, uint16_t syncAddress, uint16_t frame, uint8_t part) {
+  Datagram d{0, E131_DEFAULT_PORT, frame, std::vector<uint8_t>(sizeof(e131_packet_t)), 638};
+  e131_packet_t* p = reinterpret_cast<e131_packet_t*>(d.data.data());
+  static const uint8_t acnId[12] = {0x41, 0x53, 0x43, 0x2d, 0x45, 0x31, 0x2e, 0x31, 0x37, 0x00, 0x00, 0x00};
+  p->preamble_size = htons(0x10);
+  memcpy(p->acn_id, acnId, sizeof(acnId));
+  p->root_flength = htons(0x7000 | (d.len - 16));
+  p->root_vector = htonl(4);
+  p->frame_flength = htons(0x7000 | (d.len - 38));
+  p->frame_vector = htonl(2);
+  p->priority = 100;
+  p->sync_address = htons(syncAddress);
+  p->sequence_number = seq;
+  p->universe = htons(universe);
+  p->dmp_flength = htons(0x7000 | (d.len - 115));
+  p->dmp_vector = 2;
+  p->type = 0xa1;
+  p->address_increment = htons(1);
+  p->property_value_count = htons(513);
+  pixels(&p->property_values[1], 170, frame, part);
+  return d;
+}
+
+static Datagram e131SyncPacket(uint8_t seq, uint16_t syncAddress) {
+  Datagram d = e131Packet(0, 0, 0, 0, 0); // same root layer as a data packet
+  d.len = 49;
+  e131_packet_t* p = reinterpret_cast<e131_packet_t*>(d.data.data());
+  memset(&p->raw[E131_SYNC_SEQ], 0, d.data.size() - E131_SYNC_SEQ);
+  p->root_flength = htons(0x7000 | (d.len - 16));
+  p->root_vector = htonl(8);
+  p->frame_flength = htons(0x7000 | (d.len - 38));
+  p->frame_vector = htonl(1);
+  p->raw[E131_SYNC_SEQ] = seq;
+  p->raw[E131_SYNC_ADDRESS] = syncAddress >> 8;
+  p->raw[E131_SYNC_ADDRESS + 1] = syncAddress & 0xFF;
+  return d;
+}
+
+static Datagram artnetPacket(uint16_t universe, uint8_t seq, uint16_t frame, uint8_t part) {
+  Datagram d{0, ARTNET_DEFAULT_PORT, frame, std::vector<uint8_t>(sizeof(e131_packet_t)), 18 + 512};
+  e131_packet_t* p = reinterpret_cast<e131_packet_t*>(d.data.data());
+  memcpy(p->art_id, "Art-Net", 8);
+  p->art_opcode = ARTNET_OPCODE_OPDMX; // little endian on the wire
+  p->art_protocol_ver = htons(14);
+  p->art_sequence_number = seq;
+  p->art_universe = universe;
+  p->art_length = htons(512);
+  pixels(p->art_data, 170, frame, part);
+  return d;
+}
+
+static Datagram artSyncPacket() {
+  Datagram d{0, ARTNET_DEFAULT_PORT, 0, std::vector<uint8_t>(sizeof(e131_packet_t)), 14};
+  e131_packet_t* p = reinterpret_cast<e131_packet_t*>(d.data.data());
+  memcpy(p->art_id, "Art-Net", 8);
+  p->art_opcode = ARTNET_OPCODE_OPSYNC;
+  p->art_protocol_ver = htons(14);
+  return d;
+}
+
+static Datagram ddpPacket(uint16_t firstLed, uint16_t count, uint8_t seq, bool push, uint16_t frame, uint8_t part) {
+  Datagram d{0, DDP_DEFAULT_PORT, frame, std::vector<uint8_t>(sizeof(e131_packet_t)), 10 + count * 3u};
+  e131_packet_t* p = reinterpret_cast<e131_packet_t*>(d.data.data());
+  p->flags = 0x40 | (push ? DDP_PUSH_FLAG : 0); // version 1
+  p->sequenceNum = seq;
+  p->dataType = 0x0B; // RGB, 8 bit
+  p->destination = 1;
+  p->channelOffset = htonl(firstLed * 3u);
+  p->dataLen = htons(count * 3);
+  pixels(p->data, count, frame, part);
+  return d;
+}
+
+// universes are lost in measured frames only, and not in the last one: no frame follows to notice it
+static bool dropFrame(const Scenario& s, uint16_t frame, uint16_t warmupFrames, uint16_t frames) {
+  return s.dropEvery && frame % s.dropEvery == 0 && frame > warmupFrames && frame < frames;
+}
+
+// packets of a stream, frame numbers start at 1
+static std::vector<Datagram> generate(const Scenario& s, uint16_t fps, uint32_t spacingUs, uint64_t start, uint16_t warmupFrames, uint16_t frames) {
+  std::vector<Datagram> stream;
+  uint8_t parts = s.protocol == P_DDP ? (s.leds + DDP_LEDS_PER_PACKET - 1) / DDP_LEDS_PER_PACKET : (s.leds + 169) / 170;
+  uint64_t period = 1000000 / fps;
+  uint16_t syncAddress = s.sync && s.protocol == P_E131 ? 7000 : 0;
+  std::vector<uint8_t> order(parts);
+  for (uint8_t i = 0; i < parts; i++) order[i] = i;
+
+  for (uint16_t frame = 1; frame <= frames; frame++) {
+    uint64_t at = start + (frame - 1) * period;
+    if (s.shuffle) for (uint8_t i = parts - 1; i > 0; i--) std::swap(order[i], order[rand() % (i + 1)]);
+    uint8_t lost = dropFrame(s, frame, warmupFrames, frames) ? order[parts / 2] : 0xFF;
+    for (uint8_t i = 0; i < parts; i++) {
+      uint8_t part = order[i];
+      Datagram d;
+      if (s.protocol == P_E131)        d = e131Packet(e131Universe + part, frame, syncAddress, frame, part);
+      else if (s.protocol == P_ARTNET) d = artnetPacket(e131Universe + part, frame, frame, part);
+      else {
+        uint16_t first = part * DDP_LEDS_PER_PACKET;
+        d = ddpPacket(first, std::min<uint16_t>(DDP_LEDS_PER_PACKET, s.leds - first), frame % 15 + 1, part == parts - 1, frame, part);
+      }
+      d.at = at + i * spacingUs;
+      if (part != lost) stream.push_back(std::move(d));
+    }
+    if (s.sync) {
+      Datagram d = s.protocol == P_E131 ? e131SyncPacket(frame, syncAddress) : artSyncPacket();
+      d.at = at + parts * spacingUs;
+      d.frame = frame;
+      stream.push_back(std::move(d));
+    }
+  }
+  return stream;
+}
+
+struct Result {
+  uint32_t packets = 0;
+  double wallNs = 0;
+  uint32_t frames = 0, dropped = 0;  // measured source frames, those with a lost universe
+  uint32_t shown = 0, complete = 0, torn = 0, lost = 0;
+  uint32_t framesComplete = 0, framesIncomplete = 0, framesLate = 0;
+  uint32_t pps = 0;
+};
+
+// info "lstat" of the json API
+static uint32_t lstat(const char* key, int8_t source = -1) {
+  StaticJsonDocument<512> stats;
+  serializeRealtimeStats(stats.to<JsonObject>());
+  return source < 0 ? stats[key].as<uint32_t>() : stats[key][source].as<uint32_t>();
+}
+
+static Result replay(const Scenario& s, uint16_t fps) {
+  uint64_t period = 1000000 / fps;
+  uint8_t parts = s.protocol == P_DDP ? (s.leds + DDP_LEDS_PER_PACKET - 1) / DDP_LEDS_PER_PACKET : (s.leds + 169) / 170;
+  uint32_t spacingUs = std::min<uint64_t>(s.spacingUs, period / (parts + 1));
+  uint16_t warmupFrames = WARMUP_US / period, frames = warmupFrames + MEASURE_US / period;
+  uint64_t start = host::micros + GAP_US;
+  std::vector<Datagram> stream = generate(s, fps, spacingUs, start, warmupFrames, frames);
+
+  strip.ledCount = s.leds;
+  bus.assign(s.leds, 0);
+  std::vector<bool> newest(frames + 1, false); // frames which were the newest in a shown frame
+  Result r;
+  uint32_t complete0 = 0, incomplete0 = 0, late0 = 0;
+  bool measuring = false;
+  auto restart = [&]() {
+    r = Result();
+    complete0 = e131FramesComplete; incomplete0 = e131FramesIncomplete; late0 = e131FramesLate;
+    measuring = true;
+  };
+
+  // handleNotifications(): frame timeout, then show the assembled frame
+  auto loop = [&]() {
+    handleE131FrameTimeout();
+    if (!e131NewData) return;
+    e131NewData = false;
+    if (!measuring) return;
+    uint16_t first = bus[0], last = 0;
+    bool same = true;
+    for (uint16_t id : bus) {
+      same = same && id == first;
+      last = std::max(last, id);
+    }
+    r.shown++;
+    if (same && first) r.complete++;
+    else r.torn++;
+    newest[last] = true;
+  };
+
+  uint64_t nextLoop = host::micros;
+  for (Datagram& d : stream) {
+    while (nextLoop <= d.at) {
+      host::micros = nextLoop;
+      loop();
+      nextLoop += s.loopUs;
+    }
+    if (!measuring && d.frame > warmupFrames) restart();
+    host::micros = d.at;
+    auto t0 = std::chrono::steady_clock::now();
+    hostUdpDeliver(d.port, d.data.data(), d.len, sender);
+    r.wallNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+    r.packets++;
+  }
+  for (uint64_t end = host::micros + 200000; nextLoop <= end; nextLoop += s.loopUs) {
+    host::micros = nextLoop;
+    loop();
+  }
+
+  for (uint16_t frame = warmupFrames + 1; frame <= frames; frame++) {
+    r.frames++;
+    if (dropFrame(s, frame, warmupFrames, frames)) r.dropped++;
+    if (!newest[frame]) r.lost++;
+  }
+  r.framesComplete = e131FramesComplete - complete0;
+  r.framesIncomplete = e131FramesIncomplete - incomplete0;
+  r.framesLate = e131FramesLate - late0;
+  host::micros = stream.back().at;
+  r.pps = lstat("pps");
+  return r;
+}
+
+static int failures = 0;
+#define CHECK(cond) do { if (!(cond)) { printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+// the AsyncUDP task and the loop count packets at the same time, no count may get lost (needs more than one core
+// to overlap often enough to fail without the lock)
+static void contention() {
+  const uint32_t packets = 200000;
+  std::vector<Datagram> stream;
+  for (uint8_t u = 0; u < 4; u++) stream.push_back(e131Packet(e131Universe + u, 1, 0, 1, u));
+  strip.ledCount = 680;
+  bus.assign(680, 0);
+  host::micros = 10000000; // the clock stands still, the loop reports 1000 us per packet, the task 0 us
+
+  std::atomic<bool> go(false);
+  std::thread task([&]() {
+    while (!go);
+    for (uint32_t i = 0; i < packets; i++) hostUdpDeliver(E131_DEFAULT_PORT, stream[i & 3].data.data(), stream[i & 3].len, sender);
+  });
+  go = true;
+  for (uint32_t i = 0; i < packets; i++) {
+    countRealtimePacket(3, micros() - 1000);
+    handleE131FrameTimeout();
+  }
+  task.join();
+
+  printf("contention     e131 %u  udp %u  average %u us max %u us (expected %u, %u, 500, 1000)\n", lstat("pkt", 0), lstat("pkt", 3), lstat("us"), lstat("usmax"), packets, packets);
+  CHECK(lstat("pkt", 0) == packets);
+  CHECK(lstat("pkt", 3) == packets);
+  CHECK(lstat("us") == 500);
+  CHECK(lstat("usmax") == 1000);
+}
+
+int main(int argc, char** argv) {
+  uint16_t fps = 0;
+  for (int i = 1; i < argc - 1; i++) if (!strcmp(argv[i], "--fps")) fps = atoi(argv[i + 1]);
+  srand(1);
+
+  e131.begin(false, E131_DEFAULT_PORT);
+  artnet.begin(false, ARTNET_DEFAULT_PORT);
+  ddp.begin(false, DDP_DEFAULT_PORT);
+
+  contention(); // first, while the statistics are still zero
+
+  for (const Scenario& s : scenarios) {
+    uint16_t rate = fps ? fps : s.fps;
+    Result r = replay(s, rate);
+    printf("%-14s %-6s %4u leds %3u fps  loop %5u us  %5u packets %9.0f pkt/s %5.0f ns/pkt  shown %4u complete %4u torn %3u lost %3u"
+           "  frames ok %4u inc %3u late %3u  pps %u\n",
+           s.name, s.protocol == P_E131 ? "E1.31" : s.protocol == P_ARTNET ? "ArtNet" : "DDP", s.leds, rate, s.loopUs, r.packets,
+           r.packets * 1e9 / r.wallNs, r.wallNs / r.packets, r.shown, r.complete, r.torn, r.lost, r.framesComplete,
+           r.framesIncomplete, r.framesLate, r.pps);
+    if (!s.check) continue;
+    // a frame with a lost universe is given up when the next frame starts, or shown after e131FrameTimeout
+    // if that comes first. It is shown torn if the loop runs before it is replaced, otherwise it is lost.
+    CHECK(r.complete == r.frames - r.dropped);
+    CHECK(r.framesIncomplete + r.framesLate == r.dropped);
+    CHECK(r.torn <= r.dropped);
+    CHECK(r.lost <= r.dropped);
+  }
+
+  if (failures) {
+    printf("%d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("realtime replay OK\n");
+  return 0;
+}
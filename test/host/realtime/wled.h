@@ -0,0 +1,62 @@
+#pragma once
+/*
+ * Host stand-in for wled.h, just enough to compile e131.cpp and ESPAsyncE131.cpp for ESP32.
+ * Packets come in through the AsyncUDP stand-in, pixels go to the capture bus of the harness.
+ */
+
+#include "Arduino.h"
+#include <atomic>
+
+// the AsyncUDP task is a thread of the harness, critical sections spin like on a dual core ESP32
+typedef struct { std::atomic_flag flag; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {}
+inline void portENTER_CRITICAL(portMUX_TYPE* mux) { while (mux->flag.test_and_set(std::memory_order_acquire)); }
+inline void portEXIT_CRITICAL(portMUX_TYPE* mux) { mux->flag.clear(std::memory_order_release); }
+
+#define ARDUINOJSON_ENABLE_ARDUINO_STRING 0
+#define ARDUINOJSON_ENABLE_ARDUINO_STREAM 0
+#define ARDUINOJSON_ENABLE_ARDUINO_PRINT 0
+#define ARDUINOJSON_ENABLE_PROGMEM 0
+#include "src/dependencies/json/ArduinoJson-v6.h"
+#include "const.h"
+#include "src/dependencies/e131/ESPAsyncE131.h"
+
+#define MODE_COUNT 188
+#define DEBUG_PRINT(x)
+#define DEBUG_PRINTLN(x)
+
+class HostStrip {
+  public:
+  uint16_t ledCount = 0;
+  uint8_t brightness = 255;
+  uint16_t getLengthTotal() { return ledCount; }
+  void setBrightness(uint8_t b, bool = false) { brightness = b; }
+};
+extern HostStrip strip;
+
+extern uint16_t e131Universe;
+extern byte DMXMode;
+extern uint16_t DMXAddress;
+extern byte DMXOldDimmer;
+extern byte e131LastSequenceNumber[E131_MAX_UNIVERSE_COUNT];
+extern bool e131SkipOutOfSequence;
+extern uint16_t e131FrameTimeout;
+extern bool e131NewData;
+extern uint32_t e131FramesComplete, e131FramesIncomplete, e131FramesLate;
+extern IPAddress realtimeIP;
+extern bool realtimeOverride;
+extern uint32_t realtimeTimeoutMs;
+extern byte bri, effectCurrent, effectSpeed, effectIntensity, effectPalette;
+extern byte col[4], colSec[4];
+extern uint16_t transitionDelayTemp;
+
+inline void applyPreset(byte, byte = 0) {}
+inline void colorUpdated(int) {}
+void realtimeLock(uint32_t timeoutMs, byte md = REALTIME_MODE_GENERIC);
+void setRealtimePixel(uint16_t i, byte r, byte g, byte b, byte w);
+void setRealtimePixels(uint16_t start, const byte* data, uint16_t count, byte channels);
+
+void handleE131Packet(e131_packet_t* p, IPAddress clientIP, byte protocol);
+void handleE131FrameTimeout();
+void countRealtimePacket(uint8_t source, uint32_t startMicros);
+void serializeRealtimeStats(JsonObject root);
@@ -0,0 +1,158 @@
+/*
+ * Encodes Adalight, TPM2 and binary frames as documented in wled_serial.cpp and checks
+ * that handleSerial() commits exactly the encoded pixels, also when frames arrive in pieces.
+ */
+
+#include "wled.h"
+
+namespace host { uint64_t micros = 0; }
+HostSerial Serial;
+HostPinManager pinManager;
+HostStrip strip;
+DynamicJsonDocument doc(JSON_BUFFER_SIZE);
+bool realtimeOverride = false;
+uint32_t realtimeTimeoutMs = 2500;
+
+struct Frame {
+  uint16_t start;
+  uint8_t channels;
+  std::vector<uint8_t> data;
+};
+static std::vector<Frame> committed;
+static unsigned shows = 0;
+
+void realtimeLock(uint32_t, byte) {}
+void realtimeShow() { shows++; }
+void setRealtimePixels(uint16_t start, const byte* data, uint16_t count, byte channels) {
+  committed.push_back({start, channels, std::vector<uint8_t>(data, data + count * channels)});
+}
+
+static uint16_t crc16(uint16_t crc, const uint8_t* data, size_t len) { // CRC-16/CCITT-FALSE
+  while (len--) {
+    crc ^= *data++ << 8;
+    for (uint8_t i = 0; i < 8; i++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+static std::vector<uint8_t> pixels(uint16_t count, uint8_t channels, uint8_t seed) {
+  std::vector<uint8_t> p(count * channels);
+  for (size_t i = 0; i < p.size(); i++) p[i] = (uint8_t)(seed + i * 7);
+  return p;
+}
+
+static std::vector<uint8_t> encodeBinary(uint16_t start, uint8_t channels, bool show, const std::vector<uint8_t>& data) {
+  uint16_t count = data.size() / channels;
+  std::vector<uint8_t> f;
+  f.reserve(data.size() + 8);
+  f.insert(f.end(), {0xCB, (uint8_t)(channels | (show ? 0x80 : 0)), (uint8_t)(start >> 8), (uint8_t)start, (uint8_t)(count >> 8), (uint8_t)count});
+  f.insert(f.end(), data.begin(), data.end());
+  uint16_t crc = crc16(0xFFFF, f.data() + 1, f.size() - 1);
+  f.push_back(crc >> 8);
+  f.push_back(crc & 0xFF);
+  return f;
+}
+
+static std::vector<uint8_t> encodeAdalight(const std::vector<uint8_t>& data) {
+  uint16_t n = data.size() / 3 - 1;
+  std::vector<uint8_t> f;
+  f.reserve(data.size() + 6);
+  f.insert(f.end(), {'A', 'd', 'a', (uint8_t)(n >> 8), (uint8_t)n, (uint8_t)((n >> 8) ^ (n & 0xFF) ^ 0x55)});
+  f.insert(f.end(), data.begin(), data.end());
+  return f;
+}
+
+static std::vector<uint8_t> encodeTPM2(const std::vector<uint8_t>& data) {
+  std::vector<uint8_t> f;
+  f.reserve(data.size() + 5);
+  f.insert(f.end(), {0xC9, 0xDA, (uint8_t)(data.size() >> 8), (uint8_t)data.size()});
+  f.insert(f.end(), data.begin(), data.end());
+  f.push_back(0x36);
+  return f;
+}
+
+static int failures = 0;
+#define CHECK(cond) do { if (!(cond)) { printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+// feeds the stream in pieces of chunk bytes, calling handleSerial() after each like the main loop
+static void feed(const std::vector<uint8_t>& stream, size_t chunk) {
+  Serial.rx.clear();
+  Serial.pos = 0;
+  committed.clear();
+  shows = 0;
+  for (size_t i = 0; i < stream.size(); i += chunk) {
+    Serial.rx.insert(Serial.rx.end(), stream.begin() + i, stream.begin() + std::min(stream.size(), i + chunk));
+    handleSerial();
+  }
+  handleSerial();
+}
+
+int main() {
+  const size_t chunks[] = {1, 7, 64, 100000};
+  for (size_t chunk : chunks) {
+    // two binary frames back to back, the first one not shown
+    std::vector<uint8_t> a = pixels(300, 3, 1), b = pixels(120, 4, 9);
+    std::vector<uint8_t> stream = encodeBinary(0, 3, false, a);
+    std::vector<uint8_t> fb = encodeBinary(300, 4, true, b);
+    stream.reserve(stream.size() + fb.size());
+    stream.insert(stream.end(), fb.begin(), fb.end());
+    feed(stream, chunk);
+    CHECK(committed.size() == 2);
+    if (committed.size() == 2) {
+      CHECK(committed[0].start == 0   && committed[0].channels == 3 && committed[0].data == a);
+      CHECK(committed[1].start == 300 && committed[1].channels == 4 && committed[1].data == b);
+    }
+    CHECK(shows == 1);
+
+    // a corrupted frame is dropped, the following one still decodes
+    std::vector<uint8_t> bad = encodeBinary(0, 3, true, a);
+    bad[10] ^= 0x01;
+    stream = bad;
+    stream.insert(stream.end(), fb.begin(), fb.end());
+    feed(stream, chunk);
+    CHECK(committed.size() == 1);
+    if (committed.size() == 1) CHECK(committed[0].start == 300 && committed[0].data == b);
+
+    // Adalight and TPM2
+    std::vector<uint8_t> c = pixels(50, 3, 3);
+    stream = encodeAdalight(c);
+    std::vector<uint8_t> t = encodeTPM2(a);
+    stream.insert(stream.end(), t.begin(), t.end());
+    feed(stream, chunk);
+    CHECK(committed.size() == 2);
+    if (committed.size() == 2) {
+      CHECK(committed[0].start == 0 && committed[0].channels == 3 && committed[0].data == c);
+      CHECK(committed[1].start == 0 && committed[1].channels == 3 && committed[1].data == a);
+    }
+    CHECK(shows == 2);
+
+    // malformed TPM2 headers are dropped without reading the frame buffer, the following frame still decodes
+    std::vector<uint8_t> tc = encodeTPM2(c);
+    const std::vector<uint8_t> malformed[] = {
+      {0xC9, 0xDA, 0x00, 0x00, 0x36},                                         // empty frame
+      {0xC9, 0xDA, (uint8_t)((MAX_LEDS * 3 + 3) >> 8), (uint8_t)(MAX_LEDS * 3 + 3), 0x36}, // more than MAX_LEDS pixels
+      {0xC9, 0xDA, 0xFF, 0xFF, 0x36},                                         // largest count
+      {0xC9, 0x00, 0x00, 0x03, 0x36},                                         // invalid type
+      {0xC9, 0xDA, 0x00, 0x03, 1, 2, 3, 4, 0x36},                             // one payload byte too many
+    };
+    for (const std::vector<uint8_t>& m : malformed) {
+      stream = t; // leaves a larger frame in the buffer
+      stream.insert(stream.end(), m.begin(), m.end());
+      stream.insert(stream.end(), tc.begin(), tc.end());
+      feed(stream, chunk);
+      CHECK(committed.size() == 2);
+      if (committed.size() == 2) {
+        CHECK(committed[0].data == a);
+        CHECK(committed[1].data == c);
+      }
+      CHECK(shows == 2);
+    }
+  }
+
+  if (failures) {
+    printf("%d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("serial frames OK\n");
+  return 0;
+}
@@ -0,0 +1,85 @@
+#pragma once
+/*
+ * Host stand-in for wled.h, just enough to compile wled_serial.cpp.
+ * Serial is fed from a byte buffer, committed frames are recorded by the harness.
+ */
+
+#include "Arduino.h"
+#include <vector>
+
+#define WLED_ENABLE_ADALIGHT
+#define ARDUINOJSON_ENABLE_ARDUINO_STRING 0
+#define ARDUINOJSON_ENABLE_ARDUINO_STREAM 0
+#define ARDUINOJSON_ENABLE_ARDUINO_PRINT 0
+#define ARDUINOJSON_ENABLE_PROGMEM 0
+#include "src/dependencies/json/ArduinoJson-v6.h"
+#include "const.h"
+
+#define VERSION 0
+#define DEBUG_PRINTLN(x)
+
+#define R(c) (byte((c) >> 16))
+#define G(c) (byte((c) >> 8))
+#define B(c) (byte(c))
+#define W(c) (byte((c) >> 24))
+
+inline uint8_t qadd8(uint8_t i, uint8_t j) { unsigned t = i + j; return t > 255 ? 255 : t; }
+
+// RX side of the serial port: the harness appends bytes, handleSerial() consumes them
+class HostSerial {
+  public:
+  std::vector<uint8_t> rx;
+  size_t pos = 0;
+  std::vector<uint8_t> tx;
+
+  int available() { return rx.size() - pos; }
+  int peek() { return pos < rx.size() ? rx[pos] : -1; }
+  int read() { return pos < rx.size() ? rx[pos++] : -1; }
+  size_t readBytes(uint8_t* buf, size_t len) {
+    len = std::min(len, rx.size() - pos);
+    memcpy(buf, rx.data() + pos, len);
+    pos += len;
+    return len;
+  }
+  size_t readBytes(char* buf, size_t len) { return readBytes((uint8_t*)buf, len); }
+  size_t write(uint8_t c) { tx.push_back(c); return 1; }
+  size_t write(const uint8_t* buf, size_t len) { tx.insert(tx.end(), buf, buf + len); return len; }
+  template <typename T> size_t print(T) { return 0; }
+  template <typename T> size_t println(T) { return 0; }
+  size_t println() { return 0; }
+  void flush() {}
+  void begin(unsigned long) {}
+  void end() {}
+  void setTimeout(unsigned long) {}
+};
+extern HostSerial Serial;
+
+enum struct PinOwner : uint8_t { None = 0, DebugOut = 0x89 };
+class HostPinManager {
+  public:
+  bool isPinAllocated(byte) { return false; }
+  PinOwner getPinOwner(byte) { return PinOwner::None; }
+};
+extern HostPinManager pinManager;
+
+class HostStrip {
+  public:
+  uint16_t getLengthTotal() { return 0; }
+  uint32_t getPixelColor(uint16_t) { return 0; }
+};
+extern HostStrip strip;
+
+extern DynamicJsonDocument doc;
+inline bool requestJSONBufferLock(uint8_t) { return true; }
+inline void releaseJSONBufferLock() {}
+inline bool deserializeState(JsonObject, byte = 0, byte = 0) { return false; }
+inline void serializeState(JsonObject) {}
+inline void serializeInfo(JsonObject) {}
+inline void handleImprovPacket() {}
+
+extern bool realtimeOverride;
+extern uint32_t realtimeTimeoutMs;
+void realtimeLock(uint32_t timeoutMs, byte md);
+void setRealtimePixels(uint16_t start, const byte* data, uint16_t count, byte channels);
+void realtimeShow();
+void handleSerial();
@@ -0,0 +1,95 @@
+#pragma once
+/*
+ * Minimal Arduino core for compiling wled00 sources on the host.
+ * Only what the host harnesses link against, time is driven by the harness.
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define F(s) (s)
+#define FPSTR(s) (s)
+#define pgm_read_byte(p)  (*(const uint8_t*)(p))
+#define pgm_read_word(p)  (*(const uint16_t*)(p))
+// a 32 bit read on a controller is also how tables of PROGMEM pointers are read, so keep the type of the element
+template <typename T> inline T pgm_read_dword_host(const T* p) { return *p; }
+#define pgm_read_dword(p) pgm_read_dword_host(p)
+#define sprintf_P sprintf
+#define snprintf_P snprintf
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+#define strcmp_P strcmp
+#define strlen_P strlen
+// copies from flash may read past the end of a PROGMEM array (load_gradient_palette() always copies 72 bytes)
+__attribute__((no_sanitize("address"))) inline void* memcpy_P(void* dest, const void* src, size_t n) {
+  for (size_t i = 0; i < n; i++) ((uint8_t*)dest)[i] = ((const uint8_t*)src)[i];
+  return dest;
+}
+
+#define highByte(w) ((uint8_t)((w) >> 8))
+#define lowByte(w)  ((uint8_t)((w) & 0xFF))
+#define bitRead(v, b) (((v) >> (b)) & 0x01)
+#define bitSet(v, b) ((v) |= (1UL << (b)))
+#define bitClear(v, b) ((v) &= ~(1UL << (b)))
+#define bitWrite(v, b, x) ((x) ? bitSet(v, b) : bitClear(v, b))
+#define radians(deg) ((deg) * 0.017453292519943295)
+#define degrees(rad) ((rad) * 57.29577951308232)
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+using std::min;
+using std::max;
+using std::abs;
+
+// clock of the harness, advanced explicitly so runs are reproducible. Benchmarks set wallClock
+// to run on the monotonic clock of the host instead.
+namespace host {
+  extern uint64_t micros;
+  inline bool wallClock = false;
+  inline uint64_t clock() {
+    if (!wallClock) return micros;
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+}
+inline unsigned long millis() { return (unsigned long)(host::clock() / 1000); }
+inline unsigned long micros() { return (unsigned long)host::clock(); }
+inline void delay(unsigned long ms) {
+  if (host::wallClock) std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+  else host::micros += ms * 1000ULL;
+}
+inline void yield() {}
+
+inline long map(long x, long in_min, long in_max, long out_min, long out_max) {
+  if (in_max == in_min) return -1; // like the ESP32 core
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+inline long random(long howsmall, long howbig) { return howsmall >= howbig ? howsmall : howsmall + rand() % (howbig - howsmall); }
+inline long random(long howbig) { return random(0, howbig); }
+
+class String : public std::string {
+  public:
+  String() {}
+  String(const char* s) : std::string(s ? s : "") {}
+  String(const std::string& s) : std::string(s) {}
+  String(int v) : std::string(std::to_string(v)) {}
+  String(unsigned v) : std::string(std::to_string(v)) {}
+  String(long v) : std::string(std::to_string(v)) {}
+  String(unsigned long v) : std::string(std::to_string(v)) {}
+  int toInt() const { return atoi(c_str()); }
+  bool startsWith(const char* s) const { return compare(0, strlen(s), s) == 0; }
+  int indexOf(const char* s) const { size_t p = find(s); return p == npos ? -1 : (int)p; }
+  String substring(size_t from) const { return from < size() ? String(substr(from)) : String(); }
+  String substring(size_t from, size_t to) const { return from < size() ? String(substr(from, to - from)) : String(); }
+};
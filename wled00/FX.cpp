@@ -1720,10 +1720,10 @@ uint16_t WS2812FX::mode_lightning(void)
     }
     SEGENV.aux1--;
 
-    SEGENV.step = millis();
+    SEGENV.step = now;
     //return random8(4, 10); // each flash only lasts one frame/every 24ms... originally 4-10 milliseconds
   } else {
-    if (millis() - SEGENV.step > SEGENV.aux0) {
+    if (now - SEGENV.step > SEGENV.aux0) {
       SEGENV.aux1--;
       if (SEGENV.aux1 < 2) SEGENV.aux1 = 0;
 
@@ -1731,7 +1731,7 @@ uint16_t WS2812FX::mode_lightning(void)
       if (SEGENV.aux1 == 2) {
         SEGENV.aux0 = (random8(255 - SEGMENT.speed) * 100); // delay between strikes
       }
-      SEGENV.step = millis();
+      SEGENV.step = now;
     }
   }
   return FRAMETIME;
@@ -2657,7 +2657,7 @@ uint16_t WS2812FX::mode_bouncing_balls(void) {
   float gravity                           = -9.81; // standard value of gravity
   float impactVelocityStart               = sqrt( -2 * gravity);
 
-  unsigned long time = millis();
+  unsigned long time = now;
 
   if (SEGENV.call == 0) {
     for (uint8_t i = 0; i < maxNumBalls; i++) balls[i].lastBounceTime = time;
@@ -2949,7 +2949,7 @@ uint16_t WS2812FX::mode_starburst(void) {
 
   if (!SEGENV.allocateData(dataSize)) return mode_static(); //allocation failed
 
-  uint32_t it = millis();
+  uint32_t it = now;
 
   star* stars = reinterpret_cast<star*>(SEGENV.data);
 
@@ -3382,7 +3382,7 @@ uint16_t WS2812FX::mode_heartbeat(void) {
   bri_lower = bri_lower * 2042 / (2048 + SEGMENT.intensity);
   SEGENV.aux1 = bri_lower;
 
-  unsigned long beatTimer = millis() - SEGENV.step;
+  unsigned long beatTimer = now - SEGENV.step;
   if((beatTimer > secondBeat) && !SEGENV.aux0) { // time for the second beat?
     SEGENV.aux1 = UINT16_MAX; //full bri
     SEGENV.aux0 = 1;
@@ -3390,7 +3390,7 @@ uint16_t WS2812FX::mode_heartbeat(void) {
   if(beatTimer > msPerBeat) { // time to reset the beat timer?
     SEGENV.aux1 = UINT16_MAX; //full bri
     SEGENV.aux0 = 0;
-    SEGENV.step = millis();
+    SEGENV.step = now;
   }
 
   for (uint16_t i = 0; i < SEGLEN; i++) {
@@ -3589,14 +3589,12 @@ uint16_t WS2812FX::mode_sunrise() {
 uint16_t WS2812FX::phased_base(uint8_t moder) {                  // We're making sine waves here. By Andrew Tuline.
 
   uint8_t allfreq = 16;                                          // Base frequency.
-  //float* phasePtr = reinterpret_cast<float*>(SEGENV.step);       // Phase change value gets calculated.
-  static float phase = 0;//phasePtr[0];
   uint8_t cutOff = (255-SEGMENT.intensity);                      // You can change the number of pixels.  AKA INTENSITY (was 192).
   uint8_t modVal = 5;//SEGMENT.custom1/8+1;                         // You can change the modulus. AKA Custom1 (was 5).
 
   uint8_t index = now/64;                                    // Set color rotation speed
-  phase += SEGMENT.speed/32.0;                                   // You can change the speed of the wave. AKA SPEED (was .4)
-  //phasePtr[0] = phase;
+  SEGENV.step += SEGMENT.speed * 8;                              // Phase in 1/256, per segment. You can change the speed of the wave. AKA SPEED (was .4)
+  float phase = SEGENV.step / 256.0;
 
   for (int i = 0; i < SEGLEN; i++) {
     if (moder == 1) modVal = (inoise8(i*10 + i*10) /16);         // Let's randomize our mod length with some Perlin noise.
@@ -3660,9 +3658,9 @@ uint16_t WS2812FX::mode_noisepal(void) {                                    // S
   CRGBPalette16* palettes = reinterpret_cast<CRGBPalette16*>(SEGENV.data);
 
   uint16_t changePaletteMs = 4000 + SEGMENT.speed *10; //between 4 - 6.5sec
-  if (millis() - SEGENV.step > changePaletteMs)
+  if (now - SEGENV.step > changePaletteMs)
   {
-    SEGENV.step = millis();
+    SEGENV.step = now;
 
     uint8_t baseI = random8();
     palettes[1] = CRGBPalette16(CHSV(baseI+random8(64), 255, random8(128,255)), CHSV(baseI+128, 255, random8(128,255)), CHSV(baseI+random8(92), 192, random8(128,255)), CHSV(baseI+random8(92), 255, random8(128,255)));
@@ -3809,7 +3807,7 @@ uint16_t WS2812FX::mode_dancing_shadows(void)
 
   fill(BLACK);
 
-  unsigned long time = millis();
+  unsigned long time = now;
   bool respawn = false;
 
   for (uint8_t i = 0; i < numSpotlights; i++) {
@@ -4001,8 +3999,8 @@ uint16_t WS2812FX::mode_tv_simulator(void) {
   }
 
     // create a new sceene
-    if (((millis() - tvSimulator->sceeneStart) >= tvSimulator->sceeneDuration) || SEGENV.aux1 == 0) {
-      tvSimulator->sceeneStart    = millis();                                               // remember the start of the new sceene
+    if (((now - tvSimulator->sceeneStart) >= tvSimulator->sceeneDuration) || SEGENV.aux1 == 0) {
+      tvSimulator->sceeneStart    = now;                                               // remember the start of the new sceene
       tvSimulator->sceeneDuration = random16(60* 250* colorSpeed, 60* 750 * colorSpeed);    // duration of a "movie sceene" which has similar colors (5 to 15 minutes with max speed slider)
       tvSimulator->sceeneColorHue = random16(   0, 768);                                    // random start color-tone for the sceene
       tvSimulator->sceeneColorSat = random8 ( 100, 130 + colorIntensity);                   // random start color-saturation for the sceene
@@ -4053,11 +4051,11 @@ uint16_t WS2812FX::mode_tv_simulator(void) {
     tvSimulator->fadeTime  = random16(0, tvSimulator->totalTime);   // Pixel-to-pixel transition time
     if (random8(10) < 3) tvSimulator->fadeTime = 0;                 // Force scene cut 30% of time
 
-    tvSimulator->startTime = millis();
+    tvSimulator->startTime = now;
   } // end of initialization
 
   // how much time is elapsed ?
-  tvSimulator->elapsed = millis() - tvSimulator->startTime;
+  tvSimulator->elapsed = now - tvSimulator->startTime;
 
   // fade from prev volor to next color
   if (tvSimulator->elapsed < tvSimulator->fadeTime) {
@@ -4114,15 +4112,15 @@ class AuroraWave {
 
   public:
     void init(uint32_t segment_length, CRGB color) {
-      ttl = random(500, 1501);
+      ttl = random16(500, 1501);
       basecolor = color;
-      basealpha = random(60, 101) / (float)100;
+      basealpha = random8(60, 101) / (float)100;
       age = 0;
-      width = random(segment_length / 20, segment_length / W_WIDTH_FACTOR); //half of width to make math easier
+      width = random16(segment_length / 20, segment_length / W_WIDTH_FACTOR); //half of width to make math easier
       if (!width) width = 1;
-      center = random(101) / (float)100 * segment_length;
-      goingleft = random(0, 2) == 0;
-      speed_factor = (random(10, 31) / (float)100 * W_MAX_SPEED / 255);
+      center = random8(101) / (float)100 * segment_length;
+      goingleft = random8(2) == 0;
+      speed_factor = (random8(10, 31) / (float)100 * W_MAX_SPEED / 255);
       alive = true;
     }
 
@@ -4320,7 +4318,7 @@ uint16_t WS2812FX::mode_perlinmove(void) {
 
   fade_out(255-SEGMENT.custom1);
   for (int i=0; i<SEGMENT.intensity/16+1; i++) {
-    uint16_t locn = inoise16(millis()*128/(260-SEGMENT.speed)+i*15000, millis()*128/(260-SEGMENT.speed));   // Get a new pixel location from moving noise.
+    uint16_t locn = inoise16(now*128/(260-SEGMENT.speed)+i*15000, now*128/(260-SEGMENT.speed));   // Get a new pixel location from moving noise.
     uint16_t pixloc = map(locn,50*256,192*256,0,SEGLEN)%(SEGLEN);                       // Map that to the length of the strand, and ensure we don't go over.
     setPixelColor(pixloc, color_from_palette(pixloc%255, false, PALETTE_SOLID_WRAP, 0));
   }
@@ -4336,7 +4334,7 @@ uint16_t WS2812FX::mode_perlinmove(void) {
 uint16_t WS2812FX::mode_wavesins(void) {                          // Uses beatsin8() + phase shifting. By: Andrew Tuline
 
   for (int i = 0; i < SEGLEN; i++) {
-    uint8_t bri = sin8(millis()/4+i* (int)SEGMENT.intensity);
+    uint8_t bri = sin8(now/4+i* (int)SEGMENT.intensity);
 //    leds[i] = CHSV(beatsin8(SEGMENT.speed, SEGMENT.custom1, SEGMENT.custom1+SEGMENT.custom2, 0, i * SEGMENT.custom3), 255, bri);
     leds[segmentToLogical(i)] = ColorFromPalette(currentPalette, beatsin8(SEGMENT.speed, SEGMENT.custom1, SEGMENT.custom1+SEGMENT.custom2, 0, i * SEGMENT.custom3), bri, LINEARBLEND);
   }
@@ -4353,8 +4351,8 @@ uint16_t WS2812FX::mode_wavesins(void) {                          // Uses beatsi
 uint16_t WS2812FX::mode_FlowStripe(void) {                        // By: ldirko  https://editor.soulmatelights.com/gallery/392-flow-led-stripe , modifed by: Andrew Tuline
 
   const float hl = SEGLEN / 1.3;
-  uint8_t hue = millis() / (SEGMENT.speed+1);
-  int t = millis() / (SEGMENT.intensity/8+1);
+  uint8_t hue = now / (SEGMENT.speed+1);
+  int t = now / (SEGMENT.intensity/8+1);
 
   for (int i = 0; i < SEGLEN; i++) {
     int c = (abs(i - hl) / hl) * 127;
@@ -4537,7 +4535,7 @@ uint16_t WS2812FX::logicalToPhysical(uint16_t i) {                       // ewow
 uint16_t WS2812FX::mode_2DBlackHole() {            // By: Stepko https://editor.soulmatelights.com/gallery/1012 , Modified by: Andrew Tuline
 
   fadeToBlackBy(leds, 32);
-  double t = (float)(millis())/128;
+  double t = (float)(now)/128;
   for (byte i = 0; i < 8; i++) {
     leds[XY(beatsin8(SEGMENT.custom1/8, 0, SEGMENT.width - 1, 0, ((i % 2) ? 128 : 0)+t*i), beatsin8(10, 0, SEGMENT.height - 1, 0, ((i % 2) ? 192 : 64)+t*i))] += CHSV(i*32, 255, 255);
   }
@@ -4561,11 +4559,8 @@ uint16_t WS2812FX::mode_2DColoredBursts() {              // By: ldirko   https:/
   bool dot = false;
   bool grad = true;
 
-  static byte hue = 0;
-  static byte numLines = 10;
-
-  hue++;
-  numLines = SEGMENT.intensity/16;
+  byte hue = ++SEGENV.aux0;
+  byte numLines = SEGMENT.intensity/16;
   fadeToBlackBy(leds, 40);
 
   for (byte i = 0; i < numLines; i++) {
@@ -4610,8 +4605,8 @@ uint16_t WS2812FX::mode_2Ddna(void) {         // dna originally by by ldirko at
   for(int i = 0; i < SEGMENT.width; i++) {               // change to height if you want to re-orient, and swap the 4 lines below.
  //     leds[XY(beatsin8(SEGMENT.speed/8, 0, SEGMENT.width-1, 0, i*4), i)] = ColorFromPalette(currentPalette, i*5+millis()/17, beatsin8(5, 55, 255, 0, i*10), LINEARBLEND);
  //     leds[XY(beatsin8(SEGMENT.speed/8, 0, SEGMENT.width-1, 0, i*4+128), i)] = ColorFromPalette(currentPalette,i*5+128+millis()/17, beatsin8(5, 55, 255, 0, i*10+128), LINEARBLEND);        // 180 degrees (128) out of phase
-     leds[XY(i, beatsin8(SEGMENT.speed/8, 0, SEGMENT.height-1, 0, i*4))] = ColorFromPalette(currentPalette, i*5+millis()/17, beatsin8(5, 55, 255, 0, i*10), LINEARBLEND);
-      leds[XY(i, beatsin8(SEGMENT.speed/8, 0, SEGMENT.height-1, 0, i*4+128))] = ColorFromPalette(currentPalette,i*5+128+millis()/17, beatsin8(5, 55, 255, 0, i*10+128), LINEARBLEND);        // 180 degrees (128) out of phase
+     leds[XY(i, beatsin8(SEGMENT.speed/8, 0, SEGMENT.height-1, 0, i*4))] = ColorFromPalette(currentPalette, i*5+now/17, beatsin8(5, 55, 255, 0, i*10), LINEARBLEND);
+      leds[XY(i, beatsin8(SEGMENT.speed/8, 0, SEGMENT.height-1, 0, i*4+128))] = ColorFromPalette(currentPalette,i*5+128+now/17, beatsin8(5, 55, 255, 0, i*10+128), LINEARBLEND);        // 180 degrees (128) out of phase
   }
 
   blur2d(leds, SEGMENT.intensity/8);
@@ -4632,7 +4627,7 @@ uint16_t WS2812FX::mode_2DDNASpiral() {               // By: ldirko  https://edi
   uint8_t freq = SEGMENT.intensity/8;
 
   static byte hue = 0;
-  int ms = millis() / 20;
+  int ms = now / 20;
   nscale8(leds, 120);
 
   for (int i = 0; i < SEGMENT.height; i++) {
@@ -4669,7 +4664,7 @@ uint16_t WS2812FX::mode_2DDrift() {              // By: Stepko   https://editor.
   #define CenterY ((SEGMENT.height / 2) - 0.5)
   const byte maxDim = max(SEGMENT.width, SEGMENT.height);
   fadeToBlackBy(leds, 128);
-  unsigned long t = millis() / (32 - SEGMENT.speed/8);
+  unsigned long t = now / (32 - SEGMENT.speed/8);
   for (float i = 1; i < maxDim / 2; i += 0.25) {
     double angle = radians(t * (maxDim / 2 - i));
     int myX = (int)(CenterX + sin(angle) * i);
@@ -4694,8 +4689,8 @@ uint16_t WS2812FX::mode_2Dfire2012(void) {                // Fire2012 by Mark Kr
 
   CRGBPalette16 currentPalette  = CRGBPalette16( CRGB::Black, CRGB::Red, CRGB::Orange, CRGB::Yellow);
 
-  if (millis() - SEGENV.step >= ((256-SEGMENT.speed) >>2)) {
-    SEGENV.step = millis();
+  if (now - SEGENV.step >= ((256-SEGMENT.speed) >>2)) {
+    SEGENV.step = now;
     // static byte *heat = (uint16_t *)dataStore;
 
     if (!SEGENV.allocateData(sizeof(byte) * 4096)) return mode_static(); //allocation failed
@@ -4761,7 +4756,7 @@ uint16_t WS2812FX::mode_2Dfirenoise(void) {               // firenoise2d. By And
 for (int j=0; j < SEGMENT.width; j++) {
     for (int i=0; i < SEGMENT.height; i++) {
 
-      indexx = inoise8(j*yscale*SEGMENT.height/255, i*xscale+millis()/4);                                             // We're moving along our Perlin map.
+      indexx = inoise8(j*yscale*SEGMENT.height/255, i*xscale+now/4);                                             // We're moving along our Perlin map.
       leds[XY(j,i)] = ColorFromPalette(currentPalette, min(i*(indexx)>>4, 255), i*255/SEGMENT.width, LINEARBLEND);  // With that value, look up the 8 bit colour palette value and assign it to the current LED.
 
 // This perlin fire is by /u/ldirko
@@ -4806,15 +4801,17 @@ typedef struct ColorCount {
 uint16_t WS2812FX::mode_2Dgameoflife(void) { // Written by Ewoud Wijma, inspired by https://natureofcode.com/book/chapter-7-cellular-automata/ and https://github.com/DougHaber/nlife-color
 
   //slow down based on speed parameter
-  if (millis() - SEGENV.step >= ((255-SEGMENT.speed)*4)) {
-    SEGENV.step = millis();
+  if (now - SEGENV.step >= ((255-SEGMENT.speed)*4)) {
+    SEGENV.step = now;
 
     CRGB prevLeds[32*32]; //MAX_LED causes a panic, but this will do
+    if (SEGMENT.stop > 32*32) return mode_static(); // prevLeds is indexed with XY(), which goes up to the end of the segment
 
     //array of patterns. Needed to identify repeating patterns. A pattern is one iteration of leds, without the color (on/off only)
+    //patterns are kept as hashes: segment data is freed without destructors, so it can't hold Strings
     const int patternsSize = (SEGMENT.width + SEGMENT.height) * 2; //seems to be a good value to catch also repetition in moving patterns
-    if (!SEGENV.allocateData(sizeof(String) * patternsSize)) return mode_static(); //allocation failed
-    String* patterns = reinterpret_cast<String*>(SEGENV.data);
+    if (!SEGENV.allocateData(sizeof(uint32_t) * patternsSize)) return mode_static(); //allocation failed
+    uint32_t* patterns = reinterpret_cast<uint32_t*>(SEGENV.data);
 
     CRGB backgroundColor = SEGCOLOR(1);
 
@@ -4827,14 +4824,14 @@ uint16_t WS2812FX::mode_2Dgameoflife(void) { // Written by Ewoud Wijma, inspired
         if (leds[XY(x,y)].r > 10 || leds[XY(x,y)].g > 10 || leds[XY(x,y)].b > 10) //looks like some pixels are not completely off
           allZero = false;
       if (!allZero)
-        resetMillis = millis(); //avoid reset
+        resetMillis = now; //avoid reset
     }
 
     //reset leds if effect repeats (wait 3 seconds after repetition)
-    if (millis() - resetMillis > 3000) {
-      resetMillis = millis();
+    if (now - resetMillis > 3000) {
+      resetMillis = now;
 
-      random16_set_seed(millis()); //seed the random generator
+      random16_set_seed(now); //seed the random generator
 
       //give the leds random state and colors (based on intensity, colors from palette or all posible colors are chosen)
       for (int x = 0; x < SEGMENT.width; x++) for (int y = 0; y < SEGMENT.height; y++) {
@@ -4847,7 +4844,7 @@ uint16_t WS2812FX::mode_2Dgameoflife(void) { // Written by Ewoud Wijma, inspired
 
       //init patterns
       SEGENV.aux0 = 0; //ewowi20210629: pka static! patternsize: round robin index of next slot to add pattern
-      for (int i=0; i<patternsSize; i++) patterns[i] = "";
+      for (int i=0; i<patternsSize; i++) patterns[i] = 0;
     }
     else {
       //copy previous leds
@@ -4892,9 +4889,9 @@ uint16_t WS2812FX::mode_2Dgameoflife(void) { // Written by Ewoud Wijma, inspired
       } //x,y
 
       //create new pattern
-      String pattern = "";
+      uint32_t pattern = 2166136261UL; //FNV-1a hash of the on/off states
       for (int x = 0; x < SEGMENT.width; x+=MAX(SEGMENT.width/8,1)) for (int y = 0; y < SEGMENT.height; y+=MAX(SEGMENT.height/8,1))
-        pattern += leds[XY(x,y)] == backgroundColor?" ":"o"; //string representation if on/off
+        pattern = (pattern ^ (leds[XY(x,y)] == backgroundColor?0:1)) * 16777619UL;
 
       //check if repetition of patterns occurs
       bool repetition = false;
@@ -4905,7 +4902,7 @@ uint16_t WS2812FX::mode_2Dgameoflife(void) { // Written by Ewoud Wijma, inspired
       patterns[SEGENV.aux0] = pattern;
       SEGENV.aux0 = (SEGENV.aux0+1)%patternsSize;
 
-      if (!repetition) resetMillis = millis(); //if no repetition avoid reset
+      if (!repetition) resetMillis = now; //if no repetition avoid reset
     } //not reset
 
     setPixels(leds);
@@ -4921,7 +4918,7 @@ uint16_t WS2812FX::mode_2Dgameoflife(void) { // Written by Ewoud Wijma, inspired
 
 uint16_t WS2812FX::mode_2DHiphotic() {                        //  By: ldirko  https://editor.soulmatelights.com/gallery/810 , Modified by: Andrew Tuline
 
-  int a = millis() / 8;
+  int a = now / 8;
 
   for (int x = 0; x < SEGMENT.width; x++) {
     for (int y = 0; y < SEGMENT.height; y++) {
@@ -4945,36 +4942,90 @@ uint16_t WS2812FX::mode_2DHiphotic() {                        //  By: ldirko  ht
 
 // Sliders are:
 //
+// speed = Half resolution render with bilinear upscale (above 128)
 // intensity = Maximum number of iterations per pixel.
 // Custom1 = Location of X centerpoint
 // Custom2 = Location of Y centerpoint
 // Custom3 = Size of the area (small value = smaller area)
 
+// The per pixel iteration runs in Q3.13 fixed point: |a| and |b| stay below 4 so a*a, b*b and a*b fit in 32 bits.
+// This avoids (soft) float math per pixel, which made the effect unusable on ESP8266.
+#define JULIA_FRAC 13
+
 typedef struct Julia {              // We can't use the 'static' keyword for persistent variables, so we have to go the LONG route to support them.
   float xcen;
   float ycen;
   float xymag;
+  uint8_t iterBudget;               // Iteration limit adapted to the measured render time
 } julia;
 
 
+static uint8_t julia_iterate(int32_t a, int32_t b, int32_t reAl, int32_t imAg, uint8_t maxIterations) {
+  const int32_t  maxAxis = 4L << JULIA_FRAC;
+  const uint32_t maxCalc = 16UL << (2*JULIA_FRAC);   // How big is each calculation allowed to be before we give up.
+  uint8_t iter = 0;
+
+  while (iter < maxIterations) {    // Here we determine whether or not we're out of bounds.
+    if (a >= maxAxis || a <= -maxAxis || b >= maxAxis || b <= -maxAxis) break; // |z| > 4, also guards the products below against overflow
+    int32_t aa = a * a;
+    int32_t bb = b * b;
+    if ((uint32_t)aa + (uint32_t)bb > maxCalc) break; // |z| = sqrt(a^2+b^2) OR z^2 = a^2+b^2 to save on having to perform a square root.
+
+    // This operation corresponds to z -> z^2+c where z=a+ib c=(x,y). Remember to use 'foil'.
+    b = ((a * b) >> (JULIA_FRAC - 1)) + imAg;
+    a = ((aa - bb) >> JULIA_FRAC) + reAl;
+    iter++;
+  }
+  return iter;
+}
+
+// Bilinear 2x upscale of a half resolution 8 bit field with (width/2+1) columns.
+// If keepZero is set, samples of 0 mark "empty" areas: they are not blended and stay 0.
+static uint8_t upscale2x(const uint8_t* buf, uint16_t cols, uint16_t x, uint16_t y, bool keepZero) {
+  const uint8_t* p = buf + (y >> 1) * cols + (x >> 1);
+  uint8_t p00 = p[0];
+  if (keepZero && p00 == 0) return 0;
+  uint8_t p01 = (x & 1) ? p[1]      : p00;
+  uint8_t p10 = (y & 1) ? p[cols]   : p00;
+  uint8_t p11 = (x & 1) ? ((y & 1) ? p[cols+1] : p01) : p10;
+  if (keepZero) {
+    if (!p01) p01 = p00;
+    if (!p10) p10 = p00;
+    if (!p11) p11 = p00;
+  }
+  return (p00 + p01 + p10 + p11 + 2) >> 2;
+}
+
+
 uint16_t WS2812FX::mode_2DJulia(void) {                           // An animated Julia set by Andrew Tuline.
 
-  if (!SEGENV.allocateData(sizeof(julia))) return mode_static();  // We use this method for allocating memory for static variables.
+  bool halfRes = SEGMENT.speed > 128;
+  uint16_t cols = (SEGMENT.width >> 1) + 1;
+  uint16_t rows = (SEGMENT.height >> 1) + 1;
+  uint16_t dataSize = sizeof(julia) + (halfRes ? cols * rows : 0);
+
+  if (!SEGENV.allocateData(dataSize)) {                           // Not enough memory for the half resolution buffer, render at full resolution.
+    halfRes = false;
+    if (!SEGENV.allocateData(sizeof(julia))) return mode_static(); // We use this method for allocating memory for static variables.
+  }
   Julia* julias = reinterpret_cast<Julia*>(SEGENV.data);          // Because 'static' doesn't work with SEGMENTS.
+  uint8_t* field = SEGENV.data + sizeof(julia);
 
   float reAl;
   float imAg;
 
   if (SEGENV.call == 0) {           // Reset the center if we've just re-started this animation.
-    julias->xcen = 0.;
-    julias->ycen = 0.;
-    julias->xymag = 1.0;
-
     SEGMENT.custom1 = 128;             // Make sure the location widgets are centered to start. Too bad
     SEGMENT.custom2 = 128;             // it doesn't show up on the UI.
     SEGMENT.custom3 = 128;
     SEGMENT.intensity = 24;
   }
+  if (SEGENV.call == 0 || julias->xymag == 0.) { // (Re)allocated data is zeroed, so this also catches a resolution switch.
+    julias->xcen = 0.;
+    julias->ycen = 0.;
+    julias->xymag = 1.0;
+    julias->iterBudget = 127;
+  }
 
   julias->xcen = julias->xcen + (float)(SEGMENT.custom1 - 128)/100000.;
   julias->ycen = julias->ycen + (float)(SEGMENT.custom2 - 128)/100000.;
@@ -4993,67 +5044,75 @@ uint16_t WS2812FX::mode_2DJulia(void) {                           // An animated
   ymin = constrain(ymin,-.8,1.0);
   ymax = constrain(ymax,-.8,1.0);
 
-  float dx;                       // Delta x is mapped to the matrix size.
-  float dy;                       // Delta y is mapped to the matrix size.
-
-  int maxIterations = 15;         // How many iterations per pixel before we give up. Make it 8 bits to match our range of colours.
-  float maxCalc = 16.0;           // How big is each calculation allowed to be before we give up.
-
-  maxIterations = SEGMENT.intensity/2;
-
+  // How many iterations per pixel before we give up. Capped by the budget that keeps us within the frame time.
+  uint8_t maxIterations = MIN(SEGMENT.intensity/2, julias->iterBudget);
 
 // Resize section on the fly for some animaton.
   reAl = -0.94299;                // PixelBlaze example
   imAg = 0.3162;
 
-  reAl += sin((float)millis()/305.)/20.;
-  imAg += sin((float)millis()/405.)/20.;
-
-//  Serial.print(reAl,4); Serial.print("\t"); Serial.print(imAg,4); Serial.println(" ");
-
-  dx = (xmax - xmin) / (SEGMENT.width);     // Scale the delta x and y values to our matrix size.
-  dy = (ymax - ymin) / (SEGMENT.height);
-
-  // Start y
-  float y = ymin;
-  for (int j = 0; j < SEGMENT.height; j++) {
+  reAl += sin((float)now/305.)/20.;
+  imAg += sin((float)now/405.)/20.;
+
+  // Per frame conversion to fixed point. Positions are stepped in Q16.16 to keep the deltas precise when zoomed in.
+  int32_t re = reAl * (1L << JULIA_FRAC);
+  int32_t im = imAg * (1L << JULIA_FRAC);
+  int32_t x0 = xmin * 65536.f;
+  int32_t y0 = ymin * 65536.f;
+  int32_t dx = (xmax - xmin) * 65536.f / SEGMENT.width;     // Scale the delta x and y values to our matrix size.
+  int32_t dy = (ymax - ymin) * 65536.f / SEGMENT.height;
+
+  uint32_t renderStart = micros();
+
+  if (halfRes) {
+    // Iterate every second pixel and row (plus one extra sample on the far edge), 0 marks pixels within the set.
+    int32_t y = y0;
+    for (int j = 0; j < rows; j++) {
+      int32_t x = x0;
+      for (int i = 0; i < cols; i++) {
+        uint8_t iter = julia_iterate(x >> (16 - JULIA_FRAC), y >> (16 - JULIA_FRAC), re, im, maxIterations);
+        field[j * cols + i] = (iter == maxIterations) ? 0 : 1 + iter*254/maxIterations;
+        x += 2*dx;
+      }
+      y += 2*dy;
+    }
+    for (int j = 0; j < SEGMENT.height; j++) {
+      for (int i = 0; i < SEGMENT.width; i++) {
+        uint8_t v = upscale2x(field, cols, i, j, true);
+        if (v == 0) setPixelColor(XY(i,j), 0);
+        else        setPixelColor(XY(i,j), color_from_palette((v-1)*255/254, false, PALETTE_SOLID_WRAP, 0));
+      }
+    }
+  } else {
+    // Start y
+    int32_t y = y0;
+    for (int j = 0; j < SEGMENT.height; j++) {
 
-    // Start x
-    float x = xmin;
-    for (int i = 0; i < SEGMENT.width; i++) {
+      // Start x
+      int32_t x = x0;
+      for (int i = 0; i < SEGMENT.width; i++) {
 
-      // Now we test, as we iterate z = z^2 + c does z tend towards infinity?
-      float a = x;
-      float b = y;
-      int iter = 0;
+        // Now we test, as we iterate z = z^2 + c does z tend towards infinity?
+        uint8_t iter = julia_iterate(x >> (16 - JULIA_FRAC), y >> (16 - JULIA_FRAC), re, im, maxIterations);
 
-      while (iter < maxIterations) {    // Here we determine whether or not we're out of bounds.
-        float aa = a * a;
-        float bb = b * b;
-        float len = aa + bb;
-        if (len > maxCalc) {            // |z| = sqrt(a^2+b^2) OR z^2 = a^2+b^2 to save on having to perform a square root.
-          break;  // Bail
+        // We color each pixel based on how long it takes to get to infinity, or black if it never gets there.
+        if (iter == maxIterations) {
+          setPixelColor(XY(i,j),0);       // Calculation kept on going, so it was within the set.
+        } else {
+          setPixelColor(XY(i,j), color_from_palette(iter*255/maxIterations, false, PALETTE_SOLID_WRAP, 0));
         }
-
-       // This operation corresponds to z -> z^2+c where z=a+ib c=(x,y). Remember to use 'foil'.
-        b = 2*a*b + imAg;
-        a = aa - bb + reAl;
-        iter++;
-      } // while
-
-      // We color each pixel based on how long it takes to get to infinity, or black if it never gets there.
-      if (iter == maxIterations) {
-//        leds[XY(i,j)] = CRGB::Black;            // Calculation kept on going, so it was within the set.
-        setPixelColor(XY(i,j),0);
-      } else {
-//        leds[XY(i,j)] = CHSV(iter*255/maxIterations,255,255);   // Near the edge of the set.
-        setPixelColor(XY(i,j), color_from_palette(iter*255/maxIterations, false, PALETTE_SOLID_WRAP, 0));
+        x += dx;
       }
-      x += dx;
+      y += dy;
     }
-    y += dy;
   }
 
+  // Adapt the iteration budget: back off quickly if we use more than half of the frame time, recover slowly.
+  uint32_t renderTime = micros() - renderStart;
+  uint32_t budget = FRAMETIME * 500;
+  if (renderTime > budget && julias->iterBudget > 8) julias->iterBudget -= (julias->iterBudget >> 3) + 1;
+  else if (renderTime < budget/2 && julias->iterBudget < 127) julias->iterBudget++;
+
 //  blur2d( leds, 64);
 
 //  setPixels(leds);       // Use this ONLY if we're going to display via leds[x] method.
@@ -5072,12 +5131,12 @@ uint16_t WS2812FX::mode_2DLissajous(void) {            // By: Andrew Tuline
 
   for (int i=0; i < 256; i ++) {
 
-    uint8_t xlocn = sin8(millis()/2+i*SEGMENT.speed/64);
-    uint8_t ylocn = cos8(millis()/2+i*128/64);
+    uint8_t xlocn = sin8(now/2+i*SEGMENT.speed/64);
+    uint8_t ylocn = cos8(now/2+i*128/64);
 
     xlocn = map(xlocn,0,255,0,SEGMENT.width-1);
     ylocn = map(ylocn,0,255,0,SEGMENT.height-1);
-    leds[XY(xlocn,ylocn)] = ColorFromPalette(currentPalette, millis()/100+i, 255, LINEARBLEND);
+    leds[XY(xlocn,ylocn)] = ColorFromPalette(currentPalette, now/100+i, 255, LINEARBLEND);
   }
 
   setPixels(leds);
@@ -5108,8 +5167,8 @@ uint16_t WS2812FX::mode_2Dmatrix(void) {                  // Matrix2D. By Jeremy
     trailColor = CRGB(27,130,39);
   }
 
-  if (millis() - SEGENV.step >= speed) {
-    SEGENV.step = millis();
+  if (now - SEGENV.step >= speed) {
+    SEGENV.step = now;
     // if (SEGMENT.custom3 < 128) {									            // check for orientation, slider in first quarter, default orientation
     	for (int16_t row=SEGMENT.height-1; row>=0; row--) {
     		for (int16_t col=0; col<SEGMENT.width; col++) {
@@ -5153,40 +5212,59 @@ uint16_t WS2812FX::mode_2Dmatrix(void) {                  // Matrix2D. By Jeremy
 //     2D Metaballs    //
 /////////////////////////
 
+// Sliders are:
+//
+// speed = Half resolution render with bilinear upscale (above 128)
+
+// Field strength of the 3 balls at (x,y) in integer math: sqrt16() instead of float sqrt() per pixel.
+static uint8_t metaballs_field(int16_t x, int16_t y, uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, uint8_t x3, uint8_t y3) {
+  // calculate distances of the 3 points from actual pixel
+  // and add them together with weightening
+  uint32_t dx = abs(x - x1);
+  uint32_t dy = abs(y - y1);
+  uint16_t dist = 2 * sqrt16(MIN(dx * dx + dy * dy, 65535UL));
+
+  dx = abs(x - x2);
+  dy = abs(y - y2);
+  dist += sqrt16(MIN(dx * dx + dy * dy, 65535UL));
+
+  dx = abs(x - x3);
+  dy = abs(y - y3);
+  dist += sqrt16(MIN(dx * dx + dy * dy, 65535UL));
+
+  // inverse result
+  return dist ? MIN(1000 / dist, 255) : 255;
+}
+
 uint16_t WS2812FX::mode_2Dmetaballs(void) {   // Metaballs by Stefan Petrick. Cannot have one of the dimensions be 2 or less. Adapted by Andrew Tuline.
 
-  float speed = 1;
+  uint16_t cols = (SEGMENT.width >> 1) + 1;
+  uint16_t rows = (SEGMENT.height >> 1) + 1;
+  bool halfRes = SEGMENT.speed > 128 && SEGENV.allocateData(cols * rows);
 
   // get some 2 random moving points
-  uint8_t x2 = inoise8(millis() * speed, 25355, 685 ) / 16;
-  uint8_t y2 = inoise8(millis() * speed, 355, 11685 ) / 16;
+  uint8_t x2 = inoise8(now, 25355, 685 ) / 16;
+  uint8_t y2 = inoise8(now, 355, 11685 ) / 16;
 
-  uint8_t x3 = inoise8(millis() * speed, 55355, 6685 ) / 16;
-  uint8_t y3 = inoise8(millis() * speed, 25355, 22685 ) / 16;
+  uint8_t x3 = inoise8(now, 55355, 6685 ) / 16;
+  uint8_t y3 = inoise8(now, 25355, 22685 ) / 16;
 
   // and one Lissajou function
-  uint8_t x1 = beatsin8(23 * speed, 0, 15);
-  uint8_t y1 = beatsin8(28 * speed, 0, 15);
+  uint8_t x1 = beatsin8(23, 0, 15);
+  uint8_t y1 = beatsin8(28, 0, 15);
+
+  if (halfRes) {
+    // sample the field on every second pixel and row (plus one extra sample on the far edge)
+    for (uint16_t y = 0; y < rows; y++) {
+      for (uint16_t x = 0; x < cols; x++) {
+        SEGENV.data[y * cols + x] = metaballs_field(2*x, 2*y, x1, y1, x2, y2, x3, y3);
+      }
+    }
+  }
 
   for (uint16_t y = 0; y < SEGMENT.height; y++) {
     for (uint16_t x = 0; x < SEGMENT.width; x++) {
-
-      // calculate distances of the 3 points from actual pixel
-      // and add them together with weightening
-      uint16_t  dx =  abs(x - x1);
-      uint16_t  dy =  abs(y - y1);
-      uint16_t dist = 2 * sqrt((dx * dx) + (dy * dy));
-
-      dx =  abs(x - x2);
-      dy =  abs(y - y2);
-      dist += sqrt((dx * dx) + (dy * dy));
-
-      dx =  abs(x - x3);
-      dy =  abs(y - y3);
-      dist += sqrt((dx * dx) + (dy * dy));
-
-      // inverse result
-      byte color = 1000 / dist;//dist=0?1000: 1000 / dist;
+      byte color = halfRes ? upscale2x(SEGENV.data, cols, x, y, false) : metaballs_field(x, y, x1, y1, x2, y2, x3, y3);
 
       // map color between thresholds
       if (color > 0 and color < 60) {
@@ -5194,13 +5272,14 @@ uint16_t WS2812FX::mode_2Dmetaballs(void) {   // Metaballs by Stefan Petrick. Ca
       } else {
         leds[XY(x, y)] = ColorFromPalette(currentPalette, 0, 255);
       }
-        // show the 3 points, too
-        leds[XY(x1,y1)] = CRGB(255, 255,255);
-        leds[XY(x2,y2)] = CRGB(255, 255,255);
-        leds[XY(x3,y3)] = CRGB(255, 255,255);
     }
   }
 
+  // show the 3 points, too
+  leds[XY(x1,y1)] = CRGB(255, 255,255);
+  leds[XY(x2,y2)] = CRGB(255, 255,255);
+  leds[XY(x3,y3)] = CRGB(255, 255,255);
+
   setPixels(leds);
 
   return FRAMETIME;
@@ -5217,7 +5296,7 @@ uint16_t WS2812FX::mode_2Dnoise(void) {                  // By Andrew Tuline
 
   for (uint16_t y = 0; y < SEGMENT.height; y++) {
     for (uint16_t x = 0; x < SEGMENT.width; x++) {
-      uint8_t pixelHue8 = inoise8(x * scale, y * scale, millis() / (16 - SEGMENT.speed/16));
+      uint8_t pixelHue8 = inoise8(x * scale, y * scale, now / (16 - SEGMENT.speed/16));
       leds[XY(x, y)] = ColorFromPalette(currentPalette, pixelHue8);
     }
   }
@@ -5234,7 +5313,7 @@ uint16_t WS2812FX::mode_2Dnoise(void) {                  // By Andrew Tuline
 uint16_t WS2812FX::mode_2DPlasmaball(void) {                   // By: Stepko https://editor.soulmatelights.com/gallery/659-plasm-ball , Modified by: Andrew Tuline
 
   fadeToBlackBy(leds, 64);
-  double t = millis() / (33 - SEGMENT.speed/8);
+  double t = now / (33 - SEGMENT.speed/8);
   for (uint16_t i = 0; i < SEGMENT.width; i++) {
     uint16_t thisVal = inoise8(i * 30, t, t);
     uint16_t thisMax = map(thisVal, 0, 255, 0, SEGMENT.width);
@@ -5278,7 +5357,7 @@ uint16_t WS2812FX::mode_2DPolarLights() {            // By: Kostyantyn Matviyevs
 
   uint16_t adjScale = map(SEGMENT.width, 8, 64, 310, 63);
 
-  static unsigned long timer;        // Cannot be uint16_t value (aka aux0)
+  uint32_t &timer = SEGENV.step;     // Cannot be uint16_t value (aka aux0)
 
   if (SEGENV.aux1 != SEGMENT.custom1/12) {   // Hacky palette rotation. We need that black.
 
@@ -5324,7 +5403,7 @@ uint16_t WS2812FX::mode_2DPulser() {                       // By: ldirko   https
   if (SEGENV.call == 0) FastLED.clear();
 
   static byte r = 16;
-  uint16_t a = millis() / (18 - SEGMENT.speed / 16);
+  uint16_t a = now / (18 - SEGMENT.speed / 16);
   byte x = (a / 14) % SEGMENT.width;
   byte y = (sin8(a * 5) + sin8(a * 4) + sin8(a * 2)) / 3 * r / 255;
   uint16_t index = XY (x, (SEGMENT.height / 2 - r / 2 + y) % SEGMENT.width);
@@ -5343,7 +5422,7 @@ uint16_t WS2812FX::mode_2DPulser() {                       // By: ldirko   https
 uint16_t WS2812FX::mode_2DSindots() {                             // By: ldirko   https://editor.soulmatelights.com/gallery/597-sin-dots , modified by: Andrew Tuline
 
   fadeToBlackBy(leds, 15);
-  byte t1 = millis() / (257 - SEGMENT.speed); // 20;
+  byte t1 = now / (257 - SEGMENT.speed); // 20;
   byte t2 = sin8(t1) / 4 * 2;
   for (uint16_t i = 0; i < 13; i++) {
     byte x = sin8(t1 + i * SEGMENT.intensity/8)*(SEGMENT.width-1)/255;  //   max index now 255x15/255=15!
@@ -5380,7 +5459,7 @@ uint16_t WS2812FX::mode_2Dsquaredswirl(void) {            // By: Mark Kriegsman.
   uint8_t  n = beatsin8(15, kBorderWidth, SEGMENT.height-kBorderWidth);
   uint8_t  p = beatsin8(20, kBorderWidth, SEGMENT.height-kBorderWidth);
 
-  uint16_t ms = millis();
+  uint16_t ms = now;
 
   leds[XY( i, m)] += ColorFromPalette(currentPalette, ms/29, 255, LINEARBLEND);
   leds[XY( j, n)] += ColorFromPalette(currentPalette, ms/41, 255, LINEARBLEND);
@@ -5400,7 +5479,8 @@ uint16_t WS2812FX::mode_2DSunradiation(void) {                   // By: ldirko h
                                                                  // Does not yet support segments.
 
   static CRGB chsvLut[256];
-  static byte bump[1156];             // Don't go beyond a 32x32 matrix!!!  or (SEGMENT.width+2) * (mtrixHeight+2)
+  if (!SEGENV.allocateData((SEGMENT.width + 2) * (SEGMENT.height + 2))) return mode_static(); //allocation failed
+  byte* bump = SEGENV.data;
 
   if (SEGMENT.intensity != SEGENV.aux0) {
     SEGENV.aux0 = SEGMENT.intensity;
@@ -5409,7 +5489,7 @@ uint16_t WS2812FX::mode_2DSunradiation(void) {                   // By: ldirko h
     }
   }
 
-  int t = millis() / 4;
+  int t = now / 4;
   int index = 0;
   uint8_t someVal = SEGMENT.speed/4;             // Was 25.
   for (uint16_t j = 0; j < (SEGMENT.height + 2); j++) {
@@ -5457,7 +5537,7 @@ uint16_t WS2812FX::mode_2DSwirl(void) {             // By: Mark Kriegsman https:
   uint8_t  j = beatsin8( 41*SEGMENT.speed/255, borderWidth, SEGMENT.width - borderWidth);
   uint8_t ni = (SEGMENT.width - 1) - i;
   uint8_t nj = (SEGMENT.width - 1) - j;
-  uint16_t ms = millis();
+  uint16_t ms = now;
 
   int tmpSound = (soundAgc) ? rawSampleAgc : sampleRaw;
 
@@ -5506,7 +5586,7 @@ uint16_t WS2812FX::mode_2DWaverly(void) {
 
   fadeToBlackBy(leds, SEGMENT.speed);
 
-  long t = millis() / 2;
+  long t = now / 2;
   for (uint16_t i = 0; i < SEGMENT.width; i++) {
   //  byte thisVal = inoise8(i * 45 , t , t);
   // byte thisMax = map(thisVal, 0, 255, 0, SEGMENT.height);
@@ -5560,7 +5640,7 @@ uint16_t WS2812FX::mode_gravcenter(void) {                // Gravcenter. By Andr
   uint8_t gravity = 8 - SEGMENT.speed/32;
 
   for (int i=0; i<tempsamp; i++) {
-    uint8_t index = inoise8(i*segmentSampleAvg+millis(), 5000+i*segmentSampleAvg);
+    uint8_t index = inoise8(i*segmentSampleAvg+now, 5000+i*segmentSampleAvg);
     setPixelColor(i+SEGLEN/2, color_blend(SEGCOLOR(1), color_from_palette(index, false, PALETTE_SOLID_WRAP, 0), segmentSampleAvg*8));
     setPixelColor(SEGLEN/2-i-1, color_blend(SEGCOLOR(1), color_from_palette(index, false, PALETTE_SOLID_WRAP, 0), segmentSampleAvg*8));
   }
@@ -5571,8 +5651,8 @@ uint16_t WS2812FX::mode_gravcenter(void) {                // Gravcenter. By Andr
     gravcen->topLED--;
 
   if (gravcen->topLED >= 0) {
-    setPixelColor(gravcen->topLED+SEGLEN/2, color_from_palette(millis(), false, PALETTE_SOLID_WRAP, 0));
-    setPixelColor(SEGLEN/2-1-gravcen->topLED, color_from_palette(millis(), false, PALETTE_SOLID_WRAP, 0));
+    setPixelColor(gravcen->topLED+SEGLEN/2, color_from_palette(now, false, PALETTE_SOLID_WRAP, 0));
+    setPixelColor(SEGLEN/2-1-gravcen->topLED, color_from_palette(now, false, PALETTE_SOLID_WRAP, 0));
   }
   gravcen->gravityCounter = (gravcen->gravityCounter + 1) % gravity;
 
@@ -5602,7 +5682,7 @@ uint16_t WS2812FX::mode_gravcentric(void) {                     // Gravcentric.
   uint8_t gravity = 8 - SEGMENT.speed/32;
 
   for (int i=0; i<tempsamp; i++) {
-    uint8_t index = segmentSampleAvg*24+millis()/200;
+    uint8_t index = segmentSampleAvg*24+now/200;
     setPixelColor(i+SEGLEN/2, color_from_palette(index, false, PALETTE_SOLID_WRAP, 0));
     setPixelColor(SEGLEN/2-1-i, color_from_palette(index, false, PALETTE_SOLID_WRAP, 0));
   }
@@ -5643,7 +5723,7 @@ uint16_t WS2812FX::mode_gravimeter(void) {                // Gravmeter. By Andre
   uint8_t gravity = 8 - SEGMENT.speed/32;
 
   for (int i=0; i<tempsamp; i++) {
-    uint8_t index = inoise8(i*segmentSampleAvg+millis(), 5000+i*segmentSampleAvg);
+    uint8_t index = inoise8(i*segmentSampleAvg+now, 5000+i*segmentSampleAvg);
     setPixelColor(i, color_blend(SEGCOLOR(1), color_from_palette(index, false, PALETTE_SOLID_WRAP, 0), segmentSampleAvg*8));
   }
 
@@ -5653,7 +5733,7 @@ uint16_t WS2812FX::mode_gravimeter(void) {                // Gravmeter. By Andre
     gravcen->topLED--;
 
   if (gravcen->topLED > 0) {
-    setPixelColor(gravcen->topLED, color_from_palette(millis(), false, PALETTE_SOLID_WRAP, 0));
+    setPixelColor(gravcen->topLED, color_from_palette(now, false, PALETTE_SOLID_WRAP, 0));
   }
   gravcen->gravityCounter = (gravcen->gravityCounter + 1) % gravity;
 
@@ -5694,7 +5774,7 @@ uint16_t WS2812FX::mode_gravimeter(void) {                // Gravmeter. By Andre
   if (sampleAvg > 1)                                                 // disable bar "body" if below squelch
   {
     for (int i=0; i<tempsamp; i++) {
-      uint8_t index = inoise8(i*segmentSampleAvg+millis(), 5000+i*segmentSampleAvg);
+      uint8_t index = inoise8(i*segmentSampleAvg+now, 5000+i*segmentSampleAvg);
       setPixelColor(i, color_blend(SEGCOLOR(1), color_from_palette(index, false, PALETTE_SOLID_WRAP, 0), segmentSampleAvg*4.0));
     }
   }
@@ -5704,7 +5784,7 @@ uint16_t WS2812FX::mode_gravimeter(void) {                // Gravmeter. By Andre
     gravcen->topLED--;
 
   if (gravcen->topLED > 0) {
-    setPixelColor(gravcen->topLED, color_from_palette(millis(), false, PALETTE_SOLID_WRAP, 0));
+    setPixelColor(gravcen->topLED, color_from_palette(now, false, PALETTE_SOLID_WRAP, 0));
   }
   gravcen->gravityCounter = (gravcen->gravityCounter + 1) % gravity;
 
@@ -5722,7 +5802,7 @@ uint16_t WS2812FX::mode_juggles(void) {                   // Juggles. By Andrew
   int my_sampleAgc = fmax(fmin(sampleAgc, 255.0), 0);
 
   for (int i=0; i<SEGMENT.intensity/32+1; i++) {
-          setPixelColor(beatsin16(SEGMENT.speed/4+i*2,0,SEGLEN-1), color_blend(SEGCOLOR(1), color_from_palette(millis()/4+i*2, false, PALETTE_SOLID_WRAP, 0), my_sampleAgc));
+          setPixelColor(beatsin16(SEGMENT.speed/4+i*2,0,SEGLEN-1), color_blend(SEGCOLOR(1), color_from_palette(now/4+i*2, false, PALETTE_SOLID_WRAP, 0), my_sampleAgc));
   }
 
   return FRAMETIME;
@@ -5741,7 +5821,7 @@ uint16_t WS2812FX::mode_matripix(void) {                  // Matripix. By Andrew
     SEGENV.aux0 = secondHand;
     uint8_t tmpSound = (soundAgc) ? rawSampleAgc : sampleRaw;
     int pixBri = tmpSound * SEGMENT.intensity / 64;
-    leds[segmentToLogical(SEGLEN-1)] = color_blend(SEGCOLOR(1), color_from_palette(millis(), false, PALETTE_SOLID_WRAP, 0), pixBri);
+    leds[segmentToLogical(SEGLEN-1)] = color_blend(SEGCOLOR(1), color_from_palette(now, false, PALETTE_SOLID_WRAP, 0), pixBri);
     for (int i=0; i<SEGLEN-1; i++) leds[segmentToLogical(i)] = leds[segmentToLogical(i+1)];
   }
 
@@ -5793,7 +5873,7 @@ uint16_t WS2812FX::mode_noisefire(void) {                 // Noisefire. By Andre
                                  CRGB::Yellow, CRGB::Orange, CRGB::Yellow, CRGB::Yellow);
 
   for (int i = 0; i < SEGLEN; i++) {
-    uint16_t index = inoise8(i*SEGMENT.speed/64,millis()*SEGMENT.speed/64*SEGLEN/255);  // X location is constant, but we move along the Y at the rate of millis(). By Andrew Tuline.
+    uint16_t index = inoise8(i*SEGMENT.speed/64,now*SEGMENT.speed/64*SEGLEN/255);  // X location is constant, but we move along the Y at the rate of millis(). By Andrew Tuline.
     index = (255 - i*256/SEGLEN) * index/(256-SEGMENT.intensity);                       // Now we need to scale index so that it gets blacker as we get close to one of the ends.
                                                                                         // This is a simple y=mx+b equation that's been scaled. index/128 is another scaling.
 
@@ -5866,7 +5946,7 @@ uint16_t WS2812FX::mode_pixelwave(void) {                 // Pixelwave. By Andre
 
     uint8_t tmpSound = (soundAgc) ? rawSampleAgc : sampleRaw;
     int pixBri = tmpSound * SEGMENT.intensity / 64;
-    leds[segmentToLogical(SEGLEN/2)] = color_blend(SEGCOLOR(1), color_from_palette(millis(), false, PALETTE_SOLID_WRAP, 0), pixBri);
+    leds[segmentToLogical(SEGLEN/2)] = color_blend(SEGCOLOR(1), color_from_palette(now, false, PALETTE_SOLID_WRAP, 0), pixBri);
 
     for (int i=SEGLEN-1; i>SEGLEN/2; i--) {               // Move to the right.
       leds[segmentToLogical(i)] = leds[segmentToLogical(i-1)];
@@ -5942,7 +6022,7 @@ uint16_t WS2812FX::mode_puddlepeak(void) {                // Puddlepeak. By Andr
   }
 
   for(int i=0; i<size; i++) {                             // Flash the LED's.
-    setPixelColor(pos+i, color_from_palette(millis(), false, PALETTE_SOLID_WRAP, 0));
+    setPixelColor(pos+i, color_from_palette(now, false, PALETTE_SOLID_WRAP, 0));
   }
 
   return FRAMETIME;
@@ -5969,7 +6049,7 @@ uint16_t WS2812FX::mode_puddles(void) {                   // Puddles. By Andrew
   }
 
   for(int i=0; i<size; i++) {                             // Flash the LED's.
-    setPixelColor(pos+i, color_from_palette(millis(), false, PALETTE_SOLID_WRAP, 0));
+    setPixelColor(pos+i, color_from_palette(now, false, PALETTE_SOLID_WRAP, 0));
   }
 
   return FRAMETIME;
@@ -6108,7 +6188,7 @@ uint16_t WS2812FX::mode_binmap(void) {                    // Binmap. Scale raw f
 
     uint8_t bright = constrain(mapf(sumBin, 0, maxVal, 0, 255),0,255);  // Map the brightness in relation to maxVal and crunch to 8 bits.
 
-    setPixelColor(i, color_blend(SEGCOLOR(1), color_from_palette(i*8+millis()/50, false, PALETTE_SOLID_WRAP, 0), bright));  // 'i' is just an index in the palette. The FFT value, bright, is the intensity.
+    setPixelColor(i, color_blend(SEGCOLOR(1), color_from_palette(i*8+now/50, false, PALETTE_SOLID_WRAP, 0), bright));  // 'i' is just an index in the palette. The FFT value, bright, is the intensity.
 
   } // for i
 
@@ -6417,7 +6497,7 @@ uint16_t WS2812FX::mode_noisemove(void) {                 // Noisemove.    By: A
   uint8_t numBins = map(SEGMENT.intensity,0,255,0,16);    // Map slider to fftResult bins.
 
   for (int i=0; i<numBins; i++) {                         // How many active bins are we using.
-    uint16_t locn = inoise16(millis()*SEGMENT.speed+i*50000, millis()*SEGMENT.speed);   // Get a new pixel location from moving noise.
+    uint16_t locn = inoise16(now*SEGMENT.speed+i*50000, now*SEGMENT.speed);   // Get a new pixel location from moving noise.
 
     locn = map(locn,7500,58000,0,SEGLEN-1);               // Map that to the length of the strand, and ensure we don't go over.
     locn = locn % SEGLEN;                                 // Just to be bloody sure.
@@ -6515,21 +6595,23 @@ uint16_t WS2812FX::mode_waterfall(void) {                   // Waterfall. By: An
 /////////////////////////
 
 uint16_t WS2812FX::GEQ_base(bool centered_horizontal, bool centered_vertical, bool color_vertical) {                     // By Will Tatam. Refactor by Ewoud Wijma.
+  if (!SEGENV.allocateData(64 * sizeof(int16_t))) return mode_static(); //allocation failed
+  int16_t *previousBarHeight = reinterpret_cast<int16_t*>(SEGENV.data); //previous bar heights per frequency band
+
   fadeToBlackBy(leds, SEGMENT.speed);
 
   bool rippleTime;
-  if (millis() - SEGENV.step >= 255 - SEGMENT.intensity)
+  if (now - SEGENV.step >= 255 - SEGMENT.intensity)
   {
-    SEGENV.step = millis();
+    SEGENV.step = now;
     rippleTime = true;
   }
   else
     rippleTime = false;
 
-  static int previousBarHeight[64]; //array of previous bar heights per frequency band
-
   int xCount = SEGMENT.width;
   if (centered_vertical) xCount /= 2;
+  if (xCount > 64) xCount = 64; // previousBarHeight has room for 64 columns (a 1D segment is one row of SEGLEN columns)
 
   for (int x=0; x < xCount; x++) {
     int band = map(x, 0, xCount-1, 0, 15);
@@ -6715,7 +6797,7 @@ uint16_t WS2812FX::mode_2DAkemi(void) {
   //add geq left and right
   for (int x=0;x<SEGMENT.width/8;x++)
   {
-    int band = x*SEGMENT.width/8;
+    int band = constrain(x*SEGMENT.width/8, 0, 15);
     int barHeight = map(fftResult[band], 0, 255, 0, 17*SEGMENT.height/32);
     CRGB color = color_from_palette((band * 35), false, PALETTE_SOLID_WRAP, 0);
 
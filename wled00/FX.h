@@ -62,6 +62,8 @@
   #define MAX_NUM_SEGMENTS    16
   /* How many color transitions can run at once */
   #define MAX_NUM_TRANSITIONS  8
+  /* How many effect cross-fades can run at once */
+  #define MAX_NUM_MODE_TRANSITIONS 2
   /* How much data bytes all segments combined may allocate */
   #define MAX_SEGMENT_DATA  4096
 #else
@@ -69,6 +71,7 @@
     #define MAX_NUM_SEGMENTS  32
   #endif
   #define MAX_NUM_TRANSITIONS 24
+  #define MAX_NUM_MODE_TRANSITIONS 4
   #define MAX_SEGMENT_DATA  20480
 #endif
 
@@ -79,6 +82,17 @@
 // NEED WORKAROUND TO ACCESS PRIVATE CLASS VARIABLE '_frametime'
 #define MIN_SHOW_DELAY   (_frametime < 16 ? 8 : 15)
 
+// frame budget: a segment is never slowed down to less than 1/(MAX_FRAME_SHED+1) of the target FPS
+#define MAX_FRAME_SHED   7
+
+// effect benchmark: frames rendered per service() call at most, no more frames are started after FX_BENCH_SLICE_US
+#ifndef FX_BENCH_SLICE_FRAMES
+  #define FX_BENCH_SLICE_FRAMES 32
+#endif
+#ifndef FX_BENCH_SLICE_US
+  #define FX_BENCH_SLICE_US   10000
+#endif
+
 #define NUM_COLORS       3 /* number of colors per segment */
 #define SEGMENT          _segments[_segment_index]
 #define SEGCOLOR(x)      _colors_t[x]
@@ -329,6 +343,7 @@ class WS2812FX {
 
   // pre show callback
   typedef void (*show_callback) (void);
+  typedef void (*bench_frame_callback) (uint8_t mode, uint16_t frame); // frame of a golden run, rendered on the main segment
 
   static WS2812FX* instance;
 
@@ -442,12 +457,17 @@ class WS2812FX {
     } segment;
 
   // segment runtime parameters
-    typedef struct Segment_runtime { // 28 bytes
+    typedef struct Segment_runtime { // 32 bytes
       unsigned long next_time;  // millis() of next update
       uint32_t step;  // custom "step" var
       uint32_t call;  // call counter
       uint16_t aux0;  // custom var
       uint16_t aux1;  // custom var
+      uint16_t renderTime = 0; // smoothed render cost of one frame in us
+      uint8_t frames = 0;      // frames rendered since the last frame budget check
+      uint8_t fps = 0;         // frames rendered per second, measured at the last frame budget check
+      uint8_t shed = 0;        // load shedding: frame periods skipped between updates (0 = full rate)
+      bool audio = false;      // effect is audio reactive, slowed down last
       byte* data = nullptr;
       bool allocateData(uint16_t len){
         if (data && _dataLen == len) return true; //already allocated
@@ -483,6 +503,7 @@ class WS2812FX {
       void resetIfRequired() {
         if (_requiresReset) {
           next_time = 0; step = 0; call = 0; aux0 = 0; aux1 = 0;
+          renderTime = 0; shed = 0;
           deallocateData();
           _requiresReset = false;
         }
@@ -495,6 +516,19 @@ class WS2812FX {
        * Safe to call from interrupts and network requests.
        */
       inline void markForReset() { _requiresReset = true; }
+
+      /**
+       * Hands the state of the current effect (including its data buffer)
+       * over to another runtime, e.g. to keep rendering it during an effect
+       * cross-fade. This runtime no longer owns the data afterwards.
+       */
+      void moveTo(Segment_runtime &dest) {
+        dest.deallocateData();
+        dest = *this;
+        dest._requiresReset = false;
+        data = nullptr;
+        _dataLen = 0;
+      }
       private:
         uint16_t _dataLen = 0;
         bool _requiresReset = false;
@@ -585,6 +619,30 @@ class WS2812FX {
       }
     } color_transition;
 
+    /*
+     * Cross-fade between the outgoing and incoming effect of a segment. The outgoing effect keeps its
+     * runtime state and, like the incoming one, renders into its own pixel buffer (before any bus conversion),
+     * on top of its previous frame. Only the blend of both is sent to the busses. Only started and rendered from service().
+     * The outgoing effect also keeps its own copy of the segment's leds[], swapped in while it renders.
+     */
+    typedef struct ModeTransition { // 56 bytes
+      segment_runtime runtimeOld;       // state of the outgoing effect
+      uint32_t* pixelsOld = nullptr;    // last frame of the outgoing effect
+      uint32_t* pixelsNew = nullptr;    // last frame of the incoming effect
+      CRGB* ledsOld = nullptr;          // leds[] of the segment as the outgoing effect left them
+      uint32_t transitionStart;
+      uint16_t transitionDur;
+      uint16_t len = 0;                 // virtual segment length the pixel buffers were allocated for
+      uint8_t segment = 0xFF;           // the segment this transition is for (255 indicates transition not in use/available)
+      uint8_t modeOld = 0;
+      uint8_t frame = 0;
+      uint16_t progress() { //transition progression between 0-65535
+        uint32_t elapsed = millis() - transitionStart;
+        if (elapsed >= transitionDur) return 0xFFFF;
+        return elapsed * 0xFFFF / transitionDur;
+      }
+    } mode_transition;
+
     WS2812FX() {
       WS2812FX::instance = this;
       //assign each member of the _mode[] array to its respective function reference
@@ -810,6 +868,7 @@ class WS2812FX {
       ablMilliampsMax = ABL_MILLIAMPS_DEFAULT;
       currentMilliamps = 0;
       timebase = 0;
+      memset(_modeFadeFrom, 0xFF, sizeof(_modeFadeFrom));
       resetSegments();
     }
 
@@ -843,6 +902,17 @@ class WS2812FX {
       deserializeMap(uint8_t n=0);
 
     inline void setPixelColor(uint16_t n, uint32_t c) {setPixelColor(n, byte(c>>16), byte(c>>8), byte(c), byte(c>>24));}
+    void setRealtimePixels(uint16_t start, const uint8_t* data, uint16_t count, uint8_t channels, bool gamma);
+
+    #ifdef WLED_ENABLE_FX_BENCHMARK
+    void startBenchmark(uint16_t frames, bool golden = false);
+    bool isBenchmarkRunning(void);
+    bool isGoldenRunning(void);                  // true while effects are fed the scripted clock and audio input
+    uint32_t getBenchmarkResult(uint8_t mode); // average render time per frame in ns, 0 if not (yet) measured
+    uint32_t getGoldenHash(uint8_t mode);        // hash over all frames of the last golden run, 0 if not measured
+    bool isGoldenStable(uint8_t mode);           // false if two golden runs of the mode produced different frames
+    void setBenchmarkCallback(bench_frame_callback cb); // called for every frame of the first golden run of a mode, to keep frames for a comparison with tolerance
+    #endif
 
     bool
       gammaCorrectBri = false,
@@ -871,6 +941,8 @@ class WS2812FX {
       getMainSegmentId(void),
       getLastActiveSegmentId(void),
       getTargetFps(void),
+      getSegmentFps(uint8_t n),
+      getSegmentTargetFps(uint8_t n),
       setPixelSegment(uint8_t n),
       gamma8(uint8_t),
       gamma8_cal(uint8_t, float),
@@ -891,6 +963,7 @@ class WS2812FX {
       getLengthTotal(void),
       getLengthPhysical(void),
       getFps(),
+      getSegmentRenderTime(uint8_t n),
       getMinShowDelay(); // Fixes private class variable compiler error. Unsure if this is the correct way of fixing the root problem. -THATDONFC
 
     uint32_t
@@ -902,7 +975,8 @@ class WS2812FX {
       currentColor(uint32_t colorNew, uint8_t tNr),
       gamma32(uint32_t),
       getLastShow(void),
-      getPixelColor(uint16_t);
+      getPixelColor(uint16_t),
+      getLivePixelColor(uint16_t);
 
     WS2812FX::Segment
       &getSegment(uint8_t n),
@@ -1173,6 +1247,7 @@ class WS2812FX {
 		uint8_t _targetFps = 42;
 		uint16_t _frametime = (1000/42);
     uint16_t _cumulativeFps = 2;
+    uint32_t _lastBudgetCheck = 0;
 
     bool
       _isOffRefreshRequired = false, //periodic refresh is required for the strip to remain off.
@@ -1183,6 +1258,39 @@ class WS2812FX {
 
     show_callback _callback = nullptr;
 
+    #ifdef WLED_ENABLE_FX_BENCHMARK
+    uint16_t _benchFrames = 0; // frames per mode, 0 if no benchmark is running
+    uint8_t  _benchMode = 0;
+    uint8_t  _benchPrevMode = 0;
+    uint32_t _benchResult[MODE_COUNT]; // ns per frame
+    bool     _benchGolden = false;         // deterministic run: scripted clock, PRNG seed and audio, frames are hashed
+    bool     _benchRepeat = false;         // second golden run of the current mode
+    uint32_t _benchStart = 0;
+    uint16_t _benchFrame = 0;              // frames of the current mode rendered by earlier slices
+    uint32_t _benchElapsed = 0;            // us
+    uint32_t _benchHash = 0;
+    uint32_t _benchNow = 0, _benchPrevT = 0; // scripted clock between slices
+    uint16_t _benchSeed = 0;
+    uint32_t _benchRandom = 0;             // PRNG behind random() of the effects during a golden run
+    uint32_t _goldenHash[MODE_COUNT];      // FNV-1a over every pixel of every frame
+    uint8_t  _goldenUnstable[(MODE_COUNT+7)/8];
+    bench_frame_callback _benchCallback = nullptr;
+    void benchmarkStep(void);
+    void benchmarkSlice(void);
+    // hide the Arduino random() from the effects, so golden runs can script it
+    long random(long howbig);
+    long random(long howsmall, long howbig);
+    #endif
+
+    uint16_t runEffect(void);
+    uint16_t callEffect(uint8_t mode);
+    void startModeTransition(void);
+    void endModeTransition(mode_transition &t);
+    uint16_t renderModeTransition(mode_transition &t);
+    void readSegmentPixels(uint32_t* buf);
+    void swapSegmentLeds(CRGB* buf);
+    void balanceLoad(uint32_t nowUp);
+
     // mode helper functions
     uint16_t
       blink(uint32_t, uint32_t, bool strobe, bool),
@@ -1234,12 +1342,16 @@ class WS2812FX {
       // start, stop, offset, speed, intensity, custom1, custom2, custom3, palette, mode, options, grouping, spacing, opacity (unused), color[], capabilities
       {0, 7, 0, DEFAULT_SPEED, DEFAULT_INTENSITY, DEFAULT_Custom1, DEFAULT_Custom2, DEFAULT_Custom3, 0, DEFAULT_MODE, NO_OPTIONS, 1, 0, 255, {DEFAULT_COLOR}, 0}
     };
-    segment_runtime _segment_runtimes[MAX_NUM_SEGMENTS]; // SRAM footprint: 28 bytes per element
+    segment_runtime _segment_runtimes[MAX_NUM_SEGMENTS]; // SRAM footprint: 32 bytes per element
     friend class Segment_runtime;
 
     ColorTransition transitions[MAX_NUM_TRANSITIONS]; //12 bytes per element
     friend class ColorTransition;
 
+    ModeTransition _modeTransitions[MAX_NUM_MODE_TRANSITIONS]; //52 bytes per element
+    uint8_t _modeFadeFrom[MAX_NUM_SEGMENTS]; // effect to cross-fade from when a segment's mode changed, 255 if none
+    uint32_t* _segmentBuffer = nullptr;      // while rendering a cross-fade, pixels of the current segment go here instead of to the busses
+
     uint16_t
       segmentToLogical(uint16_t i),
       transitionProgress(uint8_t tNr);
@@ -1429,7 +1541,7 @@ const char JSON_mode_names[] PROGMEM = R"=====([
 "2D Fire2012@Speed;;",
 "2D DNA@Scroll speed,Blur;;!",
 "2D Matrix@Falling speed,Spawning rate,Trail,Custom color ☑;Spawn,Trail;",
-"2D Metaballs@;;",
+"2D Metaballs@Half res ☑;;",
 " ♫ Freqmap@Fade rate,Starting color;,!;!",
 " ♪ Gravcenter@Rate of fall,Sensitivity=128;,!;!",
 " ♪ Gravcentric@Rate of fall,Sensitivity=128;!;!",
@@ -1443,7 +1555,7 @@ const char JSON_mode_names[] PROGMEM = R"=====([
 " ♪ 2D Waverly@Amplification,Sensitivity=64;;!",
 "2D Sun Radiation@Variance,Brightness;;",
 "2D Colored Bursts@Speed,Number of lines;;!",
-"2D Julia@,Max iterations per pixel,X center,Y center,Area size;;!",
+"2D Julia@Half res ☑,Max iterations per pixel,X center,Y center,Area size;;!",
 "Reserved for PoolNoise",
 "Reserved for Twister",
 "Reserved for Elementary",
@@ -126,9 +126,19 @@ void WS2812FX::finalizeInit(void)
   setBrightness(_brightness);
 }
 
+// effects marked with ♪ (volume) or ♫ (frequency) in their name react to sound
+static bool isAudioReactiveMode(uint8_t mode) {
+  char name[4];
+  extractModeName(mode, JSON_mode_names, name, 3);
+  return name[1] == char(0xE2) && name[2] == char(0x99); // UTF-8 lead bytes of both symbols
+}
+
 void WS2812FX::service() {
   uint32_t nowUp = millis(); // Be aware, millis() rolls over every 49 days
-  now = nowUp + timebase;
+  now = syncedMillis() + timebase; // shared between controllers if clock sync is enabled
+  #ifdef WLED_ENABLE_FX_BENCHMARK
+  if (_benchFrames) { benchmarkStep(); return; } // no regular rendering while benchmarking
+  #endif
   if (nowUp - _lastShow < MIN_SHOW_DELAY) return;
   bool doShow = false;
 
@@ -138,11 +148,19 @@ void WS2812FX::service() {
 
     _segment_index = i;
 
+    // keep the outgoing effect's state for a cross-fade before the runtime gets reset for the new one
+    if (_modeFadeFrom[i] != 0xFF) startModeTransition();
+
     // reset the segment runtime data if needed, called before isActive to ensure deleted
     // segment's buffers are cleared
     SEGENV.resetIfRequired();
 
-    if (!SEGMENT.isActive()) continue;
+    if (!SEGMENT.isActive()) {
+      for (uint8_t t = 0; t < MAX_NUM_MODE_TRANSITIONS; t++) { // deactivated while fading
+        if (_modeTransitions[t].segment == i) endModeTransition(_modeTransitions[t]);
+      }
+      continue;
+    }
 
     // last condition ensures all solid segments are updated at the same time
     if(nowUp > SEGENV.next_time || _triggered || (doShow && SEGMENT.mode == 0))
@@ -152,46 +170,15 @@ void WS2812FX::service() {
       uint16_t delay = FRAMETIME;
 
       if (!SEGMENT.getOption(SEG_OPTION_FREEZE)) { //only run effect function if not frozen
-        _virtualSegmentLength = SEGMENT.virtualLength();
-        _bri_t = SEGMENT.opacity; _colors_t[0] = SEGMENT.colors[0]; _colors_t[1] = SEGMENT.colors[1]; _colors_t[2] = SEGMENT.colors[2];
-        uint8_t _cct_t = SEGMENT.cct;
-        if (!IS_SEGMENT_ON) _bri_t = 0;
-        for (uint8_t t = 0; t < MAX_NUM_TRANSITIONS; t++) {
-          if ((transitions[t].segment & 0x3F) != i) continue;
-          uint8_t slot = transitions[t].segment >> 6;
-          if (slot == 0) _bri_t = transitions[t].currentBri();
-          if (slot == 1) _cct_t = transitions[t].currentBri(false, 1);
-          _colors_t[slot] = transitions[t].currentColor(SEGMENT.colors[slot]);
-        }
-        if (!cctFromRgb || correctWB) busses.setSegmentCCT(_cct_t, correctWB);
-        for (uint8_t c = 0; c < NUM_COLORS; c++) {
-          _colors_t[c] = gamma32(_colors_t[c]);
-        }
-        handle_palette();
-        //WLEDSR: swap width and height if rotated
-        if (IS_ROTATED2D && stripOrMatrixPanel == 1) {//matrix
-          SEGMENT.height = SEGMENT.stopX - SEGMENT.startX + 1;
-          SEGMENT.width = SEGMENT.stopY - SEGMENT.startY + 1;
-        }
-        else {
-          SEGMENT.width = SEGMENT.stopX - SEGMENT.startX + 1;
-          SEGMENT.height = SEGMENT.stopY - SEGMENT.startY + 1;
-        }
-        if (_mode[SEGMENT.mode] != nullptr)
-          delay = (this->*_mode[SEGMENT.mode])(); //effect function
-        else
-          delay = (this->*_mode[FX_MODE_BLINK])(); //WLEDSR: blink if mode has not been activated
-
-        // if segment is not RGB capable, force None auto white mode
-        // If not RGB capable, also treat palette as if default (0), as palettes set white channel to 0
-        _no_rgb = !(SEGMENT.getLightCapabilities() & 0x01);
-        if (_no_rgb) Bus::setAutoWhiteMode(RGBW_MODE_MANUAL_ONLY);
-        delay = (this->*_mode[SEGMENT.mode])(); //effect function
-        if (SEGMENT.mode != FX_MODE_HALLOWEEN_EYES) SEGENV.call++;
-        Bus::setAutoWhiteMode(strip.autoWhiteMode);
+        if (SEGENV.renderTime == 0) SEGENV.audio = isAudioReactiveMode(SEGMENT.mode); // first frame after reset
+        uint32_t renderStart = micros();
+        delay = runEffect();
+        uint32_t renderTime = MIN(micros() - renderStart, 65535UL);
+        SEGENV.renderTime = SEGENV.renderTime ? (3 * SEGENV.renderTime + renderTime) >> 2 : renderTime;
+        if (SEGENV.frames < 255) SEGENV.frames++;
       }
 
-      SEGENV.next_time = nowUp + delay;
+      SEGENV.next_time = nowUp + delay + SEGENV.shed * FRAMETIME;
     }
   }
   _virtualSegmentLength = 0;
@@ -201,8 +188,447 @@ void WS2812FX::service() {
     show();
   }
   _triggered = false;
+  if (nowUp - _lastBudgetCheck >= 1000) balanceLoad(nowUp);
+}
+
+/*
+ * Frame budget. Once per second the render cost of all segments is compared to the frame time.
+ * On overload the most expensive segment renders less often (one more frame period skipped between
+ * updates). Audio reactive segments are only slowed down if no other segment can be.
+ * When there is enough headroom again, segments return to full rate one step at a time, audio reactive first.
+ */
+void WS2812FX::balanceLoad(uint32_t nowUp) {
+  uint32_t elapsed = nowUp - _lastBudgetCheck;
+  uint32_t budget = FRAMETIME * 750UL; // us, leaves a quarter of the frame for show() and the main loop
+  uint32_t load = 0;
+  _lastBudgetCheck = nowUp;
+
+  for (uint8_t i = 0; i < MAX_NUM_SEGMENTS; i++) {
+    segment_runtime &rt = _segment_runtimes[i];
+    rt.fps = MIN(rt.frames * 1000UL / elapsed, 255UL);
+    rt.frames = 0;
+    if (!_segments[i].isActive() || _segments[i].getOption(SEG_OPTION_FREEZE)) continue;
+    load += rt.renderTime / (rt.shed + 1);
+  }
+
+  int8_t slowest = -1, fastest = -1;
+  uint16_t slowCost = 0;
+  uint8_t  fastShed = 0;
+  for (uint8_t i = 0; i < MAX_NUM_SEGMENTS; i++) {
+    segment_runtime &rt = _segment_runtimes[i];
+    if (!_segments[i].isActive() || _segments[i].getOption(SEG_OPTION_FREEZE)) continue;
+    // candidate to slow down: highest cost per frame, segments that are not audio reactive first
+    uint16_t cost = rt.renderTime / (rt.shed + 1);
+    if (rt.shed < MAX_FRAME_SHED && (slowest < 0 || (!rt.audio && _segment_runtimes[slowest].audio) ||
+        (rt.audio == _segment_runtimes[slowest].audio && cost > slowCost))) {
+      slowest = i; slowCost = cost;
+    }
+    // candidate to speed up: audio reactive first, then the one that was slowed down the most
+    if (rt.shed && (fastest < 0 || (rt.audio && !_segment_runtimes[fastest].audio) ||
+        (rt.audio == _segment_runtimes[fastest].audio && rt.shed > fastShed))) {
+      fastest = i; fastShed = rt.shed;
+    }
+  }
+
+  if (load > budget) {
+    if (slowest >= 0) _segment_runtimes[slowest].shed++;
+  } else if (fastest >= 0) {
+    segment_runtime &rt = _segment_runtimes[fastest];
+    uint32_t more = rt.renderTime / rt.shed - rt.renderTime / (rt.shed + 1);
+    if (load + more < budget * 3 / 4) rt.shed--; // hysteresis, so segments don't toggle between two rates
+  }
+}
+
+/*
+ * Renders one frame of the current segment's (_segment_index) effect:
+ * applies color/brightness transitions and the palette, then calls the effect function once.
+ * Returns the delay requested by the effect.
+ */
+uint16_t WS2812FX::runEffect() {
+  uint8_t i = _segment_index;
+  uint16_t delay = FRAMETIME;
+  _virtualSegmentLength = SEGMENT.virtualLength();
+  _bri_t = SEGMENT.opacity; _colors_t[0] = SEGMENT.colors[0]; _colors_t[1] = SEGMENT.colors[1]; _colors_t[2] = SEGMENT.colors[2];
+  uint8_t _cct_t = SEGMENT.cct;
+  if (!IS_SEGMENT_ON) _bri_t = 0;
+  for (uint8_t t = 0; t < MAX_NUM_TRANSITIONS; t++) {
+    if ((transitions[t].segment & 0x3F) != i) continue;
+    uint8_t slot = transitions[t].segment >> 6;
+    if (slot == 0) _bri_t = transitions[t].currentBri();
+    if (slot == 1) _cct_t = transitions[t].currentBri(false, 1);
+    _colors_t[slot] = transitions[t].currentColor(SEGMENT.colors[slot]);
+  }
+  if (!cctFromRgb || correctWB) busses.setSegmentCCT(_cct_t, correctWB);
+  for (uint8_t c = 0; c < NUM_COLORS; c++) {
+    _colors_t[c] = gamma32(_colors_t[c]);
+  }
+  handle_palette();
+  //WLEDSR: swap width and height if rotated
+  if (IS_ROTATED2D && stripOrMatrixPanel == 1) {//matrix
+    SEGMENT.height = SEGMENT.stopX - SEGMENT.startX + 1;
+    SEGMENT.width = SEGMENT.stopY - SEGMENT.startY + 1;
+  }
+  else {
+    SEGMENT.width = SEGMENT.stopX - SEGMENT.startX + 1;
+    SEGMENT.height = SEGMENT.stopY - SEGMENT.startY + 1;
+  }
+
+  // if segment is not RGB capable, force None auto white mode
+  // If not RGB capable, also treat palette as if default (0), as palettes set white channel to 0
+  _no_rgb = !(SEGMENT.getLightCapabilities() & 0x01);
+  if (_no_rgb) Bus::setAutoWhiteMode(RGBW_MODE_MANUAL_ONLY);
+  mode_transition* fade = nullptr;
+  for (uint8_t t = 0; t < MAX_NUM_MODE_TRANSITIONS; t++) {
+    if (_modeTransitions[t].segment == i) fade = &_modeTransitions[t];
+  }
+  if (fade) delay = renderModeTransition(*fade);
+  else      delay = callEffect(SEGMENT.mode);
+  Bus::setAutoWhiteMode(strip.autoWhiteMode);
+  return delay;
+}
+
+// calls the effect function of a mode on the current segment once
+uint16_t WS2812FX::callEffect(uint8_t mode) {
+  uint16_t delay;
+  if (_mode[mode] != nullptr)
+    delay = (this->*_mode[mode])(); //effect function
+  else
+    delay = (this->*_mode[FX_MODE_BLINK])(); //WLEDSR: blink if mode has not been activated
+  if (mode != FX_MODE_HALLOWEEN_EYES) SEGENV.call++;
+  return delay;
+}
+
+/*
+ * Effect cross-fades. setMode() only records the effect a segment is changing from, the transition is set up
+ * here before service() resets the segment runtime, so the outgoing effect's state can be moved out of it.
+ * If no transition slot or not enough memory for the pixel buffers is available the effect changes instantly.
+ */
+void WS2812FX::startModeTransition() {
+  uint8_t modeOld = _modeFadeFrom[_segment_index];
+  _modeFadeFrom[_segment_index] = 0xFF;
+  if (modeOld == SEGMENT.mode || SEGENV.call == 0) return; // changed back, or old effect never rendered
+  if (!SEGMENT.isActive() || !IS_SEGMENT_ON || _transitionDur == 0) return;
+
+  mode_transition* t = nullptr;
+  for (uint8_t j = 0; j < MAX_NUM_MODE_TRANSITIONS; j++) {
+    mode_transition &slot = _modeTransitions[j];
+    if (slot.segment == _segment_index) { t = &slot; break; } // already fading, restart from the current effect
+    if (slot.segment != 0xFF && slot.progress() == 0xFFFF) endModeTransition(slot); // finished, but not rendered since
+    if (slot.segment == 0xFF && !t) t = &slot;
+  }
+  if (!t) return;
+
+  uint16_t len = SEGMENT.virtualLength();
+  if (t->segment == _segment_index && t->len == len) {
+    // the incoming effect of the running transition becomes the outgoing one
+    uint32_t* last = t->pixelsOld;
+    t->pixelsOld = t->pixelsNew;
+    t->pixelsNew = last;
+  } else {
+    endModeTransition(*t);
+    size_t size = len * sizeof(uint32_t);
+    #if defined(ARDUINO_ARCH_ESP32) && defined(WLED_USE_PSRAM)
+    if (psramFound()) {
+      t->pixelsOld = (uint32_t*) ps_malloc(size);
+      t->pixelsNew = (uint32_t*) ps_malloc(size);
+      t->ledsOld = (CRGB*) ps_malloc(len * sizeof(CRGB));
+    } else
+    #endif
+    {
+      t->pixelsOld = (uint32_t*) malloc(size);
+      t->pixelsNew = (uint32_t*) malloc(size);
+      t->ledsOld = (CRGB*) malloc(len * sizeof(CRGB));
+    }
+    if (!t->pixelsOld || !t->pixelsNew || !t->ledsOld) { endModeTransition(*t); return; } // not enough memory
+    _virtualSegmentLength = len;
+    readSegmentPixels(t->pixelsOld);
+    _virtualSegmentLength = 0;
+  }
+  memcpy(t->pixelsNew, t->pixelsOld, len * sizeof(uint32_t)); // the new effect starts on what is shown now
+  // leds[] stays with the incoming effect, the outgoing one continues on a copy
+  for (uint16_t i = 0; i < len; i++) t->ledsOld[i] = leds[segmentToLogical(i)];
+
+  SEGENV.moveTo(t->runtimeOld);
+  t->modeOld = modeOld;
+  t->len = len;
+  t->frame = 0;
+  t->transitionStart = millis();
+  t->transitionDur = _transitionDur;
+  t->segment = _segment_index;
+}
+
+void WS2812FX::endModeTransition(mode_transition &t) {
+  t.runtimeOld.deallocateData();
+  free(t.pixelsOld); t.pixelsOld = nullptr;
+  free(t.pixelsNew); t.pixelsNew = nullptr;
+  free(t.ledsOld); t.ledsOld = nullptr;
+  t.len = 0;
+  t.segment = 0xFF;
 }
 
+/*
+ * Renders one frame of an effect cross-fade. Each effect renders into its own buffer, on top of its previous frame,
+ * so the busses only get the blend and auto white, CCT and brightness are applied once.
+ * The outgoing effect only renders every other frame (half rate) so a transition frame costs about
+ * 1.5 normal frames; the frame budget (balanceLoad()) sheds the rest if needed.
+ */
+uint16_t WS2812FX::renderModeTransition(mode_transition &t) {
+  uint16_t progress = t.progress();
+  if (progress == 0xFFFF || t.len != SEGLEN) { // done, or the segment was resized
+    endModeTransition(t);
+    return callEffect(SEGMENT.mode);
+  }
+
+  if (!(t.frame++ & 0x01)) {
+    segment_runtime runtimeNew = SEGENV;
+    SEGENV = t.runtimeOld;
+    _segmentBuffer = t.pixelsOld;
+    swapSegmentLeds(t.ledsOld);
+    callEffect(t.modeOld);
+    swapSegmentLeds(t.ledsOld);
+    t.runtimeOld = SEGENV;
+    SEGENV = runtimeNew;
+  }
+
+  _segmentBuffer = t.pixelsNew;
+  uint16_t delay = callEffect(SEGMENT.mode);
+  _segmentBuffer = nullptr;
+
+  uint8_t bri = _bri_t;
+  _bri_t = 255; // both frames already have the segment opacity applied
+  for (uint16_t i = 0; i < SEGLEN; i++) setPixelColor(i, color_blend(t.pixelsOld[i], t.pixelsNew[i], progress, true));
+  _bri_t = bri;
+  return MIN(delay, FRAMETIME); // keep the fade smooth for effects with long delays
+}
+
+// reads back what the current segment shows (same mapping as setPixelColor()), the start of both buffers of a cross-fade.
+// Like every effect which renders on top of the previous frame, this gets colors as the busses keep them.
+void WS2812FX::readSegmentPixels(uint32_t* buf) {
+  for (uint16_t i = 0; i < SEGLEN; i++) {
+    uint16_t index = segmentToLogical(i);
+    if (index < SEGMENT.start || index >= SEGMENT.stop) { buf[i] = 0; continue; }
+    index += SEGMENT.offset;
+    if (index >= SEGMENT.stop) index -= SEGMENT.length();
+    if (index < customMappingSize) index = customMappingTable[index];
+    buf[i] = busses.getPixelColor(logicalToPhysical(index));
+  }
+}
+
+// exchanges the leds[] of the current segment (the pixels setPixels() shows) with buf, so effects which keep their
+// state in leds[] (trails, blur, fire) do not see each other's pixels during a cross-fade
+void WS2812FX::swapSegmentLeds(CRGB* buf) {
+  for (uint16_t i = 0; i < SEGLEN; i++) {
+    uint16_t index = segmentToLogical(i);
+    CRGB c = leds[index];
+    leds[index] = buf[i];
+    buf[i] = c;
+  }
+}
+
+#ifdef WLED_ENABLE_FX_BENCHMARK
+// sound reactive globals (audio_reactive.h), replaced by a scripted signal during golden runs
+extern int sampleRaw;
+extern int rawSampleAgc;
+extern float sampleAgc;
+extern float sampleAvg;
+extern float sampleReal;
+extern float multAgc;
+extern bool samplePeak;
+extern uint8_t myVals[32];
+extern double FFT_MajorPeak;
+extern double FFT_Magnitude;
+extern double fftBin[];
+extern int fftResult[];
+extern float fftAvg[];
+
+#define GOLDEN_T0      1000000UL // scripted clock at the first frame of a golden run (ms)
+#define GOLDEN_SEED    1337      // random16 seed at the first frame of a golden run
+#define GOLDEN_SETTLE  100       // ms to wait for an FFT cycle in progress before the audio input is scripted
+
+/*
+ * Scripted audio input for golden runs, derived from the scripted clock only:
+ * a 120 BPM kick (decaying bass envelope, peak on every beat) over a slowly sweeping tone.
+ */
+static void scriptAudio(uint32_t t, uint32_t prevT) {
+  uint16_t beat  = t % 500;
+  uint8_t  env   = beat < 250 ? 255 - beat : 5;
+  uint8_t  sweep = sin8(t >> 4);
+
+  sampleRaw    = (env >> 1) + (sweep >> 3);
+  rawSampleAgc = MIN(sampleRaw << 1, 255);
+  sampleAgc    = rawSampleAgc;
+  sampleAvg    = (env + sweep) / 4.0f;
+  sampleReal   = sampleRaw;
+  multAgc      = 1.0f;
+  samplePeak   = (t / 500) != (prevT / 500);
+  myVals[t % 32] = sampleAgc;
+
+  FFT_MajorPeak = 80.0 + sweep * 20.0;
+  FFT_Magnitude = env * 16.0;
+  for (uint8_t b = 0; b < 16; b++) {
+    fftResult[b] = (b < 4) ? env : scale8(sweep, 255 - b*8);
+    fftAvg[b]    = fftResult[b];
+  }
+  for (uint16_t i = 0; i < 512; i++) fftBin[i] = fftResult[i >> 5] * 8.0; // 512 = samplesFFT
+}
+
+/*
+ * On-device effect benchmark. Renders every mode on the main segment (at its current size)
+ * for a number of frames without showing them, and records the average render time per frame.
+ * Each service() call renders a slice of at most FX_BENCH_SLICE_FRAMES frames, and stops early after
+ * FX_BENCH_SLICE_US, so the main loop (network, watchdog) keeps running even for long runs on large segments.
+ *
+ * A golden run additionally makes the effects reproducible: the clock (now) starts at GOLDEN_T0 and
+ * advances by the delay each frame returns, random16 and random() are seeded, the audio input is scripted
+ * and the segment (pixels and leds[]) starts black.
+ * Every frame is hashed, so hashes can be compared against a known good firmware build. Where exact
+ * results are not expected (e.g. a port to fixed point math), a benchmark callback can keep the frames
+ * for a comparison per channel with a tolerance instead (see test/host).
+ * Each mode is rendered twice; modes that keep static state between calls produce different frames
+ * and are reported as unstable.
+ */
+void WS2812FX::startBenchmark(uint16_t frames, bool golden) {
+  if (frames == 0 || _benchFrames) return;
+  _benchMode = 0;
+  _benchFrame = 0;
+  _benchRepeat = false;
+  _benchPrevMode = getMainSegment().mode;
+  _benchGolden = golden;
+  _benchStart = millis();
+  memset(_benchResult, 0, sizeof(_benchResult));
+  memset(_goldenHash, 0, sizeof(_goldenHash));
+  memset(_goldenUnstable, 0, sizeof(_goldenUnstable));
+  _benchFrames = frames;
+}
+
+// renders the next slice of frames of the current mode, the clock and PRNG of a golden run continue where the last slice stopped
+void WS2812FX::benchmarkSlice() {
+  uint8_t m = _benchMode;
+  SEGMENT.mode = m;
+  if (_benchFrame == 0) { // fresh start of the mode
+    SEGENV.markForReset();
+    SEGENV.resetIfRequired();
+    _benchElapsed = 0;
+    _benchHash  = 2166136261UL; // FNV-1a offset basis
+    _benchNow   = GOLDEN_T0;
+    _benchPrevT = 0;
+    _benchSeed  = GOLDEN_SEED;
+    _benchRandom = GOLDEN_SEED;
+    if (_benchGolden) { // effects which render on top of the previous frame or keep state in leds[] start from black
+      _virtualSegmentLength = SEGMENT.virtualLength();
+      for (uint16_t i = 0; i < SEGLEN; i++) {
+        setPixelColor(i, BLACK);
+        leds[segmentToLogical(i)] = CRGB::Black;
+      }
+    }
+  }
+  uint32_t realNow = now;
+  if (_benchGolden) {
+    now = _benchNow;
+    random16_set_seed(_benchSeed);
+  }
+  uint32_t sliceStart = micros();
+  uint16_t n = 0;
+  do {
+    if (_benchGolden) scriptAudio(now, _benchPrevT);
+    uint32_t start = micros();
+    uint16_t delay = runEffect();
+    _benchElapsed += micros() - start;
+    if (_benchGolden) {
+      for (uint16_t i = 0; i < SEGLEN; i++) {
+        uint32_t c = getPixelColor(i);
+        for (uint8_t b = 0; b < 32; b += 8) _benchHash = (_benchHash ^ (uint8_t)(c >> b)) * 16777619UL; // FNV prime
+      }
+      if (_benchCallback && !_benchRepeat) _benchCallback(m, _benchFrame);
+      _benchPrevT = now;
+      now += delay;
+    }
+    _benchFrame++;
+    n++;
+  } while (_benchFrame < _benchFrames && n < FX_BENCH_SLICE_FRAMES && micros() - sliceStart < FX_BENCH_SLICE_US);
+  if (_benchGolden) {
+    _benchNow = now;
+    _benchSeed = random16_get_seed();
+    now = realNow;
+  }
+  if (_benchFrame < _benchFrames) return; // continued by the next service() call
+
+  _benchFrame = 0;
+  if (_benchRepeat) { // second golden run of the mode
+    if (_benchHash != _goldenHash[m]) _goldenUnstable[m >> 3] |= 1 << (m & 7);
+    _benchRepeat = false;
+  } else {
+    _benchResult[m] = (uint64_t)_benchElapsed * 1000 / _benchFrames;
+    if (_benchGolden) {
+      _goldenHash[m] = _benchHash;
+      _benchRepeat = true;
+      return;
+    }
+  }
+  DEBUG_PRINTF("FX benchmark: mode %d, %u ns/frame, hash %08X\n", m, _benchResult[m], _goldenHash[m]);
+  _benchMode++;
+}
+
+// random() as the effects see it: the hardware RNG, during a golden run a PRNG (xorshift32) seeded for every mode
+long WS2812FX::random(long howbig) {
+  if (!_benchGolden) return ::random(howbig);
+  if (howbig <= 0) return 0;
+  _benchRandom ^= _benchRandom << 13;
+  _benchRandom ^= _benchRandom >> 17;
+  _benchRandom ^= _benchRandom << 5;
+  return _benchRandom % howbig;
+}
+
+long WS2812FX::random(long howsmall, long howbig) {
+  if (howsmall >= howbig) return howsmall;
+  return howsmall + random(howbig - howsmall);
+}
+
+void WS2812FX::benchmarkStep() {
+  if (_benchGolden && millis() - _benchStart < GOLDEN_SETTLE) return; // audio processing is suspended by userLoop()
+  _segment_index = getMainSegmentId();
+  while (_benchMode < MODE_COUNT && _mode[_benchMode] == nullptr) _benchMode++;
+  if (_benchMode < MODE_COUNT) {
+    benchmarkSlice();
+    _virtualSegmentLength = 0;
+    busses.setSegmentCCT(-1);
+    return;
+  }
+  // all modes done, restore the effect that was running before
+  SEGMENT.mode = _benchPrevMode;
+  SEGENV.markForReset();
+  _virtualSegmentLength = 0;
+  _benchFrames = 0;
+  if (_benchGolden) random16_set_seed(millis()); // don't leave the fixed seed behind
+  _benchGolden = false;
+  _triggered = true;
+}
+
+bool WS2812FX::isBenchmarkRunning() {
+  return _benchFrames > 0;
+}
+
+bool WS2812FX::isGoldenRunning() {
+  return _benchFrames > 0 && _benchGolden;
+}
+
+uint32_t WS2812FX::getBenchmarkResult(uint8_t mode) {
+  return (mode < MODE_COUNT) ? _benchResult[mode] : 0;
+}
+
+uint32_t WS2812FX::getGoldenHash(uint8_t mode) {
+  return (mode < MODE_COUNT) ? _goldenHash[mode] : 0;
+}
+
+bool WS2812FX::isGoldenStable(uint8_t mode) {
+  return (mode < MODE_COUNT) && !(_goldenUnstable[mode >> 3] & (1 << (mode & 7)));
+}
+
+void WS2812FX::setBenchmarkCallback(bench_frame_callback cb) {
+  _benchCallback = cb;
+}
+#endif
+
 // WLEDSR used to map from segment index to logical pixel, taking into account grouping, offsets, reverse and mirroring
 uint16_t IRAM_ATTR WS2812FX::segmentToLogical(uint16_t i) { // ewowi20210703: will not map to physical pixel index but to rotated and mirrored logical pixel index as matrix panels will require mapping.
                                                 // Mapping is done in logicalToPhysical below. 
@@ -265,6 +691,10 @@ void IRAM_ATTR WS2812FX::setPixelColor(uint16_t i, byte r, byte g, byte b, byte
       b = scale8(b, _bri_t);
       w = scale8(w, _bri_t);
     }
+    if (_segmentBuffer) { // rendering a cross-fade
+      if (i < SEGLEN) _segmentBuffer[i] = RGBW32(r, g, b, w);
+      return;
+    }
     segIdx = _segment_index;
   } else // from live/realtime
     segIdx = _mainSegment;
@@ -313,6 +743,52 @@ void IRAM_ATTR WS2812FX::setPixelColor(uint16_t i, byte r, byte g, byte b, byte
   }
 }
 
+/*
+ * Bulk version of setPixelColor() for live/realtime data: count pixels of 3 (RGB) or 4 (RGBW) bytes each, starting at pixel start.
+ * Same mapping as setPixelColor(), but the bus of a pixel is only looked up if it is not the bus of the previous pixel.
+ */
+void IRAM_ATTR WS2812FX::setRealtimePixels(uint16_t start, const uint8_t* data, uint16_t count, uint8_t channels, bool gamma)
+{
+  if (SEGLEN || (realtimeMode && useMainSegmentOnly) || busses.hasOverlap()) { // mapped into a segment or several busses, pixel by pixel
+    for (uint16_t n = 0; n < count; n++, data += channels) {
+      uint8_t w = (channels > 3) ? data[3] : 0;
+      if (gamma) setPixelColor(start + n, gamma8(data[0]), gamma8(data[1]), gamma8(data[2]), gamma8(w));
+      else       setPixelColor(start + n, data[0], data[1], data[2], w);
+    }
+    return;
+  }
+
+  Bus* bus = nullptr;
+  uint16_t busStart = 0, busEnd = 0;
+  for (uint16_t n = 0; n < count; n++, data += channels) {
+    uint32_t col;
+    if (gamma) col = RGBW32(gamma8(data[0]), gamma8(data[1]), gamma8(data[2]), (channels > 3) ? gamma8(data[3]) : 0);
+    else       col = RGBW32(data[0], data[1], data[2], (channels > 3) ? data[3] : 0);
+
+    uint16_t i = start + n;
+    if (i < customMappingSize) i = customMappingTable[i];
+
+    uint16_t pix[2] = {i, logicalToPhysical(i)}; // as setPixelColor()
+    for (uint8_t p = 0; p < 2; p++) {
+      if (pix[p] < busStart || pix[p] >= busEnd) {
+        bus = nullptr;
+        busStart = busEnd = 0;
+        for (uint8_t b = 0; b < busses.getNumBusses(); b++) {
+          Bus* candidate = busses.getBus(b);
+          if (pix[p] >= candidate->getStart() && pix[p] < candidate->getStart() + candidate->getLength()) {
+            bus = candidate;
+            busStart = candidate->getStart();
+            busEnd = busStart + candidate->getLength();
+            break;
+          }
+        }
+        if (bus == nullptr) continue;
+      }
+      bus->setPixelColor(pix[p] - busStart, col);
+    }
+  }
+}
+
 
 // DISCLAIMER
 // The following function attemps to calculate the current LED power usage,
@@ -438,6 +914,24 @@ uint8_t WS2812FX::getTargetFps() {
 	return _targetFps;
 }
 
+// frames per second a segment actually rendered, measured once per second
+uint8_t WS2812FX::getSegmentFps(uint8_t n) {
+  if (n >= MAX_NUM_SEGMENTS) return 0;
+  return _segment_runtimes[n].fps;
+}
+
+// target FPS of a segment after load shedding
+uint8_t WS2812FX::getSegmentTargetFps(uint8_t n) {
+  if (n >= MAX_NUM_SEGMENTS) return 0;
+  return _targetFps / (_segment_runtimes[n].shed + 1);
+}
+
+// smoothed render time of one frame of a segment in us
+uint16_t WS2812FX::getSegmentRenderTime(uint8_t n) {
+  if (n >= MAX_NUM_SEGMENTS) return 0;
+  return _segment_runtimes[n].renderTime;
+}
+
 void WS2812FX::setTargetFps(uint8_t fps) {
 	if (fps > 0 && fps <= 120) _targetFps = fps;
 	_frametime = 1000 / _targetFps;
@@ -462,6 +956,8 @@ void WS2812FX::setMode(uint8_t segid, uint8_t m) {
 
   if (_segments[segid].mode != m)
   {
+    // cross-fade from the effect the runtime still belongs to, see startModeTransition()
+    if (_modeFadeFrom[segid] == 0xFF && _transitionDur) _modeFadeFrom[segid] = _segments[segid].mode;
     _segment_runtimes[segid].markForReset();
     _segments[segid].mode = m;
   }
@@ -617,6 +1113,8 @@ uint8_t WS2812FX::getActiveSegmentsNum(void) {
 
 uint32_t WS2812FX::getPixelColor(uint16_t i)
 {
+  if (_segmentBuffer && SEGLEN) return (i < SEGLEN) ? _segmentBuffer[i] : 0; // rendering a cross-fade
+
   // get physical pixel
   i = i * SEGMENT.groupLength();;
   if (IS_REVERSE) {
@@ -637,6 +1135,14 @@ uint32_t WS2812FX::getPixelColor(uint16_t i)
   return busses.getPixelColor(logicalToPhysical(i)); // ewowi20210624: logicalToPhysical: Maps logical led index to physical led index.
 }
 
+// color of a logical LED as sent to the busses (after ledmap and 2D panel mapping), independent of segments
+uint32_t WS2812FX::getLivePixelColor(uint16_t i)
+{
+  if (i < customMappingSize) i = customMappingTable[i];
+  if (i >= _length) return 0;
+  return busses.getPixelColor(logicalToPhysical(i));
+}
+
 WS2812FX::Segment& WS2812FX::getSegment(uint8_t id) {
   if (id >= MAX_NUM_SEGMENTS) return _segments[getMainSegmentId()];
   return _segments[id];
@@ -502,8 +502,17 @@ class BusNetwork : public Bus {
       _data = (byte *)malloc(bc.count * _UDPchannels);
       if (_data == nullptr) return;
       memset(_data, 0, bc.count * _UDPchannels);
+      #ifdef ARDUINO_ARCH_ESP32
+      _sendData = (byte *)malloc(bc.count * _UDPchannels); // sent by the network output task while the next frame renders
+      if (_sendData == nullptr) return;
+      #else
+      _sendData = _data;
+      #endif
       _len = bc.count;
       _client = IPAddress(bc.pins[0],bc.pins[1],bc.pins[2],bc.pins[3]);
+      _packet = (byte *)malloc(realtimeBroadcastPacketSize(_UDPtype));
+      if (_packet == nullptr) return;
+      realtimeBroadcastInit(_UDPtype, _packet);
       _broadcastLock = false;
       _valid = true;
     };
@@ -528,10 +537,34 @@ class BusNetwork : public Bus {
   void show() {
     if (!_valid || !canShow()) return;
     _broadcastLock = true;
-    realtimeBroadcast(_UDPtype, _client, _len, _data, _bri, _rgbw);
+    #ifdef ARDUINO_ARCH_ESP32
+    memcpy(_sendData, _data, _len * _UDPchannels);
+    _sendBri = _bri;
+    queueNetworkOutput(this); // sent after all busses are shown, unlocked when done
+    #else
+    _sendBri = _bri;
+    send();
+    _broadcastLock = false;
+    #endif
+  }
+
+  //sends the last shown frame, from the network output task on ESP32
+  void send() {
+    uint32_t start = micros();
+    if (realtimeBroadcast(_UDPtype, _client, _len, _sendData, _sendBri, _rgbw, _packet)) _sendErrors++;
+    _sendMicros = micros() - start;
+    _sendFrames++;
+  }
+
+  inline void unlock() {
     _broadcastLock = false;
   }
 
+  inline IPAddress getClient()      { return _client; }
+  inline uint32_t getSendMicros()   { return _sendMicros; }
+  inline uint32_t getSendErrors()   { return _sendErrors; }
+  inline uint32_t getSendFrames()   { return _sendFrames; }
+
   inline bool canShow() {
     // this should be a return value from UDP routine if it is still sending data out
     return !_broadcastLock;
@@ -561,6 +594,12 @@ class BusNetwork : public Bus {
     _valid = false;
     if (_data != nullptr) free(_data);
     _data = nullptr;
+    if (_packet != nullptr) free(_packet);
+    _packet = nullptr;
+    #ifdef ARDUINO_ARCH_ESP32
+    if (_sendData != nullptr) free(_sendData);
+    #endif
+    _sendData = nullptr;
   }
 
   ~BusNetwork() {
@@ -575,6 +614,12 @@ class BusNetwork : public Bus {
     bool      _rgbw;
     bool      _broadcastLock;
     byte     *_data;
+    byte     *_packet = nullptr; // headers prebuilt by realtimeBroadcastInit()
+    byte     *_sendData = nullptr;
+    uint8_t   _sendBri = 255;
+    uint32_t  _sendMicros = 0;  // duration of the last send
+    uint32_t  _sendErrors = 0;
+    uint32_t  _sendFrames = 0;
 };
 
 
@@ -608,6 +653,9 @@ class BusManager {
 
   int add(BusConfig &bc) {
     if (numBusses >= WLED_MAX_BUSSES) return -1;
+    for (uint8_t i = 0; i < numBusses; i++) { // pixels sent to more than one bus (e.g. mirrored network outputs)
+      if (bc.start < busses[i]->getStart() + busses[i]->getLength() && busses[i]->getStart() < bc.start + bc.count) overlap = true;
+    }
     if (bc.type >= TYPE_NET_DDP_RGB && bc.type < 96) {
       busses[numBusses] = new BusNetwork(bc);
     } else if (IS_DIGITAL(bc.type)) {
@@ -625,12 +673,14 @@ class BusManager {
     while (!canAllShow()) yield();
     for (uint8_t i = 0; i < numBusses; i++) delete busses[i];
     numBusses = 0;
+    overlap = false;
   }
 
   void show() {
     for (uint8_t i = 0; i < numBusses; i++) {
       busses[i]->show();
     }
+    flushNetworkOutput();
   }
 
 	void setStatusPixel(uint32_t c) {
@@ -689,6 +739,10 @@ class BusManager {
     return numBusses;
   }
 
+  inline bool hasOverlap() {
+    return overlap;
+  }
+
   //semi-duplicate of strip.getLengthTotal() (though that just returns strip._length, calculated in finalizeInit())
   uint16_t getTotalLength() {
     uint16_t len = 0;
@@ -706,6 +760,7 @@ class BusManager {
 
   private:
   uint8_t numBusses = 0;
+  bool overlap = false;
   Bus* busses[WLED_MAX_BUSSES];
   ColorOrderMap colorOrderMap;
 };
@@ -89,6 +89,7 @@ bool deserializeConfig(JsonObject doc, bool fromFS) {
   CJSON(correctWB, hw_led["cct"]);
   CJSON(cctFromRgb, hw_led[F("cr")]);
   CJSON(strip.cctBlending, hw_led[F("cb")]);
+  CJSON(networkOutputSync, hw_led[F("nsync")]);
   Bus::setCCTBlend(strip.cctBlending);
   strip.setTargetFps(hw_led["fps"]); //NOP if 0, default 42 FPS
 
@@ -348,6 +349,10 @@ bool deserializeConfig(JsonObject doc, bool fromFS) {
   CJSON(notifyTwice, if_sync_send[F("twice")]);
   CJSON(syncGroups, if_sync_send["grp"]);
 
+  JsonObject if_sync_clock = if_sync["clock"];
+  CJSON(clockSyncEnabled, if_sync_clock["en"]);
+  CJSON(clockSyncPriority, if_sync_clock[F("prio")]);
+
   JsonObject if_nodes = interfaces["nodes"];
   CJSON(nodeListEnabled, if_nodes[F("list")]);
   CJSON(nodeBroadcastEnabled, if_nodes[F("bcast")]);
@@ -362,6 +367,7 @@ bool deserializeConfig(JsonObject doc, bool fromFS) {
   JsonObject if_live_dmx = if_live[F("dmx")];
   CJSON(e131Universe, if_live_dmx[F("uni")]);
   CJSON(e131SkipOutOfSequence, if_live_dmx[F("seqskip")]);
+  CJSON(e131FrameTimeout, if_live_dmx[F("ftimeout")]);
   CJSON(DMXAddress, if_live_dmx[F("addr")]);
   CJSON(DMXMode, if_live_dmx["mode"]);
 
@@ -370,6 +376,8 @@ bool deserializeConfig(JsonObject doc, bool fromFS) {
   CJSON(arlsForceMaxBri, if_live[F("maxbri")]);
   CJSON(arlsDisableGammaCorrection, if_live[F("no-gc")]); // false
   CJSON(arlsOffset, if_live[F("offset")]); // 0
+  CJSON(realtimeJitterFrames, if_live[F("jbuf")]); // 0
+  CJSON(realtimeInterpolate, if_live[F("interp")]); // false
 
   CJSON(alexaEnabled, interfaces["va"][F("alexa")]); // false
 
@@ -663,6 +671,7 @@ void serializeConfig() {
   hw_led["cct"] = correctWB;
   hw_led[F("cr")] = cctFromRgb;
   hw_led[F("cb")] = strip.cctBlending;
+  hw_led[F("nsync")] = networkOutputSync;
   hw_led["fps"] = strip.getTargetFps();
   hw_led[F("rgbwm")] = strip.autoWhiteMode;
 
@@ -809,6 +818,10 @@ void serializeConfig() {
   if_sync_send[F("twice")] = notifyTwice;
   if_sync_send["grp"] = syncGroups;
 
+  JsonObject if_sync_clock = if_sync.createNestedObject("clock");
+  if_sync_clock["en"] = clockSyncEnabled;
+  if_sync_clock[F("prio")] = clockSyncPriority;
+
   JsonObject if_nodes = interfaces.createNestedObject("nodes");
   if_nodes[F("list")] = nodeListEnabled;
   if_nodes[F("bcast")] = nodeBroadcastEnabled;
@@ -822,6 +835,7 @@ void serializeConfig() {
   JsonObject if_live_dmx = if_live.createNestedObject("dmx");
   if_live_dmx[F("uni")] = e131Universe;
   if_live_dmx[F("seqskip")] = e131SkipOutOfSequence;
+  if_live_dmx[F("ftimeout")] = e131FrameTimeout;
   if_live_dmx[F("addr")] = DMXAddress;
   if_live_dmx["mode"] = DMXMode;
 
@@ -829,6 +843,8 @@ void serializeConfig() {
   if_live[F("maxbri")] = arlsForceMaxBri;
   if_live[F("no-gc")] = arlsDisableGammaCorrection;
   if_live[F("offset")] = arlsOffset;
+  if_live[F("jbuf")] = realtimeJitterFrames;
+  if_live[F("interp")] = realtimeInterpolate;
 
   JsonObject if_va = interfaces.createNestedObject("va");
   if_va[F("alexa")] = alexaEnabled;
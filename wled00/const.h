@@ -121,6 +121,11 @@
 #define REALTIME_OVERRIDE_ONCE    1
 #define REALTIME_OVERRIDE_ALWAYS  2
 
+//UDP notifier ports (udpListen())
+#define UDP_SOURCE_NOTIFIER       0
+#define UDP_SOURCE_NOTIFIER2      1
+#define UDP_SOURCE_RGB            2
+
 //E1.31 DMX modes
 #define DMX_MODE_DISABLED         0            //not used
 #define DMX_MODE_SINGLE_RGB       1            //all LEDs same RGB color (3 channels)
@@ -241,6 +246,7 @@
 // WLED Error modes
 #define ERR_NONE         0  // All good :)
 #define ERR_EEP_COMMIT   2  // Could not commit to EEPROM (wrong flash layout?)
+#define ERR_NOBUF        3  // JSON buffer was not released in time, request cannot be handled at this time
 #define ERR_JSON         9  // JSON parsing failed (input too large?)
 #define ERR_FS_BEGIN    10  // Could not init filesystem (no partition?)
 #define ERR_FS_QUOTA    11  // The FS is full or the maximum file size is reached
@@ -331,6 +337,49 @@
   #define JSON_BUFFER_SIZE 20480
 #endif
 
+// Number of JSON arenas: the global doc plus arenas for concurrent serialization, allocated when doc is busy
+#ifndef JSON_POOL_SIZE
+  #ifdef ESP8266
+    #define JSON_POOL_SIZE 1
+  #else
+    #define JSON_POOL_SIZE 3
+  #endif
+#endif
+#define JSON_DEFER_QUEUE 8 // work waiting in the main loop for a free JSON buffer
+
+// Number of presets kept in RAM (PSRAM if available) as JSON text, in addition to the presets.json offset index
+#ifndef WLED_PRESET_CACHE
+  #if defined(ARDUINO_ARCH_ESP32) && defined(WLED_USE_PSRAM)
+    #define WLED_PRESET_CACHE 16
+  #else
+    #define WLED_PRESET_CACHE 0
+  #endif
+#endif
+#define PRESET_CACHE_MAX_LEN 2048 // larger presets are always read from the file
+
+// Presets compiled into binary state snapshots, applied without reading presets.json or parsing JSON
+#ifndef WLED_PRESET_SNAPSHOTS
+  #if defined(ESP8266) || defined(WLED_USE_DYNAMIC_JSON) // snapshots are guarded by the JSON buffer lock
+    #define WLED_PRESET_SNAPSHOTS 0
+  #else
+    #define WLED_PRESET_SNAPSHOTS 1
+  #endif
+#endif
+#ifndef PRESET_SNAPSHOT_RAM
+  #if defined(ARDUINO_ARCH_ESP32) && defined(WLED_USE_PSRAM)
+    #define PRESET_SNAPSHOT_RAM 65536 // bytes, presets beyond that are applied as JSON
+  #else
+    #define PRESET_SNAPSHOT_RAM 12288
+  #endif
+#endif
+
+// Sections of a streamed state/info response (JsonStreamer)
+#define JSON_STREAM_STATE 0x01
+#define JSON_STREAM_INFO  0x02
+#define JSON_STREAM_NAMES 0x04 // effect and palette names
+#define JSON_STREAM_DONE  255
+#define JSON_STREAM_SLACK 64   // WS message room for values growing between measuring and writing
+
 #ifdef WLED_USE_DYNAMIC_JSON
   #define MIN_HEAP_SIZE JSON_BUFFER_SIZE+512
 #else
@@ -26,7 +26,7 @@ var pJson = {};
 var pN = "", pI = 0, pNum = 0;
 var pmt = 1, pmtLS = 0, pmtLast = 0;
 var lastinfo = {};
-var ws;
+var ws, wsState = null, wsRev = 0; //last full state and revision for WS delta updates
 var fxlist = d.getElementById('fxlist'), pallist = d.getElementById('pallist');
 var cfg = {
   theme:{base:"dark", bg:{url:""}, alpha:{bg:0.6,tab:0.8}, color:{bg:""}},
@@ -1141,6 +1141,18 @@ function makeWS() {
 	ws.onmessage = function(event) {
 		if (event.data instanceof ArrayBuffer) return; //liveview packet
 		var json = JSON.parse(event.data);
+		if (json.d !== undefined) {
+			if (!json.f) { //delta: changed state keys and segments only, info every few seconds
+				if (!wsState || (wsRev && json.d != wsRev+1)) { //missed an update, request full state
+					wsRev = 0;
+					ws.send('{"v":true}');
+					return;
+				}
+				json = mergeDelta(json);
+			}
+			wsRev = json.d;
+		} else wsRev = 0;
+		wsState = json.state;
 		clearTimeout(jsonTimeout);
 		jsonTimeout = null;
 		clearErrorToast();
@@ -1164,7 +1176,26 @@ function makeWS() {
 	}
 	ws.onopen = (e)=>{
 		reqsLegal = true;
+		ws.send('{"dlt":true}'); //only receive changes from now on
+	}
+}
+
+//applies a WS delta update to the last received state, segments are matched by id
+function mergeDelta(json) {
+	var st = json.state || {};
+	for (var k in st) if (k !== 'seg') wsState[k] = st[k];
+	if (!('error' in st)) delete wsState.error;
+	if (st.seg) for (let sg of st.seg) {
+		let i = wsState.seg.findIndex((e)=>e.id == sg.id);
+		if (sg.stop == 0 && sg.len === undefined) { //removed
+			if (i > -1) wsState.seg.splice(i,1);
+		} else if (i > -1) wsState.seg[i] = sg;
+		else {
+			wsState.seg.push(sg);
+			wsState.seg.sort((a,b)=>a.id-b.id);
+		}
 	}
+	return {d: json.d, state: wsState, info: json.info || lastinfo};
 }
 
 function readState(s,command=false) {
@@ -8,6 +8,125 @@
  * E1.31 handler
  */
 
+//frame assembly: the universes of a frame are collected and the strip is shown once per frame,
+//when all expected universes arrived, on E1.31 universe sync / ArtSync, or after e131FrameTimeout
+static uint32_t e131FrameMask = 0;      //universes received for the pending frame
+static uint32_t e131ExpectedMask = 0;   //universes of a complete frame, learned from the universes seen during the last second
+static uint32_t e131SeenMask = 0;
+static unsigned long e131SeenSince = 0;
+static unsigned long e131FrameStart = 0; //0: no frame pending
+static uint16_t e131FrameSync = 0;      //E1.31 synchronization address of the pending frame
+static unsigned long artSyncTime = 0;   //last ArtSync, frames wait for ArtSync as long as the sender uses it
+
+#define ARTSYNC_TIMEOUT 4000 //Art-Net: fall back to unsynchronized output 4s after the last ArtSync
+
+//packets are handled by the AsyncUDP task, the frame timeout and the statistics of UDP realtime packets by the loop
+#ifdef ARDUINO_ARCH_ESP32
+static portMUX_TYPE e131Mux = portMUX_INITIALIZER_UNLOCKED;
+#define E131_ENTER portENTER_CRITICAL(&e131Mux)
+#define E131_EXIT  portEXIT_CRITICAL(&e131Mux)
+#else
+#define E131_ENTER
+#define E131_EXIT
+#endif
+
+static void e131FrameReady(uint32_t &counter) {
+  counter++;
+  e131FrameMask = 0;
+  e131FrameStart = 0;
+  e131NewData = true;
+}
+
+static void e131UniverseReceived(uint8_t universeIndex, uint16_t syncAddress) {
+  uint32_t bit = 1UL << universeIndex;
+  unsigned long now = millis();
+  E131_ENTER;
+
+  if (now - e131SeenSince > 1000) {
+    e131ExpectedMask = e131SeenMask | bit;
+    e131SeenMask = 0;
+    e131SeenSince = now;
+  }
+  e131SeenMask |= bit;
+
+  //same universe again before the frame was complete: a packet of the previous frame got lost
+  if (e131FrameMask & bit) e131FrameReady(e131FramesIncomplete);
+
+  if (!e131FrameStart) e131FrameStart = now ? now : 1;
+  e131FrameMask |= bit;
+  e131FrameSync = syncAddress;
+
+  bool waitForSync = syncAddress || (artSyncTime && now - artSyncTime < ARTSYNC_TIMEOUT);
+  if (!waitForSync && (e131FrameMask & e131ExpectedMask) == e131ExpectedMask) e131FrameReady(e131FramesComplete);
+  E131_EXIT;
+}
+
+//E1.31 universe synchronization and ArtSync
+static void handleE131Sync(e131_packet_t* p, byte protocol) {
+  uint16_t syncAddress = (p->raw[E131_SYNC_ADDRESS] << 8) | p->raw[E131_SYNC_ADDRESS +1];
+  unsigned long now = millis();
+  E131_ENTER;
+  if (protocol == P_ARTNET_SYNC) artSyncTime = now ? now : 1;
+  //E1.31: other sync addresses synchronize other universes
+  if (e131FrameStart && (protocol == P_ARTNET_SYNC || syncAddress == e131FrameSync)) e131FrameReady(e131FramesComplete);
+  E131_EXIT;
+}
+
+//ingest load statistics, packets by source: E1.31, Art-Net, DDP, UDP (WARLS/DRGB, Hyperion, TPM2.NET)
+static uint32_t rtPackets[4] = {0};
+static uint32_t rtSkipped = 0;           //out of sequence packets, only counted by the AsyncUDP task
+static uint32_t rtMicros = 0, rtMaxMicros = 0;
+static uint32_t rtRate = 0, rtRateCount = 0;
+static unsigned long rtRateStart = 0;
+
+//called by the AsyncUDP task and, for UDP realtime packets, by the loop
+void countRealtimePacket(uint8_t source, uint32_t startMicros) {
+  uint32_t us = micros() - startMicros;
+  unsigned long now = millis();
+  E131_ENTER;
+  rtPackets[source]++;
+  rtMicros += us;
+  if (us > rtMaxMicros) rtMaxMicros = us;
+  rtRateCount++;
+  if (now - rtRateStart >= 1000) {
+    rtRate = rtRateCount;
+    rtRateCount = 0;
+    rtRateStart = now;
+  }
+  E131_EXIT;
+}
+
+void serializeRealtimeStats(JsonObject root) {
+  uint32_t packets[4], us, usMax, rate;
+  unsigned long rateStart;
+  E131_ENTER; //consistent copy, the task may be counting
+  memcpy(packets, rtPackets, sizeof(packets));
+  us = rtMicros;
+  usMax = rtMaxMicros;
+  rate = rtRate;
+  rateStart = rtRateStart;
+  E131_EXIT;
+
+  JsonArray pkt = root.createNestedArray(F("pkt"));
+  uint32_t total = 0;
+  for (uint8_t i = 0; i < 4; i++) {
+    pkt.add(packets[i]);
+    total += packets[i];
+  }
+  root[F("skip")]  = rtSkipped;
+  root[F("pps")]   = (millis() - rateStart < 2000) ? rate : 0; //packets during the last second
+  root[F("us")]    = total ? us / total : 0;                 //average processing time per packet
+  root[F("usmax")] = usMax;
+}
+
+//shows the pending frame if its missing universes or sync did not arrive in time, called from handleNotifications()
+void handleE131FrameTimeout() {
+  unsigned long now = millis();
+  E131_ENTER;
+  if (e131FrameStart && now - e131FrameStart > e131FrameTimeout) e131FrameReady(e131FramesLate);
+  E131_EXIT;
+}
+
 //DDP protocol support, called by handleE131Packet
 //handles RGB data only
 void handleDDPPacket(e131_packet_t* p) {
@@ -18,9 +137,9 @@ void handleDDPPacket(e131_packet_t* p) {
     int sn = p->sequenceNum & 0xF;
     if (sn) {
       if (lastPushSeq > 5) {
-        if (sn > (lastPushSeq -5) && sn < lastPushSeq) return;
+        if (sn > (lastPushSeq -5) && sn < lastPushSeq) { rtSkipped++; return; }
       } else {
-        if (sn > (10 + lastPushSeq) || sn < lastPushSeq) return;
+        if (sn > (10 + lastPushSeq) || sn < lastPushSeq) { rtSkipped++; return; }
       }
     }
   }
@@ -34,27 +153,31 @@ void handleDDPPacket(e131_packet_t* p) {
 
   realtimeLock(realtimeTimeoutMs, REALTIME_MODE_DDP);
 
-  if (!realtimeOverride) {
-    for (uint16_t i = start; i < stop; i++) {
-      setRealtimePixel(i, data[c], data[c+1], data[c+2], 0);
-      c+=3;
-    }
-  }
+  if (!realtimeOverride && start < stop) setRealtimePixels(start, &data[c], stop - start, 3);
 
   bool push = p->flags & DDP_PUSH_FLAG;
   if (push) {
+    E131_ENTER;
+    e131FramesComplete++;
     e131NewData = true;
+    E131_EXIT;
     byte sn = p->sequenceNum & 0xF;
     if (sn) e131LastSequenceNumber[0] = sn;
   }
 }
 
 //E1.31 and Art-Net protocol support
-void handleE131Packet(e131_packet_t* p, IPAddress clientIP, byte protocol){
+static void processE131Packet(e131_packet_t* p, IPAddress clientIP, byte protocol){
 
   uint16_t uni = 0, dmxChannels = 0;
   uint8_t* e131_data = nullptr;
   uint8_t seq = 0, mde = REALTIME_MODE_E131;
+  uint16_t syncAddress = 0;
+
+  if (protocol == P_E131_SYNC || protocol == P_ARTNET_SYNC) {
+    handleE131Sync(p, protocol);
+    return;
+  }
 
   if (protocol == P_ARTNET)
   {
@@ -68,6 +191,7 @@ void handleE131Packet(e131_packet_t* p, IPAddress clientIP, byte protocol){
     dmxChannels = htons(p->property_value_count) -1;
     e131_data = p->property_values;
     seq = p->sequence_number;
+    syncAddress = htons(p->sync_address);
   } else { //DDP
     realtimeIP = clientIP;
     handleDDPPacket(p);
@@ -84,7 +208,7 @@ void handleE131Packet(e131_packet_t* p, IPAddress clientIP, byte protocol){
   #endif
 
   // only listen for universes we're handling & allocated memory
-  if (uni >= (e131Universe + E131_MAX_UNIVERSE_COUNT)) return;
+  if (uni < e131Universe || uni >= (e131Universe + E131_MAX_UNIVERSE_COUNT)) return;
 
   uint8_t previousUniverses = uni - e131Universe;
 
@@ -97,6 +221,7 @@ void handleE131Packet(e131_packet_t* p, IPAddress clientIP, byte protocol){
       DEBUG_PRINT(", universe=");
       DEBUG_PRINT(uni);
       DEBUG_PRINTLN(")");
+      rtSkipped++;
       return;
     }
   e131LastSequenceNumber[uni-e131Universe] = seq;
@@ -204,17 +329,8 @@ void handleE131Packet(e131_packet_t* p, IPAddress clientIP, byte protocol){
           previousLeds = ledsInFirstUniverse + (previousUniverses - 1) * ledsPerUniverse;
           ledsTotal = previousLeds + (dmxChannels / dmxChannelsPerLed);
         }
-        if (!is4Chan) {
-          for (uint16_t i = previousLeds; i < ledsTotal; i++) {
-            setRealtimePixel(i, e131_data[dmxOffset], e131_data[dmxOffset+1], e131_data[dmxOffset+2], 0);
-            dmxOffset+=3;
-          }
-        } else {
-          for (uint16_t i = previousLeds; i < ledsTotal; i++) {
-            setRealtimePixel(i, e131_data[dmxOffset], e131_data[dmxOffset+1], e131_data[dmxOffset+2], e131_data[dmxOffset+3]);
-            dmxOffset+=4;
-          }
-        }
+        if (previousLeds < ledsTotal)
+          setRealtimePixels(previousLeds, &e131_data[dmxOffset], ledsTotal - previousLeds, dmxChannelsPerLed);
         break;
       }
     default:
@@ -223,5 +339,15 @@ void handleE131Packet(e131_packet_t* p, IPAddress clientIP, byte protocol){
       break;
   }
 
-  e131NewData = true;
+  e131UniverseReceived(previousUniverses, syncAddress);
+}
+
+void handleE131Packet(e131_packet_t* p, IPAddress clientIP, byte protocol){
+  uint32_t start = micros();
+  processE131Packet(p, clientIP, protocol);
+  switch (protocol) {
+    case P_E131_SYNC:   protocol = P_E131;   break;
+    case P_ARTNET_SYNC: protocol = P_ARTNET; break;
+  }
+  countRealtimePacket(protocol, start);
 }
@@ -85,6 +85,9 @@ void handleDMX();
 
 //e131.cpp
 void handleE131Packet(e131_packet_t* p, IPAddress clientIP, byte protocol);
+void handleE131FrameTimeout();
+void countRealtimePacket(uint8_t source, uint32_t startMicros);
+void serializeRealtimeStats(JsonObject root);
 
 //file.cpp
 bool handleFileRead(AsyncWebServerRequest*, String path);
@@ -94,6 +97,8 @@ bool readObjectFromFileUsingId(const char* file, uint16_t id, JsonDocument* dest
 bool readObjectFromFile(const char* file, const char* key, JsonDocument* dest);
 void updateFSInfo();
 void closeFile();
+bool buildPresetIndex();
+void invalidatePresetIndex();
 
 //hue.cpp
 void handleHue();
@@ -136,9 +141,33 @@ void handleIR();
 void deserializeSegment(JsonObject elem, byte it, byte presetId = 0);
 bool deserializeState(JsonObject root, byte callMode = CALL_MODE_DIRECT_CHANGE, byte presetId = 0);
 void serializeSegment(JsonObject& root, WS2812FX::Segment& seg, byte id, bool forPreset = false, bool segmentBounds = true);
-void serializeState(JsonObject root, bool forPreset = false, bool includeBri = true, bool segmentBounds = true);
+void serializeState(JsonObject root, bool forPreset = false, bool includeBri = true, bool segmentBounds = true, bool includeSegments = true);
 void serializeInfo(JsonObject root);
 void serveJson(AsyncWebServerRequest* request);
+
+// streams state/info piece by piece (state without segments, each segment, info, names),
+// each piece is built in a JSON arena that is released before the piece text is sent
+class JsonStreamer {
+  public:
+    JsonStreamer(uint8_t content) : _content(content) {} // JSON_STREAM_* flags, wrapped in an object if more than one
+    ~JsonStreamer() { free(_part); }
+    size_t read(uint8_t* dest, size_t maxLen); // copies the next bytes, stops early if no JSON buffer is free
+    size_t length();                            // total size, consumes the stream (0 if no JSON buffer is free)
+    bool done() const { return _step == JSON_STREAM_DONE && _srcPos >= _srcLen; }
+  private:
+    bool nextPart();
+    bool buildPart(uint8_t step, bool comma);
+    void setSource(const char* src, size_t len, bool flash);
+    uint8_t _content;
+    uint8_t _step = 0;
+    uint8_t _seg = 0;
+    bool _comma = false;         // a section was already written to the wrapping object
+    char* _part = nullptr;       // text of the last built piece
+    const char* _src = nullptr;  // piece being copied (heap or PROGMEM)
+    bool _srcFlash = false;
+    size_t _srcLen = 0;
+    size_t _srcPos = 0;
+};
 #ifdef WLED_ENABLE_JSONLIVE
 bool serveLiveLeds(AsyncWebServerRequest* request, uint32_t wsClient = 0);
 #endif
@@ -198,6 +227,7 @@ inline bool applyTemporaryPreset() {return applyPreset(255);};
 void savePreset(byte index, const char* pname = nullptr, JsonObject saveobj = JsonObject());
 inline void saveTemporaryPreset() {savePreset(255);};
 void deletePreset(byte index);
+void invalidatePresetSnapshots();
 
 //set.cpp
 bool isAsterisksOnly(const char* str, byte maxLen);
@@ -209,11 +239,24 @@ bool updateVal(const String* req, const char* key, byte* val, byte minv=0, byte
 
 //udp.cpp
 void notify(byte callMode, bool followUp=false);
-uint8_t realtimeBroadcast(uint8_t type, IPAddress client, uint16_t length, byte *buffer, uint8_t bri=255, bool isRGBW=false);
+uint32_t syncedMillis();
+void handleClockSync();
+void serializeClockSync(JsonObject root);
+uint16_t realtimeBroadcastPacketSize(uint8_t type);
+void realtimeBroadcastInit(uint8_t type, byte *packet);
+uint8_t realtimeBroadcast(uint8_t type, IPAddress client, uint16_t length, byte *buffer, uint8_t bri=255, bool isRGBW=false, byte *packet=nullptr);
+class BusNetwork;
+void queueNetworkOutput(BusNetwork* bus);
+void flushNetworkOutput();
 void realtimeLock(uint32_t timeoutMs, byte md = REALTIME_MODE_GENERIC);
 void exitRealtime();
 void handleNotifications();
+bool udpListen(uint8_t source, uint16_t port);
+uint32_t getUdpQueueDropped();
 void setRealtimePixel(uint16_t i, byte r, byte g, byte b, byte w);
+void setRealtimePixels(uint16_t start, const byte* data, uint16_t count, byte channels);
+void realtimeShow();
+void handleRealtimeJitterBuffer();
 void refreshNodeList();
 void sendSysInfoUDP();
 
@@ -225,7 +268,13 @@ void sendSysInfoUDP();
 //void prepareHostname(char* hostname);
 //bool isAsterisksOnly(const char* str, byte maxLen);
 bool requestJSONBufferLock(uint8_t module=255);
+bool tryJSONBufferLock(uint8_t module=255);
 void releaseJSONBufferLock();
+JsonDocument* requestJSONBuffer(uint8_t module=255, uint16_t waitMs=0);
+void releaseJSONBuffer(JsonDocument* arena);
+bool deferJSONWork(void (*fn)(uint32_t), uint32_t arg);
+void handleJSONDeferred();
+void serializeJSONBufferStats(JsonObject root);
 uint8_t extractModeName(uint8_t mode, const char *src, char *dest, uint8_t maxLen);
 
 //um_manager.cpp
@@ -31,6 +31,57 @@ uint16_t knownLargestSpace = UINT16_MAX;
 
 File f;
 
+// Offset index of /presets.json: position of each preset object (right after its "id": key) and its length,
+// so a preset is read with one seek instead of scanning the file. Kept up to date by writeObjectToFile(),
+// rebuilt by a single scan when it does not match the file (e.g. after an upload).
+struct PresetIndexEntry {
+  uint32_t pos;
+  uint16_t len; // 0 if the preset does not exist
+} __attribute__((packed));
+static PresetIndexEntry* presetIndex = nullptr; // ids 0-250
+static bool presetIndexValid = false;
+static const char* presetIndexKey = nullptr; // key of the preset being written, nullptr if not writing presets.json
+
+#if WLED_PRESET_CACHE > 0
+// most recently used presets as JSON text
+struct PresetCacheEntry {
+  uint8_t id;
+  uint16_t len;
+  uint32_t used;
+  char* data;
+};
+static PresetCacheEntry presetCache[WLED_PRESET_CACHE] = {{0, 0, 0, nullptr}};
+static uint32_t presetCacheTick = 0;
+
+static void dropCachedPreset(int16_t id) // -1 drops all
+{
+  for (uint8_t i = 0; i < WLED_PRESET_CACHE; i++) {
+    if (!presetCache[i].data || (id >= 0 && presetCache[i].id != id)) continue;
+    free(presetCache[i].data);
+    presetCache[i].data = nullptr;
+  }
+}
+#else
+static void dropCachedPreset(int16_t id) {}
+#endif
+
+void invalidatePresetIndex()
+{
+  presetIndexValid = false;
+  dropCachedPreset(-1);
+}
+
+static void updatePresetIndex(uint32_t pos, uint32_t len)
+{
+  if (!presetIndexKey || !presetIndexValid) return;
+  int id = atoi(presetIndexKey + 1); // "id":
+  if (id < 0 || id > 250) return;
+  dropCachedPreset(id);
+  if (len > UINT16_MAX) { invalidatePresetIndex(); return; }
+  presetIndex[id].pos = pos;
+  presetIndex[id].len = len;
+}
+
 //wrapper to find out how long closing takes
 void closeFile() {
   #ifdef WLED_DEBUG_FS
@@ -201,6 +252,7 @@ bool appendObjectToFile(const char* key, JsonDocument* content, uint32_t s, uint
   if (bufferedFindSpace(contentLen + strlen(key) + 1)) {
     if (f.position() > 2) f.write(','); //add comma if not first object
     f.print(key);
+    updatePresetIndex(f.position(), contentLen);
     serializeJson(*content, f);
     DEBUGFS_PRINTF("Inserted, took %d ms (total %d)", millis() - s1, millis() - s);
     doCloseFile = true;
@@ -244,6 +296,7 @@ bool appendObjectToFile(const char* key, JsonDocument* content, uint32_t s, uint
   }
 
   f.print(key);
+  updatePresetIndex(f.position(), contentLen);
 
   //Append object
   serializeJson(*content, f);
@@ -271,6 +324,7 @@ bool writeObjectToFile(const char* file, const char* key, JsonDocument* content)
   #endif
 
   uint32_t pos = 0;
+  presetIndexKey = strcmp(file, "/presets.json") ? nullptr : key;
   f = WLED_FS.open(file, "r+");
   if (!f && !WLED_FS.exists(file)) f = WLED_FS.open(file, "w+");
   if (!f) {
@@ -306,12 +360,15 @@ bool writeObjectToFile(const char* file, const char* key, JsonDocument* content)
     f.seek(pos);
     serializeJson(*content, f);
     writeSpace(pos2 - f.position());
+    updatePresetIndex(pos, contentLen);
   } else if (contentLen && bufferedFindSpace(contentLen - oldLen, false)) { //enough leading spaces to replace
     DEBUGFS_PRINTLN(F("replace (trailing)"));
     f.seek(pos);
     serializeJson(*content, f);
+    updatePresetIndex(pos, contentLen);
   } else {
     DEBUGFS_PRINTLN(F("delete"));
+    updatePresetIndex(0, 0);
     pos -= strlen(key);
     if (pos > 3) pos--; //also delete leading comma if not first object
     f.seek(pos);
@@ -324,10 +381,149 @@ bool writeObjectToFile(const char* file, const char* key, JsonDocument* content)
   return true;
 }
 
+//scans presets.json once and records where each top level object starts and ends
+bool buildPresetIndex()
+{
+  #ifdef WLED_DEBUG_FS
+    DEBUGFS_PRINTLN(F("Build preset index"));
+    uint32_t s = millis();
+  #endif
+  if (doCloseFile) closeFile();
+  if (!presetIndex) presetIndex = (PresetIndexEntry*)malloc(251 * sizeof(PresetIndexEntry));
+  if (!presetIndex) return false;
+  memset(presetIndex, 0, 251 * sizeof(PresetIndexEntry));
+  dropCachedPreset(-1);
+
+  File pf = WLED_FS.open("/presets.json", "r");
+  if (pf) {
+    byte buf[FS_BUFSIZE];
+    uint32_t pos = 0;
+    uint16_t depth = 0;
+    bool inString = false, escape = false;
+    int16_t keyId = -1;    // numeric root level key being read
+    int16_t pendingId = -1; // key followed by ':'
+    int16_t objId = -1;     // preset object being measured
+    uint32_t objStart = 0;
+
+    while (pf.available()) {
+      uint16_t bufsize = pf.read(buf, FS_BUFSIZE);
+      for (uint16_t i = 0; i < bufsize; i++, pos++) {
+        char c = buf[i];
+        if (inString) {
+          if (escape) escape = false;
+          else if (c == '\\') { escape = true; keyId = -1; }
+          else if (c == '"') inString = false;
+          else if (keyId >= 0) keyId = (c >= '0' && c <= '9' && keyId < 1000) ? keyId*10 + c - '0' : -1;
+          continue;
+        }
+        switch (c) {
+          case '"':
+            inString = true;
+            keyId = (depth == 1) ? 0 : -1;
+            break;
+          case ':':
+            if (depth == 1) pendingId = keyId;
+            keyId = -1;
+            break;
+          case '{':
+            if (++depth == 2 && pendingId >= 0 && pendingId <= 250) { objId = pendingId; objStart = pos; }
+            pendingId = -1;
+            break;
+          case '}':
+            if (depth) depth--;
+            if (depth == 1 && objId >= 0) {
+              if (pos - objStart < UINT16_MAX) {
+                presetIndex[objId].pos = objStart;
+                presetIndex[objId].len = pos - objStart + 1;
+              }
+              objId = -1;
+            }
+            break;
+        }
+      }
+    }
+    pf.close();
+  }
+  presetIndexValid = true;
+  DEBUGFS_PRINTF("Indexed, took %d ms\n", millis() - s);
+  return true;
+}
+
+//reads a preset using the index, returns 1 if read, 0 if it does not exist and -1 if the index cannot be used
+static int8_t readIndexedPreset(uint8_t id, const char* key, JsonDocument* dest)
+{
+  if (!presetIndexValid && !buildPresetIndex()) return -1;
+  PresetIndexEntry &entry = presetIndex[id];
+  if (!entry.len) {
+    dest->clear();
+    DEBUGFS_PRINTLN(F("Obj not found."));
+    return 0;
+  }
+
+  #if WLED_PRESET_CACHE > 0
+  PresetCacheEntry *slot = &presetCache[0];
+  for (uint8_t i = 0; i < WLED_PRESET_CACHE; i++) {
+    PresetCacheEntry &c = presetCache[i];
+    if (c.data && c.id == id) {
+      c.used = ++presetCacheTick;
+      deserializeJson(*dest, (const char*)c.data, c.len); //copy strings, the entry may be dropped
+      return 1;
+    }
+    if (!c.data || (slot->data && c.used < slot->used)) slot = &c; //free or least recently used
+  }
+  #endif
+
+  if (doCloseFile) closeFile();
+  f = WLED_FS.open("/presets.json", "r");
+  if (!f) return -1;
+
+  //make sure the file still matches the index, it may have been replaced
+  size_t keyLen = strlen(key);
+  char check[12];
+  if (entry.pos < keyLen || !f.seek(entry.pos - keyLen) || f.read((uint8_t*)check, keyLen +1) != keyLen +1
+      || memcmp(check, key, keyLen) || check[keyLen] != '{') {
+    f.close();
+    DEBUGFS_PRINTLN(F("Preset index outdated."));
+    invalidatePresetIndex();
+    return -1;
+  }
+  f.seek(entry.pos);
+
+  #if WLED_PRESET_CACHE > 0
+  if (entry.len <= PRESET_CACHE_MAX_LEN) {
+    free(slot->data);
+    #if defined(ARDUINO_ARCH_ESP32) && defined(WLED_USE_PSRAM)
+    slot->data = (char*)(psramFound() ? ps_malloc(entry.len) : malloc(entry.len));
+    #else
+    slot->data = (char*)malloc(entry.len);
+    #endif
+    if (slot->data && f.read((uint8_t*)slot->data, entry.len) == entry.len) {
+      f.close();
+      slot->id = id;
+      slot->len = entry.len;
+      slot->used = ++presetCacheTick;
+      deserializeJson(*dest, (const char*)slot->data, slot->len);
+      return 1;
+    }
+    free(slot->data);
+    slot->data = nullptr;
+    f.seek(entry.pos);
+  }
+  #endif
+
+  deserializeJson(*dest, f);
+  f.close();
+  return 1;
+}
+
 bool readObjectFromFileUsingId(const char* file, uint16_t id, JsonDocument* dest)
 {
   char objKey[10];
   sprintf(objKey, "\"%d\":", id);
+  if (id <= 250 && !strcmp(file, "/presets.json")) {
+    int8_t found = readIndexedPreset(id, objKey, dest);
+    if (found >= 0) return found;
+  }
   return readObjectFromFile(file, objKey, dest);
 }
 
@@ -95,7 +95,7 @@ content="width=device-width,initial-scale=1,minimum-scale=1"><meta
 charset="utf-8"><meta name="theme-color" content="#222222"><title>
 WLED Live Preview</title><style>body{margin:0}</style></head><body><canvas 
 id="liveviewCanvas">LiveView</canvas><script>
-var canvas=document.getElementById("liveviewCanvas");canvas.width=.98*window.innerWidth,canvas.height=.98*window.innerHeight;var ws,leds="",matrixWidth=0,pixelsPerLed=0;if(canvas.getContext){var ctx=canvas.getContext("2d");function drawLedCircles(e,t,i,n,a,s){ctx.fillStyle=`rgb(${i},${n},${a})`,ctx.beginPath(),ctx.arc(e*pixelsPerLed+pixelsPerLed/2,t*pixelsPerLed+pixelsPerLed/2,pixelsPerLed/2,0,2*Math.PI),ctx.fill()}function paintLeds(){for(i=4;i<leds.length;i+=3){let e=(i-4)/3;drawLedCircles(e%matrixWidth,Math.floor(e/matrixWidth),leds[i],leds[i+1],leds[i+2],255)}}}function updatePreview(e){matrixWidth=(leds=e)[2],matrixHeight=leds[3],pixelsPerLed=Math.min(canvas.width/matrixWidth,canvas.height/matrixHeight),paintLeds()}function getLiveJson(e){try{if("[object ArrayBuffer]"===toString.call(e.data)){let e=new Uint8Array(event.data);if(76!=e[0])return;updatePreview(e)}}catch(e){console.error("Peek WS error:",e)}}try{ws=top.window.ws}catch(e){}ws&&ws.readyState===WebSocket.OPEN?(console.info("Peek uses top WS"),ws.send("{'lv':true}")):(console.info("Peek WS opening"),(ws=new WebSocket(("https:"==window.location.protocol?"wss":"ws")+"://"+document.location.host+"/ws")).onopen=function(){console.info("Peek WS open"),ws.send("{'lv':true}")}),ws.binaryType="arraybuffer",ws.addEventListener("message",getLiveJson)
+var canvas=document.getElementById("liveviewCanvas");canvas.width=.98*window.innerWidth,canvas.height=.98*window.innerHeight;var ws,leds="",ledsStart=4,frame=null,matrixWidth=0,pixelsPerLed=0;if(canvas.getContext){var ctx=canvas.getContext("2d");function drawLedCircles(e,t,i,n,a,s){ctx.fillStyle=`rgb(${i},${n},${a})`,ctx.beginPath(),ctx.arc(e*pixelsPerLed+pixelsPerLed/2,t*pixelsPerLed+pixelsPerLed/2,pixelsPerLed/2,0,2*Math.PI),ctx.fill()}function paintLeds(){for(i=ledsStart;i<leds.length;i+=3){let e=(i-ledsStart)/3;drawLedCircles(e%matrixWidth,Math.floor(e/matrixWidth),leds[i],leds[i+1],leds[i+2],255)}}}function decodeFrame(e){let t=e[6],i=Math.ceil((e[2]|e[3]<<8)/t),n=Math.ceil((e[4]|e[5]<<8)/t),a=i*n;if(!frame||frame.length!=3*a){if(!(1&e[7]))return!1;frame=new Uint8Array(3*a)}let s=8,r=0;for(;s<e.length&&r<a;){let o=e[s++],l=(o<128?o:63&o)+1;if(o<128)frame.set(e.subarray(s,s+3*l),3*r),s+=3*l;else if(o<192){for(let c=0;c<l;c++)frame.set(e.subarray(s,s+3),3*(r+c));s+=3}r+=l}return updatePreview(frame,i,n,0),!0}function updatePreview(e,t,i,n){leds=e,ledsStart=n,matrixWidth=t,matrixHeight=i,pixelsPerLed=Math.min(canvas.width/matrixWidth,canvas.height/matrixHeight),paintLeds()}function getLiveJson(e){try{if("[object ArrayBuffer]"===toString.call(e.data)){let e=new Uint8Array(event.data);if(76!=e[0])return;2==e[1]?decodeFrame(e):updatePreview(e,e[2],e[3],4)}}catch(e){console.error("Peek WS error:",e)}}try{ws=top.window.ws}catch(e){}ws&&ws.readyState===WebSocket.OPEN?(console.info("Peek uses top WS"),ws.send("{'lv':2}")):(console.info("Peek WS opening"),(ws=new WebSocket(("https:"==window.location.protocol?"wss":"ws")+"://"+document.location.host+"/ws")).onopen=function(){console.info("Peek WS open"),ws.send("{'lv':2}")}),ws.binaryType="arraybuffer",ws.addEventListener("message",getLiveJson)
 </script></body></html>)=====";
 
 
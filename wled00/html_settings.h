@@ -187,7 +187,8 @@ name="PB"><option value="0">Linear (wrap if moving)</option><option value="1">
 Linear (always wrap)</option><option value="2">Linear (never wrap)</option>
 <option value="3">None (not recommended)</option></select><br>
 Target refresh rate: <input type="number" class="s" min="1" max="120" name="FR" 
-required> FPS<hr style="width:260px"><div id="cfg">Config template: <input 
+required> FPS<br>Send sync after each frame (network busses): <input 
+type="checkbox" name="NS"><hr style="width:260px"><div id="cfg">Config template: <input 
 type="file" name="data2" accept=".json"> <input type="button" value="Apply" 
 onclick="loadCfg(d.Sf.data2)"><br></div><hr><button type="button" onclick="B()">
 Back</button><button type="submit">Save</button></form><div id="toast"></div>
@@ -337,7 +338,7 @@ Send notifications on button press or IR: <input type="checkbox" name="SB"><br>
 Send Alexa notifications: <input type="checkbox" name="SA"><br>
 Send Philips Hue change notifications: <input type="checkbox" name="SH"><br>
 Send Macro notifications: <input type="checkbox" name="SM"><br>
-Send notifications twice: <input type="checkbox" name="S2"><br><i>
+Send notifications twice: <input type="checkbox" name="S2"><br>Sync effect clock: <input type="checkbox" name="CS"><br>Clock priority: <input name="CP" type="number" min="0" max="255" required> (lowest leads)<br><i>
 Reboot required to apply changes.</i><h3>Instance List</h3>
 Enable instance list: <input type="checkbox" name="NL"><br>
 Make this instance discoverable: <input type="checkbox" name="NB"><h3>Realtime
@@ -359,6 +360,11 @@ Single DRGB</option><option value="3">Effect</option><option value="4">Multi RGB
 Multi RGBW</option></select><br><a 
 href="https://kno.wled.ge/interfaces/e1.31-dmx/" target="_blank">E1.31 info</a>
 <br>Timeout: <input name="ET" type="number" min="1" max="65000" required> ms<br>
+Frame timeout: <input name="FT" type="number" min="1" max="1000" required> ms<br>
+Jitter buffer: <select name="JB"><option value="0">Off</option><option value="2">
+2 frames</option><option value="3">3 frames</option><option value="4">4 frames
+</option></select><br>Interpolate buffered frames: <input type="checkbox" name="JI">
+<br>
 Force max brightness: <input type="checkbox" name="FB"><br>
 Disable realtime gamma correction: <input type="checkbox" name="RG"><br>
 Realtime LED offset: <input name="WO" type="number" min="-255" max="255" 
@@ -1,4 +1,5 @@
 #include "wled.h"
+#include <memory>
 
 #include "palettes.h"
 
@@ -327,7 +328,7 @@ bool deserializeState(JsonObject root, byte callMode, byte presetId)
   strip.setTransition(transitionDelayTemp); // required here for color transitions to have correct duration
 
   tr = root[F("tb")] | -1;
-  if (tr >= 0) strip.timebase = ((uint32_t)tr) - millis();
+  if (tr >= 0) strip.timebase = ((uint32_t)tr) - syncedMillis();
 
   JsonObject nl       = root["nl"];
   nightlightActive    = nl["on"]      | nightlightActive;
@@ -348,6 +349,13 @@ bool deserializeState(JsonObject root, byte callMode, byte presetId)
 
   doReboot = root[F("rb")] | doReboot;
 
+  #ifdef WLED_ENABLE_FX_BENCHMARK
+  uint16_t benchFrames = root[F("fxbench")] | 0; // frames rendered per effect, results in /json/fxbench
+  if (benchFrames) strip.startBenchmark(benchFrames);
+  uint16_t goldenFrames = root[F("fxgold")] | 0; // same, with scripted clock/audio and frame hashes
+  if (goldenFrames) strip.startBenchmark(goldenFrames, true);
+  #endif
+
   strip.setMainSegmentId(root[F("mainseg")] | strip.getMainSegmentId()); // must be before realtimeLock() if "live"
 
   realtimeOverride = root[F("lor")] | realtimeOverride;
@@ -494,7 +502,7 @@ void serializeSegment(JsonObject& root, WS2812FX::Segment& seg, byte id, bool fo
   root[F("rot2D")]  = seg.getOption(SEG_OPTION_ROTATED2D);
 }
 
-void serializeState(JsonObject root, bool forPreset, bool includeBri, bool segmentBounds)
+void serializeState(JsonObject root, bool forPreset, bool includeBri, bool segmentBounds, bool includeSegments)
 {
   if (includeBri) {
     root["on"] = (bri > 0);
@@ -530,6 +538,7 @@ void serializeState(JsonObject root, bool forPreset, bool includeBri, bool segme
   }
 
   root[F("mainseg")] = strip.getMainSegmentId();
+  if (!includeSegments) return; // JsonStreamer sends each segment separately
 
   JsonArray seg = root.createNestedArray("seg");
   for (byte s = 0; s < strip.getMaxSegments(); s++) {
@@ -581,11 +590,17 @@ void serializeInfo(JsonObject root)
 
   uint8_t totalLC = 0;
   JsonArray lcarr = leds.createNestedArray(F("seglc"));
+  JsonArray fpsarr  = leds.createNestedArray(F("segfps"));  // actual FPS per segment
+  JsonArray tfpsarr = leds.createNestedArray(F("segtfps")); // target FPS per segment, lower while the frame budget is exceeded
+  JsonArray usarr   = leds.createNestedArray(F("segus"));   // render time per frame in us
   uint8_t nSegs = strip.getLastActiveSegmentId();
   for (byte s = 0; s <= nSegs; s++) {
     uint8_t lc = strip.getSegment(s).getLightCapabilities();
     totalLC |= lc;
     lcarr.add(lc);
+    fpsarr.add(strip.getSegmentFps(s));
+    tfpsarr.add(strip.getSegmentTargetFps(s));
+    usarr.add(strip.getSegmentRenderTime(s));
   }
 
   leds["lc"] = totalLC;
@@ -594,7 +609,23 @@ void serializeInfo(JsonObject root)
   leds[F("wv")]   = totalLC & 0x02;     // deprecated, true if white slider should be displayed for any segment
   leds["cct"]     = totalLC & 0x04;     // deprecated, use info.leds.lc
 
+  JsonArray nout = leds.createNestedArray(F("nout")); // network outputs: ip, last send time in us, frames, errors
+  for (uint8_t b = 0; b < busses.getNumBusses(); b++) {
+    Bus* bus = busses.getBus(b);
+    if (bus->getType() < TYPE_NET_DDP_RGB || bus->getType() >= 96) continue;
+    BusNetwork* net = static_cast<BusNetwork*>(bus);
+    JsonArray dest = nout.createNestedArray();
+    dest.add(net->getClient().toString());
+    dest.add(net->getSendMicros());
+    dest.add(net->getSendFrames());
+    dest.add(net->getSendErrors());
+  }
+
   root[F("str")] = syncToggleReceive;
+  if (clockSyncEnabled) {
+    JsonObject clk = root.createNestedObject(F("clk")); // shared clock: leader IP (empty while leading), offset, round trip, drift
+    serializeClockSync(clk);
+  }
 
   root[F("name")] = serverDescription;
   root[F("udpport")] = udpPort;
@@ -621,6 +652,18 @@ void serializeInfo(JsonObject root)
     root[F("lip")] = realtimeIP.toString();
   }
 
+  JsonObject lfr = root.createNestedObject(F("lfr")); // realtime frames shown since boot
+  lfr[F("ok")]   = e131FramesComplete;
+  lfr[F("inc")]  = e131FramesIncomplete;
+  lfr[F("late")] = e131FramesLate;
+
+  JsonObject lstat = root.createNestedObject(F("lstat")); // realtime ingest load: packets by source (E1.31, Art-Net, DDP, UDP), skipped, rate, processing time
+  serializeRealtimeStats(lstat);
+  lstat[F("udpdrop")] = getUdpQueueDropped(); // notifier port packets dropped while the receive queue was full
+
+  JsonObject jbuf = root.createNestedObject(F("jbuf")); // JSON buffer pool: arenas, lock contention and wait, deferred work
+  serializeJSONBufferStats(jbuf);
+
   #ifdef WLED_ENABLE_WEBSOCKETS
   root[F("ws")] = ws.count();
   #else
@@ -879,6 +922,152 @@ void serializeNodes(JsonObject root)
   }
 }
 
+#ifdef WLED_ENABLE_FX_BENCHMARK
+// results of the on-device effect benchmark, measured on the main segment
+void serializeBenchmark(JsonObject root)
+{
+  WS2812FX::Segment& seg = strip.getMainSegment();
+  uint16_t len = seg.virtualLength();
+  root[F("run")] = strip.isBenchmarkRunning();
+  root["len"] = len;
+  root["w"] = seg.stopX - seg.startX + 1;
+  root["h"] = seg.stopY - seg.startY + 1;
+
+  JsonArray us   = root.createNestedArray("us");      // us per frame
+  JsonArray nspx = root.createNestedArray(F("nspx")); // ns per pixel
+  for (uint8_t m = 0; m < strip.getModeCount(); m++) {
+    uint32_t t = strip.getBenchmarkResult(m); // ns
+    us.add(t / 1000);
+    nspx.add(len ? t / len : 0);
+  }
+
+  // golden run: frame hashes, and modes that did not reproduce
+  if (!strip.getGoldenHash(FX_MODE_STATIC)) return; // keep the plain benchmark within the JSON buffer
+  JsonArray hash     = root.createNestedArray(F("hash"));
+  JsonArray unstable = root.createNestedArray(F("unstable"));
+  for (uint8_t m = 0; m < strip.getModeCount(); m++) {
+    hash.add(strip.getGoldenHash(m));
+    if (strip.getGoldenHash(m) && !strip.isGoldenStable(m)) unstable.add(m);
+  }
+}
+#endif
+
+// streaming steps, each one emits a single piece (or nothing if its section is not requested)
+enum JsonStreamStep : uint8_t {
+  STREAM_OPEN, STREAM_STATE_KEY, STREAM_STATE_HEAD, STREAM_SEG_OPEN, STREAM_SEGMENTS, STREAM_STATE_CLOSE,
+  STREAM_INFO_KEY, STREAM_INFO, STREAM_EFFECTS_KEY, STREAM_EFFECTS, STREAM_PALETTES_KEY, STREAM_PALETTES, STREAM_CLOSE
+};
+
+void JsonStreamer::setSource(const char* src, size_t len, bool flash)
+{
+  _src = src;
+  _srcLen = len;
+  _srcPos = 0;
+  _srcFlash = flash;
+}
+
+// builds one piece in a JSON arena and keeps only its text, returns false if no arena is free
+bool JsonStreamer::buildPart(uint8_t step, bool comma)
+{
+  JsonDocument *arena = requestJSONBuffer(18);
+  if (!arena) return false;
+  JsonObject root = arena->to<JsonObject>();
+  switch (step) {
+    case STREAM_STATE_HEAD: serializeState(root, false, true, true, false); break;
+    case STREAM_SEGMENTS:   serializeSegment(root, strip.getSegment(_seg), _seg, false, true); break;
+    case STREAM_INFO:       serializeInfo(root); break;
+  }
+  size_t len = measureJson(*arena);
+  free(_part);
+  _part = (char*)malloc(len + 2);
+  if (_part) {
+    _part[0] = ',';
+    serializeJson(*arena, _part + comma, len + 1);
+  }
+  releaseJSONBuffer(arena);
+
+  if (!_part) { // out of memory, end the (now invalid) response
+    _step = JSON_STREAM_DONE;
+    setSource(nullptr, 0, false);
+    return true;
+  }
+  if (step == STREAM_STATE_HEAD) len--; // drop closing brace, segments follow
+  setSource(_part, len + comma, false);
+  return true;
+}
+
+// sets up the piece of the current step and advances
+bool JsonStreamer::nextPart()
+{
+  bool wrap   = (_content & (_content - 1)); // more than one section
+  bool state  = _content & JSON_STREAM_STATE;
+  bool info   = _content & JSON_STREAM_INFO;
+  bool names  = _content & JSON_STREAM_NAMES;
+  const char *lit = nullptr;
+
+  setSource(nullptr, 0, false);
+  switch (_step) {
+    case STREAM_OPEN:         if (wrap) lit = PSTR("{"); break;
+    case STREAM_STATE_KEY:    if (wrap && state) lit = PSTR("\"state\":"); break;
+    case STREAM_STATE_HEAD:   if (state && !buildPart(_step, false)) return false; break;
+    case STREAM_SEG_OPEN:     if (state) lit = PSTR(",\"seg\":["); break;
+    case STREAM_SEGMENTS:
+      if (!state) break;
+      for (; _seg < strip.getMaxSegments(); _seg++) {
+        if (!strip.getSegment(_seg).isActive()) continue;
+        if (!buildPart(_step, _comma)) return false;
+        _comma = true;
+        _seg++;
+        return true; // stay on this step for the next segment
+      }
+      _comma = false;
+      break;
+    case STREAM_STATE_CLOSE:  if (state) { lit = PSTR("]}"); _comma = true; } break;
+    case STREAM_INFO_KEY:     if (wrap && info) lit = _comma ? PSTR(",\"info\":") : PSTR("\"info\":"); break;
+    case STREAM_INFO:         if (info) { if (!buildPart(_step, false)) return false; _comma = true; } break;
+    case STREAM_EFFECTS_KEY:  if (names) lit = _comma ? PSTR(",\"effects\":") : PSTR("\"effects\":"); break;
+    case STREAM_EFFECTS:      if (names) setSource(JSON_mode_names, strlen_P(JSON_mode_names), true); break;
+    case STREAM_PALETTES_KEY: if (names) lit = PSTR(",\"palettes\":"); break;
+    case STREAM_PALETTES:     if (names) setSource(JSON_palette_names, strlen_P(JSON_palette_names), true); break;
+    case STREAM_CLOSE:        if (wrap) lit = PSTR("}"); break;
+    default:                  return true;
+  }
+  if (lit) setSource(lit, strlen_P(lit), true);
+  if (_step != JSON_STREAM_DONE) _step = (_step == STREAM_CLOSE) ? JSON_STREAM_DONE : _step + 1;
+  return true;
+}
+
+size_t JsonStreamer::read(uint8_t* dest, size_t maxLen)
+{
+  size_t written = 0;
+  while (written < maxLen) {
+    if (_srcPos >= _srcLen) {
+      if (_step == JSON_STREAM_DONE) break;
+      if (!nextPart()) break; // no JSON buffer free, continue on the next call
+      continue;
+    }
+    size_t n = _srcLen - _srcPos;
+    if (n > maxLen - written) n = maxLen - written;
+    if (_srcFlash) memcpy_P(dest + written, _src + _srcPos, n);
+    else           memcpy(dest + written, _src + _srcPos, n);
+    written += n;
+    _srcPos += n;
+  }
+  return written;
+}
+
+size_t JsonStreamer::length()
+{
+  size_t total = 0;
+  while (true) {
+    total += _srcLen - _srcPos;
+    _srcPos = _srcLen;
+    if (_step == JSON_STREAM_DONE) break;
+    if (!nextPart()) return 0;
+  }
+  return total;
+}
+
 void serveJson(AsyncWebServerRequest* request)
 {
   byte subJson = 0;
@@ -888,6 +1077,9 @@ void serveJson(AsyncWebServerRequest* request)
   else if (url.indexOf("si")    > 0) subJson = 3;
   else if (url.indexOf("nodes") > 0) subJson = 4;
   else if (url.indexOf("palx")  > 0) subJson = 5;
+  #ifdef WLED_ENABLE_FX_BENCHMARK
+  else if (url.indexOf(F("fxbench")) > 0) subJson = 6;
+  #endif
   #ifdef WLED_ENABLE_JSONLIVE
   else if (url.indexOf("live")  > 0) {
     serveLiveLeds(request);
@@ -910,35 +1102,46 @@ void serveJson(AsyncWebServerRequest* request)
     return;
   }
 
+  if (subJson < 4) { // state and info are streamed in pieces instead of holding a JSON buffer until sent
+    static const uint8_t streamContent[] = {
+      JSON_STREAM_STATE | JSON_STREAM_INFO | JSON_STREAM_NAMES, JSON_STREAM_STATE, JSON_STREAM_INFO, JSON_STREAM_STATE | JSON_STREAM_INFO
+    };
+    std::shared_ptr<JsonStreamer> stream = std::make_shared<JsonStreamer>(streamContent[subJson]);
+    AsyncWebServerResponse *response = request->beginChunkedResponse("application/json",
+      [stream](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+        size_t len = stream->read(buffer, maxLen);
+        if (!len && !stream->done()) return RESPONSE_TRY_AGAIN; // all JSON buffers busy
+        return len;
+      });
+    request->send(response);
+    return;
+  }
+
   #ifdef WLED_USE_DYNAMIC_JSON
   AsyncJsonResponse* response = new AsyncJsonResponse(JSON_BUFFER_SIZE);
   #else
-  if (!requestJSONBufferLock(17)) return;
-  AsyncJsonResponse *response = new AsyncJsonResponse(&doc);
+  // read-only, may use a pool arena while doc is busy. Without a free arena (ESP8266 has none) wait up to
+  // a second for one, like for doc before the pool, the other requests only hold it while serializing
+  JsonDocument *pDoc = requestJSONBuffer(17, 1000);
+  if (!pDoc) {
+    request->send(503, "application/json", F("{\"error\":3}"));
+    return;
+  }
+  AsyncJsonResponse *response = new AsyncJsonResponse(pDoc);
   #endif
 
   JsonObject lDoc = response->getRoot();
 
   switch (subJson)
   {
-    case 1: //state
-      serializeState(lDoc); break;
-    case 2: //info
-      serializeInfo(lDoc); break;
     case 4: //node list
       serializeNodes(lDoc); break;
     case 5: //palettes
       serializePalettes(lDoc, request); break;
-    default: //all
-      JsonObject state = lDoc.createNestedObject("state");
-      serializeState(state);
-      JsonObject info = lDoc.createNestedObject("info");
-      serializeInfo(info);
-      if (subJson != 3)
-      {
-        doc[F("effects")]  = serialized((const __FlashStringHelper*)JSON_mode_names);
-        doc[F("palettes")] = serialized((const __FlashStringHelper*)JSON_palette_names);
-      }
+    #ifdef WLED_ENABLE_FX_BENCHMARK
+    case 6: //effect benchmark
+      serializeBenchmark(lDoc); break;
+    #endif
   }
 
   DEBUG_PRINT("JSON buffer size: ");
@@ -946,7 +1149,9 @@ void serveJson(AsyncWebServerRequest* request)
 
   response->setLength();
   request->send(response);
-  releaseJSONBufferLock();
+  #ifndef WLED_USE_DYNAMIC_JSON
+  releaseJSONBuffer(pDoc);
+  #endif
 }
 
 #ifdef WLED_ENABLE_JSONLIVE
@@ -971,7 +1176,7 @@ bool serveLiveLeds(AsyncWebServerRequest* request, uint32_t wsClient)
 
   for (uint16_t i= 0; i < used; i += n)
   {
-    uint32_t c = strip.getPixelColor(i);
+    uint32_t c = strip.getLivePixelColor(i);
     uint8_t r = qadd8(W(c), R(c)); //add white channel to RGB channels as a simple RGBW -> RGB map
     uint8_t g = qadd8(W(c), G(c));
     uint8_t b = qadd8(W(c), B(c));
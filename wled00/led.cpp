@@ -55,7 +55,7 @@ void applyValuesToSelectedSegs()
 
 void resetTimebase()
 {
-  strip.timebase = 0 - millis();
+  strip.timebase = 0 - syncedMillis();
 }
 
 
@@ -4,6 +4,470 @@
  * Methods to handle saving and loading presets to/from the filesystem
  */
 
+#if WLED_PRESET_SNAPSHOTS
+/*
+ * Binary preset snapshots: presets that only set state (no API calls, playlists, nested presets or usermod keys)
+ * and describe complete segments are compiled into a flat image when saved or first applied.
+ * Applying one assigns the stored values in the same order deserializeState() would, without reading or parsing JSON.
+ * Snapshots are only created, applied and dropped with the JSON buffer lock held, like presets applied from JSON.
+ */
+#define SNAP_VERSION 1
+
+// snapshot flags
+#define SNAP_HAS_BRI     0x01
+#define SNAP_HAS_ON      0x02
+#define SNAP_ON          0x04
+#define SNAP_HAS_LEVEL   0x08
+#define SNAP_HAS_TR      0x10
+#define SNAP_HAS_MAINSEG 0x20
+#define SNAP_HAS_LEDMAP  0x40
+
+// segment flags
+#define SNAP_SEG_OFF     0x01 // {"stop":0}, segment not part of the preset
+#define SNAP_SEG_ON      0x02
+#define SNAP_SEG_FRZ     0x04
+#define SNAP_SEG_SEL     0x08
+#define SNAP_SEG_REV     0x10
+#define SNAP_SEG_REV2D   0x20
+#define SNAP_SEG_MI      0x40
+#define SNAP_SEG_ROT2D   0x80
+
+struct PresetSnapshotSegment {
+  uint32_t colors[NUM_COLORS];
+  uint16_t start, stop, offset;
+  uint8_t id, flags;
+  uint8_t colSet;  // bit per color slot present in the preset
+  uint8_t grouping, spacing, opacity, cct;
+  uint8_t mode, speed, intensity, custom1, custom2, custom3, palette;
+  uint8_t nameLen; // name follows the segment, padded to 4 bytes
+};
+
+struct PresetSnapshot {
+  uint16_t size;   // including segments and names
+  uint16_t check;  // Fletcher-16 of everything after this field
+  uint8_t version, flags;
+  uint8_t bri, inputLevel, mainseg;
+  int8_t ledmap;
+  uint16_t transition; // in 100ms
+  uint8_t segCount;
+};
+#define SNAP_SEG_OFFSET ((sizeof(PresetSnapshot) + 3) & ~3)
+#define SNAP_SEG_STRIDE(s) (sizeof(PresetSnapshotSegment) + (((s)->nameLen + 3) & ~3))
+
+static PresetSnapshot* presetSnapshots[251] = {nullptr}; // ids 0-250
+static uint32_t presetUsesJson[8] = {0};                  // bit per id, preset can not be compiled
+static uint32_t presetSnapshotRam = 0;
+
+static inline bool presetNeedsJson(uint8_t id)
+{
+  return presetUsesJson[id >> 5] & (1UL << (id & 31));
+}
+
+static void dropPresetSnapshot(uint8_t id)
+{
+  if (id > 250) return;
+  if (presetSnapshots[id]) {
+    presetSnapshotRam -= presetSnapshots[id]->size;
+    free(presetSnapshots[id]);
+    presetSnapshots[id] = nullptr;
+  }
+  presetUsesJson[id >> 5] &= ~(1UL << (id & 31));
+}
+
+// set when presets.json was replaced behind our back (/edit, uploads), from any task without the JSON buffer lock
+static volatile bool presetSnapshotsStale = false;
+
+void invalidatePresetSnapshots()
+{
+  presetSnapshotsStale = true;
+}
+
+// before using snapshots, with the JSON buffer lock held
+static void dropStaleSnapshots()
+{
+  if (!presetSnapshotsStale) return;
+  presetSnapshotsStale = false;
+  DEBUGFS_PRINTLN(F("presets.json replaced, dropping snapshots"));
+  for (uint8_t i = 0; i <= 250; i++) dropPresetSnapshot(i);
+}
+
+static uint16_t snapshotChecksum(const PresetSnapshot* s)
+{
+  const uint8_t* p = (const uint8_t*)s;
+  uint16_t a = 0, b = 0;
+  for (uint16_t i = offsetof(PresetSnapshot, version); i < s->size; i++) {
+    a = (a + p[i]) % 255;
+    b = (b + a) % 255;
+  }
+  return (b << 8) | a;
+}
+
+// true if v holds an integer in [vmin, vmax], strings ('r' random, '~' inc/dec) are not
+static bool snapInt(JsonVariant v, int32_t vmin, int32_t vmax, int32_t &out)
+{
+  if (!v.is<int>()) return false;
+  out = v.as<int>();
+  return out >= vmin && out <= vmax;
+}
+
+static bool snapByte(JsonVariant v, uint8_t &out)
+{
+  int32_t val;
+  if (!snapInt(v, 0, 255, val)) return false;
+  out = val;
+  return true;
+}
+
+// true if v holds a bool, "t" toggles and depends on the current state
+static bool snapFlag(JsonVariant v, uint8_t flag, uint8_t &flags)
+{
+  if (!v.is<bool>()) return false;
+  if (v.as<bool>()) flags |= flag;
+  return true;
+}
+
+// only segments with every key serializeSegment() writes for a preset, so the result does not depend on the current state
+static bool compileSnapshotSegment(JsonObject elem, PresetSnapshotSegment &ss, const char* &name)
+{
+  int32_t v, start, stop;
+  size_t keys = elem.containsKey("id");
+  memset(&ss, 0, sizeof(ss));
+  name = nullptr;
+
+  if (elem.size() == keys + 1 && snapInt(elem["stop"], 0, 0, v)) {
+    ss.flags = SNAP_SEG_OFF;
+    return true;
+  }
+
+  if (!elem["n"].isNull()) {
+    name = elem["n"];
+    size_t len = name ? strlen(name) : 0;
+    if (len == 0 || len > 32) return false; // invalid names are dropped by deserializeSegment()
+    ss.nameLen = len;
+    keys++;
+  }
+  if (elem.size() != keys + 22) return false; // missing or unknown keys (len, rpt, i, reset, lx, ...)
+
+  if (!snapInt(elem["start"], 0, UINT16_MAX, start)) return false;
+  if (!snapInt(elem["stop"],  0, UINT16_MAX, stop))  return false;
+  ss.start = start;
+  ss.stop  = stop;
+  if (!snapByte(elem["grp"], ss.grouping)) return false;
+  if (!snapByte(elem["spc"], ss.spacing)) return false;
+
+  if (!snapInt(elem["of"], -UINT16_MAX, UINT16_MAX, v)) return false;
+  int offset = v; // normalized like deserializeSegment() does
+  uint16_t len = 1;
+  if (stop > start) len = stop - start;
+  int offsetAbs = abs(offset);
+  if (offsetAbs > len - 1) offsetAbs %= len;
+  if (offset < 0) offsetAbs = len - offsetAbs;
+  uint16_t of = offsetAbs;
+  if (stop > start && of > len -1) of = len -1;
+  ss.offset = of;
+
+  if (!snapByte(elem["bri"], ss.opacity)) return false;
+  if (!snapByte(elem["cct"], ss.cct)) return false;
+  if (!snapFlag(elem["on"],    SNAP_SEG_ON,    ss.flags)) return false;
+  if (!snapFlag(elem["frz"],   SNAP_SEG_FRZ,   ss.flags)) return false;
+  if (!snapFlag(elem["sel"],   SNAP_SEG_SEL,   ss.flags)) return false;
+  if (!snapFlag(elem["rev"],   SNAP_SEG_REV,   ss.flags)) return false;
+  if (!snapFlag(elem["rev2D"], SNAP_SEG_REV2D, ss.flags)) return false;
+  if (!snapFlag(elem["mi"],    SNAP_SEG_MI,    ss.flags)) return false;
+  if (!snapFlag(elem["rot2D"], SNAP_SEG_ROT2D, ss.flags)) return false;
+
+  if (!snapByte(elem["fx"], ss.mode)) return false;
+  if (!snapByte(elem["sx"], ss.speed)) return false;
+  if (!snapByte(elem["ix"], ss.intensity)) return false;
+  if (!snapByte(elem["c1x"], ss.custom1)) return false;
+  if (!snapByte(elem["c2x"], ss.custom2)) return false;
+  if (!snapByte(elem["c3x"], ss.custom3)) return false;
+  if (!snapByte(elem["pal"], ss.palette)) return false;
+
+  JsonArray colarr = elem["col"];
+  if (colarr.isNull()) return false;
+  for (uint8_t i = 0; i < NUM_COLORS && i < colarr.size(); i++) {
+    JsonArray colX = colarr[i];
+    if (colX.isNull()) return false; // HEX strings and Kelvin values are left to the JSON path
+    if (colX.size() == 0) continue;
+    int rgbw[] = {0,0,0,0};
+    copyArray(colX, rgbw, 4);
+    ss.colors[i] = RGBW32(rgbw[0],rgbw[1],rgbw[2],rgbw[3]);
+    ss.colSet |= 1 << i;
+  }
+  return true;
+}
+
+// compiles root into s (only measures if s is nullptr), returns the snapshot size or 0 if root must be applied as JSON
+static uint16_t buildPresetSnapshot(JsonObject root, PresetSnapshot* s)
+{
+  PresetSnapshot head;
+  memset(&head, 0, sizeof(head));
+  head.version = SNAP_VERSION;
+  int32_t v;
+  size_t keys = 0;
+
+  if (!root["n"].isNull())  keys++; // preset name and quick load label are not state
+  if (!root["ql"].isNull()) keys++;
+  if (!root["bri"].isNull()) {
+    if (!snapByte(root["bri"], head.bri)) return 0;
+    head.flags |= SNAP_HAS_BRI;
+    keys++;
+  }
+  if (!root["on"].isNull()) {
+    if (!snapFlag(root["on"], SNAP_ON, head.flags)) return 0;
+    head.flags |= SNAP_HAS_ON;
+    keys++;
+  }
+  if (!root["inputLevel"].isNull()) {
+    if (!snapByte(root["inputLevel"], head.inputLevel)) return 0;
+    head.flags |= SNAP_HAS_LEVEL;
+    keys++;
+  }
+  if (!root[F("transition")].isNull()) {
+    if (!snapInt(root[F("transition")], 0, UINT16_MAX, v)) return 0;
+    head.transition = v;
+    head.flags |= SNAP_HAS_TR;
+    keys++;
+  }
+  if (!root[F("mainseg")].isNull()) {
+    if (!snapByte(root[F("mainseg")], head.mainseg)) return 0;
+    head.flags |= SNAP_HAS_MAINSEG;
+    keys++;
+  }
+  if (!root[F("ledmap")].isNull()) {
+    if (!snapInt(root[F("ledmap")], INT8_MIN, INT8_MAX, v)) return 0;
+    head.ledmap = v;
+    head.flags |= SNAP_HAS_LEDMAP;
+    keys++;
+  }
+  JsonArray segs = root["seg"];
+  if (!root["seg"].isNull()) {
+    if (segs.isNull()) return 0; // a single segment object applies to the selected segments
+    keys++;
+  }
+  if (root.size() != keys) return 0; // win, playlist, ps, psave, nl, udpn, tt, live, usermods, ...
+
+  uint32_t size = SNAP_SEG_OFFSET;
+  uint8_t it = 0;
+  for (JsonObject elem : segs) {
+    uint8_t id = it++;
+    if (!elem["id"].isNull()) {
+      if (!snapInt(elem["id"], 0, 255, v)) return 0;
+      id = v;
+    }
+    if (id >= strip.getMaxSegments()) continue; // ignored by deserializeSegment() as well
+
+    PresetSnapshotSegment ss;
+    const char* name;
+    if (!compileSnapshotSegment(elem, ss, name)) return 0;
+    ss.id = id;
+    if (head.segCount == UINT8_MAX || size + SNAP_SEG_STRIDE(&ss) > UINT16_MAX) return 0;
+    if (s) {
+      uint8_t* p = (uint8_t*)s + size;
+      memcpy(p, &ss, sizeof(ss));
+      if (ss.nameLen) memcpy(p + sizeof(ss), name, ss.nameLen);
+    }
+    size += SNAP_SEG_STRIDE(&ss);
+    head.segCount++;
+  }
+
+  head.size = size;
+  if (s) {
+    memcpy(s, &head, sizeof(head));
+    s->check = snapshotChecksum(s);
+  }
+  return size;
+}
+
+// called with the preset read for applying, before deserializeState() may modify it
+static void compilePresetSnapshot(uint8_t index, JsonObject root)
+{
+  if (index == 0 || index > 250 || presetSnapshots[index] || presetNeedsJson(index)) return;
+
+  uint16_t size = buildPresetSnapshot(root, nullptr);
+  if (!size) {
+    presetUsesJson[index >> 5] |= 1UL << (index & 31);
+    return;
+  }
+  if (presetSnapshotRam + size > PRESET_SNAPSHOT_RAM) return; // retried when applied next time
+
+  #if defined(ARDUINO_ARCH_ESP32) && defined(WLED_USE_PSRAM)
+  PresetSnapshot* s = (PresetSnapshot*)(psramFound() ? ps_malloc(size) : malloc(size));
+  #else
+  PresetSnapshot* s = (PresetSnapshot*)malloc(size);
+  #endif
+  if (!s) return;
+  memset(s, 0, size);
+  buildPresetSnapshot(root, s);
+  presetSnapshots[index] = s;
+  presetSnapshotRam += size;
+  DEBUGFS_PRINTF("Preset %d compiled to %d bytes\n", index, size);
+}
+
+// queued by savePreset(), compiles from the file once the JSON buffer is free
+static void compileDeferredPreset(uint32_t index)
+{
+  if (presetSnapshots[index] || presetNeedsJson(index)) return;
+  #ifdef WLED_USE_DYNAMIC_JSON
+  DynamicJsonDocument doc(JSON_BUFFER_SIZE);
+  #else
+  if (!tryJSONBufferLock(10)) {
+    deferJSONWork(compileDeferredPreset, index);
+    return;
+  }
+  #endif
+  dropStaleSnapshots();
+  if (readObjectFromFileUsingId("/presets.json", index, &doc)) compilePresetSnapshot(index, doc.as<JsonObject>());
+  releaseJSONBufferLock();
+}
+
+static bool snapshotValid(const PresetSnapshot* s)
+{
+  if (s->version != SNAP_VERSION || s->size < SNAP_SEG_OFFSET || s->check != snapshotChecksum(s)) return false;
+  uint32_t pos = SNAP_SEG_OFFSET;
+  for (uint8_t i = 0; i < s->segCount; i++) {
+    if (pos + sizeof(PresetSnapshotSegment) > s->size) return false;
+    const PresetSnapshotSegment* ss = (const PresetSnapshotSegment*)((const uint8_t*)s + pos);
+    if (ss->id >= strip.getMaxSegments() || ss->nameLen > 32) return false;
+    pos += SNAP_SEG_STRIDE(ss);
+  }
+  return pos == s->size;
+}
+
+// same order as deserializeSegment()
+static void applySnapshotSegment(const PresetSnapshotSegment &ss, const char* name)
+{
+  uint8_t id = ss.id;
+  WS2812FX::Segment& seg = strip.getSegment(id);
+  WS2812FX::Segment prev = seg; //make a backup so we can tell if something changed
+
+  if (ss.flags & SNAP_SEG_OFF) {
+    strip.setSegment(id, seg.start, 0, seg.grouping, seg.spacing, seg.offset); // also clears the name
+    if (seg.differs(prev) & 0x7F) stateChanged = true;
+    return;
+  }
+
+  if (ss.nameLen) {
+    if (!seg.name || strncmp(seg.name, name, ss.nameLen) || seg.name[ss.nameLen]) {
+      delete[] seg.name;
+      seg.name = new char[ss.nameLen+1];
+      if (seg.name) {
+        memcpy(seg.name, name, ss.nameLen);
+        seg.name[ss.nameLen] = '\0';
+      }
+    }
+  } else if (ss.start != seg.start || ss.stop != seg.stop) {
+    delete[] seg.name;
+    seg.name = nullptr;
+  }
+
+  strip.setSegment(id, ss.start, ss.stop, ss.grouping, ss.spacing, ss.offset);
+
+  if (ss.opacity > 0) seg.setOpacity(ss.opacity, id);
+  seg.setOption(SEG_OPTION_ON, ss.opacity, id);
+  seg.setOption(SEG_OPTION_ON, ss.flags & SNAP_SEG_ON, id);
+  seg.setOption(SEG_OPTION_FREEZE, ss.flags & SNAP_SEG_FRZ, id);
+  seg.setCCT(ss.cct, id);
+
+  for (uint8_t i = 0; i < NUM_COLORS; i++) {
+    if (!(ss.colSet & (1 << i))) continue;
+    seg.setColor(i, ss.colors[i], id);
+    if (seg.mode == FX_MODE_STATIC) strip.trigger(); //instant refresh
+  }
+
+  seg.setOption(SEG_OPTION_SELECTED  , ss.flags & SNAP_SEG_SEL);
+  seg.setOption(SEG_OPTION_REVERSED  , ss.flags & SNAP_SEG_REV);
+  seg.setOption(SEG_OPTION_REVERSED2D, ss.flags & SNAP_SEG_REV2D);
+  seg.setOption(SEG_OPTION_MIRROR    , ss.flags & SNAP_SEG_MI);
+  seg.setOption(SEG_OPTION_ROTATED2D , ss.flags & SNAP_SEG_ROT2D);
+
+  strip.setMode(id, ss.mode);
+  seg.speed     = ss.speed;
+  seg.intensity = ss.intensity;
+  seg.custom1   = ss.custom1;
+  seg.custom2   = ss.custom2;
+  seg.custom3   = ss.custom3;
+  seg.palette   = ss.palette;
+
+  if (seg.differs(prev) & 0x7F) stateChanged = true;
+}
+
+// same order as deserializeState() for a preset (presetId != 0), returns false if the preset has to be read from the file
+static bool applyPresetSnapshot(uint8_t index, byte callMode)
+{
+  if (index > 250) return false;
+  dropStaleSnapshots();
+  if (!presetSnapshots[index]) return false;
+  const PresetSnapshot* s = presetSnapshots[index];
+  if (!snapshotValid(s)) {
+    DEBUGFS_PRINTF("Preset %d snapshot invalid\n", index);
+    dropPresetSnapshot(index); // recompiled from the file
+    return false;
+  }
+
+  bool onBefore = bri;
+  if (s->flags & SNAP_HAS_BRI)   bri = s->bri;
+  if (s->flags & SNAP_HAS_LEVEL) inputLevel = s->inputLevel;
+
+  bool on = (s->flags & SNAP_HAS_ON) ? (s->flags & SNAP_ON) : (bri > 0);
+  if (!on != !bri) toggleOnOff();
+
+  if (bri && !onBefore) { // unfreeze all segments when turning on
+    for (uint8_t i=0; i < strip.getMaxSegments(); i++) {
+      strip.getSegment(i).setOption(SEG_OPTION_FREEZE, false, i);
+    }
+    if (realtimeMode && !realtimeOverride && useMainSegmentOnly) { // keep live segment frozen if live
+      strip.getMainSegment().setOption(SEG_OPTION_FREEZE, true, strip.getMainSegmentId());
+    }
+  }
+
+  if ((s->flags & SNAP_HAS_TR) && currentPlaylist < 0) { //playlist transition times take precedence
+    transitionDelay = s->transition;
+    transitionDelay *= 100;
+    transitionDelayTemp = transitionDelay;
+  }
+  strip.setTransition(transitionDelayTemp); // required here for color transitions to have correct duration
+
+  if (s->flags & SNAP_HAS_MAINSEG) strip.setMainSegmentId(s->mainseg);
+  if (realtimeMode && useMainSegmentOnly) {
+    strip.getMainSegment().setOption(SEG_OPTION_FREEZE, !realtimeOverride, strip.getMainSegmentId());
+  }
+
+  const uint8_t* p = (const uint8_t*)s + SNAP_SEG_OFFSET;
+  for (uint8_t i = 0; i < s->segCount; i++) {
+    const PresetSnapshotSegment* ss = (const PresetSnapshotSegment*)p;
+    applySnapshotSegment(*ss, (const char*)(p + sizeof(PresetSnapshotSegment)));
+    p += SNAP_SEG_STRIDE(ss);
+  }
+
+  if (s->flags & SNAP_HAS_LEDMAP) loadLedmap = s->ledmap;
+
+  interfaceUpdateCallMode = CALL_MODE_WS_SEND;
+  stateUpdated(callMode);
+  errorFlag = ERR_NONE;
+  return true;
+}
+
+// compiles a saved preset once the JSON buffer is free
+static void queuePresetSnapshot(uint8_t index)
+{
+  if (index <= 250) deferJSONWork(compileDeferredPreset, index);
+}
+#else
+void invalidatePresetSnapshots() {}
+static void dropPresetSnapshot(uint8_t id) {}
+static void compilePresetSnapshot(uint8_t index, JsonObject root) {}
+static bool applyPresetSnapshot(uint8_t index, byte callMode) { return false; }
+static void queuePresetSnapshot(uint8_t index) {}
+#endif
+
+// retried by handleJSONDeferred() when the JSON buffer was busy
+static void applyDeferredPreset(uint32_t arg)
+{
+  applyPreset(arg & 0xFF, arg >> 8);
+}
+
 bool applyPreset(byte index, byte callMode)
 {
   if (index == 0) return false;
@@ -32,27 +496,34 @@ bool applyPreset(byte index, byte callMode)
 	//only allow use of fileDoc from the core responsible for network requests
 	//do not use active network request doc from preset called by main loop (playlist, schedule, ...)
   if (fileDoc && core) {
-    errorFlag = readObjectFromFileUsingId(filename, index, fileDoc) ? ERR_NONE : ERR_FS_PLOAD;
-    JsonObject fdo = fileDoc->as<JsonObject>();
-    if (fdo["ps"] == index) fdo.remove("ps"); //remove load request for same presets to prevent recursive crash
-    #ifdef WLED_DEBUG_FS
-      serializeJson(*fileDoc, Serial);
-    #endif
-    deserializeState(fdo, callMode, index);
+    if (!applyPresetSnapshot(index, callMode)) {
+      errorFlag = readObjectFromFileUsingId(filename, index, fileDoc) ? ERR_NONE : ERR_FS_PLOAD;
+      JsonObject fdo = fileDoc->as<JsonObject>();
+      if (fdo["ps"] == index) fdo.remove("ps"); //remove load request for same presets to prevent recursive crash
+      if (!errorFlag) compilePresetSnapshot(index, fdo); //applied without JSON next time
+      #ifdef WLED_DEBUG_FS
+        serializeJson(*fileDoc, Serial);
+      #endif
+      deserializeState(fdo, callMode, index);
+    }
   } else {
     DEBUGFS_PRINTLN(F("Make read buf"));
     #ifdef WLED_USE_DYNAMIC_JSON
     DynamicJsonDocument doc(JSON_BUFFER_SIZE);
     #else
-    if (!requestJSONBufferLock(9)) return false;
+    // do not stall the main loop (playlist, schedule, ...) or network task on a busy buffer, apply once it is free
+    if (!tryJSONBufferLock(9)) return deferJSONWork(applyDeferredPreset, index | (callMode << 8));
     #endif
-    errorFlag = readObjectFromFileUsingId(filename, index, &doc) ? ERR_NONE : ERR_FS_PLOAD;
-    JsonObject fdo = doc.as<JsonObject>();
-    if (fdo["ps"] == index) fdo.remove("ps");
-    #ifdef WLED_DEBUG_FS
-      serializeJson(doc, Serial);
-    #endif
-    deserializeState(fdo, callMode, index);
+    if (!applyPresetSnapshot(index, callMode)) {
+      errorFlag = readObjectFromFileUsingId(filename, index, &doc) ? ERR_NONE : ERR_FS_PLOAD;
+      JsonObject fdo = doc.as<JsonObject>();
+      if (fdo["ps"] == index) fdo.remove("ps");
+      if (!errorFlag) compilePresetSnapshot(index, fdo);
+      #ifdef WLED_DEBUG_FS
+        serializeJson(doc, Serial);
+      #endif
+      deserializeState(fdo, callMode, index);
+    }
     releaseJSONBufferLock();
   }
 
@@ -91,6 +562,7 @@ void savePreset(byte index, const char* pname, JsonObject saveobj)
     if (persist) currentPreset = index;
 
     writeObjectToFileUsingId(filename, index, &doc);
+    if (persist) dropPresetSnapshot(index);
 
     releaseJSONBufferLock();
   } else { //from JSON API (fileDoc != nullptr)
@@ -110,14 +582,20 @@ void savePreset(byte index, const char* pname, JsonObject saveobj)
     sObj.remove(F("time"));
 
     writeObjectToFileUsingId(filename, index, fileDoc);
+    if (persist) dropPresetSnapshot(index);
+  }
+  if (persist) {
+    presetsModifiedTime = toki.second(); //unix time
+    queuePresetSnapshot(index);
   }
-  if (persist) presetsModifiedTime = toki.second(); //unix time
   updateFSInfo();
 }
 
+// called with the JSON buffer lock held (from deserializeState())
 void deletePreset(byte index) {
   StaticJsonDocument<24> empty;
   writeObjectToFileUsingId("/presets.json", index, &empty);
+  dropPresetSnapshot(index);
   presetsModifiedTime = toki.second(); //unix time
   updateFSInfo();
 }
@@ -89,6 +89,7 @@ void handleSettingsSet(AsyncWebServerRequest *request, byte subPage)
     strip.autoWhiteMode = (request->arg(F("AW")).toInt());
     Bus::setAutoWhiteMode(strip.autoWhiteMode);
     strip.setTargetFps(request->arg(F("FR")).toInt());
+    networkOutputSync = request->hasArg(F("NS"));
 
     bool busesChanged = false;
     for (uint8_t s = 0; s < WLED_MAX_BUSSES; s++) {
@@ -250,6 +251,9 @@ void handleSettingsSet(AsyncWebServerRequest *request, byte subPage)
     notifyHue = request->hasArg(F("SH"));
     notifyMacro = request->hasArg(F("SM"));
     notifyTwice = request->hasArg(F("S2"));
+    clockSyncEnabled = request->hasArg(F("CS"));
+    t = request->arg(F("CP")).toInt();
+    if (t >= 0 && t <= 255) clockSyncPriority = t;
 
     nodeListEnabled = request->hasArg(F("NL"));
     if (!nodeListEnabled) Nodes.clear();
@@ -269,6 +273,11 @@ void handleSettingsSet(AsyncWebServerRequest *request, byte subPage)
     if (t >= DMX_MODE_DISABLED && t <= DMX_MODE_MULTIPLE_RGBW) DMXMode = t;
     t = request->arg(F("ET")).toInt();
     if (t > 99  && t <= 65000) realtimeTimeoutMs = t;
+    t = request->arg(F("FT")).toInt();
+    if (t > 0  && t <= 1000) e131FrameTimeout = t;
+    t = request->arg(F("JB")).toInt();
+    if (t == 0 || (t >= 2 && t <= 4)) realtimeJitterFrames = t;
+    realtimeInterpolate = request->hasArg(F("JI"));
     arlsForceMaxBri = request->hasArg(F("FB"));
     arlsDisableGammaCorrection = request->hasArg(F("RG"));
     t = request->arg(F("WO")).toInt();
@@ -28,6 +28,7 @@
           - move code from interpreter to analyzer to speed up interpreting
    @done?
    @done
+          - compile the parseTree to bytecode and run it in a vm instead of interpreting the parseTree
           - save log after first run of loop to get runtime errors included (or 30 iterations to also capture any stack overflows)
    @todo
           - check why statement is not 'shrinked'
@@ -45,8 +46,6 @@
   #include "../../../wled.h"  
   #include "../json/ArduinoJson-v6.h"
 
-  File logFile;
-
   #define ARTI_ERRORWARNING 1 //shows lexer, parser, analyzer and interpreter errors
   // #define ARTI_DEBUG 1
   // #define ARTI_ANDBG 1
@@ -60,12 +59,12 @@
 #else //embedded
   #include "dependencies/ArduinoJson-recent.h"
 
-  FILE * logFile; // FILE needed to use in fprintf (std stream does not work)
-
   #define ARTI_ERRORWARNING 1
-  #define ARTI_DEBUG 1
-  #define ARTI_ANDBG 1
-  #define ARTI_RUNLOG 1
+  #ifndef ARTI_NO_TRACE //e.g. for benchmarks: no parse, analyze and run traces in the log
+    #define ARTI_DEBUG 1
+    #define ARTI_ANDBG 1
+    #define ARTI_RUNLOG 1
+  #endif
   #define ARTI_MEMORY 1
   #define ARTI_PRINT 1
 
@@ -75,12 +74,26 @@
   #include <sstream>
 
   const char spaces[51]         = "                                                  ";
-  #define FREE_SIZE (unsigned int)0
+  #ifndef FREE_SIZE //can be set by the test program to measure heap use
+    #define FREE_SIZE (unsigned int)0
+  #endif
   // #define OPTIMIZED_TREE 1
 #endif
 
-bool logToFile = true; //print output to file (e.g. default.wled.log)
-uint32_t frameCounter = 0; //tbd move to class if more instances run 
+// Log and error state of an ARTI instance. Each instance has its own, so programs running side by side
+// (e.g. custom effects on several segments) do not close each other's log or clear each other's errors.
+struct ArtiContext {
+  bool logToFile = false; //print output to file (e.g. default.wled.log)
+  #if ARTI_PLATFORM == ARTI_ARDUINO
+    File logFile;
+  #else
+    FILE * logFile = nullptr; // FILE needed to use in fprintf (std stream does not work)
+  #endif
+  bool errorOccurred = false;
+};
+
+ArtiContext artiConsole; //output outside of an instance goes to the console
+ArtiContext *artiContext = &artiConsole; //instance which runs now, set by each entry point of ARTI. Used by the lexer and the externals
 
 void artiPrintf(char const * format, ...)
 {
@@ -88,6 +101,13 @@ void artiPrintf(char const * format, ...)
 
   va_start(argp, format);
 
+  bool logToFile = artiContext->logToFile;
+  #if ARTI_PLATFORM == ARTI_ARDUINO
+    File &logFile = artiContext->logFile;
+  #else
+    FILE * logFile = artiContext->logFile;
+  #endif
+
   if (!logToFile)
   {
     vprintf(format, argp);
@@ -142,7 +162,12 @@ void artiPrintf(char const * format, ...)
 #if ARTI_PLATFORM != ARTI_ARDUINO
   uint32_t millis()
   {
-    return std::chrono::system_clock::now().time_since_epoch().count();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  uint32_t micros()
+  {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
   }
 #endif
 
@@ -487,8 +512,6 @@ uint8_t stringToNode(const char * node)
   return F_NoNode;
 }
 
-bool errorOccurred = false;
-
 struct Token {
     uint16_t lineno;
     uint16_t column;
@@ -639,9 +662,9 @@ class Lexer {
     strcpy(current_token.type, "");
     strcpy(current_token.value, "");
 
-    if (errorOccurred) return;
+    if (artiContext->errorOccurred) return;
 
-    while (this->current_char != -1 && this->pos <= strlen(this->text) - 1 && !errorOccurred) 
+    while (this->current_char != -1 && this->pos <= strlen(this->text) - 1 && !artiContext->errorOccurred) 
     {
       if (isspace(this->current_char)) {
         this->skip_whitespace();
@@ -702,7 +725,7 @@ class Lexer {
       }
       else {
         ERROR_ARTI("Lexer error on %c line %u col %u\n", this->current_char, this->lineno, this->column);
-        errorOccurred = true;
+        artiContext->errorOccurred = true;
       }
     }
   } //get_next_token
@@ -715,7 +738,7 @@ class Lexer {
     }
     else {
       ERROR_ARTI("Lexer Error: Unexpected token %s %s\n", current_token.type, current_token.value);
-      errorOccurred = true;
+      artiContext->errorOccurred = true;
     }
   }
 
@@ -851,194 +874,170 @@ class ScopedSymbolTable {
 
 }; //ScopedSymbolTable
 
-#define nrOfVariables 20
-
-class ActivationRecord 
+// Bytecode: the analyzed parseTree is compiled into a flat array of opcodes followed by their operands (bytes, addresses are 2 bytes little endian).
+// Variables are resolved to a slot in a frame, constants are decoded once into a constant table and externals are referenced by their index.
+enum Opcodes
 {
-  private:
-  public:
-    char name[charLength];
-    char type[charLength];
-    int nesting_level;
-    // char charMembers[charLength][nrOfVariables];
-    float floatMembers[nrOfVariables];
-    char lastSet[charLength];
-    uint8_t lastSetIndex;
-
-    ActivationRecord(const char * name, const char * type, int nesting_level) 
-    {
-        strcpy(this->name, name);
-        strcpy(this->type, type);
-        this->nesting_level = nesting_level;
-    }
-
-    ~ActivationRecord() 
-    {
-      RUNLOG_ARTI("Destruct activation record %s\n", name);
-    }
-
-    // void set(uint8_t index,  const char * value) 
-    // {
-    //   lastSetIndex = index;
-    //   strcpy(charMembers[index], value);
-    // }
+  OP_Halt,
+  OP_Const,             // constant index
+  OP_LoadGlobal,        // index
+  OP_StoreGlobal,       // index
+  OP_LoadLocal,         // index (current frame)
+  OP_StoreLocal,        // index (current frame)
+  OP_Load,              // level, index
+  OP_Store,             // level, index
+  OP_GetExternal,       // external, nr of indices
+  OP_SetExternal,       // external, nr of indices (value below the indices)
+  OP_CallExternal,      // external, nr of actuals (result pushed)
+  OP_CallExternalVoid,  // external, nr of actuals (result ignored)
+  OP_Call,              // function, nr of actuals
+  OP_Return,
+  OP_Add,               // OP_Add..OP_Or in the same order as F_plus..F_or
+  OP_Subtract,
+  OP_Multiply,
+  OP_Divide,
+  OP_Modulo,
+  OP_BitShiftLeft,
+  OP_BitShiftRight,
+  OP_Equal,
+  OP_NotEqual,
+  OP_LessThen,
+  OP_LessThenOrEqual,
+  OP_GreaterThen,
+  OP_GreaterThenOrEqual,
+  OP_And,
+  OP_Or,
+  OP_Negate,
+  OP_Jump,              // address
+  OP_JumpIfNotTrue,     // address (pops condition, jumps if condition != 1)
+  OP_ForInit,           // pushes iteration counter and mode
+  OP_ForTest,           // level, index of loop variable, exit address (pops condition)
+  OP_ForNext,           // level, index of loop variable, address after increment
+  OP_ForLoop,           // condition address
+  OP_ForEnd             // pops iteration counter and mode
+};
 
-    void set(uint8_t index, float value) 
-    {
-      lastSetIndex = index;
-      floatMembers[index] = value;
-    }
+#define nrOfRecords 20
+#define nrOfStateVariables 100 //globals and locals of all active function calls
+#define nrOfConstants 128
+#define nrOfFunctions nrOfChildScope
+#define nrOfIterations 2000 //to avoid endless loops
+#define functionNone 255
+#define variableNone 255
+#define codeNone 0xFFFF
+#define nrOfHoisted 16 //per frame expressions of renderLed evaluated before the pixel loop
+
+// Expressions in renderLed are classified while compiling: constants are folded, per frame expressions
+// are evaluated once per frame into hidden globals (framePrologue) and only per pixel expressions run for every led.
+enum ExpressionClasses
+{
+  C_Constant, // constants and operators on constants
+  C_Frame,    // constants, globals not assigned while rendering leds and externals without side effects
+  C_Pixel     // formals, locals, assigned globals, user functions and externals with side effects
+};
 
-    // const char * getChar(uint8_t index) 
-    // {
-    //   return charMembers[index];
-    // }
+struct ArtiFunction {
+  uint16_t address;
+  uint8_t nrOfFormals;
+  uint8_t nrOfLocals;
+  uint8_t nesting_level;
+};
 
-    float getFloat(uint8_t index) 
-    {
-      return floatMembers[index];
-    }
+class ArtiProgram {
+  public:
 
-}; //ActivationRecord
+  uint8_t *code = nullptr;
+  uint16_t codeSize = 0;
+  uint16_t codeCapacity = 0;
 
-#define nrOfRecords 20
+  float constants[nrOfConstants];
+  uint8_t constantsIndex = 0;
 
-class CallStack {
-public:
-  ActivationRecord* records[nrOfRecords];
-  uint8_t recordsCounter = 0;
+  ArtiFunction functions[nrOfFunctions];
+  uint8_t functionsIndex = 0;
 
-  CallStack() {
-  }
+  uint8_t renderFrame = functionNone;
+  uint8_t renderLed = functionNone;
+  uint8_t nrOfGlobals = 1;
+  uint8_t maxStack = 0; //deepest value stack use of one function body
+  uint16_t framePrologue = 0; //per frame expressions of renderLed, run before the pixel loop, 0 if none
 
-  ~CallStack() 
+  ~ArtiProgram()
   {
-    RUNLOG_ARTI("Destruct callstack\n");
+    free(code);
+    MEMORY_ARTI("Destruct ArtiProgram\n");
   }
 
-  void push(ActivationRecord* ar) 
-  {
-    if (recordsCounter < nrOfRecords) 
-    {
-      // RUNLOG_ARTI("%s\n", "Push ", ar->name);
-      this->records[recordsCounter++] = ar;
-    }
-    else 
-    {
-      errorOccurred = true;
-      ERROR_ARTI("no space left in callstack\n");
-    }
-  }
+}; //ArtiProgram
 
-  ActivationRecord* pop()
-  {
-    if (recordsCounter > 0)
-    {
-      // RUNLOG_ARTI("%s\n", "Pop ", this->peek()->name);
-      return this->records[recordsCounter--];
-    }
-    else 
-    {
-      ERROR_ARTI("no ar left on callstack\n");
-      return nullptr;
-    }
-  }
+struct ArtiFrame {
+  uint16_t returnAddress;
+  uint8_t base; //first variable of this frame in ArtiState::variables
+  uint8_t nesting_level;
+};
 
-  ActivationRecord* peek() 
-  {
-    return this->records[recordsCounter-1];
-  }
-}; //CallStack
+// Everything which changes while running a program: one per instance (e.g. per segment), the ArtiProgram is shared
+class ArtiState {
+  public:
 
-class ValueStack 
-{
-private:
-public:
-  // char charStack[arrayLength][charLength]; //currently only floatStack used.
-  float floatStack[arrayLength];
+  float stack[arrayLength];
   uint8_t stack_index = 0;
 
-  ValueStack() 
-  {
-  }
-
-  ~ValueStack() 
-  {
-    RUNLOG_ARTI("Destruct valueStack\n");
-  }
-
-  // void push(const char * value) {
-  //   if (stack_index >= arrayLength)
-  //     ERROR_ARTI("Push charStack full %u of %u\n", stack_index, arrayLength);
-  //   else if (value == nullptr) {
-  //     strcpy(charStack[stack_index++], "empty");
-  //     ERROR_ARTI("Push null pointer on float stack\n");
-  //   }
-  //   else
-  //     // RUNLOG_ARTI("calc push %s %s\n", key, value);
-  //     strcpy(charStack[stack_index++], value);
-  // }
-
-  void push(float value) 
-  {
-    if (stack_index >= arrayLength) 
-    {
-      ERROR_ARTI("Push floatStack full (check functions with result assigned) %u\n", arrayLength);
-      errorOccurred = true;
-    }
-    else if (value == floatNull)
-      ERROR_ARTI("Push null value on float stack\n");
-    else
-      // RUNLOG_ARTI("calc push %s %s\n", key, value);
-      floatStack[stack_index++] = value;
-  }
-
-  // const char * peekChar() {
-  //   // RUNLOG_ARTI("Calc Peek %s\n", charStack[stack_index-1]);
-  //   return charStack[stack_index-1];
-  // }
-
-  float peekFloat() 
-  {
-    // RUNLOG_ARTI("Calc Peek %s\n", floatStack[stack_index-1]);
-    return floatStack[stack_index-1];
-  }
+  float variables[nrOfStateVariables];
+  uint8_t variablesIndex = 0;
+
+  ArtiFrame frames[nrOfRecords];
+  uint8_t framesIndex = 0;
+
+  uint32_t frameCounter = 0;
+
+}; //ArtiState
+
+// Run statistics, written to the log when it is closed. Same numbers on Arduino and on the host build,
+// so changes to compiler or vm can be checked for speed and memory without flashing.
+struct ArtiStats {
+  uint32_t setupMicros = 0; //lexer, parse, optimize, analyze and compile or load of the compiled program
+  uint32_t parseMicros = 0; //lexer and parse
+  bool loaded = false; //compiled program loaded from .artic
+  uint32_t minFreeHeap = UINT32_MAX; //lowest free heap during setup (Arduino)
+  uint32_t parseTreeBytes = 0; //largest use of the parseTree document
+  uint32_t frames = 0;
+  uint32_t frameMicros = 0; //all frames
+  uint32_t maxFrameMicros = 0;
+  uint8_t maxFrames = 0; //deepest call stack
+  uint8_t maxVariables = 0; //most variables in use
+};
 
-  // const char * popChar() {
-  //   if (stack_index>0) {
-  //     stack_index--;
-  //     return charStack[stack_index];
-  //   }
-  //   else {
-  //     ERROR_ARTI("Pop value stack empty\n");
-        // errorOccurred = true;
-//   // RUNLOG_ARTI("Calc Pop %s\n", charStack[stack_index]);
-  //     return "novalue";
-  //   }
-  // }
-
-  float popFloat() 
-  {
-    if (stack_index>0) 
-    {
-      stack_index--;
-      return floatStack[stack_index];
-    }
-    else 
-    {
-      ERROR_ARTI("Pop floatStack empty\n");
-    // RUNLOG_ARTI("Calc Pop %s\n", floatStack[stack_index]);
-      errorOccurred = true;
-      return -1;
-    }
-  }
+// Compiled program file (.artic next to the .wled file): header, functions, constants and code.
+// Only valid on the device which wrote it, hash is over definition and program text.
+#define ARTI_CODE_VERSION 2
+
+struct ArtiCodeHeader {
+  char magic[4]; // "ARTI"
+  uint8_t version;
+  uint8_t constantsIndex;
+  uint8_t functionsIndex;
+  uint8_t renderFrame;
+  uint8_t renderLed;
+  uint8_t nrOfGlobals;
+  uint8_t maxStack;
+  uint8_t reserved;
+  uint32_t hash;
+  uint16_t codeSize;
+  uint16_t framePrologue;
+};
 
-}; //ValueStack
+struct ExpressionState {
+  uint8_t items; //operands compiled so far
+  uint8_t pendingOperator; //emitted after the next operand
+};
 
 #define programTextSize 5000
+#define compileHeapSize 45000 //definitionJson, parseTree, symbol tables and code while compiling
 
 class ARTI {
 private:
+  ArtiContext context; //log and errors of this instance, artiContext points here while it runs
   Lexer *lexer = nullptr;
 
   DynamicJsonDocument *definitionJsonDoc = nullptr;
@@ -1047,16 +1046,38 @@ private:
   JsonVariant parseTreeJson;
 
   ScopedSymbolTable *global_scope = nullptr;
-  CallStack *callStack = nullptr;
-  ValueStack *valueStack = nullptr;
-
-  uint8_t stages = 5; //for debugging: 0:parseFile, 1:Lexer, 2:parse, 3:optimize, 4:analyze, 5:interpret should be 5 if no debugging
+  ArtiProgram *program = nullptr;
+  ArtiState *state = nullptr; //state the program runs in, see newState and useState
+  ArtiState *ownState = nullptr; //created by setup, until the caller provides its own state
+
+  //compiler state
+  Symbol* functionSymbols[nrOfFunctions];
+  ExpressionState expressionStates[arrayLength];
+  uint8_t expressionIndex = 0;
+  uint8_t compileDepth = 0;
+  uint16_t lastOps[2] = {codeNone, codeNone}; //address of the last two instructions, for constant folding
+  uint16_t lastLabel = 0; //last jump target, no folding across it
+
+  //hoisting of per frame expressions out of renderLed
+  bool hoisting = false;
+  uint32_t assignedGlobals = 0; //globals assigned while rendering leds (first 32)
+  Symbol* scannedFunctions[nrOfFunctions];
+  uint8_t scannedIndex = 0;
+  JsonVariant hoistedTrees[nrOfHoisted]; //parent and key of the hoisted expressions
+  const char * hoistedKeys[nrOfHoisted];
+  uint8_t hoistedSlots[nrOfHoisted];
+  uint8_t hoistedIndex = 0;
+
+  uint8_t stages = 5; //for debugging: 0:parseFile, 1:Lexer, 2:parse, 3:optimize, 4:analyze, 5:compile and run should be 5 if no debugging
 
   char logFileName[fileNameLength];
 
   uint32_t startMillis;
 
 public:
+  bool notEnoughHeap = false; //setup failed because compiling needs more heap, try again later
+  ArtiStats stats;
+
   ARTI() 
   {
     // MEMORY_ARTI("new Arti < %u\n", FREE_SIZE); //logfile not open here
@@ -1071,6 +1092,7 @@ public:
   float arti_external_function(uint8_t function, float par1 = floatNull, float par2 = floatNull, float par3 = floatNull, float par4 = floatNull, float par5 = floatNull);
   float arti_get_external_variable(uint8_t variable, float par1 = floatNull, float par2 = floatNull, float par3 = floatNull);
   void arti_set_external_variable(float value, uint8_t variable, float par1 = floatNull, float par2 = floatNull, float par3 = floatNull);
+  bool arti_external_per_frame(uint8_t external); //same result for all leds of a frame, no side effects
   bool loop(); 
   
   uint8_t parse(JsonVariant parseTree, const char * node_name, char operatorx, JsonVariant expression, uint8_t depth = 0) 
@@ -1078,9 +1100,9 @@ public:
     if (depth > 50) 
     {
       ERROR_ARTI("Error: Parse recursion level too deep at %s (%u)\n", parseTree.as<std::string>().c_str(), depth);
-      errorOccurred = true;
+      context.errorOccurred = true;
     }
-    if (errorOccurred) return ResultFail;
+    if (context.errorOccurred) return ResultFail;
 
     uint8_t result = ResultContinue;
 
@@ -1331,9 +1353,9 @@ public:
     if (depth > 24) //otherwise stack canary errors on Arduino (value determined after testing, should be revisited)
     {
       ERROR_ARTI("Error: Analyze recursion level too deep at %s (%u)\n", parseTree.as<std::string>().c_str(), depth);
-      errorOccurred = true;
+      context.errorOccurred = true;
     }
-    if (errorOccurred) return false;
+    if (context.errorOccurred) return false;
 
     if (parseTree.is<JsonObject>()) 
     {
@@ -1408,11 +1430,11 @@ public:
 
                 if (value["ID"].isNull()) {
                   ERROR_ARTI("program name null\n");
-                  errorOccurred = true;
+                  context.errorOccurred = true;
                 }
                 if (value["block"].isNull()) {
                   ERROR_ARTI("%s Program %s: no block in parseTree\n", spaces+50-depth, program_name); 
-                  errorOccurred = true;
+                  context.errorOccurred = true;
                 }
                 else {
                   analyze(value["block"], nullptr, global_scope, depth + 1);
@@ -1562,7 +1584,7 @@ public:
                   else if (value["assignoperator"].as<uint8_t>() != F_plusplus && value["assignoperator"].as<uint8_t>() != F_minmin)
                   {
                     ERROR_ARTI("%s %s %s: Assign without expression\n", spaces+50-depth, key, variable_name); 
-                    errorOccurred = true;
+                    context.errorOccurred = true;
                   }
                 }
 
@@ -1625,7 +1647,7 @@ public:
       // ERROR_ARTI("%s Error: parseTree should be array or object %s (%u)\n", spaces+50-depth, parseTree.as<std::string>().c_str(), depth);
     }
 
-    return !errorOccurred;
+    return !context.errorOccurred;
   } //analyze
 
   //https://dev.to/lefebvre/compilers-106---optimizer--ig8
@@ -1833,32 +1855,417 @@ public:
 
     // DEBUG_ARTI("%s optimized %s (%u)\n", spaces+50-depth, parseTree.as<std::string>().c_str(), depth);
 
-    return !errorOccurred;
+    return !context.errorOccurred;
   } //optimize
 
   // bool visit_ID(JsonVariant parseTree, const char * treeElement = nullptr, ScopedSymbolTable* current_scope = nullptr, uint8_t depth = 0) 
 
-  bool interpret(JsonVariant parseTree, const char * treeElement = nullptr, ScopedSymbolTable* current_scope = nullptr, uint8_t depth = 0) 
+  void emit(uint8_t byte)
+  {
+    if (program->codeSize >= program->codeCapacity)
+    {
+      uint8_t *code = (uint8_t *)realloc(program->code, program->codeCapacity + 256);
+      if (code == nullptr)
+      {
+        ERROR_ARTI("Compile: no memory for code (%u bytes)\n", program->codeCapacity + 256);
+        context.errorOccurred = true;
+        return;
+      }
+      program->code = code;
+      program->codeCapacity += 256;
+    }
+    program->code[program->codeSize++] = byte;
+  }
+
+  void emitOp(uint8_t opcode)
+  {
+    lastOps[0] = lastOps[1];
+    lastOps[1] = program->codeSize;
+    emit(opcode);
+  }
+
+  uint16_t emitAddress(uint16_t address = 0)
+  {
+    uint16_t at = program->codeSize;
+    emit(address & 0xFF);
+    emit(address >> 8);
+    return at;
+  }
+
+  void patchAddress(uint16_t at, uint16_t address)
+  {
+    if (context.errorOccurred) return;
+    program->code[at] = address & 0xFF;
+    program->code[at + 1] = address >> 8;
+    if (address > lastLabel)
+      lastLabel = address;
+  }
+
+  void stackDelta(int8_t delta)
   {
-    // RUNLOG_ARTI("%s Interpret %s %s (%u)\n", spaces+50-depth, stringOrEmpty(treeElement), parseTree.as<std::string>().c_str(), depth);
+    compileDepth += delta;
+    if (compileDepth > program->maxStack)
+      program->maxStack = compileDepth;
+  }
 
-    if (depth >= 50) 
+  void emitConstant(float value)
+  {
+    uint8_t index = 0;
+    while (index < program->constantsIndex && program->constants[index] != value)
+      index++;
+    if (index == program->constantsIndex)
     {
-      ERROR_ARTI("Error: Interpret recursion level too deep at %s (%u)\n", parseTree.as<std::string>().c_str(), depth);
-      errorOccurred = true;
+      if (program->constantsIndex >= nrOfConstants)
+      {
+        ERROR_ARTI("Compile: too many constants (%u)\n", nrOfConstants);
+        context.errorOccurred = true;
+        return;
+      }
+      program->constants[program->constantsIndex++] = value;
     }
-    if (errorOccurred) return false;
+    emitOp(OP_Const);
+    emit(index);
+    stackDelta(1);
+  }
 
-    if (parseTree.is<JsonObject>()) 
+  void emitVariable(uint8_t opcode, uint8_t level, uint8_t index, ScopedSymbolTable* current_scope)
+  {
+    //opcode is OP_Load or OP_Store, use the short forms if the frame is known at compile time
+    if (level == 1)
+      emitOp(opcode == OP_Load?OP_LoadGlobal:OP_StoreGlobal);
+    else if (level == 0 || level == current_scope->scope_level) //level 0: variable not found, current frame like the tree interpreter did
+      emitOp(opcode == OP_Load?OP_LoadLocal:OP_StoreLocal);
+    else
     {
-      for (JsonPair parseTreePair : parseTree.as<JsonObject>()) 
+      emitOp(opcode);
+      emit(level);
+    }
+    emit(index);
+    stackDelta(opcode == OP_Load?1:-1);
+  }
+
+  //replace an operator on constants by its result, e.g. 2 * 3 => 6, division and mod by 0 are left to the vm
+  bool foldConstants(uint8_t opcode)
+  {
+    if (context.errorOccurred) return false;
+
+    const uint8_t *code = program->code;
+    uint16_t first = (opcode == OP_Negate)?lastOps[1]:lastOps[0];
+    if (first == codeNone || first < lastLabel || code[first] != OP_Const || lastOps[1] + 2 != program->codeSize || code[lastOps[1]] != OP_Const)
+      return false;
+
+    float left = program->constants[code[first + 1]];
+    float right = program->constants[code[lastOps[1] + 1]];
+    float result;
+    switch (opcode)
+    {
+      case OP_Negate: result = -right; break;
+      case OP_Add: result = left + right; break;
+      case OP_Subtract: result = left - right; break;
+      case OP_Multiply: result = left * right; break;
+      case OP_Divide: if (right == 0) return false; result = left / right; break;
+      case OP_Modulo: if (right == 0) return false; result = fmod(left, right); break;
+      case OP_BitShiftLeft: result = (int)left << (int)right; break;
+      case OP_BitShiftRight: result = (int)left >> (int)right; break;
+      case OP_Equal: result = left == right; break;
+      case OP_NotEqual: result = left != right; break;
+      case OP_LessThen: result = left < right; break;
+      case OP_LessThenOrEqual: result = left <= right; break;
+      case OP_GreaterThen: result = left > right; break;
+      case OP_GreaterThenOrEqual: result = left >= right; break;
+      case OP_And: result = left && right; break;
+      case OP_Or: result = left || right; break;
+      default: return false;
+    }
+
+    compileDepth -= (opcode == OP_Negate)?1:2;
+    program->codeSize = first;
+    lastOps[1] = codeNone;
+    emitConstant(result);
+    return true;
+  }
+
+  //operands and operators of an expr or term are compiled in order: a + b - c => a b OP_Add c OP_Subtract
+  void beginExpression()
+  {
+    if (expressionIndex >= arrayLength)
+    {
+      ERROR_ARTI("Compile: expression nesting too deep (%u)\n", arrayLength);
+      context.errorOccurred = true;
+      return;
+    }
+    expressionStates[expressionIndex].items = 0;
+    expressionStates[expressionIndex].pendingOperator = F_NoToken;
+    expressionIndex++;
+  }
+
+  void endExpression()
+  {
+    if (expressionIndex > 0)
+      expressionIndex--;
+  }
+
+  void compileOperator(uint8_t operatorx)
+  {
+    if (expressionIndex > 0)
+      expressionStates[expressionIndex - 1].pendingOperator = operatorx;
+    else
+      ERROR_ARTI("Compile: operator %s outside expression\n", tokenToString(operatorx));
+  }
+
+  void operandCompiled()
+  {
+    if (expressionIndex == 0) return;
+
+    ExpressionState &expression = expressionStates[expressionIndex - 1];
+    expression.items++;
+    if (expression.pendingOperator == F_NoToken) return;
+
+    if (expression.items == 1) // unary: operator and 1 operand
+    {
+      if (expression.pendingOperator == F_minus)
+      {
+        if (!foldConstants(OP_Negate))
+          emitOp(OP_Negate);
+      }
+      else
+        ERROR_ARTI("Compile: unary operator not supported %s\n", tokenToString(expression.pendingOperator));
+    }
+    else if (expression.pendingOperator >= F_plus && expression.pendingOperator <= F_or)
+    {
+      uint8_t opcode = OP_Add + expression.pendingOperator - F_plus;
+      if (!foldConstants(opcode))
+      {
+        emitOp(opcode);
+        stackDelta(-1);
+      }
+    }
+    else
+      ERROR_ARTI("Compile: Programming error: unknown operator %u\n", expression.pendingOperator);
+
+    expression.pendingOperator = F_NoToken;
+  }
+
+  //compile an element which must result in exactly one value on the stack
+  bool compileValue(JsonVariant parseTree, const char * treeElement, ScopedSymbolTable* current_scope, uint8_t depth)
+  {
+    uint8_t oldDepth = compileDepth;
+
+    beginExpression();
+    compile(parseTree, treeElement, current_scope, depth);
+    endExpression();
+
+    if (compileDepth != oldDepth + 1 && !context.errorOccurred)
+    {
+      ERROR_ARTI("Compile: %s should result in one value (%d)\n", stringOrEmpty(treeElement), compileDepth - oldDepth);
+      context.errorOccurred = true;
+    }
+    return !context.errorOccurred;
+  }
+
+  uint8_t compileFunction(Symbol* function_symbol)
+  {
+    for (uint8_t i = 0; i < program->functionsIndex; i++)
+    {
+      if (functionSymbols[i] == function_symbol)
+        return i;
+    }
+
+    if (program->functionsIndex >= nrOfFunctions)
+    {
+      ERROR_ARTI("Compile: too many functions (%u)\n", nrOfFunctions);
+      context.errorOccurred = true;
+      return functionNone;
+    }
+
+    //code is generated after main, see compile()
+    ArtiFunction &function = program->functions[program->functionsIndex];
+    function.address = 0;
+    function.nrOfFormals = function_symbol->function_scope->nrOfFormals;
+    function.nrOfLocals = (function_symbol->function_scope->symbolsIndex > 0)?function_symbol->function_scope->symbolsIndex:1;
+    function.nesting_level = function_symbol->function_scope->scope_level;
+    functionSymbols[program->functionsIndex] = function_symbol;
+    return program->functionsIndex++;
+  }
+
+  //is an expression node constant, the same for all leds of a frame or different per led, see ExpressionClasses
+  uint8_t classifyNode(uint8_t node, JsonVariant value, uint8_t depth)
+  {
+    switch (node)
+    {
+      case F_VarRef:
+      case F_Call:
+        if (value.containsKey("external"))
+        {
+          if (!arti_external_per_frame(value["external"]))
+            return C_Pixel;
+          uint8_t result = classify(value[(node == F_VarRef)?"indices":"actuals"], depth + 1);
+          return (result > C_Frame)?result:C_Frame;
+        }
+        else if (node == F_VarRef)
+        {
+          uint8_t level = value["level"];
+          uint8_t index = value["index"];
+          return (level == 1 && index < 32 && !(assignedGlobals & (1UL << index)))?C_Frame:C_Pixel;
+        }
+        return C_Pixel; //user functions
+      case F_Expr:
+      case F_Term:
+      case F_Cex:
+        return classify(value, depth + 1);
+      default:
+        return C_Pixel; //statements
+    }
+  }
+
+  uint8_t classify(JsonVariant parseTree, uint8_t depth)
+  {
+    if (depth >= 50) return C_Pixel;
+
+    uint8_t result = C_Constant;
+    if (parseTree.is<JsonObject>())
+    {
+      if (parseTree.containsKey("token")) //constant or operator
+        return C_Constant;
+      for (JsonPair parseTreePair : parseTree.as<JsonObject>())
+      {
+        uint8_t node = stringToNode(parseTreePair.key().c_str());
+        uint8_t childResult = C_Constant;
+        if (node != F_NoNode)
+          childResult = classifyNode(node, parseTreePair.value(), depth);
+        else if (parseTreePair.value().size() > 0)
+          childResult = classify(parseTreePair.value(), depth + 1);
+        if (childResult > result)
+          result = childResult;
+      }
+    }
+    else if (parseTree.is<JsonArray>())
+    {
+      for (JsonVariant element: parseTree.as<JsonArray>())
+      {
+        uint8_t childResult = classify(element, depth + 1);
+        if (childResult > result)
+          result = childResult;
+      }
+    }
+    return result;
+  }
+
+  //globals assigned in a block or in the functions called from it
+  void scanAssignedGlobals(JsonVariant parseTree, ScopedSymbolTable* current_scope, uint8_t depth)
+  {
+    if (depth >= 50) {assignedGlobals = UINT32_MAX; return;}
+
+    if (parseTree.is<JsonObject>())
+    {
+      for (JsonPair parseTreePair : parseTree.as<JsonObject>())
       {
-        const char * key = parseTreePair.key().c_str();
         JsonVariant value = parseTreePair.value();
-        if (treeElement == nullptr || strcmp(treeElement, key) == 0) 
+        uint8_t node = stringToNode(parseTreePair.key().c_str());
+
+        if (node == F_Assign && !value["varref"].containsKey("external"))
+        {
+          uint8_t level = value["varref"]["level"];
+          uint8_t index = value["varref"]["index"];
+          if (level == 1 && index < 32)
+            assignedGlobals |= 1UL << index;
+        }
+        else if (node == F_Call && !value.containsKey("external"))
         {
-          // RUNLOG_ARTI("%s Interpret object element %s %s\n", spaces+50-depth, key, value.as<std::string>().c_str());
+          const char * function_name = value["ID"];
+          Symbol* function_symbol = current_scope->lookup(function_name);
+          if (function_symbol != nullptr && function_symbol->function_scope != nullptr)
+          {
+            bool scanned = false;
+            for (uint8_t i = 0; i < scannedIndex; i++)
+              scanned = scanned || scannedFunctions[i] == function_symbol;
+
+            if (function_symbol->block.isNull() || scannedIndex >= nrOfFunctions)
+              assignedGlobals = UINT32_MAX;
+            else if (!scanned)
+            {
+              scannedFunctions[scannedIndex++] = function_symbol;
+              scanAssignedGlobals(function_symbol->block, function_symbol->function_scope, depth + 1);
+            }
+          }
+        }
+
+        if (value.size() > 0)
+          scanAssignedGlobals(value, current_scope, depth + 1);
+      }
+    }
+    else if (parseTree.is<JsonArray>())
+    {
+      for (JsonVariant element: parseTree.as<JsonArray>())
+        scanAssignedGlobals(element, current_scope, depth + 1);
+    }
+  }
+
+  bool containsCall(JsonVariant parseTree, const char * function_name, uint8_t depth = 0)
+  {
+    if (depth >= 50) return true;
+
+    if (parseTree.is<JsonObject>())
+    {
+      for (JsonPair parseTreePair : parseTree.as<JsonObject>())
+      {
+        if (strcmp(parseTreePair.key().c_str(), "call") == 0 && parseTreePair.value()["ID"] == function_name)
+          return true;
+        if (parseTreePair.value().size() > 0 && containsCall(parseTreePair.value(), function_name, depth + 1))
+          return true;
+      }
+    }
+    else if (parseTree.is<JsonArray>())
+    {
+      for (JsonVariant element: parseTree.as<JsonArray>())
+        if (containsCall(element, function_name, depth + 1))
+          return true;
+    }
+    return false;
+  }
 
+  //replace a per frame expression of renderLed by a hidden global which is set in the framePrologue
+  bool hoist(JsonVariant parseTree, const char * key, uint8_t node, JsonVariant value, uint8_t depth)
+  {
+    if (!hoisting || expressionIndex == 0 || hoistedIndex >= nrOfHoisted || program->nrOfGlobals >= nrOfStateVariables / 2)
+      return false;
+    if (node == F_VarRef && !value.containsKey("external")) //already a variable
+      return false;
+    if (classifyNode(node, value, depth) != C_Frame)
+      return false;
+
+    hoistedTrees[hoistedIndex] = parseTree;
+    hoistedKeys[hoistedIndex] = key;
+    hoistedSlots[hoistedIndex] = program->nrOfGlobals++;
+    DEBUG_ARTI("%s hoist %s to global %u\n", spaces+50-depth, key, hoistedSlots[hoistedIndex]);
+
+    emitOp(OP_LoadGlobal);
+    emit(hoistedSlots[hoistedIndex]);
+    stackDelta(1);
+    operandCompiled();
+
+    hoistedIndex++;
+    return true;
+  }
+
+  //lower the analyzed parseTree to bytecode, walks the tree the same way the tree interpreter did
+  bool compile(JsonVariant parseTree, const char * treeElement = nullptr, ScopedSymbolTable* current_scope = nullptr, uint8_t depth = 0)
+  {
+    if (depth >= 50)
+    {
+      ERROR_ARTI("Error: Compile recursion level too deep at %s (%u)\n", parseTree.as<std::string>().c_str(), depth);
+      context.errorOccurred = true;
+    }
+    if (context.errorOccurred) return false;
+
+    if (parseTree.is<JsonObject>())
+    {
+      for (JsonPair parseTreePair : parseTree.as<JsonObject>())
+      {
+        const char * key = parseTreePair.key().c_str();
+        JsonVariant value = parseTreePair.value();
+        if (treeElement == nullptr || strcmp(treeElement, key) == 0)
+        {
           bool visitedAlready = false;
 
           if (strcmp(key, "*") == 0)
@@ -1869,148 +2276,97 @@ public:
             visitedAlready = true;
           else if (parseTree.containsKey("token")) //key is token
           {
-            // RUNLOG_ARTI("%s Token %s %s %s\n", spaces+50-depth, key, valueStr, parseTree.as<std::string>().c_str());
-
-            const char * valueStr = value;
-
-            switch (parseTree["token"].as<uint8_t>()) 
+            uint8_t token = parseTree["token"];
+            if (token == F_integerConstant || token == F_realConstant)
             {
-              case F_integerConstant:
-              case F_realConstant:
-                valueStack->push(atof(valueStr)); //push value
-                #if ARTI_PLATFORM != ARTI_ARDUINO  //for some weird reason this causes a crash on esp32
-                  RUNLOG_ARTI("%s %s %s (Push %u)\n", spaces+50-depth, key, valueStr, valueStack->stack_index);
-                #endif
-                break;
-              default:
-                valueStack->push(parseTree["token"].as<uint8_t>()); // push Operator index
-                #if ARTI_PLATFORM != ARTI_ARDUINO  //for some weird reason this causes a crash on esp32
-                  RUNLOG_ARTI("%s %s %s (Push %u)\n", spaces+50-depth, key, valueStr, valueStack->stack_index);
-                #endif
+              emitConstant(atof(value.as<const char *>()));
+              operandCompiled();
             }
+            else
+              compileOperator(token);
             visitedAlready = true;
           }
           else //if key is node_name
           {
             uint8_t node = stringToNode(key);
 
-            // RUNLOG_ARTI("%s Node %s\n", spaces+50-depth, key);
-
-            switch (node)
+            if ((node == F_Expr || node == F_Term || node == F_Cex || node == F_Call || node == F_VarRef) && hoist(parseTree, key, node, value, depth))
+              visitedAlready = true;
+            else switch (node)
             {
-              case F_Program: 
+              case F_Program:
               {
-                const char * program_name = value["ID"];
-                RUNLOG_ARTI("%s program %s\n", spaces+50-depth, program_name);
-
-                ActivationRecord* ar = new ActivationRecord(program_name, "PROGRAM", 1);
-
-                this->callStack->push(ar);
-
-                interpret(value["block"], nullptr, global_scope, depth + 1);
-
-                // do not delete main stack and program ar as used in subsequent calls 
-                // this->callStack->pop();
-                // delete ar; ar = nullptr;
+                compile(value["block"], nullptr, global_scope, depth + 1);
+                emitOp(OP_Halt);
 
                 visitedAlready = true;
                 break;
               }
-              case F_Function: 
+              case F_Function:
               {
                 const char * function_name = value["ID"];
                 Symbol* function_symbol = current_scope->lookup(function_name);
-                RUNLOG_ARTI("%s Save block of %s\n", spaces+50-depth, function_name);
-                if (function_symbol != nullptr)
+                if (function_symbol != nullptr && function_symbol->function_scope != nullptr)
+                {
                   function_symbol->block = value["block"];
+                  compileFunction(function_symbol);
+                }
                 else
-                  ERROR_ARTI("%s Function %s: not found\n", spaces+50-depth, function_name); 
+                  ERROR_ARTI("%s Function %s: not found\n", spaces+50-depth, function_name);
 
                 visitedAlready = true;
                 break;
               }
-              case F_Call: 
+              case F_Call:
               {
                 const char * function_name = value["ID"];
+                uint8_t oldDepth = compileDepth;
 
-                //check if external function
-                if (value.containsKey("external")) {
-                  uint8_t oldIndex = valueStack->stack_index;
+                if (value.containsKey("external"))
+                {
+                  bool resultUsed = expressionIndex > 0; //as statement the result is not used
 
                   if (value.containsKey("actuals"))
-                    interpret(value["actuals"], nullptr, current_scope, depth + 1);
-
-                  float returnValue = floatNull;
-
-                  returnValue = arti_external_function(value["external"], valueStack->floatStack[oldIndex]
-                                                                        , (valueStack->stack_index - oldIndex>1)?valueStack->floatStack[oldIndex+1]:floatNull
-                                                                        , (valueStack->stack_index - oldIndex>2)?valueStack->floatStack[oldIndex+2]:floatNull
-                                                                        , (valueStack->stack_index - oldIndex>3)?valueStack->floatStack[oldIndex+3]:floatNull
-                                                                        , (valueStack->stack_index - oldIndex>4)?valueStack->floatStack[oldIndex+4]:floatNull);
-
-                  #if ARTI_PLATFORM != ARTI_ARDUINO // because arduino runs the code instead of showing the code
-                    uint8_t lastIndex = oldIndex;
-                    RUNLOG_ARTI("%s Call %s(", spaces+50-depth, function_name);
-                    char sep[3] = "";
-                    for (int i = oldIndex; i< valueStack->stack_index; i++) {
-                      RUNLOG_ARTI("%s%f", sep, valueStack->floatStack[i]);
-                      strcpy(sep, ", ");
-                    }
-                    if ( returnValue != floatNull)
-                      RUNLOG_ARTI(") = %f (Pop %u, Push %u)\n", returnValue, oldIndex, oldIndex + 1);
-                    else
-                      RUNLOG_ARTI(") (Pop %u)\n", oldIndex);
-
-                  #endif
-
-                  valueStack->stack_index = oldIndex;
+                  {
+                    beginExpression();
+                    compile(value["actuals"], nullptr, current_scope, depth + 1);
+                    endExpression();
+                  }
 
-                  if (returnValue != floatNull)
-                    valueStack->push(returnValue);
+                  uint8_t nrOfActuals = compileDepth - oldDepth;
+                  emitOp(resultUsed?OP_CallExternal:OP_CallExternalVoid);
+                  emit(value["external"].as<uint8_t>());
+                  emit(nrOfActuals);
+                  stackDelta(-nrOfActuals + (resultUsed?1:0));
 
+                  if (resultUsed)
+                    operandCompiled();
                 }
-                else { //not an external function
+                else
+                {
                   Symbol* function_symbol = current_scope->lookup(function_name);
 
-                  if (function_symbol != nullptr) //calling undefined function: pre-defined functions e.g. print
+                  if (function_symbol != nullptr && function_symbol->function_scope != nullptr)
                   {
-                    ActivationRecord* ar = new ActivationRecord(function_name, "Function", function_symbol->scope_level + 1);
-
-                    RUNLOG_ARTI("%s %s %s\n", spaces+50-depth, key, function_name);
-
-                    uint8_t oldIndex = valueStack->stack_index;
-                    uint8_t lastIndex = valueStack->stack_index;
+                    uint8_t function = compileFunction(function_symbol);
 
                     if (value.containsKey("actuals"))
-                      interpret(value["actuals"], nullptr, current_scope, depth + 1);
-
-                    for (uint8_t i=0; i<function_symbol->function_scope->nrOfFormals; i++)
                     {
-                      //determine type, for now assume float
-                      float result = valueStack->floatStack[lastIndex++];
-                      ar->set(function_symbol->function_scope->symbols[i]->scope_index, result);
-                      RUNLOG_ARTI("%s Actual %s.%s = %f (pop %u)\n", spaces+50-depth, function_name, function_symbol->function_scope->symbols[i]->name, result, valueStack->stack_index);
+                      beginExpression();
+                      compile(value["actuals"], nullptr, current_scope, depth + 1);
+                      endExpression();
                     }
 
-                    valueStack->stack_index = oldIndex;
-
-                    this->callStack->push(ar);
-
-                    interpret(function_symbol->block, nullptr, function_symbol->function_scope, depth + 1);
-
-                    this->callStack->pop();
-
-                    delete ar; ar =  nullptr;
-
+                    uint8_t nrOfActuals = compileDepth - oldDepth;
+                    emitOp(OP_Call);
+                    emit(function);
+                    emit(nrOfActuals);
+                    stackDelta(-nrOfActuals);
                     //tbd if syntax supports returnvalue
-                    // char callResult[charLength] = "CallResult tbd of ";
-                    // strcat(callResult, function_name);
-                    // valueStack->push(callResult);
-
-                  } //function_symbol != nullptr
+                  }
                   else
-                    RUNLOG_ARTI("%s %s not found %s\n", spaces+50-depth, key, function_name);
-                } //external functions
+                    DEBUG_ARTI("%s %s not found %s\n", spaces+50-depth, key, function_name);
+                }
 
                 visitedAlready = true;
                 break;
@@ -2018,431 +2374,974 @@ public:
               case F_VarRef:
               case F_Assign: //get or set a variable
               {
-                const char * variable_name;
-                uint8_t variable_level;
-                uint8_t variable_index;
-                uint8_t variable_external;
-                JsonObject variable_indices;
                 JsonObject variable_value;
-
-                float resultValue = floatNull;
-
-                if (node == F_Assign) 
-                {
+                if (node == F_Assign)
                   variable_value = value["varref"];
-
-                  if (value.containsKey("expr")) //value assignment
-                  {
-                    interpret(value, "expr", current_scope, depth + 1); //value pushed
-
-                    resultValue = valueStack->popFloat(); //result of interpret expr (but not for -- and ++ !!!!)
-                  }
-                }
                 else
                   variable_value = value;
 
-                variable_name = variable_value["ID"];
-                variable_level = variable_value["level"];
-                variable_index = variable_value["index"];
-                variable_external = variable_value["external"];
-                variable_indices = variable_value["indices"];
-
-                uint8_t oldIndex = valueStack->stack_index;
-
-                //array indices
-                char indices[charLength]; //used in RUNLOG_ARTI only
-                strcpy(indices, "");
-                if (!variable_indices.isNull()) 
-                {
-                  strcat(indices, "[");
-
-                  interpret(variable_value, "indices", current_scope, depth + 1); //values of indices pushed
-
-                  char sep[3] = "";
-                  for (uint8_t i = oldIndex; i< valueStack->stack_index; i++) {
-                    strcat(indices, sep);
-                    char itoaChar[charLength];
-                    // itoa(valueStack->floatStack[i], itoaChar, 10);
-                    snprintf(itoaChar, sizeof(itoaChar), "%f", valueStack->floatStack[i]);
-                    strcat(indices, itoaChar);
-                    strcpy(sep, ",");
-                  }
-
-                  strcat(indices, "]");
-                }
+                uint8_t variable_level = variable_value["level"];
+                uint8_t variable_index = variable_value["index"];
 
-                //check if external variable
                 if (variable_value.containsKey("external")) //added by Analyze
                 {
+                  uint8_t variable_external = variable_value["external"];
 
-                  if (node == F_VarRef) { //get the value
-
-                    resultValue = arti_get_external_variable(variable_external, (valueStack->stack_index - oldIndex>0)?valueStack->floatStack[oldIndex]:floatNull, (valueStack->stack_index - oldIndex>1)?valueStack->floatStack[oldIndex+1]:floatNull);
-                    valueStack->stack_index = oldIndex;
-
-                    if (resultValue != floatNull) 
+                  if (node == F_Assign) //value below the indices
+                  {
+                    if (value.containsKey("expr"))
                     {
-                      valueStack->push(resultValue);
-                      RUNLOG_ARTI("%s %s ext.%s = %f (push %u)\n", spaces+50-depth, key, variable_name, resultValue, valueStack->stack_index); //key is variable_declaration name is ID
+                      if (!compileValue(value, "expr", current_scope, depth + 1)) return false;
                     }
                     else
-                      ERROR_ARTI("%s Error: %s ext.%s no value\n", spaces+50-depth, key, variable_name);
+                      emitConstant(floatNull);
                   }
-                  else //assign: set the external value...
+
+                  uint8_t oldDepth = compileDepth;
+                  if (!variable_value["indices"].isNull())
                   {
-                    arti_set_external_variable(resultValue, variable_external, (valueStack->stack_index - oldIndex>0)?valueStack->floatStack[oldIndex]:floatNull, (valueStack->stack_index - oldIndex>1)?valueStack->floatStack[oldIndex+1]:floatNull);
-                    valueStack->stack_index = oldIndex;
+                    beginExpression();
+                    compile(variable_value, "indices", current_scope, depth + 1);
+                    endExpression();
+                  }
+                  uint8_t nrOfIndices = compileDepth - oldDepth;
 
-                    RUNLOG_ARTI("%s %s set ext.%s%s = %f (Pop %u)\n", spaces+50-depth, key, variable_name, indices, resultValue, oldIndex);
+                  if (node == F_VarRef)
+                  {
+                    emitOp(OP_GetExternal);
+                    emit(variable_external);
+                    emit(nrOfIndices);
+                    stackDelta(1 - nrOfIndices);
+                    operandCompiled();
+                  }
+                  else
+                  {
+                    emitOp(OP_SetExternal);
+                    emit(variable_external);
+                    emit(nrOfIndices);
+                    stackDelta(-1 - nrOfIndices);
                   }
                 }
-                else //not external, get er set the variable
+                else if (node == F_VarRef)
                 {
-                  // Symbol* variable_symbol = current_scope->lookup(variable_name);
-                  ActivationRecord* ar;
-
-                  //check already defined in this scope
+                  emitVariable(OP_Load, variable_level, variable_index, current_scope);
+                  operandCompiled();
+                }
+                else
+                {
+                  uint8_t assignOperator = value.containsKey("assignoperator")?value["assignoperator"].as<uint8_t>():F_NoToken;
 
-                  // RUNLOG_ARTI("%s levels %u-%u\n", spaces+50-depth, variable_level,  variable_index );
-                  if (variable_level != 0) { //var already exist
-                    //calculate the index in the call stack to find the right ar
-                    uint8_t index = this->callStack->recordsCounter - 1 - (this->callStack->peek()->nesting_level - variable_level);
-                    //  RUNLOG_ARTI("%s %s %s.%s = %s (push) %s %d-%d = %d (%d)\n", spaces+50-depth, key, ar->name, variable_name, varValue, variable_symbol->name, this->callStack->peek()->nesting_level,variable_symbol->scope_level, index,  this->callStack->recordsCounter); //key is variable_declaration name is ID
-                    ar = this->callStack->records[index];
+                  switch (assignOperator)
+                  {
+                    case F_plus:
+                    case F_minus:
+                    case F_multiplication:
+                    case F_division:
+                      emitVariable(OP_Load, variable_level, variable_index, current_scope);
+                      if (!compileValue(value, "expr", current_scope, depth + 1)) return false;
+                      emitOp(OP_Add + assignOperator - F_plus);
+                      stackDelta(-1);
+                      break;
+                    case F_plusplus:
+                    case F_minmin:
+                      emitVariable(OP_Load, variable_level, variable_index, current_scope);
+                      emitConstant(1);
+                      emitOp(assignOperator == F_plusplus?OP_Add:OP_Subtract);
+                      stackDelta(-1);
+                      break;
+                    default:
+                      if (!compileValue(value, "expr", current_scope, depth + 1)) return false;
                   }
-                  else //var created here
-                    ar = this->callStack->peek();
 
-                  if (ar != nullptr) // variable found
-                  {
-                    if (node == F_VarRef) //get the value
-                    {
-                      //determine type, for now assume float
-                      float varValue = ar->getFloat(variable_index);
+                  emitVariable(OP_Store, variable_level, variable_index, current_scope);
+                }
 
-                      valueStack->push(varValue);
-                      #if ARTI_PLATFORM != ARTI_ARDUINO  //for some weird reason this causes a crash on esp32
-                        RUNLOG_ARTI("%s %s %s.%s = %f (push %u) %u-%u\n", spaces+50-depth, key, ar->name, variable_name, varValue, valueStack->stack_index, variable_level, variable_index); //key is variable_declaration name is ID
-                      #endif
-                    }
-                    else { //assign: set the value 
-
-                      if (value.containsKey("assignoperator")) 
-                      {
-                        switch (value["assignoperator"].as<uint8_t>()) 
-                        {
-                          case F_plus:
-                            ar->set(variable_index, ar->getFloat(variable_index) + resultValue);
-                            break;
-                          case F_minus:
-                            ar->set(variable_index, ar->getFloat(variable_index) - resultValue);
-                            break;
-                          case F_multiplication:
-                            ar->set(variable_index, ar->getFloat(variable_index) * resultValue);
-                            break;
-                          case F_division: 
-                          {
-                            if (resultValue == 0) // divisor
-                            {
-                              resultValue = 1;
-                              ERROR_ARTI("%s /= division by 0 not possible, divisor ignored for %f\n", spaces+50-depth, ar->getFloat(variable_index));
-                            }
-                            ar->set(variable_index, ar->getFloat(variable_index) / resultValue);
-                            break;
-                          }
-                          case F_plusplus:
-                            ar->set(variable_index, ar->getFloat(variable_index) + 1);
-                            break;
-                          case F_minmin:
-                            ar->set(variable_index, ar->getFloat(variable_index) - 1);
-                            break;
-                        }
-
-                        RUNLOG_ARTI("%s %s.%s%s %s= %f (pop %u) %u-%u\n", spaces+50-depth, ar->name, variable_name, indices, tokenToString(value["assignoperator"]), ar->getFloat(variable_index), valueStack->stack_index, variable_level, variable_index);
-                      }
-                      else 
-                      {
-                        ar->set(variable_index, resultValue);
-                        RUNLOG_ARTI("%s %s.%s%s := %f (pop %u) %u-%u\n", spaces+50-depth, ar->name, variable_name, indices, ar->getFloat(variable_index), valueStack->stack_index, variable_level, variable_index);
-                      }
-                      valueStack->stack_index = oldIndex;
-                    }
-                  } //ar != nullptr
-                  else { //unknown variable
-                    ERROR_ARTI("%s %s %s unknown\n", spaces+50-depth, key, variable_name);
-                    valueStack->push(floatNull);
-                  }
-                } // ! founnd
                 visitedAlready = true;
                 break;
               }
               case F_Expr:
-              case F_Term: 
+              case F_Term:
               {
-                uint8_t oldIndex = valueStack->stack_index;
-
-                // RUNLOG_ARTI("%s before expr term interpret %s %s\n", spaces+50-depth, key, value.as<std::string>().c_str());
-                interpret(value, nullptr, current_scope, depth + 1); //pushes results
-
-                // RUNLOG_ARTI("%s %s interpret > (%u - %u = %u)\n", spaces+50-depth, key, valueStack->stack_index, oldIndex, valueStack->stack_index - oldIndex);
-
-                // always 3, 5, 7 ... values
-                if (valueStack->stack_index - oldIndex >= 3) 
-                {
-                  float left = valueStack->floatStack[oldIndex];
-                  for (int i = 3; i <= valueStack->stack_index - oldIndex; i += 2)
-                  {
-                    uint8_t operatorx = valueStack->floatStack[oldIndex + i - 2];
-                    float right = valueStack->floatStack[oldIndex + i - 1];
-
-                    float evaluation = 0;
-
-                    switch (operatorx) {
-                      case F_plus: 
-                        evaluation = left + right;
-                        break;
-                      case F_minus: 
-                        evaluation = left - right;
-                        break;
-                      case F_multiplication: 
-                        evaluation = left * right;
-                        break;
-                      case F_division: {
-                        if (right == 0)
-                        {
-                          right = 1;
-                          ERROR_ARTI("%s division by 0 not possible, divisor ignored for %f\n", spaces+50-depth, left);
-                        }
-                        evaluation = left / right;
-                        break;
-                      }
-                      case F_modulo: {
-                        if (right == 0) {
-                          evaluation = left;
-                          ERROR_ARTI("%s mod 0 not possible, mod ignored %f\n", spaces+50-depth, left);
-                        }
-                        else 
-                          evaluation = fmod(left, right);
-                        break;
-                      }
-                      case F_bitShiftLeft: 
-                        evaluation = (int)left << (int)right; //only works on integers
-                        break;
-                      case F_bitShiftRight: 
-                        evaluation = (int)left >> (int)right; //only works on integers
-                        break;
-                      case F_equal: 
-                        evaluation = left == right;
-                        break;
-                      case F_notEqual: 
-                        evaluation = left != right;
-                        break;
-                      case F_lessThen: 
-                        evaluation = left < right;
-                        break;
-                      case F_lessThenOrEqual: 
-                        evaluation = left <= right;
-                        break;
-                      case F_greaterThen: 
-                        evaluation = left > right;
-                        break;
-                      case F_greaterThenOrEqual: 
-                        evaluation = left >= right;
-                        break;
-                      case F_and: 
-                        evaluation = left && right;
-                        break;
-                      case F_or: 
-                        evaluation = left || right;
-                        break;
-                      default:
-                        ERROR_ARTI("%s Programming error: unknown operator %u\n", spaces+50-depth, operatorx);
-                    }
-
-                    RUNLOG_ARTI("%s %f %s %f = %f (pop %u, push %u)\n", spaces+50-depth, left, tokenToString(operatorx), right, evaluation, valueStack->stack_index - i, valueStack->stack_index - i + 1);
-
-                    left = evaluation;
-                  }
-
-                  valueStack->stack_index = oldIndex;
-    
-                  valueStack->push(left);
-                }
-                else if (valueStack->stack_index - oldIndex == 2) // unary: operator and 1 operand
-                {
-                  uint8_t operatorx = valueStack->floatStack[oldIndex];
-                  if (operatorx == F_minus) 
-                  {
-                    valueStack->stack_index = oldIndex;
-                    valueStack->push(-valueStack->floatStack[oldIndex + 1]);
-                    RUNLOG_ARTI("%s unary - %f (push %u)\n", spaces+50-depth, valueStack->floatStack[oldIndex + 1], valueStack->stack_index );
-                  }
-                  else
-                    RUNLOG_ARTI("%s unary operator not supported %u %s\n", spaces+50-depth, operatorx, tokenToString(operatorx));
-                }
+                beginExpression();
+                compile(value, nullptr, current_scope, depth + 1);
+                endExpression();
+                operandCompiled();
 
                 visitedAlready = true;
                 break;
               }
-              case F_For: 
+              case F_For:
               {
-                RUNLOG_ARTI("%s For (%u)\n", spaces+50-depth, valueStack->stack_index);
+                compile(value, "assign", current_scope, depth + 1);
 
-                interpret(value, "assign", current_scope, depth + 1); //creates the assignment
-                ActivationRecord* ar = this->callStack->peek();
-
-                bool continuex = true;
-                uint16_t counter = 0;
-                while (continuex && counter < 2000) //to avoid endless loops
+                //loop variable, used if the condition is a value (e.g. in pascal)
+                uint8_t variable_level = variableNone;
+                uint8_t variable_index = 0;
+                JsonObject variable_value = value["assign"]["varref"];
+                if (!variable_value.isNull() && !variable_value.containsKey("external"))
                 {
-                  RUNLOG_ARTI("%s iteration\n", spaces+50-depth);
+                  variable_level = variable_value["level"];
+                  variable_index = variable_value["index"];
+                }
 
-                  RUNLOG_ARTI("%s check to condition\n", spaces+50-depth);
-                  interpret(value, "expr", current_scope, depth + 1); //pushes result of to
+                emitOp(OP_ForInit);
+                stackDelta(2);
 
-                  float conditionResult = valueStack->popFloat();
+                uint16_t conditionAddress = program->codeSize;
+                lastLabel = conditionAddress;
+                if (!compileValue(value, "expr", current_scope, depth + 1)) return false;
 
-                  RUNLOG_ARTI("%s conditionResult (pop %u)\n", spaces+50-depth, valueStack->stack_index);
+                emitOp(OP_ForTest);
+                emit(variable_level);
+                emit(variable_index);
+                uint16_t exitAt = emitAddress();
+                stackDelta(-1);
 
-                  if (conditionResult == 1) { //conditionResult is true
-                    RUNLOG_ARTI("%s 1 => run block\n", spaces+50-depth);
-                    interpret(value["block"], nullptr, current_scope, depth + 1);
+                if (!value["block"].isNull())
+                  compile(value["block"], nullptr, current_scope, depth + 1);
 
-                    RUNLOG_ARTI("%s assign next value\n", spaces+50-depth);
-                    interpret(value["increment"], nullptr, current_scope, depth + 1); //pushes increment result
-                    // MEMORY_ARTI("%s Iteration %u %u\n", spaces+50-depth, counter, FREE_SIZE);
-                  }
-                  else 
-                  {
-                    if (conditionResult == 0) { //conditionResult is false
-                      RUNLOG_ARTI("%s 0 => end of For\n", spaces+50-depth);
-                      continuex = false;
-                    }
-                    else // conditionResult is a value (e.g. in pascal)
-                    {
-                      //get the variable from assignment
-                      float varValue = ar->getFloat(ar->lastSetIndex);
-
-                      float evaluation = varValue <= conditionResult;
-                      RUNLOG_ARTI("%s %s.(%u) %f <= %f = %f\n", spaces+50-depth, ar->name, ar->lastSetIndex, varValue, conditionResult, evaluation);
-
-                      if (evaluation == 1) 
-                      {
-                        RUNLOG_ARTI("%s 1 => run block\n", spaces+50-depth);
-                        interpret(value["block"], nullptr, current_scope, depth + 1);
-
-                        //increment
-                        ar->set(ar->lastSetIndex, varValue + 1);
-                      }
-                      else 
-                      {
-                        RUNLOG_ARTI("%s 0 => end of For\n", spaces+50-depth);
-                        continuex = false;
-                      }
-                    }
-                  }
-                  counter++;
-                };
+                emitOp(OP_ForNext);
+                emit(variable_level);
+                emit(variable_index);
+                uint16_t incrementAt = emitAddress();
+
+                if (!value["increment"].isNull())
+                  compile(value["increment"], nullptr, current_scope, depth + 1);
+
+                patchAddress(incrementAt, program->codeSize);
+                emitOp(OP_ForLoop);
+                emitAddress(conditionAddress);
 
-                if (continuex)
-                  ERROR_ARTI("%s too many iterations in for loop %u\n", spaces+50-depth, counter);
+                patchAddress(exitAt, program->codeSize);
+                emitOp(OP_ForEnd);
+                stackDelta(-2);
 
                 visitedAlready = true;
                 break;
-              }  // case
-              case F_If: 
+              }
+              case F_If:
               {
-                RUNLOG_ARTI("%s If (stack %u)\n", spaces+50-depth, valueStack->stack_index);
-
-                RUNLOG_ARTI("%s condition\n", spaces+50-depth);
                 if (value.containsKey("expr"))
-                  interpret(value, "expr", current_scope, depth + 1);
-                // else if (value.containsKey("varref"))
-                //   interpret(value, "varref", current_scope, depth + 1);
+                {
+                  if (!compileValue(value, "expr", current_scope, depth + 1)) return false;
+                }
+                else
+                  emitConstant(0);
 
-                float conditionResult = valueStack->popFloat();
+                emitOp(OP_JumpIfNotTrue);
+                uint16_t elseAt = emitAddress();
+                stackDelta(-1);
 
-                RUNLOG_ARTI("%s (pop %u)\n", spaces+50-depth, valueStack->stack_index);
+                compile(value, "block", current_scope, depth + 1);
 
-                if (conditionResult == 1) //conditionResult is true
-                  interpret(value, "block", current_scope, depth + 1);
+                if (value.containsKey("elseBlock"))
+                {
+                  emitOp(OP_Jump);
+                  uint16_t endAt = emitAddress();
+                  patchAddress(elseAt, program->codeSize);
+                  compile(value, "elseBlock", current_scope, depth + 1);
+                  patchAddress(endAt, program->codeSize);
+                }
                 else
-                  interpret(value, "elseBlock", current_scope, depth + 1);
+                  patchAddress(elseAt, program->codeSize);
 
                 visitedAlready = true;
                 break;
-              }  // case
-              case F_Cex: 
+              }
+              case F_Cex:
               {
-                RUNLOG_ARTI("%s Cex (stack %u)\n", spaces+50-depth, valueStack->stack_index);
+                if (!compileValue(value, "expr", current_scope, depth + 1)) return false;
 
-                RUNLOG_ARTI("%s condition\n", spaces+50-depth);
-                interpret(value, "expr", current_scope, depth + 1);
+                emitOp(OP_JumpIfNotTrue);
+                uint16_t falseAt = emitAddress();
+                stackDelta(-1);
 
-                float conditionResult = valueStack->popFloat();
+                if (!compileValue(value, "trueExpr", current_scope, depth + 1)) return false;
 
-                RUNLOG_ARTI("%s (pop %u)\n", spaces+50-depth, valueStack->stack_index);
+                emitOp(OP_Jump);
+                uint16_t endAt = emitAddress();
+                patchAddress(falseAt, program->codeSize);
+                stackDelta(-1); //only one of both is pushed
 
-                if (conditionResult == 1) //conditionResult is true
-                  interpret(value, "trueExpr", current_scope, depth + 1);
-                else
-                  interpret(value, "falseExpr", current_scope, depth + 1);
+                if (!compileValue(value, "falseExpr", current_scope, depth + 1)) return false;
+                patchAddress(endAt, program->codeSize);
+
+                operandCompiled();
 
                 visitedAlready = true;
                 break;
-              }  // case
+              }
               default:  //visitedalready false => recursive call
                 break;
             }
           } // is key is node_name
 
           if (!visitedAlready && value.size() > 0) // if size == 0 then injected key/value like operator
-            interpret(value, nullptr, current_scope, depth + 1);
+            compile(value, nullptr, current_scope, depth + 1);
         } // if treeelement
-                // RUNLOG_ARTI("%s before end for %u\n", spaces+50-depth, depth);
       } // for (JsonPair)
     }
-    else if (parseTree.is<JsonArray>()) 
+    else if (parseTree.is<JsonArray>())
     {
-      for (JsonVariant newParseTree: parseTree.as<JsonArray>()) 
+      for (JsonVariant newParseTree: parseTree.as<JsonArray>())
+        compile(newParseTree, nullptr, current_scope, depth + 1);
+    }
+    else //not array
+      ERROR_ARTI("%s Error: parseTree should be array or object %s (%u)\n", spaces+50-depth, parseTree.as<std::string>().c_str(), depth);
+
+    return !context.errorOccurred;
+  } //compile
+
+  bool compileProgram()
+  {
+    program = new ArtiProgram();
+    program->nrOfGlobals = (global_scope->symbolsIndex > 0)?global_scope->symbolsIndex:1;
+
+    compileDepth = 0;
+    expressionIndex = 0;
+    lastOps[0] = lastOps[1] = codeNone;
+    lastLabel = 0;
+    hoistedIndex = 0;
+
+    //main program, saves the blocks of the functions
+    if (!compile(parseTreeJson, nullptr, global_scope)) return false;
+
+    //functions, called functions can be added while compiling
+    for (uint8_t i = 0; i < program->functionsIndex; i++)
+    {
+      Symbol* function_symbol = functionSymbols[i];
+      if (function_symbol->block.isNull())
       {
-        // RUNLOG_ARTI("%s\n", spaces+50-depth, "Array ", parseTree[i], "  ";
-        interpret(newParseTree, nullptr, current_scope, depth + 1);
+        ERROR_ARTI("Compile: Function %s: no block in parseTree\n", function_symbol->name);
+        context.errorOccurred = true;
+        return false;
       }
+
+      //not if renderLed is called by the program itself, then the framePrologue may not have run
+      hoisting = strcmp(function_symbol->name, "renderLed") == 0 && function_symbol->scope == global_scope && !containsCall(parseTreeJson, "renderLed");
+      if (hoisting)
+      {
+        assignedGlobals = 0;
+        scannedIndex = 0;
+        scanAssignedGlobals(function_symbol->block, function_symbol->function_scope, 1);
+      }
+
+      program->functions[i].address = program->codeSize;
+      compileDepth = 0;
+      bool compiled = compile(function_symbol->block, nullptr, function_symbol->function_scope, 1);
+      hoisting = false;
+      if (!compiled) return false;
+      emitOp(OP_Return);
     }
-    else { //not array
-      ERROR_ARTI("%s Error: parseTree should be array or object %s (%u)\n", spaces+50-depth, parseTree.as<std::string>().c_str(), depth);
+
+    //set the hidden globals of renderLed, runs in the frame of main
+    if (hoistedIndex > 0)
+    {
+      program->framePrologue = program->codeSize;
+      for (uint8_t i = 0; i < hoistedIndex; i++)
+      {
+        compileDepth = 0;
+        if (!compileValue(hoistedTrees[i], hoistedKeys[i], global_scope, 1)) return false;
+        emitVariable(OP_Store, 1, hoistedSlots[i], global_scope);
+      }
+      emitOp(OP_Halt);
+    }
+
+    for (uint8_t i = 0; i < program->functionsIndex; i++)
+    {
+      if (strcmp(functionSymbols[i]->name, "renderFrame") == 0 && functionSymbols[i]->scope == global_scope)
+        program->renderFrame = i;
+      else if (strcmp(functionSymbols[i]->name, "renderLed") == 0 && functionSymbols[i]->scope == global_scope)
+        program->renderLed = i;
+    }
+
+    if (program->maxStack > arrayLength)
+    {
+      ERROR_ARTI("Compile: expressions too complex, %u of %u stack values\n", program->maxStack, arrayLength);
+      context.errorOccurred = true;
     }
 
-    return !errorOccurred;
-  } //interpret
+    return !context.errorOccurred;
+  } //compileProgram
+
+  //returns the variable of the nearest frame with this nesting level
+  float * variable(uint8_t level, uint8_t index)
+  {
+    for (int8_t i = state->framesIndex - 1; i >= 0; i--)
+    {
+      if (level == 0 || state->frames[i].nesting_level == level)
+        return (state->frames[i].base + index < nrOfStateVariables)?state->variables + state->frames[i].base + index:nullptr;
+    }
+    return nullptr;
+  }
+
+  bool pushFrame(const ArtiFunction &function, const float * actuals, uint8_t nrOfActuals, uint16_t returnAddress, uint8_t stack_index)
+  {
+    if (state->framesIndex >= nrOfRecords || state->variablesIndex + function.nrOfLocals > nrOfStateVariables || stack_index + program->maxStack > arrayLength)
+    {
+      context.errorOccurred = true;
+      ERROR_ARTI("no space left in callstack\n");
+      return false;
+    }
+
+    ArtiFrame &frame = state->frames[state->framesIndex++];
+    frame.returnAddress = returnAddress;
+    frame.base = state->variablesIndex;
+    frame.nesting_level = function.nesting_level;
+
+    float *locals = state->variables + frame.base;
+    memset(locals, 0, function.nrOfLocals * sizeof(float));
+    for (uint8_t i = 0; i < nrOfActuals && i < function.nrOfFormals; i++)
+      locals[i] = actuals[i];
+
+    state->variablesIndex += function.nrOfLocals;
+
+    if (state->framesIndex > stats.maxFrames)
+      stats.maxFrames = state->framesIndex;
+    if (state->variablesIndex > stats.maxVariables)
+      stats.maxVariables = state->variablesIndex;
+    return true;
+  }
+
+  //run bytecode from pc until OP_Halt or until the frame exitFrame returns
+  bool run(uint16_t pc, uint8_t exitFrame)
+  {
+    const uint8_t *code = program->code;
+    const float *constants = program->constants;
+    float *stack = state->stack;
+    float *variables = state->variables;
+    uint8_t sp = state->stack_index;
+    uint8_t base = state->frames[state->framesIndex - 1].base;
+
+    if (sp + program->maxStack > arrayLength) //calls are checked by pushFrame
+    {
+      context.errorOccurred = true;
+      ERROR_ARTI("no space left on stack\n");
+      return false;
+    }
+
+    while (true)
+    {
+      switch (code[pc++])
+      {
+        case OP_Halt:
+          state->stack_index = sp;
+          return true;
+        case OP_Const:
+          stack[sp++] = constants[code[pc++]];
+          break;
+        case OP_LoadGlobal:
+          stack[sp++] = variables[code[pc++]];
+          break;
+        case OP_StoreGlobal:
+          variables[code[pc++]] = stack[--sp];
+          break;
+        case OP_LoadLocal:
+          stack[sp++] = variables[base + code[pc++]];
+          break;
+        case OP_StoreLocal:
+          variables[base + code[pc++]] = stack[--sp];
+          break;
+        case OP_Load:
+        {
+          float *var = variable(code[pc], code[pc + 1]);
+          pc += 2;
+          stack[sp++] = (var != nullptr)?*var:0;
+          break;
+        }
+        case OP_Store:
+        {
+          float *var = variable(code[pc], code[pc + 1]);
+          pc += 2;
+          sp--;
+          if (var != nullptr)
+            *var = stack[sp];
+          break;
+        }
+        case OP_GetExternal:
+        {
+          uint8_t external = code[pc];
+          uint8_t nrOfIndices = code[pc + 1];
+          pc += 2;
+          sp -= nrOfIndices;
+          float result = arti_get_external_variable(external, (nrOfIndices>0)?stack[sp]:floatNull, (nrOfIndices>1)?stack[sp+1]:floatNull);
+          if (result == floatNull)
+          {
+            ERROR_ARTI("Error: ext %u no value\n", external);
+            result = 0;
+          }
+          stack[sp++] = result;
+          if (context.errorOccurred) {state->stack_index = sp; return false;}
+          break;
+        }
+        case OP_SetExternal:
+        {
+          uint8_t external = code[pc];
+          uint8_t nrOfIndices = code[pc + 1];
+          pc += 2;
+          sp -= nrOfIndices + 1;
+          arti_set_external_variable(stack[sp], external, (nrOfIndices>0)?stack[sp+1]:floatNull, (nrOfIndices>1)?stack[sp+2]:floatNull);
+          if (context.errorOccurred) {state->stack_index = sp; return false;}
+          break;
+        }
+        case OP_CallExternal:
+        case OP_CallExternalVoid:
+        {
+          bool resultUsed = code[pc - 1] == OP_CallExternal;
+          uint8_t external = code[pc];
+          uint8_t nrOfActuals = code[pc + 1];
+          pc += 2;
+          sp -= nrOfActuals;
+          float result = arti_external_function(external, (nrOfActuals>0)?stack[sp]:floatNull
+                                                        , (nrOfActuals>1)?stack[sp+1]:floatNull
+                                                        , (nrOfActuals>2)?stack[sp+2]:floatNull
+                                                        , (nrOfActuals>3)?stack[sp+3]:floatNull
+                                                        , (nrOfActuals>4)?stack[sp+4]:floatNull);
+          if (resultUsed)
+            stack[sp++] = (result != floatNull)?result:0;
+          if (context.errorOccurred) {state->stack_index = sp; return false;}
+          break;
+        }
+        case OP_Call:
+        {
+          const ArtiFunction &function = program->functions[code[pc]];
+          uint8_t nrOfActuals = code[pc + 1];
+          pc += 2;
+          sp -= nrOfActuals;
+          if (!pushFrame(function, stack + sp, nrOfActuals, pc, sp)) {state->stack_index = sp; return false;}
+          base = state->frames[state->framesIndex - 1].base;
+          pc = function.address;
+          break;
+        }
+        case OP_Return:
+        {
+          ArtiFrame &frame = state->frames[--state->framesIndex];
+          state->variablesIndex = frame.base;
+          pc = frame.returnAddress;
+          if (state->framesIndex <= exitFrame)
+          {
+            state->stack_index = sp;
+            return true;
+          }
+          base = state->frames[state->framesIndex - 1].base;
+          break;
+        }
+        case OP_Add:
+          sp--;
+          stack[sp-1] += stack[sp];
+          break;
+        case OP_Subtract:
+          sp--;
+          stack[sp-1] -= stack[sp];
+          break;
+        case OP_Multiply:
+          sp--;
+          stack[sp-1] *= stack[sp];
+          break;
+        case OP_Divide:
+          sp--;
+          if (stack[sp] == 0)
+            ERROR_ARTI("division by 0 not possible, divisor ignored for %f\n", stack[sp-1]);
+          else
+            stack[sp-1] /= stack[sp];
+          break;
+        case OP_Modulo:
+          sp--;
+          if (stack[sp] == 0)
+            ERROR_ARTI("mod 0 not possible, mod ignored %f\n", stack[sp-1]);
+          else
+            stack[sp-1] = fmod(stack[sp-1], stack[sp]);
+          break;
+        case OP_BitShiftLeft:
+          sp--;
+          stack[sp-1] = (int)stack[sp-1] << (int)stack[sp]; //only works on integers
+          break;
+        case OP_BitShiftRight:
+          sp--;
+          stack[sp-1] = (int)stack[sp-1] >> (int)stack[sp]; //only works on integers
+          break;
+        case OP_Equal:
+          sp--;
+          stack[sp-1] = stack[sp-1] == stack[sp];
+          break;
+        case OP_NotEqual:
+          sp--;
+          stack[sp-1] = stack[sp-1] != stack[sp];
+          break;
+        case OP_LessThen:
+          sp--;
+          stack[sp-1] = stack[sp-1] < stack[sp];
+          break;
+        case OP_LessThenOrEqual:
+          sp--;
+          stack[sp-1] = stack[sp-1] <= stack[sp];
+          break;
+        case OP_GreaterThen:
+          sp--;
+          stack[sp-1] = stack[sp-1] > stack[sp];
+          break;
+        case OP_GreaterThenOrEqual:
+          sp--;
+          stack[sp-1] = stack[sp-1] >= stack[sp];
+          break;
+        case OP_And:
+          sp--;
+          stack[sp-1] = stack[sp-1] && stack[sp];
+          break;
+        case OP_Or:
+          sp--;
+          stack[sp-1] = stack[sp-1] || stack[sp];
+          break;
+        case OP_Negate:
+          stack[sp-1] = -stack[sp-1];
+          break;
+        case OP_Jump:
+          pc = code[pc] | (code[pc + 1] << 8);
+          break;
+        case OP_JumpIfNotTrue:
+          if (stack[--sp] != 1)
+            pc = code[pc] | (code[pc + 1] << 8);
+          else
+            pc += 2;
+          break;
+        case OP_ForInit:
+          stack[sp++] = 0; //iterations
+          stack[sp++] = 0; //mode, 1 if the condition is a value (e.g. in pascal)
+          break;
+        case OP_ForTest:
+        {
+          float conditionResult = stack[--sp];
+          bool runBlock = false;
+          if (conditionResult == 1)
+          {
+            stack[sp-1] = 0;
+            runBlock = true;
+          }
+          else if (conditionResult != 0) // conditionResult is a value (e.g. in pascal)
+          {
+            float *var = (code[pc] != variableNone)?variable(code[pc], code[pc + 1]):nullptr;
+            if (var != nullptr && *var <= conditionResult)
+            {
+              stack[sp-1] = 1;
+              runBlock = true;
+            }
+          }
+          if (runBlock)
+            pc += 4;
+          else
+            pc = code[pc + 2] | (code[pc + 3] << 8);
+          break;
+        }
+        case OP_ForNext:
+          if (stack[sp-1] == 1) //increment the loop variable instead of the increment statement
+          {
+            float *var = variable(code[pc], code[pc + 1]);
+            if (var != nullptr)
+              *var += 1;
+            pc = code[pc + 2] | (code[pc + 3] << 8);
+          }
+          else
+            pc += 4;
+          break;
+        case OP_ForLoop:
+          if (++stack[sp-2] < nrOfIterations)
+            pc = code[pc] | (code[pc + 1] << 8);
+          else
+          {
+            ERROR_ARTI("too many iterations in for loop %u\n", nrOfIterations);
+            pc += 2;
+          }
+          break;
+        case OP_ForEnd:
+          sp -= 2;
+          break;
+        default:
+          ERROR_ARTI("Programming error: unknown opcode %u at %u\n", code[pc - 1], pc - 1);
+          context.errorOccurred = true;
+          state->stack_index = sp;
+          return false;
+      }
+    }
+  } //run
+
+  //run a function of the program (e.g. renderFrame or renderLed) with actuals set from outside
+  bool callFunction(uint8_t function, const float * actuals = nullptr, uint8_t nrOfActuals = 0)
+  {
+    if (!pushFrame(program->functions[function], actuals, nrOfActuals, 0, state->stack_index)) return false;
+    return run(program->functions[function].address, state->framesIndex - 1);
+  }
+
+  //FNV-1a, used to check if a compiled program belongs to the definition and program text
+  uint32_t hashBytes(const uint8_t * bytes, size_t length, uint32_t hash = 2166136261UL)
+  {
+    for (size_t i = 0; i < length; i++)
+      hash = (hash ^ bytes[i]) * 16777619UL;
+    return hash;
+  }
+
+  uint32_t hashFile(const char * fileName, uint32_t hash)
+  {
+    uint8_t buffer[64];
+    #if ARTI_PLATFORM == ARTI_ARDUINO
+      File file = LITTLEFS.open(fileName, "r");
+      if (!file) return hash;
+      size_t length;
+      while ((length = file.read(buffer, sizeof(buffer))) > 0)
+        hash = hashBytes(buffer, length, hash);
+    #else
+      std::fstream file;
+      file.open(fileName, std::ios::in | std::ios::binary);
+      if (!file) return hash;
+      while (file.read((char *)buffer, sizeof(buffer)) || file.gcount() > 0)
+        hash = hashBytes(buffer, file.gcount(), hash);
+    #endif
+    file.close();
+    return hash;
+  }
+
+  //load a compiled program, returns false if not there or not matching the hash (then compile again)
+  bool loadProgram(const char * codeFileName, uint32_t hash)
+  {
+    #if ARTI_PLATFORM == ARTI_ARDUINO
+      File codeFile = LITTLEFS.open(codeFileName, "r");
+      #define readCode(buffer, length) (codeFile.read((uint8_t *)(buffer), length) == (length))
+    #else
+      std::fstream codeFile;
+      codeFile.open(codeFileName, std::ios::in | std::ios::binary);
+      #define readCode(buffer, length) ((bool)codeFile.read((char *)(buffer), length))
+    #endif
+    if (!codeFile) return false;
+
+    ArtiCodeHeader header;
+    bool loaded = readCode(&header, sizeof(header)) && strncmp(header.magic, "ARTI", 4) == 0 && header.version == ARTI_CODE_VERSION && header.hash == hash
+                  && header.constantsIndex <= nrOfConstants && header.functionsIndex <= nrOfFunctions && header.maxStack <= arrayLength
+                  && header.nrOfGlobals <= nrOfStateVariables;
+
+    if (loaded)
+    {
+      program = new ArtiProgram();
+      program->constantsIndex = header.constantsIndex;
+      program->functionsIndex = header.functionsIndex;
+      program->renderFrame = header.renderFrame;
+      program->renderLed = header.renderLed;
+      program->nrOfGlobals = header.nrOfGlobals;
+      program->maxStack = header.maxStack;
+      program->framePrologue = header.framePrologue;
+      program->code = (uint8_t *)malloc(header.codeSize);
+      program->codeSize = program->codeCapacity = header.codeSize;
+
+      loaded = program->code != nullptr && readCode(program->functions, header.functionsIndex * sizeof(ArtiFunction)) 
+                && readCode(program->constants, header.constantsIndex * sizeof(float)) && readCode(program->code, header.codeSize);
+
+      if (loaded && !verifyProgram())
+      {
+        WARNING_ARTI("Compiled program %s not valid, compile again\n", codeFileName);
+        loaded = false;
+      }
+
+      if (!loaded) {delete program; program = nullptr;}
+    }
+    #undef readCode
+    codeFile.close();
+
+    return loaded;
+  }
+
+  //bytes of an instruction including its operands, 0 if not an opcode
+  uint8_t instructionLength(uint8_t opcode)
+  {
+    switch (opcode)
+    {
+      case OP_Const: case OP_LoadGlobal: case OP_StoreGlobal: case OP_LoadLocal: case OP_StoreLocal:
+        return 2;
+      case OP_Load: case OP_Store: case OP_GetExternal: case OP_SetExternal: case OP_CallExternal: case OP_CallExternalVoid:
+      case OP_Call: case OP_Jump: case OP_JumpIfNotTrue: case OP_ForLoop:
+        return 3;
+      case OP_ForTest: case OP_ForNext:
+        return 5;
+      default:
+        return opcode <= OP_ForEnd?1:0;
+    }
+  }
+
+  //locals of the frames a variable of this nesting level can be in, the program frame (level 1) has the globals
+  uint8_t localsOfLevel(uint8_t level)
+  {
+    if (level == 1) return program->nrOfGlobals;
+    uint8_t locals = 0;
+    for (uint8_t i = 0; i < program->functionsIndex; i++)
+      if (program->functions[i].nesting_level == level && program->functions[i].nrOfLocals > locals)
+        locals = program->functions[i].nrOfLocals;
+    return locals;
+  }
+
+  //a loaded program runs without checks on its operands: all indices must be within the tables of the program and
+  //the variables of ArtiState, jumps must go to an instruction of their block and every block must end, else it is compiled again.
+  //Blocks are laid out as compileProgram writes them: main, the functions in order, then the frame prologue.
+  //The stack depth is counted as compileProgram counts it: a block starts and ends (Halt, Return) with an empty stack,
+  //no instruction takes more values than there are or pushes beyond maxStack, and jumps arrive with the depth of their target.
+  bool verifyProgram()
+  {
+    const uint8_t *code = program->code;
+    uint16_t size = program->codeSize;
+    uint8_t functionsIndex = program->functionsIndex;
+
+    if (size == 0 || program->nrOfGlobals == 0 || program->nrOfGlobals > nrOfStateVariables) return false;
+    if ((program->renderFrame != functionNone && program->renderFrame >= functionsIndex) || (program->renderLed != functionNone && program->renderLed >= functionsIndex)) return false;
+
+    //block b ends where block b+1 starts, blocks are not empty
+    uint16_t blockEnds[nrOfFunctions + 2];
+    for (uint8_t i = 0; i < functionsIndex; i++)
+    {
+      const ArtiFunction &function = program->functions[i];
+      if (function.nrOfFormals > function.nrOfLocals || function.nrOfLocals > nrOfStateVariables - program->nrOfGlobals) return false;
+      if (function.address <= (i > 0?program->functions[i - 1].address:0)) return false;
+      blockEnds[i] = function.address;
+    }
+    blockEnds[functionsIndex] = program->framePrologue?program->framePrologue:size;
+    blockEnds[functionsIndex + 1] = size;
+    if (blockEnds[functionsIndex] <= (functionsIndex > 0?blockEnds[functionsIndex - 1]:0) || blockEnds[functionsIndex] > size) return false;
+
+    uint8_t *instructions = (uint8_t *)calloc(size / 8 + 1, 1); //bit per address, set where an instruction starts
+    if (instructions == nullptr) return false;
+
+    bool valid = true;
+    uint8_t block = 0;
+    uint8_t lastOpcode = OP_Halt;
+    for (uint16_t pc = 0; valid && pc < size; )
+    {
+      uint8_t opcode = code[pc];
+      uint8_t length = instructionLength(opcode);
+      bool programFrame = block == 0 || block > functionsIndex; //main and the frame prologue run in the program frame
+      uint8_t locals = programFrame?program->nrOfGlobals:program->functions[block - 1].nrOfLocals;
+      valid = length > 0 && pc + length <= blockEnds[block];
+      if (valid) switch (opcode)
+      {
+        case OP_Const: valid = code[pc + 1] < program->constantsIndex; break;
+        case OP_LoadGlobal: case OP_StoreGlobal: valid = code[pc + 1] < program->nrOfGlobals; break;
+        case OP_LoadLocal: case OP_StoreLocal: valid = code[pc + 1] < locals; break;
+        case OP_Load: case OP_Store: valid = code[pc + 2] < (code[pc + 1] == 0?locals:localsOfLevel(code[pc + 1])); break;
+        case OP_ForTest: case OP_ForNext: valid = code[pc + 1] == variableNone || code[pc + 2] < (code[pc + 1] == 0?locals:localsOfLevel(code[pc + 1])); break;
+        case OP_Call: valid = code[pc + 1] < functionsIndex; break;
+      }
+      instructions[pc >> 3] |= 1 << (pc & 7);
+      lastOpcode = opcode;
+      pc += length;
+      if (valid && pc == blockEnds[block])
+      {
+        valid = lastOpcode == (programFrame?OP_Halt:OP_Return);
+        block++;
+      }
+    }
+
+    //jump targets and stack depths, now that all instructions are known
+    uint8_t *depths = valid?(uint8_t *)malloc(size):nullptr; //depth before each instruction, depthNone if not reached (yet)
+    const uint8_t depthNone = 0xFF;
+    if (depths != nullptr)
+      memset(depths, depthNone, size);
+    else
+      valid = false;
+    block = 0;
+    uint16_t blockStart = 0;
+    int16_t depth = 0; //-1 if the previous instruction does not continue with this one
+    for (uint16_t pc = 0; valid && pc < size; pc += instructionLength(code[pc]))
+    {
+      while (pc == blockEnds[block])
+      {
+        blockStart = pc;
+        block++;
+        depth = 0;
+      }
+      if (depths[pc] != depthNone)
+      {
+        valid = depth < 0 || depth == depths[pc];
+        depth = depths[pc];
+      }
+
+      uint8_t opcode = code[pc];
+      int16_t pops = 0, pushes = 0;
+      switch (opcode)
+      {
+        case OP_Const: case OP_LoadGlobal: case OP_LoadLocal: case OP_Load: pushes = 1; break;
+        case OP_StoreGlobal: case OP_StoreLocal: case OP_Store: case OP_JumpIfNotTrue: pops = 1; break;
+        case OP_GetExternal: case OP_CallExternal: pops = code[pc + 2]; pushes = 1; break;
+        case OP_SetExternal: pops = code[pc + 2] + 1; break;
+        case OP_CallExternalVoid: case OP_Call: pops = code[pc + 2]; break;
+        case OP_Negate: pops = pushes = 1; break;
+        case OP_ForInit: pushes = 2; break;
+        case OP_ForTest: pops = 3; pushes = 2; break; //condition above mode and iterations
+        case OP_ForNext: case OP_ForLoop: pops = pushes = 2; break;
+        case OP_ForEnd: pops = 2; break;
+        default: if (opcode >= OP_Add && opcode <= OP_Or) {pops = 2; pushes = 1;} break;
+      }
+      if (valid && depth >= 0)
+      {
+        depths[pc] = depth;
+        valid = depth >= pops && depth - pops + pushes <= program->maxStack;
+        depth += pushes - pops;
+      }
+
+      uint8_t at = 0;
+      switch (opcode)
+      {
+        case OP_Jump: case OP_JumpIfNotTrue: case OP_ForLoop: at = 1; break;
+        case OP_ForTest: case OP_ForNext: at = 3; break;
+      }
+      if (valid && at)
+      {
+        uint16_t target = code[pc + at] | (code[pc + at + 1] << 8);
+        valid = target >= blockStart && target < blockEnds[block] && (instructions[target >> 3] & (1 << (target & 7)));
+        if (valid && depth >= 0)
+        {
+          if (target <= pc) //backward, the target has been reached before
+            valid = depths[target] == depth;
+          else if (depths[target] == depthNone)
+            depths[target] = depth;
+          else
+            valid = depths[target] == depth;
+        }
+      }
+
+      if (opcode == OP_Halt || opcode == OP_Return)
+      {
+        if (valid && depth >= 0)
+          valid = depth == 0;
+        depth = -1;
+      }
+      else if (opcode == OP_Jump)
+        depth = -1;
+    }
+
+    free(depths);
+    free(instructions);
+    return valid;
+  }
+
+  void saveProgram(const char * codeFileName, uint32_t hash)
+  {
+    ArtiCodeHeader header;
+    memcpy(header.magic, "ARTI", 4);
+    header.version = ARTI_CODE_VERSION;
+    header.constantsIndex = program->constantsIndex;
+    header.functionsIndex = program->functionsIndex;
+    header.renderFrame = program->renderFrame;
+    header.renderLed = program->renderLed;
+    header.nrOfGlobals = program->nrOfGlobals;
+    header.maxStack = program->maxStack;
+    header.reserved = 0;
+    header.hash = hash;
+    header.codeSize = program->codeSize;
+    header.framePrologue = program->framePrologue;
+
+    #if ARTI_PLATFORM == ARTI_ARDUINO
+      File codeFile = LITTLEFS.open(codeFileName, "w");
+      #define writeCode(buffer, length) codeFile.write((const uint8_t *)(buffer), length)
+    #else
+      std::fstream codeFile;
+      codeFile.open(codeFileName, std::ios::out | std::ios::binary);
+      #define writeCode(buffer, length) codeFile.write((const char *)(buffer), length)
+    #endif
+    if (!codeFile)
+    {
+      ERROR_ARTI("Compiled program %s not saved\n", codeFileName);
+      return;
+    }
+
+    writeCode(&header, sizeof(header));
+    writeCode(program->functions, program->functionsIndex * sizeof(ArtiFunction));
+    writeCode(program->constants, program->constantsIndex * sizeof(float));
+    writeCode(program->code, program->codeSize);
+    #undef writeCode
+    codeFile.close();
+  }
+
+  void sampleHeap()
+  {
+    if (FREE_SIZE < stats.minFreeHeap)
+      stats.minFreeHeap = FREE_SIZE;
+    if (parseTreeJsonDoc != nullptr && parseTreeJsonDoc->memoryUsage() > stats.parseTreeBytes)
+      stats.parseTreeBytes = parseTreeJsonDoc->memoryUsage();
+  }
+
+  void logStats()
+  {
+    if (program == nullptr) return;
+    MEMORY_ARTI("stats %s %u us, parse %u us, heap min %u, parseTree %u bytes, program %u bytes, state %u bytes\n", stats.loaded?"load":"compile", stats.setupMicros, stats.parseMicros
+                , stats.minFreeHeap, stats.parseTreeBytes, (unsigned int)(sizeof(ArtiProgram) + program->codeCapacity), (unsigned int)sizeof(ArtiState));
+    MEMORY_ARTI("stats %u frames, %u us/frame, max %u us, stack %u of %u, calls %u of %u, variables %u of %u\n", stats.frames, stats.frames?stats.frameMicros / stats.frames:0, stats.maxFrameMicros
+                , program->maxStack, arrayLength, stats.maxFrames, nrOfRecords, stats.maxVariables, nrOfStateVariables);
+  }
+
+  //start a new instance of the program in newState (e.g. in SEGENV.data, zero initialized), main sets the globals
+  bool newState(ArtiState *newState)
+  {
+    artiContext = &context;
+    if (program == nullptr) return false;
+    if (ownState != nullptr && newState != ownState)
+    {
+      delete ownState; ownState = nullptr;
+    }
+
+    context.errorOccurred = false;
+    state = newState;
+    state->stack_index = 0;
+    state->frameCounter = 0;
+    state->frames[0].returnAddress = 0;
+    state->frames[0].base = 0;
+    state->frames[0].nesting_level = 1; //program level
+    state->framesIndex = 1;
+    state->variablesIndex = program->nrOfGlobals;
+    memset(state->variables, 0, program->nrOfGlobals * sizeof(float));
+    stats.maxFrames = 1;
+    stats.maxVariables = program->nrOfGlobals;
+
+    if (!run(0, 0))
+    {
+      ERROR_ARTI("Run main failed\n");
+      return false;
+    }
+
+    MEMORY_ARTI("Run main %u ✓\n", FREE_SIZE);
+
+    return !context.errorOccurred;
+  }
+
+  //continue an instance started with newState
+  void useState(ArtiState *newState)
+  {
+    artiContext = &context;
+    state = newState;
+  }
 
   void closeLog() 
   {
+    artiContext = &context;
     //non arduino stops log here
     #if ARTI_PLATFORM == ARTI_ARDUINO
-      if (logToFile) 
+      if (context.logToFile) 
       {
-        logFile.close();
-        logToFile = false;
+        context.logFile.close();
+        context.logToFile = false;
       }
     #else
-      if (logToFile)
+      if (context.logToFile)
       {
-        fclose(logFile);
-        logToFile = false;
+        fclose(context.logFile);
+        context.logToFile = false;
       }
     #endif
   }
 
   bool setup(const char *definitionName, const char *programName)
   {
-    errorOccurred = false;
-    frameCounter = 0;
+    artiContext = &context;
+    context.errorOccurred = false;
+    stats = ArtiStats();
+    uint32_t setupStart = micros();
 
-    logToFile = true;
+    context.logToFile = true;
     //open logFile
-    if (logToFile)
+    if (context.logToFile)
     {
       #if ARTI_PLATFORM == ARTI_ARDUINO
         strcpy(logFileName, "/");
@@ -2451,9 +3350,9 @@ public:
       strcat(logFileName, ".log");
 
       #if ARTI_PLATFORM == ARTI_ARDUINO
-        logFile = LITTLEFS.open(logFileName,"w");
+        context.logFile = LITTLEFS.open(logFileName,"w");
       #else
-        logFile = fopen (logFileName,"w");
+        context.logFile = fopen (logFileName,"w");
       #endif
     }
 
@@ -2462,6 +3361,69 @@ public:
     if (stages < 1) {close(); return true;}
     bool loadParseTreeFile = false;
 
+    #if ARTI_PLATFORM == ARTI_ARDUINO
+      File programFile;
+      programFile = LITTLEFS.open(programName, "r");
+    #else
+      std::fstream programFile;
+      programFile.open(programName, std::ios::in);
+    #endif
+    MEMORY_ARTI("open %s %u ✓\n", programName, FREE_SIZE);
+    if (!programFile) 
+    {
+      ERROR_ARTI("Program file %s not found\n", programName);
+      return  false;
+    }
+
+    //open programFile
+    char * programText;
+    uint16_t programFileSize;
+    #if ARTI_PLATFORM == ARTI_ARDUINO
+      programFileSize = programFile.size();
+      programText = (char *)malloc(programFileSize+1);
+      programFile.read((byte *)programText, programFileSize);
+      programText[programFileSize] = '\0';
+    #else
+      programText = (char *)malloc(programTextSize);
+      programFile.read(programText, programTextSize);
+      DEBUG_ARTI("programFile size %lu bytes\n", programFile.gcount());
+      programText[programFile.gcount()] = '\0';
+      programFileSize = strlen(programText);
+    #endif
+    programFile.close();
+
+    //use the compiled program if definition and program did not change since last compile
+    char codeFileName[fileNameLength];
+    strcpy(codeFileName, programName);
+    char * extension = strrchr(codeFileName, '.');
+    if (extension != nullptr)
+      *extension = '\0';
+    strcat(codeFileName, ".artic");
+
+    uint32_t hash = hashBytes((const uint8_t *)programText, programFileSize, hashFile(definitionName, 2166136261UL));
+
+    if (stages >= 5 && loadProgram(codeFileName, hash))
+    {
+      #if ARTI_PLATFORM == ARTI_ARDUINO //not on windows as cause crash???
+        free(programText);
+      #endif
+      MEMORY_ARTI("load %s %u bytes, %u constants, %u functions %u ✓\n", codeFileName, program->codeSize, program->constantsIndex, program->functionsIndex, FREE_SIZE);
+      sampleHeap();
+      stats.loaded = true;
+      stats.setupMicros = micros() - setupStart;
+      return newState(ownState = new ArtiState());
+    }
+
+    #if ARTI_PLATFORM == ARTI_ARDUINO
+      if (FREE_SIZE < compileHeapSize)
+      {
+        ERROR_ARTI("Not enough free heap to compile %s (%u < %u)\n", programName, FREE_SIZE, compileHeapSize);
+        notEnoughHeap = true;
+        free(programText);
+        return false;
+      }
+    #endif
+
     #if ARTI_PLATFORM == ARTI_ARDUINO
       File definitionFile;
       definitionFile = LITTLEFS.open(definitionName, "r");
@@ -2516,36 +3478,6 @@ public:
       return false;
     }
 
-    #if ARTI_PLATFORM == ARTI_ARDUINO
-      File programFile;
-      programFile = LITTLEFS.open(programName, "r");
-    #else
-      std::fstream programFile;
-      programFile.open(programName, std::ios::in);
-    #endif
-    MEMORY_ARTI("open %s %u ✓\n", programName, FREE_SIZE);
-    if (!programFile) 
-    {
-      ERROR_ARTI("Program file %s not found\n", programName);
-      return  false;
-    }
-
-    //open programFile
-    char * programText;
-    uint16_t programFileSize;
-    #if ARTI_PLATFORM == ARTI_ARDUINO
-      programFileSize = programFile.size();
-      programText = (char *)malloc(programFileSize+1);
-      programFile.read((byte *)programText, programFileSize);
-      programText[programFileSize] = '\0';
-    #else
-      programText = (char *)malloc(programTextSize);
-      programFile.read(programText, programTextSize);
-      DEBUG_ARTI("programFile size %lu bytes\n", programFile.gcount());
-      programText[programFile.gcount()] = '\0';
-      programFileSize = strlen(programText);
-    #endif
-    programFile.close();
 
     char parseTreeName[fileNameLength];
     strcpy(parseTreeName, programName);
@@ -2578,6 +3510,7 @@ public:
     {
       parseTreeJson = parseTreeJsonDoc->as<JsonVariant>();
 
+      uint32_t parseStart = micros();
       lexer = new Lexer(programText, definitionJson);
       lexer->get_next_token();
 
@@ -2598,7 +3531,9 @@ public:
       else
       {
         DEBUG_ARTI("Node %s Parsed until (%u,%u) %u of %u\n", startNode, this->lexer->lineno, this->lexer->column, this->lexer->pos, (unsigned int)strlen(this->lexer->text));
+        stats.parseMicros = micros() - parseStart;
         MEMORY_ARTI("parse %u ✓\n", FREE_SIZE);
+        sampleHeap();
       }
 
       MEMORY_ARTI("definitionTree %u / %u%% (%u %u %u)\n", (unsigned int)definitionJsonDoc->memoryUsage(), 100 * definitionJsonDoc->memoryUsage() / definitionJsonDoc->capacity(), (unsigned int)definitionJsonDoc->size(), definitionJsonDoc->overflowed(), (unsigned int)definitionJsonDoc->nesting());
@@ -2646,10 +3581,13 @@ public:
         if (!analyze(parseTreeJson)) 
         {
           ERROR_ARTI("Analyze failed\n");
-          errorOccurred = true;
+          context.errorOccurred = true;
         }
         else
+        {
           MEMORY_ARTI("analyze %u ✓\n", FREE_SIZE);
+          sampleHeap();
+        }
       }
     }
 
@@ -2663,38 +3601,45 @@ public:
       parseTreeFile.close();
     #endif
 
-    if (stages < 5 || errorOccurred) {close(); return !errorOccurred;}
-
-    //interpret main
-    callStack = new CallStack();
-    valueStack = new ValueStack();
+    if (stages < 5 || context.errorOccurred) {close(); return !context.errorOccurred;}
 
-    if (global_scope != nullptr) //due to undefined functions??? wip
-    { 
-      RUNLOG_ARTI("\ninterpret %s %u %u\n", global_scope->scope_name, global_scope->scope_level, global_scope->symbolsIndex); 
-
-      if (!interpret(parseTreeJson)) 
-      {
-        ERROR_ARTI("Interpret main failed\n");
-        return false;
-      }
+    if (global_scope == nullptr) //due to undefined functions??? wip
+    {
+      ERROR_ARTI("\nCompile global scope is nullptr\n");
+      return false;
     }
-    else
+
+    //compile to bytecode
+    if (!compileProgram())
     {
-      ERROR_ARTI("\nInterpret global scope is nullptr\n");
+      ERROR_ARTI("Compile failed\n");
       return false;
     }
 
-    MEMORY_ARTI("Interpret main %u ✓\n", FREE_SIZE);
- 
-    return !errorOccurred;
+    MEMORY_ARTI("compile %u bytes, %u constants, %u functions, stack %u %u ✓\n", program->codeSize, program->constantsIndex, program->functionsIndex, program->maxStack, FREE_SIZE);
+    sampleHeap();
+
+    saveProgram(codeFileName, hash);
+
+    //parseTree, definition and symbol tables are not needed to run the program
+    delete parseTreeJsonDoc; parseTreeJsonDoc = nullptr;
+    delete definitionJsonDoc; definitionJsonDoc = nullptr;
+    delete global_scope; global_scope = nullptr;
+    MEMORY_ARTI("free compile memory %u ✓\n", FREE_SIZE);
+
+    stats.setupMicros = micros() - setupStart;
+    return newState(ownState = new ArtiState());
   } // setup
 
   void close() {
+    artiContext = &context;
+    if (context.logToFile)
+      logStats();
     MEMORY_ARTI("closing Arti %u\n", FREE_SIZE);
 
-    if (callStack != nullptr) {delete callStack; callStack = nullptr;}
-    if (valueStack != nullptr) {delete valueStack; valueStack = nullptr;}
+    if (ownState != nullptr) {delete ownState; ownState = nullptr;}
+    state = nullptr;
+    if (program != nullptr) {delete program; program = nullptr;}
     if (global_scope != nullptr) {delete global_scope; global_scope = nullptr;}
 
     if (definitionJsonDoc != nullptr) {
@@ -2714,5 +3659,6 @@ public:
     #if ARTI_PLATFORM == ARTI_ARDUINO
       LITTLEFS.remove(logFileName); //cleanup the /edit folder a bit
     #endif
+    artiContext = &artiConsole; //this instance may be deleted now
   }
 }; //ARTI
\ No newline at end of file
@@ -30,6 +30,7 @@
   #include <string.h>
   #include <stdlib.h>
   #include <stdio.h>
+  #include <vector>
 #endif
 
 //make sure the numbers here correspond to the order in which these functions are defined in wled.json!!
@@ -91,9 +92,24 @@ enum Externals
 };
 
 #if ARTI_PLATFORM != ARTI_ARDUINO
+  // Records what a program does to the leds instead of showing it: setPixelColor, fill, setRange, shift and leds
+  // write the values the program calculated into pixels, so the output can be compared frame by frame (see test/host/arti)
   class WS2812FX {
   public:
-    uint16_t matrixWidth = 16, matrixHeight = 16;
+    uint16_t matrixWidth = 3, matrixHeight = 1;
+    uint16_t ledCount = 3;
+    std::vector<float> pixels = std::vector<float>(3);
+    uint16_t setPixelsCalls = 0;
+    uint32_t now = 1000; //millis, advanced by the caller
+
+    void resize(uint16_t width, uint16_t height)
+    {
+      matrixWidth = width;
+      matrixHeight = height;
+      ledCount = width * height;
+      pixels.assign(ledCount, 0);
+      setPixelsCalls = 0;
+    }
 
     uint16_t XY(uint16_t x, uint16_t y)
     {
@@ -102,7 +118,7 @@ enum Externals
 
     uint32_t millis()
     {
-      return 1000; // no millis defined for non embedded yet
+      return now;
     }
 
     float arti_external_function(uint8_t function, float par1 = floatNull, float par2 = floatNull, float par3 = floatNull, float par4 = floatNull, float par5 = floatNull);
@@ -123,6 +139,10 @@ float ARTI::arti_external_function(uint8_t function, float par1, float par2, flo
 
 float ARTI::arti_get_external_variable(uint8_t variable, float par1, float par2, float par3)
 {
+  #if ARTI_PLATFORM != ARTI_ARDUINO
+    if (variable == F_counter) //on arduino the call counter of the segment
+      return state->frameCounter;
+  #endif
   return strip.arti_get_external_variable(variable, par1, par2, par3);
 }
 
@@ -131,6 +151,52 @@ void ARTI::arti_set_external_variable(float value, uint8_t variable, float par1,
   strip.arti_set_external_variable(value, variable, par1, par2, par3);
 }
 
+//used by the compiler to evaluate expressions in renderLed once per frame instead of for every led
+bool ARTI::arti_external_per_frame(uint8_t external)
+{
+  switch (external)
+  {
+    case F_ledCount:
+    case F_matrixWidth:
+    case F_matrixHeight:
+    case F_hsv:
+    case F_colorBlend:
+    case F_colorWheel:
+    case F_colorFromPalette:
+    case F_beatSin:
+    case F_iNoise:
+    case F_counter:
+    case F_segcolor:
+    case F_speedSlider:
+    case F_intensitySlider:
+    case F_custom1Slider:
+    case F_custom2Slider:
+    case F_custom3Slider:
+    case F_sampleAvg:
+    case F_circle2D:
+    case F_constrain:
+    case F_map:
+    case F_sin:
+    case F_cos:
+    case F_abs:
+    case F_min:
+    case F_max:
+    case F_floor:
+    case F_hour:
+    case F_minute:
+    case F_second:
+    case F_millis: //one time for all leds of a frame
+    case F_time:
+    case F_triangle:
+    case F_wave:
+    case F_square:
+    case F_clamp:
+      return true;
+    default: //leds changes while rendering, random, seed, printf and setting leds have side effects
+      return false;
+  }
+}
+
 float WS2812FX::arti_external_function(uint8_t function, float par1, float par2, float par3, float par4, float par5) { 
   // MEMORY_ARTI("fun %d(%f, %f, %f)\n", function, par1, par2, par3);
   #if ARTI_PLATFORM == ARTI_ARDUINO
@@ -221,19 +287,25 @@ float WS2812FX::arti_external_function(uint8_t function, float par1, float par2,
     switch (function)
     {
       case F_setPixelColor:
-        PRINT_ARTI("%s(%f, %f)\n", "setPixelColor", par1, par2);
+        RUNLOG_ARTI("%s(%f, %f)\n", "setPixelColor", par1, par2);
+        pixels[((uint16_t)par1)%ledCount] = par2;
         return floatNull;
       case F_setPixels:
-        PRINT_ARTI("%s\n", "setPixels(leds)");
+        RUNLOG_ARTI("%s\n", "setPixels(leds)");
+        setPixelsCalls++;
         return floatNull;
       case F_hsv:
-        PRINT_ARTI("%s(%f, %f, %f)\n", "hsv", par1, par2, par3);
+        RUNLOG_ARTI("%s(%f, %f, %f)\n", "hsv", par1, par2, par3);
         return par1 + par2 + par3;
 
       case F_setRange:
-        return par1 + par2 + par3;
+        RUNLOG_ARTI("%s(%f, %f, %f)\n", "setRange", par1, par2, par3);
+        for (uint16_t i = (uint16_t)par1; i <= (uint16_t)par2 && i < ledCount; i++)
+          pixels[i] = par3;
+        return floatNull;
       case F_fill:
-        PRINT_ARTI("%s(%f)\n", "fill", par1);
+        RUNLOG_ARTI("%s(%f)\n", "fill", par1);
+        pixels.assign(ledCount, par1);
         return floatNull;
       case F_colorBlend:
         return par1 + par2 + par3;
@@ -253,11 +325,16 @@ float WS2812FX::arti_external_function(uint8_t function, float par1, float par2,
       case F_segcolor:
         return par1;
 
-      case F_shift:
-        PRINT_ARTI("%s(%f)\n", "shift", par1);
+      case F_shift: {
+        RUNLOG_ARTI("%s(%f)\n", "shift", par1);
+        float saveFirstPixel = pixels[0];
+        for (uint16_t i=0; i<ledCount-1; i++)
+          pixels[i] = pixels[(uint16_t)(i + par1)%ledCount];
+        pixels[ledCount - 1] = saveFirstPixel;
         return floatNull;
+      }
       case F_circle2D:
-        PRINT_ARTI("%s(%f)\n", "circle2D", par1);
+        RUNLOG_ARTI("%s(%f)\n", "circle2D", par1);
         return par1 / 2;
 
       case F_constrain:
@@ -265,13 +342,14 @@ float WS2812FX::arti_external_function(uint8_t function, float par1, float par2,
       case F_map:
         return par1 + par2 + par3 + par4 + par5;
       case F_seed:
-        PRINT_ARTI("%s(%f)\n", "seed", par1);
+        RUNLOG_ARTI("%s(%f)\n", "seed", par1);
+        srand((unsigned int)par1);
         return floatNull;
       case F_random:
-        return rand();
+        return rand() & 0xFFFF;
 
       case F_millis:
-        return 1000;
+        return millis();
     }
   #endif
 
@@ -329,7 +407,7 @@ float WS2812FX::arti_external_function(uint8_t function, float par1, float par2,
   }
 
   ERROR_ARTI("Error: arti_external_function: %u not implemented\n", function);
-  errorOccurred = true;
+  artiContext->errorOccurred = true;
   return function;
 }
 
@@ -347,7 +425,7 @@ float WS2812FX::arti_get_external_variable(uint8_t variable, float par1, float p
       case F_leds:
         if (par1 == floatNull) {
           ERROR_ARTI("arti_get_external_variable leds without indices not supported yet (get leds)\n");
-          errorOccurred = true;
+          artiContext->errorOccurred = true;
           return floatNull;
         }
         else if (par2 == floatNull)
@@ -381,24 +459,22 @@ float WS2812FX::arti_get_external_variable(uint8_t variable, float par1, float p
     switch (variable)
     {
       case F_ledCount:
-        return 3; // used in testing e.g. for i = 1 to ledCount
+        return ledCount;
       case F_matrixWidth:
-        return 2;
+        return matrixWidth;
       case F_matrixHeight:
-        return 4;
+        return matrixHeight;
       case F_leds:
         if (par1 == floatNull) {
           ERROR_ARTI("arti_get_external_variable leds without indices not supported yet (get leds)\n");
-          errorOccurred = true;
+          artiContext->errorOccurred = true;
           return F_leds;
         }
         else if (par2 == floatNull)
-          return par1;
+          return pixels[((uint16_t)par1)%ledCount];
         else
-          return par1 * par2; //2D value!!
+          return pixels[XY((uint16_t)par1, (uint16_t)par2)]; //2D value!!
 
-      case F_counter:
-        return frameCounter;
       case F_speedSlider:
         return F_speedSlider;
       case F_intensitySlider:
@@ -422,7 +498,7 @@ float WS2812FX::arti_get_external_variable(uint8_t variable, float par1, float p
   #endif
 
   ERROR_ARTI("Error: arti_get_external_variable: %u not implemented\n", variable);
-  errorOccurred = true;
+  artiContext->errorOccurred = true;
   return variable;
 }
 
@@ -437,7 +513,7 @@ void WS2812FX::arti_set_external_variable(float value, uint8_t variable, float p
         if (par1 == floatNull) 
         {
           ERROR_ARTI("arti_set_external_variable leds without indices not supported yet (set leds to %f)\n", value);
-          errorOccurred = true;
+          artiContext->errorOccurred = true;
         }
         else if (par2 == floatNull)
           leds[segmentToLogical((uint16_t)par1%SEGLEN)] = value;
@@ -454,12 +530,18 @@ void WS2812FX::arti_set_external_variable(float value, uint8_t variable, float p
         if (par1 == floatNull) 
         {
           ERROR_ARTI("arti_set_external_variable leds without indices not supported yet (set leds to %f)\n", value);
-          errorOccurred = true;
+          artiContext->errorOccurred = true;
         }
         else if (par2 == floatNull)
+        {
           RUNLOG_ARTI("arti_set_external_variable: leds(%f) := %f\n", par1, value);
+          pixels[((uint16_t)par1)%ledCount] = value;
+        }
         else
+        {
           RUNLOG_ARTI("arti_set_external_variable: leds(%f, %f) := %f\n", par1, par2, value);
+          pixels[XY((uint16_t)par1, (uint16_t)par2)] = value;
+        }
 
         ledsSet = true;
         return;
@@ -467,77 +549,64 @@ void WS2812FX::arti_set_external_variable(float value, uint8_t variable, float p
   #endif
 
   ERROR_ARTI("Error: arti_set_external_variable: %u not implemented\n", variable);
-  errorOccurred = true;
+  artiContext->errorOccurred = true;
 } //arti_set_external_variable
 
 bool ARTI::loop() 
 {
+  artiContext = &context;
   if (stages < 5) {close(); return true;}
 
-  if (parseTreeJsonDoc == nullptr || parseTreeJsonDoc->isNull()) 
+  uint32_t frameStart = micros();
+
+  if (program == nullptr || state == nullptr) 
   {
-    ERROR_ARTI("Loop: No parsetree created\n");
-    errorOccurred = true;
+    ERROR_ARTI("Loop: No program compiled\n");
+    context.errorOccurred = true;
     return false;
   }
   else 
   {
     uint8_t depth = 8;
 
+    context.errorOccurred = false; //errors of other states of the program do not stop this one
+
     bool foundRenderFunction = false;
-    
-    const char * function_name = "renderFrame";
-    Symbol* function_symbol = global_scope->lookup(function_name);
 
     ledsSet = false;
 
-    if (function_symbol != nullptr) { //calling undefined function: pre-defined functions e.g. print
-
+    if (program->renderFrame != functionNone) 
+    {
       foundRenderFunction = true;
 
-      ActivationRecord* ar = new ActivationRecord(function_name, "Function", function_symbol->scope_level + 1);
-
-      RUNLOG_ARTI("%s %s %s (%u)\n", spaces+50-depth, "Call", function_name, this->callStack->recordsCounter);
-
-      this->callStack->push(ar);
-
-      if (!interpret(function_symbol->block, nullptr, global_scope, depth + 1))
+      if (!callFunction(program->renderFrame))
         return false;
+    }
 
-      this->callStack->pop();
-
-      delete ar; ar = nullptr;
-
-    } //function_symbol != nullptr
-
-    function_name = "renderLed";
-    function_symbol = global_scope->lookup(function_name);
-
-    if (function_symbol != nullptr) { //calling undefined function: pre-defined functions e.g. print
-
+    if (program->renderLed != functionNone) 
+    {
       foundRenderFunction = true;
 
-      ActivationRecord* ar = new ActivationRecord(function_name, "function", function_symbol->scope_level + 1);
+      //per frame expressions of renderLed, after renderFrame as they can use globals set there
+      if (program->framePrologue != 0 && !run(program->framePrologue, 0))
+        return false;
 
-      for (int i = 0; i< arti_get_external_variable(F_ledCount); i++)
+      uint16_t ledCount = arti_get_external_variable(F_ledCount);
+      uint16_t matrixWidth = strip.matrixWidth;
+      float actuals[2] = {0, 0}; // x, y (2D only)
+      for (uint16_t i = 0; i < ledCount; i++)
       {
-        ar->set(function_symbol->function_scope->symbols[0]->scope_index, i%strip.matrixWidth); // set x
-        if (function_symbol->function_scope->nrOfFormals == 2) // 2D
-          ar->set(function_symbol->function_scope->symbols[1]->scope_index, i/strip.matrixWidth); // set y
-
-        this->callStack->push(ar);
-
-        if (!interpret(function_symbol->block, nullptr, global_scope, depth + 1))
+        if (!callFunction(program->renderLed, actuals, 2))
           return false;
-
-        this->callStack->pop();
+        if (++actuals[0] >= matrixWidth)
+        {
+          actuals[0] = 0;
+          actuals[1]++;
+        }
       }
-
-      delete ar; ar = nullptr;
-
     }
 
-    // if leds has been set during interpret(renderLed)
+    // if leds has been set during renderLed
     if (ledsSet) {
       // Serial.println("ledsSet");
       arti_external_function(F_setPixels);
@@ -548,18 +617,26 @@ bool ARTI::loop()
     if (!foundRenderFunction) 
     {
       ERROR_ARTI("%s renderFrame or renderLed not found\n", spaces+50-depth);
-      errorOccurred = true;
+      context.errorOccurred = true;
       return false;
     }
   }
-  frameCounter++;
+  state->frameCounter++;
 
-  if (frameCounter == 1)
+  uint32_t frameMicros = micros() - frameStart;
+  stats.frames++;
+  stats.frameMicros += frameMicros;
+  if (frameMicros > stats.maxFrameMicros)
+    stats.maxFrameMicros = frameMicros;
+
+  if (stats.frames == 1)
     startMillis = millis();
 
   if (millis() - startMillis > 3000) //startMillis != 0 && logToFile && 
   {
     // ERROR_ARTI("time %u\n", millis() - startMillis);
+    if (context.logToFile)
+      logStats();
     closeLog();
     // startMillis = 0;
   }
@@ -569,15 +646,72 @@ bool ARTI::loop()
 
 #if ARTI_PLATFORM == ARTI_ARDUINO
 
-ARTI * arti;
+//Compiled programs are shared by all segments running the same custom effect, each segment runs it in its own ArtiState in SEGENV.data
+#define ARTI_MAX_PROGRAMS 4
+#define ARTI_UNUSED_MILLIS 10000 //programs not run by any segment for this time are freed
+
+typedef struct ArtiShared {
+  char name[charLength];
+  ARTI * arti;
+  bool succesful; //setup succeeded
+  bool notEnoughHeap;
+  uint16_t generation; //states of segments started with an older setup start again
+  uint32_t lastUsed;
+} artiShared;
+
+typedef struct ArtiSegment {
+  uint16_t generation;
+  bool succesful;
+  ArtiState state;
+} artiSegment;
+
+ArtiShared artiPrograms[ARTI_MAX_PROGRAMS];
+uint16_t artiGeneration = 0;
+
+void releaseArtiProgram(ArtiShared &shared)
+{
+  if (shared.arti != nullptr)
+  {
+    shared.arti->close();
+    delete shared.arti; shared.arti = nullptr;
+  }
+  shared.name[0] = '\0';
+}
+
+//returns the compiled program of this effect, sets it up if no segment runs it yet, nullptr if all are in use
+ArtiShared * artiProgram(const char * effect)
+{
+  ArtiShared * freeShared = nullptr;
+  for (uint8_t i = 0; i < ARTI_MAX_PROGRAMS; i++)
+  {
+    ArtiShared &shared = artiPrograms[i];
+    if (shared.arti != nullptr && strcmp(shared.name, effect) == 0)
+      return &shared;
+    if (shared.arti != nullptr && millis() - shared.lastUsed > ARTI_UNUSED_MILLIS)
+      releaseArtiProgram(shared);
+    if (shared.arti == nullptr && freeShared == nullptr)
+      freeShared = &shared;
+  }
+  if (freeShared == nullptr) return nullptr;
+
+  strcpy(freeShared->name, effect);
+  freeShared->arti = new ARTI();
+  freeShared->generation = ++artiGeneration;
+  freeShared->lastUsed = millis();
+
+  char programFileName[fileNameLength];
+  strcpy(programFileName, "/");
+  strcat(programFileName, effect);
+  strcat(programFileName, ".wled");
 
-//Adding ARTI to this structure seems to be needed to make the pointers used in ARTI survive in subsequent calls of mode_customEffect
-//  otherwise: Interpret renderFrame: No parsetree created
-//  initially added parseTreeJsonDoc in this struct to save it explicitly but that was not needed
-// maybe because this struct is not deleted
-// typedef struct ArtiWrapper {
-//   ARTI * arti;
-// } artiWrapper;
+  freeShared->succesful = freeShared->arti->setup("/wled.json", programFileName);
+  freeShared->notEnoughHeap = freeShared->arti->notEnoughHeap;
+
+  if (!freeShared->succesful)
+    ERROR_ARTI("Setup not succesful\n");
+
+  return freeShared;
+}
 
 uint16_t WS2812FX::mode_customEffect(void) 
 {
@@ -634,81 +768,46 @@ uint16_t WS2812FX::mode_customEffect(void)
 
   // return 0;
 
-  // ArtiWrapper* artiWrapper = reinterpret_cast<ArtiWrapper*>(SEGENV.data);
-  
-  //tbd: move statics to SEGMENT.data
-  static bool succesful;
-  static bool notEnoughHeap;
-
-  static char previousEffect[charLength];
+  if (!SEGENV.allocateData(sizeof(ArtiSegment))) return mode_static(); //allocation failed
+  ArtiSegment* artiSegment = reinterpret_cast<ArtiSegment*>(SEGENV.data);
   if (SEGENV.call == 0)
-    strcpy(previousEffect, ""); //force init
+    artiSegment->generation = 0; //force init
 
   char currentEffect[charLength];
   strcpy(currentEffect, (SEGMENT.name != nullptr)?SEGMENT.name:"default"); //note: switching preset with segment name to preset without does not clear the SEGMENT.name variable, but not gonna solve here ;-)
 
-  if (strcmp(previousEffect, currentEffect) != 0) 
+  ArtiShared * shared = artiProgram(currentEffect);
+  if (shared == nullptr) 
   {
-    strcpy(previousEffect, currentEffect);
+    ERROR_ARTI("No room for program %s, %u custom effects running\n", currentEffect, ARTI_MAX_PROGRAMS);
+    return mode_blink();
+  }
+  shared->lastUsed = millis();
 
-    // if (artiWrapper != nullptr && artiWrapper->arti != nullptr) {
-    if (arti != nullptr) 
-    {
-      arti->close();
-      delete arti; arti = nullptr;
+  if (!shared->succesful)
+  {
+    shared->arti->closeLog();
+    if (shared->notEnoughHeap && esp_get_free_heap_size() > compileHeapSize) {
+      ERROR_ARTI("Again enough free heap, restart effect (%u > %u)\n", esp_get_free_heap_size(), compileHeapSize);
+      releaseArtiProgram(*shared); // force new create
     }
+    return mode_blink();
+  }
 
-    // if (!SEGENV.allocateData(sizeof(ArtiWrapper))) return mode_static();  // We use this method for allocating memory for static variables.
-    // artiWrapper = reinterpret_cast<ArtiWrapper*>(SEGENV.data);
-    arti = new ARTI();
-
-    char programFileName[fileNameLength];
-    strcpy(programFileName, "/");
-    strcat(programFileName, currentEffect);
-    strcat(programFileName, ".wled");
-
-    succesful = arti->setup("/wled.json", programFileName);
-
-    if (!succesful)
-      ERROR_ARTI("Setup not succesful\n");
+  if (artiSegment->generation != shared->generation)
+  {
+    artiSegment->generation = shared->generation;
+    artiSegment->succesful = shared->arti->newState(&artiSegment->state);
   }
-  else 
+  else if (artiSegment->succesful)
   {
-    if (succesful) // && SEGENV.call < 250 for each frame
-    {
-      if (esp_get_free_heap_size() <= 20000) 
-      {
-        ERROR_ARTI("Not enough free heap (%u <= 30000)\n", esp_get_free_heap_size());
-        notEnoughHeap = true;
-        succesful = false;
-      }
-      else
-      {
-        // static int previousMillis;
-        // static int previousCall;
-        // if (millis() - previousMillis > 5000) { //tried SEGENV.aux0 but that looks to be overwritten!!! (dangling pointer???)
-        //   previousMillis = millis();
-        //   MEMORY_ARTI("Heap renderFrame %u %u fps\n", esp_get_free_heap_size(), (SEGENV.call - previousCall)/5);
-        //   previousCall = SEGENV.call;
-        // }
-        
-        succesful = arti->loop();
-      }
-    }
-    else 
-    {
-      arti->closeLog();
-      if (notEnoughHeap && esp_get_free_heap_size() > 20000) {
-        ERROR_ARTI("Again enough free heap, restart effect (%u > 30000)\n", esp_get_free_heap_size());
-        succesful = true;
-        notEnoughHeap = false;
-        strcpy(previousEffect, ""); // force new create
-      }
-      else
-        return mode_blink();
-    }
+    shared->arti->useState(&artiSegment->state);
+    artiSegment->succesful = shared->arti->loop(); //compiled program runs without heap allocations
   }
 
+  if (!artiSegment->succesful)
+    return mode_blink();
+
   return FRAMETIME;
 }
 
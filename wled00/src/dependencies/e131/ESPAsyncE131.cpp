@@ -110,8 +110,15 @@ void ESPAsyncE131::parsePacket(AsyncUDPPacket _packet) {
 	if (protocol == P_ARTNET) {
 		if (memcmp(sbuff->art_id, ESPAsyncE131::ART_ID, sizeof(sbuff->art_id)))
 			error = true; //not "Art-Net"
-		if (sbuff->art_opcode != ARTNET_OPCODE_OPDMX)
+		if (sbuff->art_opcode == ARTNET_OPCODE_OPSYNC)
+			protocol = P_ARTNET_SYNC;
+		else if (sbuff->art_opcode != ARTNET_OPCODE_OPDMX)
 			error = true; //not a DMX packet
+	} else if (htonl(sbuff->root_vector) == ESPAsyncE131::VECTOR_ROOT_EXTENDED) { //E1.31 synchronization packet
+		if (htonl(sbuff->frame_vector) == ESPAsyncE131::VECTOR_FRAME_SYNC)
+			protocol = P_E131_SYNC;
+		else
+			error = true; //universe discovery
 	} else { //E1.31 error handling
 		if (htonl(sbuff->root_vector) != ESPAsyncE131::VECTOR_ROOT)
 			error = true;
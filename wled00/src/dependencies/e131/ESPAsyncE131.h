@@ -54,10 +54,13 @@ typedef struct ip_addr ip4_addr_t;
 #define DDP_TIMECODE_FLAG 0x10
 
 #define ARTNET_OPCODE_OPDMX 0x5000
+#define ARTNET_OPCODE_OPSYNC 0x5200
 
 #define P_E131   0
 #define P_ARTNET 1
 #define P_DDP    2
+#define P_E131_SYNC   3 // E1.31 universe synchronization packet, sync address in universe
+#define P_ARTNET_SYNC 4 // ArtSync packet
 
 // E1.31 Packet Offsets
 #define E131_ROOT_PREAMBLE_SIZE 0
@@ -71,11 +74,15 @@ typedef struct ip_addr ip4_addr_t;
 #define E131_FRAME_VECTOR 40
 #define E131_FRAME_SOURCE 44
 #define E131_FRAME_PRIORITY 108
-#define E131_FRAME_RESERVED 109
+#define E131_FRAME_RESERVED 109 // synchronization address since E1.31-2016
 #define E131_FRAME_SEQ 111
 #define E131_FRAME_OPT 112
 #define E131_FRAME_UNIVERSE 113
 
+// E1.31 Synchronization Packet Offsets (root and frame layer as above)
+#define E131_SYNC_SEQ 44
+#define E131_SYNC_ADDRESS 45
+
 #define E131_DMP_FLENGTH 115
 #define E131_DMP_VECTOR 117
 #define E131_DMP_TYPE 118
@@ -100,7 +107,7 @@ typedef union {
       uint32_t frame_vector;
       uint8_t  source_name[64];
       uint8_t  priority;
-      uint16_t reserved;
+      uint16_t sync_address; // 0: no synchronization
       uint8_t  sequence_number;
       uint8_t  options;
       uint16_t universe;
@@ -161,6 +168,8 @@ class ESPAsyncE131 {
 	  static const uint8_t ART_ID[];
     static const uint32_t VECTOR_ROOT = 4;
     static const uint32_t VECTOR_FRAME = 2;
+    static const uint32_t VECTOR_ROOT_EXTENDED = 8;
+    static const uint32_t VECTOR_FRAME_SYNC = 1;
     static const uint8_t VECTOR_DMP = 2;
 
     AsyncUDP        udp;        // AsyncUDP
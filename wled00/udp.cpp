@@ -10,6 +10,175 @@
 #define UDP_IN_MAXSIZE 1472
 #define PRESUMED_NETWORK_DELAY 3 //how many ms could it take on avg to reach the receiver? This will be added to transmitted times
 
+/*
+ * Clock sync: the controllers elect a leader (lowest clockSyncPriority, then lowest IP) that announces itself
+ * every second. Followers measure the offset of the leader's clock with round trip compensated requests
+ * (PTP delay request/response), keep the sample with the shortest round trip and correct their drift.
+ * strip.now and the timebase of notifications derive from the shared clock (syncedMillis()).
+ */
+#define UDP_CLOCK_SYNC 0xFA            //byte 1 message, 2 priority, 3-10 t1, 11-18 t2, 19-26 t3 (us, MSB first)
+#define CLOCK_SYNC_ANNOUNCE 0
+#define CLOCK_SYNC_REQUEST  1
+#define CLOCK_SYNC_RESPONSE 2
+#define CLOCK_SYNC_PACKET 27
+#define CLOCK_SYNC_INTERVAL 1000       //ms between announces and between requests once synchronized
+#define CLOCK_SYNC_LEADER_TIMEOUT 3500 //ms without announce before another controller takes over
+#define CLOCK_SYNC_SAMPLES 8
+#define CLOCK_SYNC_DRIFT_WINDOW 10000000 //us between offset estimates used to measure the drift
+#define CLOCK_SYNC_MAX_DRIFT 0.0005f   //500 ppm
+
+struct ClockSample {
+  int64_t offset;   //leader clock - local clock
+  uint32_t rtt;     //round trip without the leader's processing time
+  uint64_t local;
+};
+
+static IPAddress clockLeader;          //0.0.0.0 while this controller leads
+static uint8_t clockLeaderPriority = 255;
+static unsigned long clockLeaderSeen = 0, clockLastSent = 0;
+static int64_t clockOffset = 0;        //shared clock - local clock at clockRef
+static uint64_t clockRef = 0;
+static float clockDrift = 0;
+static int64_t clockDriftOffset = 0;   //earlier offset estimate the drift is measured against
+static uint64_t clockDriftRef = 0;
+static uint32_t clockLast = 0;         //last syncedMillis(), keeps the shared clock monotonic
+static ClockSample clockSamples[CLOCK_SYNC_SAMPLES];
+static uint8_t clockSampleCount = 0, clockSampleNext = 0;
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <esp_timer.h>
+#endif
+
+static uint64_t clockLocalMicros() {
+  #ifdef ARDUINO_ARCH_ESP32
+  return esp_timer_get_time();
+  #else
+  return micros64();
+  #endif
+}
+
+static uint64_t clockShared(uint64_t local) {
+  return local + clockOffset + (int64_t)(clockDrift * (int64_t)(local - clockRef));
+}
+
+//shared clock in ms, millis() if clock sync is disabled
+uint32_t syncedMillis() {
+  if (!clockSyncEnabled) return millis();
+  uint32_t t = clockShared(clockLocalMicros()) / 1000;
+  if ((int32_t)(clockLast - t) > 0 && clockLast - t < 1000) t = clockLast; //small corrections never run the clock backwards
+  clockLast = t;
+  return t;
+}
+
+static void put64(byte* p, uint64_t v) { for (int8_t i = 7; i >= 0; i--, v >>= 8) p[i] = v; }
+static uint64_t get64(const byte* p) { uint64_t v = 0; for (uint8_t i = 0; i < 8; i++) v = (v << 8) | p[i]; return v; }
+
+//true if a controller would lead before the current leader (or this controller while leading)
+static bool clockBetterLeader(uint8_t priority, IPAddress ip) {
+  uint8_t ownPriority = clockLeader[0] ? clockLeaderPriority : clockSyncPriority;
+  IPAddress own = clockLeader[0] ? clockLeader : Network.localIP();
+  if (priority != ownPriority) return priority < ownPriority;
+  for (uint8_t i = 0; i < 4; i++) if (ip[i] != own[i]) return ip[i] < own[i];
+  return false;
+}
+
+static void sendClockSync(IPAddress ip, byte* packet) {
+  notifierUdp.beginPacket(ip, udpPort);
+  notifierUdp.write(packet, CLOCK_SYNC_PACKET);
+  notifierUdp.endPacket();
+}
+
+//announces the leader or sends delay requests to it, called from handleNotifications()
+void handleClockSync() {
+  if (!clockSyncEnabled || !udpConnected) return;
+  unsigned long now = millis();
+  if (clockLeader[0] && now - clockLeaderSeen > CLOCK_SYNC_LEADER_TIMEOUT) {
+    clockLeader = IPAddress(0, 0, 0, 0); //leader is gone, lead with the clock as it is
+    clockSampleCount = 0;
+  }
+
+  uint16_t interval = (clockLeader[0] && clockSampleCount < 4) ? CLOCK_SYNC_INTERVAL / 4 : CLOCK_SYNC_INTERVAL;
+  if (now - clockLastSent < interval) return;
+  clockLastSent = now;
+
+  byte packet[CLOCK_SYNC_PACKET] = {UDP_CLOCK_SYNC};
+  packet[2] = clockSyncPriority;
+  if (!clockLeader[0]) {
+    packet[1] = CLOCK_SYNC_ANNOUNCE;
+    IPAddress broadcastIp = ~uint32_t(Network.subnetMask()) | uint32_t(Network.gatewayIP());
+    sendClockSync(broadcastIp, packet);
+  } else {
+    packet[1] = CLOCK_SYNC_REQUEST;
+    put64(packet + 3, clockLocalMicros());
+    sendClockSync(clockLeader, packet);
+  }
+}
+
+static void handleClockSyncPacket(const byte* udpIn, uint16_t len, IPAddress ip, uint64_t received) {
+  if (!clockSyncEnabled || len < CLOCK_SYNC_PACKET) return;
+  switch (udpIn[1]) {
+    case CLOCK_SYNC_ANNOUNCE:
+      if (ip == clockLeader) {
+        clockLeaderPriority = udpIn[2];
+      } else if (clockBetterLeader(udpIn[2], ip)) {
+        clockLeader = ip;
+        clockLeaderPriority = udpIn[2];
+        clockSampleCount = 0;
+        clockDriftRef = 0;
+        clockDrift = 0;
+        clockLastSent = 0; //start measuring right away
+      } else break;
+      clockLeaderSeen = millis();
+      break;
+
+    case CLOCK_SYNC_REQUEST: { //answered by the leader with its receive and send time
+      if (clockLeader[0]) break;
+      byte packet[CLOCK_SYNC_PACKET];
+      memcpy(packet, udpIn, 11);
+      packet[1] = CLOCK_SYNC_RESPONSE;
+      packet[2] = clockSyncPriority;
+      put64(packet + 11, clockShared(received));
+      put64(packet + 19, clockShared(clockLocalMicros()));
+      sendClockSync(ip, packet);
+    } break;
+
+    case CLOCK_SYNC_RESPONSE: {
+      if (ip != clockLeader) break;
+      uint64_t t1 = get64(udpIn + 3), t2 = get64(udpIn + 11), t3 = get64(udpIn + 19), t4 = received;
+      int64_t rtt = (int64_t)(t4 - t1) - (int64_t)(t3 - t2);
+      ClockSample &sample = clockSamples[clockSampleNext];
+      sample.offset = ((int64_t)(t2 - t1) + (int64_t)(t3 - t4)) / 2;
+      sample.rtt = rtt > 0 ? rtt : 0;
+      sample.local = t1 + (t4 - t1) / 2;
+      clockSampleNext = (clockSampleNext + 1) % CLOCK_SYNC_SAMPLES;
+      if (clockSampleCount < CLOCK_SYNC_SAMPLES) clockSampleCount++;
+
+      //the sample with the shortest round trip had the least queueing delay
+      ClockSample *best = &clockSamples[0];
+      for (uint8_t i = 1; i < clockSampleCount; i++) if (clockSamples[i].rtt < best->rtt) best = &clockSamples[i];
+
+      if (!clockDriftRef) {
+        clockDriftRef = best->local;
+        clockDriftOffset = best->offset;
+      } else if (best->local - clockDriftRef > CLOCK_SYNC_DRIFT_WINDOW) {
+        float drift = (float)(best->offset - clockDriftOffset) / (float)(best->local - clockDriftRef);
+        clockDrift = constrain(clockDrift + (drift - clockDrift) / 4, -CLOCK_SYNC_MAX_DRIFT, CLOCK_SYNC_MAX_DRIFT);
+        clockDriftRef = best->local;
+        clockDriftOffset = best->offset;
+      }
+      clockOffset = best->offset;
+      clockRef = best->local;
+    } break;
+  }
+}
+
+void serializeClockSync(JsonObject root) {
+  root[F("lead")] = clockLeader[0] ? clockLeader.toString() : String();
+  root[F("off")]  = (int32_t)((clockOffset) / 1000);      //ms, shared clock - local clock
+  root[F("rtt")]  = clockSampleCount ? clockSamples[(clockSampleNext + CLOCK_SYNC_SAMPLES - 1) % CLOCK_SYNC_SAMPLES].rtt : 0; //us
+  root[F("ppm")]  = clockDrift * 1000000.0f;
+}
+
 void notify(byte callMode, bool followUp)
 {
   if (!udpConnected) return;
@@ -63,7 +232,7 @@ void notify(byte callMode, bool followUp)
   udpOut[23] = W(col);
 
   udpOut[24] = followUp;
-  uint32_t t = millis() + strip.timebase;
+  uint32_t t = syncedMillis() + strip.timebase;
   udpOut[25] = (t >> 24) & 0xFF;
   udpOut[26] = (t >> 16) & 0xFF;
   udpOut[27] = (t >>  8) & 0xFF;
@@ -190,28 +359,116 @@ void exitRealtime() {
 
 #define TMP2NET_OUT_PORT 65442
 
-void sendTPM2Ack() {
-  notifierUdp.beginPacket(notifierUdp.remoteIP(), TMP2NET_OUT_PORT);
+void sendTPM2Ack(IPAddress ip) {
+  notifierUdp.beginPacket(ip, TMP2NET_OUT_PORT);
   uint8_t response_ack = 0xac;
   notifierUdp.write(&response_ack, 1);
   notifierUdp.endPacket();
 }
 
 
+/*
+ * The notifier, secondary notifier and raw RGB ports are received by async UDP callbacks into a bounded queue
+ * (single producer, single consumer) that handleNotifications() drains once per loop. State notifications and
+ * full realtime frames that are superseded by a later packet of the same kind in the queue are skipped.
+ */
+#ifdef ESP8266
+#define UDP_QUEUE_SIZE 3
+#else
+#define UDP_QUEUE_SIZE 5
+#endif
+
+struct UdpPacket {
+  uint64_t received;  //clock sync receive time
+  uint32_t start;     //micros() at receipt, for the ingest statistics
+  IPAddress remoteIP;
+  uint16_t len;
+  uint8_t source;
+  uint8_t data[UDP_IN_MAXSIZE +1]; //+1 for the terminating 0 of the JSON and HTTP API
+};
+
+static AsyncUDP notifierAsync, notifier2Async, rgbAsync;
+static UdpPacket* udpQueue = nullptr;
+static volatile uint8_t udpQueueHead = 0, udpQueueTail = 0; //written by the callbacks / by the loop only
+static volatile uint32_t udpQueueDropped = 0;
+
+static void queueUdpPacket(AsyncUDPPacket &packet, uint8_t source) {
+  uint16_t len = packet.length();
+  if (!len) return;
+  uint8_t head = udpQueueHead, next = (head + 1) % UDP_QUEUE_SIZE;
+  if (next == udpQueueTail || len > UDP_IN_MAXSIZE) {
+    udpQueueDropped++;
+    return;
+  }
+  UdpPacket &p = udpQueue[head];
+  p.received = clockLocalMicros();
+  p.start = micros();
+  p.remoteIP = packet.remoteIP();
+  p.len = len;
+  p.source = source;
+  memcpy(p.data, packet.data(), len);
+  __sync_synchronize(); //packet is complete before the loop sees it
+  udpQueueHead = next;
+}
+
+//starts receiving on a notifier (UDP_SOURCE_*) port, replaces WiFiUDP::begin()
+bool udpListen(uint8_t source, uint16_t port) {
+  if (!udpQueue) udpQueue = (UdpPacket*) malloc(UDP_QUEUE_SIZE * sizeof(UdpPacket));
+  if (!udpQueue) return false;
+  AsyncUDP &udp = (source == UDP_SOURCE_NOTIFIER) ? notifierAsync : (source == UDP_SOURCE_NOTIFIER2) ? notifier2Async : rgbAsync;
+  if (!udp.listen(port)) return false;
+  udp.onPacket([source](AsyncUDPPacket &packet) { queueUdpPacket(packet, source); });
+  return true;
+}
+
+//packets of the same kind replace each other, 0: applied in order
+static uint8_t udpPacketKind(const UdpPacket &p) {
+  if (p.source == UDP_SOURCE_RGB) return 1;       //Hyperion frame
+  if (p.source == UDP_SOURCE_NOTIFIER2) return 0;
+  if (p.data[0] == 0) return 2;                   //state notification
+  if (p.data[0] == 2 || p.data[0] == 3) return 3; //DRGB / DRGBW frame
+  return 0;
+}
+
+static void handleUdpPacket(UdpPacket &packet);
+
+static void drainUdpQueue() {
+  uint8_t head = udpQueueHead; //packets arriving meanwhile are handled in the next loop
+  __sync_synchronize();
+  for (uint8_t i = udpQueueTail; i != head; i = (i + 1) % UDP_QUEUE_SIZE) {
+    uint8_t kind = udpPacketKind(udpQueue[i]);
+    bool superseded = false;
+    for (uint8_t j = (i + 1) % UDP_QUEUE_SIZE; kind && j != head; j = (j + 1) % UDP_QUEUE_SIZE) {
+      if (udpPacketKind(udpQueue[j]) == kind && udpQueue[j].source == udpQueue[i].source) {
+        superseded = true;
+        break;
+      }
+    }
+    if (!superseded) handleUdpPacket(udpQueue[i]);
+    udpQueueTail = (i + 1) % UDP_QUEUE_SIZE;
+  }
+}
+
+uint32_t getUdpQueueDropped() {
+  return udpQueueDropped;
+}
+
 void handleNotifications()
 {
-  IPAddress localIP;
-
   //send second notification if enabled
   if(udpConnected && notificationTwoRequired && millis()-notificationSentTime > 250){
     notify(notificationSentCallMode,true);
   }
+  handleClockSync();
 
-  if (e131NewData && millis() - strip.getLastShow() > 15)
+  //show each realtime frame once, as soon as it is complete and the previous frame has been sent out
+  handleE131FrameTimeout();
+  if (e131NewData && (rtImage || !strip.isUpdating()))
   {
     e131NewData = false;
-    strip.show();
+    realtimeShow();
   }
+  handleRealtimeJitterBuffer();
 
   //unlock strip when realtime UDP times out
   if (realtimeMode && millis() > realtimeTimeout) exitRealtime();
@@ -219,52 +476,46 @@ void handleNotifications()
   //receive UDP notifications
   if (!udpConnected) return;
 
-  bool isSupp = false;
-  uint16_t packetSize = notifierUdp.parsePacket();
-  if (!packetSize && udp2Connected) {
-    packetSize = notifier2Udp.parsePacket();
-    isSupp = true;
-  }
+  drainUdpQueue();
+}
+
+//handles one packet received on the notifier, secondary notifier or raw RGB port
+static void handleUdpPacket(UdpPacket &packet)
+{
+  uint8_t *udpIn = packet.data;
+  uint16_t packetSize = packet.len, len = packet.len;
+  bool isSupp = packet.source == UDP_SOURCE_NOTIFIER2;
+  IPAddress remoteIP = packet.remoteIP;
+  uint64_t received = packet.received;
+  uint32_t packetStart = packet.start;
 
   //hyperion / raw RGB
-  if (!packetSize && udpRgbConnected) {
-    packetSize = rgbUdp.parsePacket();
-    if (packetSize) {
-      if (!receiveDirect) return;
-      if (packetSize > UDP_IN_MAXSIZE || packetSize < 3) return;
-      realtimeIP = rgbUdp.remoteIP();
-      DEBUG_PRINTLN(rgbUdp.remoteIP());
-      uint8_t lbuf[packetSize];
-      rgbUdp.read(lbuf, packetSize);
-      realtimeLock(realtimeTimeoutMs, REALTIME_MODE_HYPERION);
-      if (realtimeOverride) return;
-      uint16_t id = 0;
-      uint16_t totalLen = strip.getLengthTotal();
-      for (uint16_t i = 0; i < packetSize -2; i += 3)
-      {
-        setRealtimePixel(id, lbuf[i], lbuf[i+1], lbuf[i+2], 0);
-        id++; if (id >= totalLen) break;
-      }
-      strip.show();
-      return;
-    }
+  if (packet.source == UDP_SOURCE_RGB) {
+    if (!receiveDirect) return;
+    if (packetSize < 3) return;
+    realtimeIP = remoteIP;
+    DEBUG_PRINTLN(remoteIP);
+    realtimeLock(realtimeTimeoutMs, REALTIME_MODE_HYPERION);
+    if (realtimeOverride) return;
+    setRealtimePixels(0, udpIn, packetSize / 3, 3);
+    realtimeShow();
+    countRealtimePacket(3, packetStart);
+    return;
   }
 
   if (!(receiveNotifications || receiveDirect)) return;
 
-  localIP = Network.localIP();
-  //notifier and UDP realtime
-  if (!packetSize || packetSize > UDP_IN_MAXSIZE) return;
-  if (!isSupp && notifierUdp.remoteIP() == localIP) return; //don't process broadcasts we send ourselves
+  IPAddress localIP = Network.localIP();
+  if (!isSupp && remoteIP == localIP) return; //don't process broadcasts we send ourselves
 
-  uint8_t udpIn[packetSize +1];
-  uint16_t len;
-  if (isSupp) len = notifier2Udp.read(udpIn, packetSize);
-  else        len =  notifierUdp.read(udpIn, packetSize);
+  if (!isSupp && udpIn[0] == UDP_CLOCK_SYNC) {
+    handleClockSyncPacket(udpIn, len, remoteIP, received);
+    return;
+  }
 
   // WLED nodes info notifications
   if (isSupp && udpIn[0] == 255 && udpIn[1] == 1 && len >= 40) {
-    if (!nodeListEnabled || notifier2Udp.remoteIP() == localIP) return;
+    if (!nodeListEnabled || remoteIP == localIP) return;
 
     uint8_t unit = udpIn[39];
     NodesMap::iterator it = Nodes.find(unit);
@@ -390,7 +641,7 @@ void handleNotifications()
       if (applyEffects && version > 5) {
         uint32_t t = (udpIn[25] << 24) | (udpIn[26] << 16) | (udpIn[27] << 8) | (udpIn[28]);
         t += PRESUMED_NETWORK_DELAY; //adjust trivially for network delay
-        t -= millis();
+        t -= syncedMillis();
         strip.timebase = t;
         timebaseUpdated = true;
       }
@@ -408,7 +659,7 @@ void handleNotifications()
         if (udpIn[29] > 99) ts = TOKI_TS_UDP_NTP;
         else if (udpIn[29] >= TOKI_TS_SEC) ts = TOKI_TS_UDP_SEC;
         toki.setTime(tm, ts);
-      } else if (timebaseUpdated && toki.getTimeSource() > 99) { //if we both have good times, get a more accurate timebase
+      } else if (timebaseUpdated && toki.getTimeSource() > 99 && !clockSyncEnabled) { //if we both have good times, get a more accurate timebase
         Toki::Time myTime = toki.getTime();
         uint32_t diff = toki.msDifference(tm, myTime);
         strip.timebase -= PRESUMED_NETWORK_DELAY; //no need to presume, use difference between NTP times at send and receive points
@@ -442,11 +693,11 @@ void handleNotifications()
     //if the number of LEDs in your installation doesn't allow that, please include padding bytes at the end of the last packet
     byte tpmType = udpIn[1];
     if (tpmType == 0xaa) { //TPM2.NET polling, expect answer
-      sendTPM2Ack(); return;
+      sendTPM2Ack(remoteIP); return;
     }
     if (tpmType != 0xda) return; //return if notTPM2.NET data
 
-    realtimeIP = (isSupp) ? notifier2Udp.remoteIP() : notifierUdp.remoteIP();
+    realtimeIP = remoteIP;
     realtimeLock(realtimeTimeoutMs, REALTIME_MODE_TPM2NET);
     if (realtimeOverride) return;
 
@@ -456,28 +707,20 @@ void handleNotifications()
     byte numPackets = udpIn[5];
 
     uint16_t id = (tpmPayloadFrameSize/3)*(packetNum-1); //start LED
-    uint16_t totalLen = strip.getLengthTotal();
-    for (uint16_t i = 6; i < tpmPayloadFrameSize + 4; i += 3)
-    {
-      if (id < totalLen)
-      {
-        setRealtimePixel(id, udpIn[i], udpIn[i+1], udpIn[i+2], 0);
-        id++;
-      }
-      else break;
-    }
+    if (id < strip.getLengthTotal()) setRealtimePixels(id, &udpIn[6], tpmPayloadFrameSize/3, 3);
     if (tpmPacketCount == numPackets) //reset packet count and show if all packets were received
     {
       tpmPacketCount = 0;
-      strip.show();
+      realtimeShow();
     }
+    countRealtimePacket(3, packetStart);
     return;
   }
 
   //UDP realtime: 1 warls 2 drgb 3 drgbw
   if (udpIn[0] > 0 && udpIn[0] < 5)
   {
-    realtimeIP = (isSupp) ? notifier2Udp.remoteIP() : notifierUdp.remoteIP();
+    realtimeIP = remoteIP;
     DEBUG_PRINTLN(realtimeIP);
     if (packetSize < 2) return;
 
@@ -490,7 +733,6 @@ void handleNotifications()
     }
     if (realtimeOverride) return;
 
-    uint16_t totalLen = strip.getLengthTotal();
     if (udpIn[0] == 1) //warls
     {
       for (uint16_t i = 2; i < packetSize -3; i += 4)
@@ -499,42 +741,21 @@ void handleNotifications()
       }
     } else if (udpIn[0] == 2) //drgb
     {
-      uint16_t id = 0;
-      for (uint16_t i = 2; i < packetSize -2; i += 3)
-      {
-        setRealtimePixel(id, udpIn[i], udpIn[i+1], udpIn[i+2], 0);
-
-        id++; if (id >= totalLen) break;
-      }
+      setRealtimePixels(0, &udpIn[2], (packetSize -2) / 3, 3);
     } else if (udpIn[0] == 3) //drgbw
     {
-      uint16_t id = 0;
-      for (uint16_t i = 2; i < packetSize -3; i += 4)
-      {
-        setRealtimePixel(id, udpIn[i], udpIn[i+1], udpIn[i+2], udpIn[i+3]);
-
-        id++; if (id >= totalLen) break;
-      }
+      setRealtimePixels(0, &udpIn[2], (packetSize -2) / 4, 4);
     } else if (udpIn[0] == 4) //dnrgb
     {
       uint16_t id = ((udpIn[3] << 0) & 0xFF) + ((udpIn[2] << 8) & 0xFF00);
-      for (uint16_t i = 4; i < packetSize -2; i += 3)
-      {
-        if (id >= totalLen) break;
-        setRealtimePixel(id, udpIn[i], udpIn[i+1], udpIn[i+2], 0);
-        id++;
-      }
+      setRealtimePixels(id, &udpIn[4], (packetSize -4) / 3, 3);
     } else if (udpIn[0] == 5) //dnrgbw
     {
       uint16_t id = ((udpIn[3] << 0) & 0xFF) + ((udpIn[2] << 8) & 0xFF00);
-      for (uint16_t i = 4; i < packetSize -2; i += 4)
-      {
-        if (id >= totalLen) break;
-        setRealtimePixel(id, udpIn[i], udpIn[i+1], udpIn[i+2], udpIn[i+3]);
-        id++;
-      }
+      setRealtimePixels(id, &udpIn[4], (packetSize -4) / 4, 4);
     }
-    strip.show();
+    realtimeShow();
+    countRealtimePacket(3, packetStart);
     return;
   }
 
@@ -554,9 +775,28 @@ void handleNotifications()
 }
 
 
+//realtime packets are written to rtImage by the AsyncUDP task, the loop allocates and frees it (jitter buffer)
+#ifdef ARDUINO_ARCH_ESP32
+static portMUX_TYPE rtImageMux = portMUX_INITIALIZER_UNLOCKED;
+#define RT_IMAGE_ENTER portENTER_CRITICAL(&rtImageMux)
+#define RT_IMAGE_EXIT  portEXIT_CRITICAL(&rtImageMux)
+#else
+#define RT_IMAGE_ENTER
+#define RT_IMAGE_EXIT
+#endif
+
 void setRealtimePixel(uint16_t i, byte r, byte g, byte b, byte w)
 {
   uint16_t pix = i + arlsOffset;
+  RT_IMAGE_ENTER;
+  if (rtImage && pix < rtFrameLen)
+  {
+    byte* px = rtImage + pix * 4;
+    px[0] = r; px[1] = g; px[2] = b; px[3] = w;
+    RT_IMAGE_EXIT;
+    return;
+  }
+  RT_IMAGE_EXIT;
   if (pix < strip.getLengthTotal())
   {
     if (!arlsDisableGammaCorrection && strip.gammaCorrectCol)
@@ -568,6 +808,166 @@ void setRealtimePixel(uint16_t i, byte r, byte g, byte b, byte w)
   }
 }
 
+//count pixels of 3 (RGB) or 4 (RGBW) bytes from a packet, same result as setRealtimePixel() for each pixel
+void setRealtimePixels(uint16_t start, const byte* data, uint16_t count, byte channels)
+{
+  int32_t first = start + arlsOffset;
+  if (first < 0) {
+    if (count <= -first) return;
+    data  += -first * channels;
+    count -= -first;
+    first  = 0;
+  }
+  uint16_t totalLen = strip.getLengthTotal();
+  if (first >= totalLen) return;
+  if (first + count > totalLen) count = totalLen - first;
+
+  RT_IMAGE_ENTER;
+  if (rtImage && first + count <= rtFrameLen) {
+    byte* px = rtImage + first * 4;
+    for (uint16_t n = 0; n < count; n++, data += channels, px += 4) {
+      px[0] = data[0]; px[1] = data[1]; px[2] = data[2];
+      px[3] = (channels > 3) ? data[3] : 0;
+    }
+    RT_IMAGE_EXIT;
+    return;
+  }
+  RT_IMAGE_EXIT;
+
+  strip.setRealtimePixels(first, data, count, channels, !arlsDisableGammaCorrection && strip.gammaCorrectCol);
+}
+
+/*********************************************************************************************\
+   Realtime jitter buffer: complete frames are queued with a presentation time and played back
+   at the average source frame rate, (realtimeJitterFrames-1) source frames behind
+\*********************************************************************************************/
+static uint8_t* rtFrames = nullptr;   // ring of queued frames, RGBW per LED like rtImage
+static unsigned long rtFramePts[4];   // presentation time of each queued frame
+static uint8_t rtSlots = 0;           // size of the ring, 0 if the jitter buffer is not allocated
+static uint8_t rtSlotsFailed = 0;     // ring size which could not be allocated, not tried again until realtime mode ends
+static uint8_t rtHead = 0, rtCount = 0;
+static bool rtHeadShown = false;      // oldest queued frame has been shown
+static unsigned long rtLastArrival = 0, rtLastPts = 0, rtLastOutput = 0;
+static uint16_t rtInterval = 0;       // average ms between source frames
+
+//swaps in a new image (or none), the old one is freed once no packet handler can be writing to it
+static void setRealtimeImage(uint8_t* image, uint16_t len)
+{
+  RT_IMAGE_ENTER;
+  uint8_t* old = rtImage;
+  rtImage = image;
+  rtFrameLen = len;
+  RT_IMAGE_EXIT;
+  free(old);
+}
+
+static void freeRealtimeJitterBuffer()
+{
+  setRealtimeImage(nullptr, 0);
+  free(rtFrames);
+  rtFrames = nullptr;
+  rtSlots = rtCount = rtHead = 0;
+  rtInterval = 0;
+  rtLastArrival = rtLastPts = 0;
+}
+
+//queues the realtime image as a new frame, or shows it right away if the jitter buffer is off.
+//Holds rtImageMux until the frame is queued: no packet handler can write the next frame into rtImage
+//while it is copied, and the loop can't free the ring meanwhile (rtImage is cleared first).
+void realtimeShow()
+{
+  RT_IMAGE_ENTER;
+  if (!rtImage) {
+    RT_IMAGE_EXIT;
+    strip.show();
+    return;
+  }
+
+  unsigned long now = millis();
+  if (rtLastArrival && now - rtLastArrival < 1000) {
+    uint16_t delta = now - rtLastArrival;
+    rtInterval = rtInterval ? (rtInterval * 7 + delta) / 8 : delta;
+  }
+  rtLastArrival = now;
+
+  //frames are spaced by the average interval, resync if arrival drifted out of the latency window
+  uint16_t latency = rtInterval * (rtSlots - 1);
+  unsigned long pts = rtLastPts + rtInterval;
+  if (!rtLastPts || (long)(pts - now) < 0 || pts - now > 2 * latency) pts = now + latency;
+  rtLastPts = pts;
+
+  if (rtCount == rtSlots) { // overrun, drop the oldest frame
+    rtHead = (rtHead + 1) % rtSlots;
+    rtCount--;
+    rtHeadShown = false;
+  }
+  uint8_t slot = (rtHead + rtCount) % rtSlots;
+  memcpy(rtFrames + slot * rtFrameLen * 4, rtImage, rtFrameLen * 4);
+  rtFramePts[slot] = pts;
+  rtCount++;
+  RT_IMAGE_EXIT;
+}
+
+//plays back queued frames at a steady rate, optionally interpolating between consecutive frames
+//at the strip target FPS, called from handleNotifications()
+void handleRealtimeJitterBuffer()
+{
+  uint8_t slots = (realtimeMode && realtimeJitterFrames) ? constrain(realtimeJitterFrames, 2, 4) : 0;
+  if (!realtimeMode) rtSlotsFailed = 0;
+  if (slots == rtSlotsFailed) slots = 0; // not enough memory, frames are shown as they arrive (the setting is kept)
+  uint16_t len = strip.getLengthTotal();
+  if (slots != rtSlots || (rtSlots && len != rtFrameLen)) {
+    freeRealtimeJitterBuffer();
+    if (slots) {
+      rtFrames = (uint8_t*) malloc(slots * len * 4);
+      uint8_t* image = (uint8_t*) calloc(len, 4);
+      if (image && rtFrames) {
+        rtSlots = slots;
+        setRealtimeImage(image, len);
+      } else {
+        DEBUG_PRINTLN(F("Realtime jitter buffer allocation failed."));
+        free(image);
+        freeRealtimeJitterBuffer();
+        rtSlotsFailed = slots;
+      }
+    }
+  }
+  if (!rtCount) return;
+
+  //skip frames superseded by a later frame that is already due
+  unsigned long now = millis();
+  while (rtCount > 1 && (long)(now - rtFramePts[(rtHead + 1) % rtSlots]) >= 0) {
+    rtHead = (rtHead + 1) % rtSlots;
+    rtCount--;
+    rtHeadShown = false;
+  }
+  if ((long)(now - rtFramePts[rtHead]) < 0 || strip.isUpdating()) return;
+
+  bool gamma = !arlsDisableGammaCorrection && strip.gammaCorrectCol;
+  const uint8_t* a = rtFrames + rtHead * rtFrameLen * 4;
+  if (realtimeInterpolate && rtCount > 1) {
+    if (rtHeadShown && now - rtLastOutput < 1000 / strip.getTargetFps()) return;
+    uint8_t next = (rtHead + 1) % rtSlots;
+    const uint8_t* b = rtFrames + next * rtFrameLen * 4;
+    uint16_t t = ((now - rtFramePts[rtHead]) << 8) / (rtFramePts[next] - rtFramePts[rtHead]); // 0-255, next frame is not due yet
+    uint8_t mix[64 * 4];
+    for (uint16_t i = 0; i < rtFrameLen; i += 64) {
+      uint16_t n = MIN(64, rtFrameLen - i);
+      for (uint16_t c = 0; c < n * 4; c++) {
+        int16_t from = a[i * 4 + c];
+        mix[c] = from + (((b[i * 4 + c] - from) * t) >> 8);
+      }
+      strip.setRealtimePixels(i, mix, n, 4, gamma);
+    }
+  } else {
+    if (rtHeadShown) return;
+    strip.setRealtimePixels(0, a, rtFrameLen, 4, gamma);
+  }
+  rtHeadShown = true;
+  rtLastOutput = now;
+  strip.show();
+}
+
 /*********************************************************************************************\
    Refresh aging for remote units, drop if too old...
 \*********************************************************************************************/
@@ -640,7 +1040,7 @@ void sendSysInfoUDP()
 
 
 /*********************************************************************************************\
- * Art-Net, DDP, E131 output - work in progress
+ * Art-Net, DDP, E131 output
 \*********************************************************************************************/
 
 #define DDP_HEADER_LEN 10
@@ -661,6 +1061,83 @@ void sendSysInfoUDP()
 // 1440 channels per packet
 #define DDP_CHANNELS_PER_PACKET 1440 // 480 leds
 
+// Art-Net and E1.31 output, channels per universe
+#define ARTNET_HEADER_LEN 18
+#define ARTNET_SYNCPACKET_LEN 14
+#define E131_HEADER_LEN (E131_DMP_DATA +1) // including the DMX start code
+#define E131_SYNCPACKET_LEN 49
+#define DMX_CHANNELS_PER_UNIVERSE 512
+#define E131_OUT_UNIVERSE 1   // first universe sent by an E1.31 network bus
+#define ARTNET_OUT_UNIVERSE 0 // first universe sent by an Art-Net network bus
+
+static WiFiUDP broadcastUdp; // shared by all network busses, keeps its socket between frames
+
+static inline void put16(byte* p, uint16_t v) { p[0] = v >> 8; p[1] = v; } // MSB first
+
+//
+// Size of the persistent packet buffer of a network bus (one packet of the largest size of the protocol)
+//
+// type   - protocol type (0=DDP, 1=E1.31, 2=ArtNet)
+uint16_t realtimeBroadcastPacketSize(uint8_t type) {
+  switch (type) {
+    case 0:  return DDP_HEADER_LEN + DDP_CHANNELS_PER_PACKET;
+    case 1:  return E131_HEADER_LEN + DMX_CHANNELS_PER_UNIVERSE;
+    case 2:  return ARTNET_HEADER_LEN + DMX_CHANNELS_PER_UNIVERSE;
+  }
+  return 0;
+}
+
+//
+// Prebuild the header fields of a packet buffer that do not change between packets
+//
+void realtimeBroadcastInit(uint8_t type, byte *packet) {
+  memset(packet, 0, realtimeBroadcastPacketSize(type));
+  switch (type) {
+    case 0: // DDP
+      packet[3] = DDP_ID_DISPLAY;
+      break;
+    case 1: // E1.31, root and frame layer as in ESPAsyncE131.h
+    {
+      put16(packet + E131_ROOT_PREAMBLE_SIZE, 0x0010);
+      memcpy_P(packet + E131_ROOT_ID, PSTR("ASC-E1.17\0\0"), 12);
+      packet[E131_ROOT_VECTOR +3] = 4;  // VECTOR_ROOT_E131_DATA
+      memcpy_P(packet + E131_ROOT_CID, PSTR("WLED-E131-"), 10);
+      WiFi.macAddress(packet + E131_ROOT_CID + 10); // unique component id
+      packet[E131_FRAME_VECTOR +3] = 2; // VECTOR_E131_DATA_PACKET
+      strlcpy((char*)packet + E131_FRAME_SOURCE, serverDescription, 64);
+      packet[E131_FRAME_PRIORITY] = 100;
+      packet[E131_DMP_VECTOR] = 2;      // VECTOR_DMP_SET_PROPERTY
+      packet[E131_DMP_TYPE] = 0xa1;
+      put16(packet + E131_DMP_ADDR_INC, 1);
+    } break;
+    case 2: // ArtNet (ArtDmx)
+      memcpy_P(packet, PSTR("Art-Net"), 8);
+      packet[9] = ARTNET_OPCODE_OPDMX >> 8; // opcode, LSB first
+      packet[11] = 14;                      // protocol version
+      break;
+  }
+}
+
+// brightness scaled copy of count pixels from the bus buffer into a packet, 3 channels per pixel dropped W
+static void fillPacket(byte *dst, const byte *src, uint16_t count, uint8_t channelsIn, uint8_t channelsOut, uint8_t bri) {
+  for (uint16_t i = 0; i < count; i++, src += channelsIn) {
+    for (uint8_t c = 0; c < channelsOut; c++) *dst++ = scale8(src[c], bri);
+  }
+}
+
+static bool sendPacket(IPAddress client, uint16_t port, const byte *packet, uint16_t len) {
+  if (!broadcastUdp.beginPacket(client, port)) {
+    DEBUG_PRINTLN(F("WiFiUDP.beginPacket returned an error"));
+    return false;
+  }
+  broadcastUdp.write(packet, len);
+  if (!broadcastUdp.endPacket()) {
+    DEBUG_PRINTLN(F("WiFiUDP.endPacket returned an error"));
+    return false;
+  }
+  return true;
+}
+
 //
 // Send real time UDP updates to the specified client
 //
@@ -669,86 +1146,157 @@ void sendSysInfoUDP()
 // length - the number of pixels
 // buffer - a buffer of at least length*4 bytes long
 // isRGBW - true if the buffer contains 4 components per pixel
+// packet - packet buffer prepared by realtimeBroadcastInit(), E1.31/Art-Net sequence numbers are kept in it
 
 uint8_t sequenceNumber = 0; // this needs to be shared across all outputs
 
-uint8_t realtimeBroadcast(uint8_t type, IPAddress client, uint16_t length, uint8_t *buffer, uint8_t bri, bool isRGBW)  {
-  if (!(apActive || interfacesInited) || !client[0] || !length) return 1;  // network not initialised or dummy/unset IP address  031522 ajn added check for ap
+uint8_t realtimeBroadcast(uint8_t type, IPAddress client, uint16_t length, uint8_t *buffer, uint8_t bri, bool isRGBW, byte *packet)  {
+  if (!(apActive || interfacesInited) || !client[0] || !length || !packet) return 1;  // network not initialised or dummy/unset IP address  031522 ajn added check for ap
 
-  WiFiUDP ddpUdp;
+  uint8_t channelsIn = isRGBW ? 4 : 3;
 
   switch (type) {
     case 0: // DDP
     {
       // calculate the number of UDP packets we need to send
-      uint16_t channelCount = length * 3; // 1 channel for every R,G,B value
+      uint32_t channelCount = length * 3; // 1 channel for every R,G,B value
       uint16_t packetCount = ((channelCount-1) / DDP_CHANNELS_PER_PACKET) +1;
 
-      // there are 3 channels per RGB pixel
       uint32_t channel = 0; // TODO: allow specifying the start channel
-      // the current position in the buffer
-      uint16_t bufferOffset = 0;
-
       for (uint16_t currentPacket = 0; currentPacket < packetCount; currentPacket++) {
         if (sequenceNumber > 15) sequenceNumber = 0;
 
-        if (!ddpUdp.beginPacket(client, DDP_DEFAULT_PORT)) {  // port defined in ESPAsyncE131.h
-          DEBUG_PRINTLN(F("WiFiUDP.beginPacket returned an error"));
-          return 1; // problem
-        }
-
         // the amount of data is AFTER the header in the current packet
         uint16_t packetSize = DDP_CHANNELS_PER_PACKET;
-
         uint8_t flags = DDP_FLAGS1_VER1;
         if (currentPacket == (packetCount - 1)) {
           // last packet, set the push flag
-          // TODO: determine if we want to send an empty push packet to each destination after sending the pixel data
           flags = DDP_FLAGS1_VER1 | DDP_FLAGS1_PUSH;
-          if (channelCount % DDP_CHANNELS_PER_PACKET) {
-            packetSize = channelCount % DDP_CHANNELS_PER_PACKET;
-          }
+          if (channelCount % DDP_CHANNELS_PER_PACKET) packetSize = channelCount % DDP_CHANNELS_PER_PACKET;
         }
 
-        // write the header
-        /*0*/ddpUdp.write(flags);
-        /*1*/ddpUdp.write(sequenceNumber++ & 0x0F); // sequence may be unnecessary unless we are sending twice (as requested in Sync settings)
-        /*2*/ddpUdp.write(0);
-        /*3*/ddpUdp.write(DDP_ID_DISPLAY);
-        // data offset in bytes, 32-bit number, MSB first
-        /*4*/ddpUdp.write(0xFF & (channel >> 24));
-        /*5*/ddpUdp.write(0xFF & (channel >> 16));
-        /*6*/ddpUdp.write(0xFF & (channel >>  8));
-        /*7*/ddpUdp.write(0xFF & (channel      ));
-        // data length in bytes, 16-bit number, MSB first
-        /*8*/ddpUdp.write(0xFF & (packetSize >> 8));
-        /*9*/ddpUdp.write(0xFF & (packetSize     ));
-
-        // write the colors, the write write(const uint8_t *buffer, size_t size)
-        // function is just a loop internally too
-        for (uint16_t i = 0; i < packetSize; i += 3) {
-          ddpUdp.write(scale8(buffer[bufferOffset++], bri)); // R
-          ddpUdp.write(scale8(buffer[bufferOffset++], bri)); // G
-          ddpUdp.write(scale8(buffer[bufferOffset++], bri)); // B
-          if (isRGBW) bufferOffset++;
-        }
-
-        if (!ddpUdp.endPacket()) {
-          DEBUG_PRINTLN(F("WiFiUDP.endPacket returned an error"));
-          return 1; // problem
-        }
+        packet[0] = flags;
+        packet[1] = sequenceNumber++ & 0x0F; // sequence may be unnecessary unless we are sending twice (as requested in Sync settings)
+        put16(packet + 4, channel >> 16);    // data offset in bytes, 32-bit number, MSB first
+        put16(packet + 6, channel);
+        put16(packet + 8, packetSize);       // data length in bytes
+        fillPacket(packet + DDP_HEADER_LEN, buffer + (channel / 3) * channelsIn, packetSize / 3, channelsIn, 3, bri);
 
+        if (!sendPacket(client, DDP_DEFAULT_PORT, packet, DDP_HEADER_LEN + packetSize)) return 1; // problem
         channel += packetSize;
       }
     } break;
 
     case 1: //E1.31
-    {
-    } break;
-
     case 2: //ArtNet
     {
+      uint16_t ledsPerUniverse = DMX_CHANNELS_PER_UNIVERSE / channelsIn; // 170 RGB or 128 RGBW
+      uint16_t universeCount = (length -1) / ledsPerUniverse +1;
+      uint16_t universe = (type == 1) ? E131_OUT_UNIVERSE : ARTNET_OUT_UNIVERSE;
+      uint8_t *seq = packet + ((type == 1) ? E131_FRAME_SEQ : 12);
+      if (!++(*seq)) (*seq)++; // one sequence number per frame, skipping 0 (Art-Net: sequence disabled)
+
+      for (uint16_t u = 0; u < universeCount; u++, universe++) {
+        uint16_t leds = MIN(ledsPerUniverse, length - u * ledsPerUniverse);
+        uint16_t channels = leds * channelsIn;
+        const byte *src = buffer + u * ledsPerUniverse * channelsIn;
+        uint16_t len;
+
+        if (type == 1) {
+          len = E131_HEADER_LEN + channels;
+          put16(packet + E131_ROOT_FLENGTH, 0x7000 | (len - E131_ROOT_FLENGTH));
+          put16(packet + E131_FRAME_FLENGTH, 0x7000 | (len - E131_FRAME_FLENGTH));
+          put16(packet + E131_FRAME_RESERVED, networkOutputSync ? E131_OUT_UNIVERSE : 0); // synchronization address
+          put16(packet + E131_FRAME_UNIVERSE, universe);
+          put16(packet + E131_DMP_FLENGTH, 0x7000 | (len - E131_DMP_FLENGTH));
+          put16(packet + E131_DMP_COUNT, channels +1);
+          fillPacket(packet + E131_HEADER_LEN, src, leds, channelsIn, channelsIn, bri);
+          if (!sendPacket(client, E131_DEFAULT_PORT, packet, len)) return 1;
+        } else {
+          if (channels & 1) packet[ARTNET_HEADER_LEN + channels++] = 0; // ArtDmx length must be even
+          len = ARTNET_HEADER_LEN + channels;
+          packet[14] = universe;      // SubUni
+          packet[15] = universe >> 8; // Net
+          put16(packet + 16, channels);
+          fillPacket(packet + ARTNET_HEADER_LEN, src, leds, channelsIn, channelsIn, bri);
+          if (!sendPacket(client, ARTNET_DEFAULT_PORT, packet, len)) return 1;
+        }
+      }
+
+      if (!networkOutputSync) break;
+      // all universes sent, receivers show them at once
+      byte sync[E131_SYNCPACKET_LEN] = {0};
+      if (type == 1) {
+        memcpy(sync, packet, E131_FRAME_FLENGTH); // preamble, ACN id and CID
+        put16(sync + E131_ROOT_FLENGTH, 0x7000 | (E131_SYNCPACKET_LEN - E131_ROOT_FLENGTH));
+        sync[E131_ROOT_VECTOR +3] = 8; // VECTOR_ROOT_E131_EXTENDED
+        put16(sync + E131_FRAME_FLENGTH, 0x7000 | (E131_SYNCPACKET_LEN - E131_FRAME_FLENGTH));
+        sync[E131_FRAME_VECTOR +3] = 1; // VECTOR_E131_EXTENDED_SYNCHRONIZATION
+        sync[E131_SYNC_SEQ] = *seq;
+        put16(sync + E131_SYNC_ADDRESS, E131_OUT_UNIVERSE);
+        if (!sendPacket(client, E131_DEFAULT_PORT, sync, E131_SYNCPACKET_LEN)) return 1;
+      } else {
+        memcpy(sync, packet, 12); // id and protocol version
+        sync[9] = ARTNET_OPCODE_OPSYNC >> 8;
+        if (!sendPacket(client, ARTNET_DEFAULT_PORT, sync, ARTNET_SYNCPACKET_LEN)) return 1;
+      }
     } break;
   }
   return 0;
 }
+
+//
+// Network busses queue their frame in show(), the whole batch is sent by a task after all busses are shown,
+// so network transmission does not stall the render loop (ESP32, ESP8266 sends from show())
+//
+#ifdef ARDUINO_ARCH_ESP32
+static BusNetwork* networkOutputBatch[WLED_MAX_BUSSES];
+static uint8_t networkOutputCount = 0;
+static portMUX_TYPE networkOutputMux = portMUX_INITIALIZER_UNLOCKED; // batch is filled by the loop while the task may be sending
+static TaskHandle_t networkOutputTask = nullptr;
+
+static void sendNetworkOutput() {
+  BusNetwork* batch[WLED_MAX_BUSSES];
+  uint8_t n;
+  portENTER_CRITICAL(&networkOutputMux); // take the batch, busses queued from now on are sent next time
+  n = networkOutputCount;
+  memcpy(batch, networkOutputBatch, n * sizeof(BusNetwork*));
+  networkOutputCount = 0;
+  portEXIT_CRITICAL(&networkOutputMux);
+
+  for (uint8_t i = 0; i < n; i++) batch[i]->send();
+  for (uint8_t i = 0; i < n; i++) batch[i]->unlock(); // busses may be deleted from here on
+}
+
+static void networkOutputLoop(void*) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    sendNetworkOutput();
+  }
+}
+#endif
+
+void queueNetworkOutput(BusNetwork* bus) {
+  #ifdef ARDUINO_ARCH_ESP32
+  bool queued = false;
+  portENTER_CRITICAL(&networkOutputMux);
+  if (networkOutputCount < WLED_MAX_BUSSES) {
+    networkOutputBatch[networkOutputCount++] = bus;
+    queued = true;
+  }
+  portEXIT_CRITICAL(&networkOutputMux);
+  if (!queued) bus->unlock();
+  #endif
+}
+
+void flushNetworkOutput() {
+  #ifdef ARDUINO_ARCH_ESP32
+  portENTER_CRITICAL(&networkOutputMux);
+  uint8_t n = networkOutputCount;
+  portEXIT_CRITICAL(&networkOutputMux);
+  if (!n) return;
+  if (!networkOutputTask) xTaskCreatePinnedToCore(networkOutputLoop, "netOut", 4096, nullptr, 1, &networkOutputTask, 0); // WiFi core
+  if (networkOutputTask) xTaskNotifyGive(networkOutputTask);
+  else sendNetworkOutput();
+  #endif
+}
@@ -116,6 +116,10 @@ void userLoop() {
     disableSoundProcessing = true;   // make sure everything is disabled IF in audio Receive mode
   if (audioSyncEnabled & (1 << 0)  && audioSource->isInitialized()) 
     disableSoundProcessing = false;  // keep running audio IF we're in audio Transmit mode
+#ifdef WLED_ENABLE_FX_BENCHMARK
+  if (strip.isGoldenRunning())
+    disableSoundProcessing = true;   // effects get scripted audio input during a golden run
+#endif
 
   int userloopDelay = int(millis() - lastUMRun);
   if (lastUMRun == 0) userloopDelay=0; // startup - don't have valid data from last run.
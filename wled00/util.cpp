@@ -3,25 +3,88 @@
 #include "const.h"
 
 //threading/network callback details: https://github.com/Aircoookie/WLED/pull/2336#discussion_r762276994
+// JSON arena pool: arena 0 is the global doc (exclusive, used for state changes and fileDoc),
+// further arenas are allocated on first contention and only hand out to read-only serialization (web UI, /json)
+static JsonDocument* jsonPool[JSON_POOL_SIZE] = {nullptr};
+static volatile uint8_t jsonPoolLock[JSON_POOL_SIZE] = {0}; // [0] unused, doc is guarded by jsonBufferLock
+static uint32_t jsonAcquired = 0, jsonContended = 0, jsonFailed = 0;
+static uint32_t jsonWaits = 0, jsonWaitTotal = 0, jsonWaitMax = 0; // ms spent waiting for doc
+
+// work that could not get a JSON buffer without blocking, run from the main loop once doc is free
+struct JsonDeferred {
+  void (*fn)(uint32_t);
+  uint32_t arg;
+};
+static JsonDeferred jsonDeferred[JSON_DEFER_QUEUE];
+static uint8_t jsonDeferredCount = 0;
+static uint32_t jsonDeferredTotal = 0, jsonDeferredDropped = 0;
+
+#ifdef ARDUINO_ARCH_ESP32
+static portMUX_TYPE jsonPoolMux = portMUX_INITIALIZER_UNLOCKED;
+#define JSON_POOL_ENTER portENTER_CRITICAL(&jsonPoolMux)
+#define JSON_POOL_EXIT  portEXIT_CRITICAL(&jsonPoolMux)
+#else
+#define JSON_POOL_ENTER
+#define JSON_POOL_EXIT
+#endif
+
+// takes doc if it is free, does not wait
+static bool takeJSONBufferLock(uint8_t module)
+{
+  bool taken = false;
+  JSON_POOL_ENTER;
+  if (!jsonBufferLock) {
+    jsonBufferLock = module ? module : 255;
+    taken = true;
+  }
+  JSON_POOL_EXIT;
+  return taken;
+}
+
 bool requestJSONBufferLock(uint8_t module)
 {
   unsigned long now = millis();
+  bool contended = false;
 
-  while (jsonBufferLock && millis()-now < 1000) delay(1); // wait for a second for buffer lock
-
-  if (millis()-now >= 1000) {
-    DEBUG_PRINT(F("ERROR: Locking JSON buffer failed! ("));
-    DEBUG_PRINT(jsonBufferLock);
-    DEBUG_PRINTLN(")");
-    return false; // waiting time-outed
+  while (!takeJSONBufferLock(module)) { // wait for a second for buffer lock
+    contended = true;
+    if (millis()-now >= 1000) {
+      DEBUG_PRINT(F("ERROR: Locking JSON buffer failed! ("));
+      DEBUG_PRINT(jsonBufferLock);
+      DEBUG_PRINTLN(")");
+      jsonContended++;
+      jsonFailed++;
+      return false; // waiting time-outed
+    }
+    delay(1);
   }
 
-  jsonBufferLock = module ? module : 255;
+  jsonAcquired++;
+  if (contended) {
+    uint32_t waited = millis()-now;
+    jsonContended++;
+    jsonWaits++;
+    jsonWaitTotal += waited;
+    if (waited > jsonWaitMax) jsonWaitMax = waited;
+  }
   fileDoc = &doc;  // used for applying presets (presets.cpp)
   doc.clear();
   return true;
 }
 
+// same as requestJSONBufferLock() but returns immediately if doc is in use
+bool tryJSONBufferLock(uint8_t module)
+{
+  if (!takeJSONBufferLock(module)) {
+    jsonContended++;
+    return false;
+  }
+  jsonAcquired++;
+  fileDoc = &doc;
+  doc.clear();
+  return true;
+}
+
 
 void releaseJSONBufferLock()
 {
@@ -33,6 +96,156 @@ void releaseJSONBufferLock()
 }
 
 
+#if JSON_POOL_SIZE > 1
+static JsonDocument* allocateJSONArena()
+{
+  #if defined(ARDUINO_ARCH_ESP32) && defined(WLED_USE_PSRAM)
+  if (!psramFound() && ESP.getFreeHeap() < 2*JSON_BUFFER_SIZE) return nullptr;
+  #else
+  if (ESP.getFreeHeap() < 2*JSON_BUFFER_SIZE) return nullptr; // keep as much heap free as the arena takes
+  #endif
+  JsonDocument *arena = new PSRAMDynamicJsonDocument(JSON_BUFFER_SIZE);
+  if (arena && !arena->capacity()) { delete arena; arena = nullptr; }
+  DEBUG_PRINT(F("JSON arena allocated: "));
+  DEBUG_PRINTLN(arena != nullptr);
+  return arena;
+}
+#endif
+
+// takes a free pool arena, allocating it on first use
+static JsonDocument* takeJSONArena(uint8_t module)
+{
+  #if JSON_POOL_SIZE > 1
+  for (uint8_t i = 1; i < JSON_POOL_SIZE; i++) {
+    bool taken = false;
+    JSON_POOL_ENTER;
+    if (!jsonPoolLock[i]) {
+      jsonPoolLock[i] = module ? module : 255;
+      taken = true;
+    }
+    JSON_POOL_EXIT;
+    if (!taken) continue;
+
+    if (!jsonPool[i]) jsonPool[i] = allocateJSONArena();
+    if (!jsonPool[i]) { // out of memory, further arenas would not fit either
+      jsonPoolLock[i] = 0;
+      break;
+    }
+    jsonPool[i]->clear();
+    return jsonPool[i];
+  }
+  #endif
+  return nullptr;
+}
+
+// returns a cleared JSON document for read-only serialization: doc if it is free, otherwise a pool arena,
+// nullptr if all stay busy for waitMs (0 returns immediately, the caller may defer the work)
+// must not be used for deserializeState() as it does not set fileDoc
+JsonDocument* requestJSONBuffer(uint8_t module, uint16_t waitMs)
+{
+  unsigned long now = millis();
+  bool contended = false;
+  JsonDocument *arena = nullptr;
+
+  while (true) {
+    if (takeJSONBufferLock(module)) {
+      doc.clear();
+      arena = &doc;
+      break;
+    }
+    if (!contended) jsonContended++;
+    contended = true;
+    arena = takeJSONArena(module);
+    if (arena || millis()-now >= waitMs) break;
+    delay(1);
+  }
+
+  if (!arena) {
+    jsonFailed++;
+    return nullptr;
+  }
+  jsonAcquired++;
+  uint32_t waited = millis()-now;
+  if (contended && waited) {
+    jsonWaits++;
+    jsonWaitTotal += waited;
+    if (waited > jsonWaitMax) jsonWaitMax = waited;
+  }
+  return arena;
+}
+
+
+void releaseJSONBuffer(JsonDocument* arena)
+{
+  #ifndef WLED_USE_DYNAMIC_JSON
+  if (arena == &doc) {
+    releaseJSONBufferLock();
+    return;
+  }
+  #endif
+  for (uint8_t i = 1; i < JSON_POOL_SIZE; i++) {
+    if (jsonPool[i] == arena) {
+      jsonPoolLock[i] = 0;
+      return;
+    }
+  }
+}
+
+
+// queues fn(arg) to be retried from the main loop, identical pending entries are merged
+bool deferJSONWork(void (*fn)(uint32_t), uint32_t arg)
+{
+  bool queued = false;
+  JSON_POOL_ENTER;
+  for (uint8_t i = 0; i < jsonDeferredCount; i++) {
+    if (jsonDeferred[i].fn == fn && jsonDeferred[i].arg == arg) { queued = true; break; }
+  }
+  if (!queued && jsonDeferredCount < JSON_DEFER_QUEUE) {
+    jsonDeferred[jsonDeferredCount].fn  = fn;
+    jsonDeferred[jsonDeferredCount].arg = arg;
+    jsonDeferredCount++;
+    jsonDeferredTotal++;
+    queued = true;
+  } else if (!queued) {
+    jsonDeferredDropped++;
+  }
+  JSON_POOL_EXIT;
+  return queued;
+}
+
+
+void handleJSONDeferred()
+{
+  if (!jsonDeferredCount || jsonBufferLock) return; // retry once doc is free
+
+  JsonDeferred pending[JSON_DEFER_QUEUE];
+  uint8_t count;
+  JSON_POOL_ENTER;
+  count = jsonDeferredCount;
+  memcpy(pending, jsonDeferred, count * sizeof(JsonDeferred));
+  jsonDeferredCount = 0;
+  JSON_POOL_EXIT;
+
+  for (uint8_t i = 0; i < count; i++) pending[i].fn(pending[i].arg); // may defer again if doc got taken meanwhile
+}
+
+
+void serializeJSONBufferStats(JsonObject root)
+{
+  uint8_t arenas = 1;
+  for (uint8_t i = 1; i < JSON_POOL_SIZE; i++) if (jsonPool[i]) arenas++;
+  root[F("n")]     = arenas;
+  root[F("lock")]  = jsonBufferLock;   // module currently holding doc
+  root[F("acq")]   = jsonAcquired;
+  root[F("cont")]  = jsonContended;    // requests that found doc in use
+  root[F("fail")]  = jsonFailed;       // requests that got no buffer at all
+  root[F("wmax")]  = jsonWaitMax;      // ms
+  root[F("wavg")]  = jsonWaits ? jsonWaitTotal / jsonWaits : 0;
+  root[F("dfr")]   = jsonDeferredTotal;
+  root[F("ddrop")] = jsonDeferredDropped;
+}
+
+
 // extracts effect mode (or palette) name from names serialized string
 // caller must provide large enough buffer for name (incluing SR extensions)!
 uint8_t extractModeName(uint8_t mode, const char *src, char *dest, uint8_t maxLen)
@@ -241,6 +241,7 @@ void WLED::loop()
   }
 
   yield();
+  handleJSONDeferred();
   handleWs();
   handleStatusLED();
 
@@ -335,7 +336,10 @@ void WLED::setup()
   if (!fsinit) {
     DEBUGFS_PRINTLN(F("FS failed!"));
     errorFlag = ERR_FS_BEGIN;
-  } else deEEP();
+  } else {
+    deEEP();
+    buildPresetIndex();
+  }
   updateFSInfo();
 
   DEBUG_PRINTLN(F("Reading config"));
@@ -467,13 +471,13 @@ void WLED::initAP(bool resetAP)
     DEBUG_PRINTLN(F("Init AP interfaces"));
     server.begin();
     if (udpPort > 0 && udpPort != ntpLocalPort) {
-      udpConnected = notifierUdp.begin(udpPort);
+      udpConnected = udpListen(UDP_SOURCE_NOTIFIER, udpPort);
     }
     if (udpRgbPort > 0 && udpRgbPort != ntpLocalPort && udpRgbPort != udpPort) {
-      udpRgbConnected = rgbUdp.begin(udpRgbPort);
+      udpRgbConnected = udpListen(UDP_SOURCE_RGB, udpRgbPort);
     }
     if (udpPort2 > 0 && udpPort2 != ntpLocalPort && udpPort2 != udpPort && udpPort2 != udpRgbPort) {
-      udp2Connected = notifier2Udp.begin(udpPort2);
+      udp2Connected = udpListen(UDP_SOURCE_NOTIFIER2, udpPort2);
     }
 
     if (audioSyncPort > 0 || (((audioSyncEnabled)>>(0)) & 1) || (((audioSyncEnabled)>>(1)) & 1)) {
@@ -674,11 +678,11 @@ void WLED::initInterfaces()
   server.begin();
 
   if (udpPort > 0 && udpPort != ntpLocalPort) {
-    udpConnected = notifierUdp.begin(udpPort);
+    udpConnected = udpListen(UDP_SOURCE_NOTIFIER, udpPort);
     if (udpConnected && udpRgbPort != udpPort)
-      udpRgbConnected = rgbUdp.begin(udpRgbPort);
+      udpRgbConnected = udpListen(UDP_SOURCE_RGB, udpRgbPort);
     if (udpConnected && udpPort2 != udpPort && udpPort2 != udpRgbPort)
-      udp2Connected = notifier2Udp.begin(udpPort2);
+      udp2Connected = udpListen(UDP_SOURCE_NOTIFIER2, udpPort2);
   }
   if (audioSyncPort > 0 || (((audioSyncEnabled)>>(0)) & 1) || (((audioSyncEnabled)>>(1)) & 1)) {
     #ifndef ESP8266
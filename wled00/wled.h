@@ -42,6 +42,7 @@
 #define WLED_ENABLE_ADALIGHT     // saves 500b only (uses GPIO3 (RX) for serial)
 //#define WLED_ENABLE_DMX          // uses 3.5kb (use LEDPIN other than 2)
 //#define WLED_ENABLE_JSONLIVE     // peek LED output via /json/live (WS binary peek is always enabled)
+//#define WLED_ENABLE_FX_BENCHMARK // time every effect on the main segment via {"fxbench":<frames>}, {"fxgold":<frames>} adds frame hashes, results in /json/fxbench
 #ifndef WLED_DISABLE_LOXONE
   #define WLED_ENABLE_LOXONE       // uses 1.2kb
 #endif
@@ -374,6 +375,8 @@ WLED_GLOBAL uint16_t udpPort2   _INIT(65506); // WLED notifier supplemental port
 WLED_GLOBAL uint16_t udpRgbPort _INIT(19446); // Hyperion port
 
 WLED_GLOBAL uint8_t syncGroups    _INIT(0x01);                    // sync groups this instance syncs (bit mapped)
+WLED_GLOBAL bool clockSyncEnabled _INIT(false);                   // share one clock between controllers (leader election over the notifier port)
+WLED_GLOBAL uint8_t clockSyncPriority _INIT(128);                 // clock sync leader election, lowest wins (ties: lowest IP)
 WLED_GLOBAL uint8_t receiveGroups _INIT(0x01);                    // sync receive groups this instance belongs to (bit mapped)
 WLED_GLOBAL bool receiveNotificationBrightness _INIT(true);       // apply brightness from incoming notifications
 WLED_GLOBAL bool receiveNotificationColor      _INIT(true);       // apply color
@@ -401,6 +404,10 @@ WLED_GLOBAL int arlsOffset _INIT(0);                              // realtime LE
 WLED_GLOBAL bool receiveDirect _INIT(true);                       // receive UDP realtime
 WLED_GLOBAL bool arlsDisableGammaCorrection _INIT(true);          // activate if gamma correction is handled by the source
 WLED_GLOBAL bool arlsForceMaxBri _INIT(false);                    // enable to force max brightness if source has very dark colors that would be black
+WLED_GLOBAL byte realtimeJitterFrames _INIT(0);                   // realtime frames buffered against network jitter (0 = show on arrival, 2-4)
+WLED_GLOBAL bool realtimeInterpolate _INIT(false);                // interpolate between buffered realtime frames at the target FPS
+WLED_GLOBAL byte* rtImage _INIT(nullptr);                         // realtime packets are written here while the jitter buffer is active
+WLED_GLOBAL uint16_t rtFrameLen _INIT(0);                         // LEDs in rtImage
 
 #ifdef WLED_ENABLE_DMX
  #ifdef ESP8266
@@ -418,6 +425,8 @@ WLED_GLOBAL byte DMXOldDimmer _INIT(0);                           // only update
 WLED_GLOBAL byte e131LastSequenceNumber[E131_MAX_UNIVERSE_COUNT]; // to detect packet loss
 WLED_GLOBAL bool e131Multicast _INIT(false);                      // multicast or unicast
 WLED_GLOBAL bool e131SkipOutOfSequence _INIT(false);              // freeze instead of flickering
+WLED_GLOBAL uint16_t e131FrameTimeout _INIT(50);                  // ms to wait for missing universes / sync before a realtime frame is shown anyway
+WLED_GLOBAL bool networkOutputSync _INIT(false);                  // network busses send E1.31 universe sync / ArtSync after each frame
 
 WLED_GLOBAL bool mqttEnabled _INIT(false);
 WLED_GLOBAL char mqttDeviceTopic[33] _INIT("");            // main MQTT topic (individual per device, default is wled/mac)
@@ -670,12 +679,15 @@ WLED_GLOBAL AsyncClient* hueClient _INIT(NULL);
 WLED_GLOBAL AsyncMqttClient* mqtt _INIT(NULL);
 
 // udp interface objects
-WLED_GLOBAL WiFiUDP notifierUdp, rgbUdp, notifier2Udp;
+WLED_GLOBAL WiFiUDP notifierUdp, notifier2Udp; // send only, notifier ports are received by udpListen()
 WLED_GLOBAL WiFiUDP ntpUdp;
 WLED_GLOBAL WiFiUDP fftUdp;
 WLED_GLOBAL ESPAsyncE131 e131 _INIT_N(((handleE131Packet)));
 WLED_GLOBAL ESPAsyncE131 ddp  _INIT_N(((handleE131Packet)));
 WLED_GLOBAL bool e131NewData _INIT(false);
+WLED_GLOBAL uint32_t e131FramesComplete _INIT(0);   // realtime frames shown complete (all universes, sync or DDP push)
+WLED_GLOBAL uint32_t e131FramesIncomplete _INIT(0); // realtime frames shown with universes missing
+WLED_GLOBAL uint32_t e131FramesLate _INIT(0);       // realtime frames shown by e131FrameTimeout
 
 // led fx library object
 WLED_GLOBAL BusManager busses _INIT(BusManager());
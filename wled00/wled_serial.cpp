@@ -1,7 +1,10 @@
 #include "wled.h"
 
 /*
- * Adalight and TPM2 handler
+ * Adalight, TPM2 and binary frame handler
+ *
+ * Binary frames (for 2-4 Mbaud): 0xCB, flags (bit 0-2 channels per pixel, 3 or 4, bit 7 show), first pixel (2 bytes),
+ * pixel count (2 bytes), pixel data, CRC-16/CCITT-FALSE of everything after the start byte (2 bytes). All values MSB first.
  */
 
 enum class AdaState {
@@ -11,14 +14,51 @@ enum class AdaState {
   Header_CountHi,
   Header_CountLo,
   Header_CountCheck,
-  Data_Red,
-  Data_Green,
-  Data_Blue,
+  Data,               //frame payload, read in blocks
   TPM2_Header_Type,
   TPM2_Header_CountHi,
   TPM2_Header_CountLo,
+  TPM2_Footer,
+  Binary_Header,
 };
 
+enum class SerialFrame {
+  Adalight,
+  TPM2,
+  Binary
+};
+
+#define SERIAL_BINARY_START 0xCB
+#define SERIAL_BINARY_HEADER 5 //flags, first pixel, pixel count
+#define SERIAL_BINARY_SHOW 0x80
+
+static byte* serialFrame = nullptr; //payload of the frame being received
+static uint16_t serialFrameSize = 0;
+
+static bool allocateSerialFrame(uint16_t len) {
+  if (len <= serialFrameSize) return true;
+  free(serialFrame);
+  serialFrame = (byte*) malloc(len);
+  serialFrameSize = serialFrame ? len : 0;
+  return serialFrame != nullptr;
+}
+
+static uint16_t crc16(uint16_t crc, const byte* data, uint16_t len) {
+  while (len--) {
+    crc ^= *data++ << 8;
+    for (uint8_t i = 0; i < 8; i++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+//applies a complete, validated frame in one bulk write
+static void handleSerialFrame(const byte* data, uint16_t start, uint16_t pixels, uint8_t channels, bool show) {
+  realtimeLock(realtimeTimeoutMs, REALTIME_MODE_ADALIGHT);
+  if (realtimeOverride) return;
+  setRealtimePixels(start, data, pixels, channels);
+  if (show) realtimeShow();
+}
+
 uint16_t currentBaud = 1152; //default baudrate 115200 (divided by 100)
 
 void updateBaudRate(uint32_t rate){
@@ -31,6 +71,12 @@ void updateBaudRate(uint32_t rate){
   }
 
   Serial.flush();
+  #ifdef ARDUINO_ARCH_ESP32
+  if (rate > 1000000) { //a 1000 LED frame arrives within a few ms, more than the default RX buffer
+    Serial.end();
+    Serial.setRxBufferSize(2048);
+  }
+  #endif
   Serial.begin(rate);
 }
 
@@ -40,14 +86,27 @@ void handleSerial()
 
   #ifdef WLED_ENABLE_ADALIGHT
   static auto state = AdaState::Header_A;
-  static uint16_t count = 0;
-  static uint16_t pixel = 0;
+  static auto frame = SerialFrame::Adalight;
+  static uint16_t count = 0;   //payload bytes
+  static uint16_t fill = 0;    //payload bytes received
   static byte check = 0x00;
-  static byte red   = 0x00;
-  static byte green = 0x00;
+  static byte header[SERIAL_BINARY_HEADER];
 
   while (Serial.available() > 0)
   {
+    if (state == AdaState::Data) {
+      fill += Serial.readBytes(serialFrame + fill, min((int)(count - fill), Serial.available()));
+      if (fill < count) continue;
+      state = AdaState::Header_A;
+      if (frame == SerialFrame::TPM2) state = AdaState::TPM2_Footer; //frame is committed once its end byte arrived
+      else if (frame == SerialFrame::Adalight) handleSerialFrame(serialFrame, 0, count / 3, 3, true);
+      else if (crc16(crc16(0xFFFF, header, SERIAL_BINARY_HEADER), serialFrame, count - 2) == ((serialFrame[count - 2] << 8) | serialFrame[count - 1]))
+        handleSerialFrame(serialFrame, (header[1] << 8) | header[2], (header[3] << 8) | header[4], header[0] & 0x07, header[0] & SERIAL_BINARY_SHOW);
+      else DEBUG_PRINTLN(F("Serial frame CRC mismatch."));
+      yield();
+      continue;
+    }
+
     yield();
     byte next = Serial.peek();
     switch (state) {
@@ -56,6 +115,10 @@ void handleSerial()
         else if (next == 0xC9) { //TPM2 start byte
           state = AdaState::TPM2_Header_Type;
         }
+        else if (next == SERIAL_BINARY_START) {
+          fill = 0;
+          state = AdaState::Binary_Header;
+        }
         else if (next == 'I') {
           handleImprovPacket();
           return;
@@ -70,6 +133,9 @@ void handleSerial()
         } else if (next == 0xB5) {updateBaudRate( 921600);
         } else if (next == 0xB6) {updateBaudRate(1000000);
         } else if (next == 0xB7) {updateBaudRate(1500000);
+        } else if (next == 0xB8) {updateBaudRate(2000000);
+        } else if (next == 0xB9) {updateBaudRate(3000000);
+        } else if (next == 0xBA) {updateBaudRate(4000000);
 
         } else if (next == 'l') { //RGB(W) LED data return as JSON array. Slow, but easy to use on the other end.
           if (!pinManager.isPinAllocated(1) || pinManager.getPinOwner(1) == PinOwner::DebugOut){
@@ -133,19 +199,23 @@ void handleSerial()
         else             state = AdaState::Header_A;
         break;
       case AdaState::Header_CountHi:
-        pixel = 0;
         count = next * 0x100;
         check = next;
         state = AdaState::Header_CountLo;
         break;
       case AdaState::Header_CountLo:
-        count += next + 1;
+        count += next;
         check = check ^ next ^ 0x55;
         state = AdaState::Header_CountCheck;
         break;
       case AdaState::Header_CountCheck:
-        if (check == next) state = AdaState::Data_Red;
-        else               state = AdaState::Header_A;
+        state = AdaState::Header_A;
+        if (check == next && count < MAX_LEDS) {
+          count = (count + 1) * 3;
+          fill = 0;
+          frame = SerialFrame::Adalight;
+          if (allocateSerialFrame(count)) state = AdaState::Data;
+        }
         break;
       case AdaState::TPM2_Header_Type:
         state = AdaState::Header_A; //(unsupported) TPM2 command or invalid type
@@ -153,31 +223,32 @@ void handleSerial()
         else if (next == 0xAA) Serial.write(0xAC); //TPM2 ping
         break;
       case AdaState::TPM2_Header_CountHi:
-        pixel = 0;
-        count = (next * 0x100) /3;
+        count = next * 0x100;
         state = AdaState::TPM2_Header_CountLo;
         break;
       case AdaState::TPM2_Header_CountLo:
-        count += next /3;
-        state = AdaState::Data_Red;
-        break;
-      case AdaState::Data_Red:
-        red   = next;
-        state = AdaState::Data_Green;
+        count += next;
+        fill = 0;
+        frame = SerialFrame::TPM2;
+        state = AdaState::Header_A; //empty or oversized frame
+        if (count > 0 && count <= MAX_LEDS * 3 && allocateSerialFrame(count)) state = AdaState::Data;
         break;
-      case AdaState::Data_Green:
-        green = next;
-        state = AdaState::Data_Blue;
+      case AdaState::TPM2_Footer:
+        state = AdaState::Header_A;
+        if (next == 0x36 && frame == SerialFrame::TPM2 && count > 0 && fill == count) handleSerialFrame(serialFrame, 0, count / 3, 3, true);
         break;
-      case AdaState::Data_Blue:
-        byte blue  = next;
-        if (!realtimeOverride) setRealtimePixel(pixel++, red, green, blue, 0);
-        if (--count > 0) state = AdaState::Data_Red;
-        else {
-          realtimeLock(realtimeTimeoutMs, REALTIME_MODE_ADALIGHT);
-
-          if (!realtimeOverride) strip.show();
-          state = AdaState::Header_A;
+      case AdaState::Binary_Header:
+        header[fill++] = next;
+        if (fill < SERIAL_BINARY_HEADER) break;
+        state = AdaState::Header_A;
+        {
+          uint8_t channels = header[0] & 0x07;
+          uint16_t pixels = (header[3] << 8) | header[4];
+          if ((channels != 3 && channels != 4) || pixels > MAX_LEDS) break;
+          count = pixels * channels + 2; //payload and CRC
+          fill = 0;
+          frame = SerialFrame::Binary;
+          if (allocateSerialFrame(count)) state = AdaState::Data;
         }
         break;
     }
@@ -31,10 +31,39 @@ void handleUpload(AsyncWebServerRequest *request, const String& filename, size_t
   }
   if(final){
     request->_tempFile.close();
+    if (filename == "/presets.json") {
+      invalidatePresetIndex();
+      invalidatePresetSnapshots();
+    }
     request->send(200, "text/plain", F("File Uploaded!"));
   }
 }
 
+#ifdef WLED_ENABLE_FS_EDITOR
+// SPIFFSEditor with the cached presets dropped after every change it makes, it may have replaced or deleted presets.json
+class PresetsEditor : public AsyncWebHandler {
+  private:
+    SPIFFSEditor editor;
+  public:
+   #ifdef ARDUINO_ARCH_ESP32
+    PresetsEditor() : editor(WLED_FS) {}
+   #else
+    PresetsEditor() : editor("","",WLED_FS) {}
+   #endif
+    bool canHandle(AsyncWebServerRequest *request) override { return editor.canHandle(request); }
+    void handleUpload(AsyncWebServerRequest *request, const String& filename, size_t index, uint8_t *data, size_t len, bool final) override {
+      editor.handleUpload(request, filename, index, data, len, final);
+    }
+    void handleRequest(AsyncWebServerRequest *request) override {
+      editor.handleRequest(request);
+      if (request->method() == HTTP_GET) return; // POST uploads, PUT creates, DELETE deletes
+      invalidatePresetIndex();
+      invalidatePresetSnapshots();
+    }
+    bool isRequestHandlerTrivial() override { return false; }
+};
+#endif
+
 bool captivePortal(AsyncWebServerRequest *request)
 {
   if (ON_STA_FILTER(request)) return false; //only serve captive in AP mode
@@ -180,11 +209,7 @@ void initServer()
   //if OTA is allowed
   if (!otaLock){
     #ifdef WLED_ENABLE_FS_EDITOR
-     #ifdef ARDUINO_ARCH_ESP32
-      server.addHandler(new SPIFFSEditor(WLED_FS));//http_username,http_password));
-     #else
-      server.addHandler(new SPIFFSEditor("","",WLED_FS));//http_username,http_password));
-     #endif
+      server.addHandler(new PresetsEditor());//http_username,http_password));
     #else
     server.on("/edit", HTTP_GET, [](AsyncWebServerRequest *request){
       serveMessage(request, 501, "Not implemented", F("The FS editor is disabled in this build."), 254);
@@ -10,15 +10,104 @@ unsigned long wsLastLiveTime = 0;
 //uint8_t* wsFrameBuffer = nullptr;
 
 #define WS_LIVE_INTERVAL 40
+#define WS_PUSH_INTERVAL 33    // state broadcasts are coalesced to one per UI frame
+#define WS_INFO_INTERVAL 5000  // deltas carry info only this often
+#define WS_MAX_CLIENTS   8     // clients tracked for delta updates
+#define WS_DELTA_KEYS    32    // top level state keys tracked for delta updates
+
+// Live view protocol v2 (client sends {"lv":2}):
+// 'L', 2, width (16 bit LE), height (16 bit LE), scale, flags (bit 0: key frame), RLE payload
+// The payload covers ceil(width/scale) x ceil(height/scale) RGB pixels, each the average of a scale x scale area.
+// Tokens: 0x00-0x7F literal run of n+1 pixels, 0x80-0xBF n+1 times the following pixel,
+//         0xC0-0xFF n+1 pixels unchanged since the previous frame (not in key frames)
+#ifdef ESP8266
+  #define MAX_LIVE_LEDS_WS2 1024
+#else
+  #define MAX_LIVE_LEDS_WS2 2048 // 128x64 at scale 2
+#endif
+#define WS_LIVE_HEADER       8
+#define WS_LIVE_KEYFRAME     2000 // ms between key frames
+#define WS_LIVE_MAX_INTERVAL 500  // slowest frame interval for clients that do not keep up
+
+static uint8_t wsLiveVersion = 1;
+static volatile bool wsLiveKey = true;
+static uint8_t* wsLiveCur = nullptr;   // downscaled frames, current and last sent
+static uint8_t* wsLivePrev = nullptr;
+static uint16_t wsLiveCount = 0;
+static unsigned long wsLiveKeyTime = 0;
+static uint16_t wsLiveInterval = WS_LIVE_INTERVAL;
+
+// Delta updates: clients that send {"dlt":true} get {"d":rev,"state":{changed keys},"info":{...}} instead of full
+// state+info broadcasts. Changes are found by hashing the serialized value of each state key and segment,
+// segments are sent whole and removed ones as {"id":n,"stop":0}. "f":true marks a complete state (resync).
+struct WsClientSlot {
+  uint32_t id;
+  bool delta;
+};
+static WsClientSlot wsClients[WS_MAX_CLIENTS] = {{0, false}};
+static volatile bool wsUpdatePending = false;
+static volatile bool wsDeltaReset = true; // next delta is complete (a delta client was added or resynced)
+static volatile bool wsDeltaAck = false;  // a delta client sent a command, push even if nothing changed
+static unsigned long wsLastPush = 0;
+static unsigned long wsLastInfo = 0;
+static uint32_t wsDeltaRev = 0;
+static uint32_t wsKeyHash[WS_DELTA_KEYS];   // hashes of the keys and values last sent
+static uint32_t wsValueHash[WS_DELTA_KEYS];
+static uint8_t wsKeyCount = 0;
+static uint32_t wsSegHash[MAX_NUM_SEGMENTS] = {0}; // 0 if the segment was inactive
+
+// FNV-1a over printed JSON
+class HashPrint : public Print {
+  public:
+    uint32_t hash = 2166136261UL;
+    size_t write(uint8_t c) override { hash = (hash ^ c) * 16777619UL; return 1; }
+};
+
+static uint32_t hashJson(JsonVariantConst value)
+{
+  HashPrint h;
+  serializeJson(value, h);
+  return h.hash ? h.hash : 1; // 0 is reserved for "not sent"
+}
+
+static uint32_t hashKey(const char* key)
+{
+  HashPrint h;
+  h.print(key);
+  return h.hash;
+}
+
+static WsClientSlot* findWsClient(uint32_t id)
+{
+  for (uint8_t i = 0; i < WS_MAX_CLIENTS; i++) if (wsClients[i].id == id) return &wsClients[i];
+  return nullptr;
+}
+
+static bool isDeltaClient(uint32_t id)
+{
+  WsClientSlot *slot = findWsClient(id);
+  return slot && slot->delta;
+}
+
+// arg is the client id
+static void sendDeferredDataWs(uint32_t clientId)
+{
+  AsyncWebSocketClient * client = ws.client(clientId);
+  if (client) sendDataWs(client);
+}
 
 void wsEvent(AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventType type, void * arg, uint8_t *data, size_t len)
 {
   if(type == WS_EVT_CONNECT){
     //client connected
+    WsClientSlot *slot = findWsClient(0); // untracked clients (table full) get full broadcasts
+    if (slot) { slot->id = client->id(); slot->delta = false; }
     sendDataWs(client);
   } else if(type == WS_EVT_DISCONNECT){
     //client disconnected
     if (client->id() == wsLiveClientId) wsLiveClientId = 0;
+    WsClientSlot *slot = findWsClient(client->id());
+    if (slot) slot->id = 0;
   } else if(type == WS_EVT_DATA){
     //data packet
     AwsFrameInfo * info = (AwsFrameInfo*)arg;
@@ -33,6 +122,7 @@ void wsEvent(AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventTyp
           return;
         }
         bool verboseResponse = false;
+        bool fullResponse = false; // requested state+info or (un)subscribed to deltas
         { //scope JsonDocument so it releases its buffer
           #ifdef WLED_USE_DYNAMIC_JSON
           DynamicJsonDocument doc(JSON_BUFFER_SIZE);
@@ -48,10 +138,16 @@ void wsEvent(AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventTyp
           }
           if (root["v"] && root.size() == 1) {
             //if the received value is just "{"v":true}", send only to this client
-            verboseResponse = true;
+            verboseResponse = fullResponse = true;
+          } else if (root.containsKey("dlt")) {
+            WsClientSlot *slot = findWsClient(client->id());
+            if (slot) slot->delta = root["dlt"];
+            verboseResponse = fullResponse = true;
           } else if (root.containsKey("lv"))
           {
             wsLiveClientId = root["lv"] ? client->id() : 0;
+            wsLiveVersion = root["lv"].as<uint8_t>() >= 2 ? 2 : 1;
+            wsLiveKey = true;
           } else {
             verboseResponse = deserializeState(root);
             if (!interfaceUpdateCallMode) {
@@ -61,8 +157,14 @@ void wsEvent(AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventTyp
           }
           releaseJSONBufferLock(); // will clean fileDoc
         }
-        //update if it takes longer than 300ms until next "broadcast"
-        if (verboseResponse && (millis() - lastInterfaceUpdate < (INTERFACE_UPDATE_COOLDOWN -300) || !interfaceUpdateCallMode)) sendDataWs(client);
+        if (verboseResponse && !fullResponse && isDeltaClient(client->id())) {
+          //delta clients get the change with the next (coalesced) push
+          wsDeltaAck = true;
+          sendDataWs();
+        } else if (verboseResponse && (fullResponse || millis() - lastInterfaceUpdate < (INTERFACE_UPDATE_COOLDOWN -300) || !interfaceUpdateCallMode)) {
+          //update if it takes longer than 300ms until next "broadcast"
+          sendDataWs(client);
+        }
       }
     } else {
       //message is comprised of multiple frames or the frame is split into multiple packets
@@ -92,51 +194,287 @@ void wsEvent(AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventTyp
   }
 }
 
-void sendDataWs(AsyncWebSocketClient * client)
+// full state+info to one client, to all clients or to all clients not receiving deltas
+static bool sendFullWs(AsyncWebSocketClient * client, bool skipDelta)
 {
-  if (!ws.count()) return;
   AsyncWebSocketMessageBuffer * buffer;
 
-  { //scope JsonDocument so it releases its buffer
-    #ifdef WLED_USE_DYNAMIC_JSON
-    DynamicJsonDocument doc(JSON_BUFFER_SIZE);
-    #else
-    if (!requestJSONBufferLock(12)) return;
-    #endif
-    JsonObject state = doc.createNestedObject("state");
-    serializeState(state);
-    JsonObject info  = doc.createNestedObject("info");
-    serializeInfo(info);
-    size_t len = measureJson(doc);
-    size_t heap1 = ESP.getFreeHeap();
-    buffer = ws.makeBuffer(len); // will not allocate correct memory sometimes
-    size_t heap2 = ESP.getFreeHeap();
-    if (!buffer || heap1-heap2<len) {
-      releaseJSONBufferLock();
-      ws.closeAll(1013); //code 1013 = temporary overload, try again later
-      ws.cleanupClients(0); //disconnect all clients to release memory
-      return; //out of memory
-    }
-    serializeJson(doc, (char *)buffer->get(), len +1);
-    releaseJSONBufferLock();
+  // a WS message needs its size up front: measure the stream first (keeping errorFlag for the pass that sends it),
+  // then stream the pieces directly into the message buffer, so no JSON buffer is held for the whole state
+  byte error = errorFlag;
+  size_t len = JsonStreamer(JSON_STREAM_STATE | JSON_STREAM_INFO).length();
+  errorFlag = error;
+  if (!len) return false; // all arenas busy
+  len += JSON_STREAM_SLACK; // values may grow between both passes, unused room is padded with spaces
+
+  size_t heap1 = ESP.getFreeHeap();
+  buffer = ws.makeBuffer(len); // will not allocate correct memory sometimes
+  size_t heap2 = ESP.getFreeHeap();
+  if (!buffer || heap1-heap2<len) {
+    ws.closeAll(1013); //code 1013 = temporary overload, try again later
+    ws.cleanupClients(0); //disconnect all clients to release memory
+    return true; //out of memory
+  }
+  JsonStreamer stream(JSON_STREAM_STATE | JSON_STREAM_INFO);
+  size_t written = stream.read(buffer->get(), len);
+  if (!stream.done()) { // grew beyond the slack or lost the arena
+    ws._cleanBuffers(); // buffer is owned by the server and freed there once unused
+    return false;
   }
+  memset(buffer->get() + written, ' ', len - written);
+
   if (client) {
     client->text(buffer);
-  } else {
+  } else if (!skipDelta) {
     ws.textAll(buffer);
+  } else {
+    for (uint8_t i = 0; i < WS_MAX_CLIENTS; i++) {
+      if (!wsClients[i].id || wsClients[i].delta) continue;
+      AsyncWebSocketClient * c = ws.client(wsClients[i].id);
+      if (c) c->text(buffer);
+    }
+    ws._cleanBuffers();
+  }
+  return true;
+}
+
+// changed state keys and segments since the last delta to all delta clients
+static bool sendDeltaWs()
+{
+  JsonDocument *pDoc = requestJSONBuffer(12);
+  if (!pDoc) return false;
+  JsonDocument &doc = *pDoc;
+  bool reset = wsDeltaReset;
+  wsDeltaReset = false;
+
+  JsonObject head = doc.createNestedObject("_"); // scratch copy, removed before sending
+  serializeState(head, false, true, true, false);
+  JsonObject state = doc.createNestedObject("state");
+  for (JsonPair kv : head) {
+    const char *key = kv.key().c_str();
+    uint32_t kh = hashKey(key);
+    uint32_t vh = hashJson(kv.value());
+    uint8_t i = 0;
+    while (i < wsKeyCount && wsKeyHash[i] != kh) i++;
+    if (i == wsKeyCount && i < WS_DELTA_KEYS) { wsKeyHash[i] = kh; wsValueHash[i] = 0; wsKeyCount++; }
+    bool changed = reset || i >= WS_DELTA_KEYS || wsValueHash[i] != vh || !strcmp(key, "error"); // errors are one-shot
+    if (!changed) continue;
+    state[key] = kv.value(); // key text lives in doc until it is cleared
+    if (i < WS_DELTA_KEYS) wsValueHash[i] = vh;
+  }
+  doc.remove("_");
+
+  JsonArray segs;
+  for (uint8_t s = 0; s < strip.getMaxSegments() && s < MAX_NUM_SEGMENTS; s++) {
+    WS2812FX::Segment &sg = strip.getSegment(s);
+    StaticJsonDocument<1024> segDoc;
+    JsonObject seg0 = segDoc.to<JsonObject>();
+    uint32_t sh = 0;
+    if (sg.isActive()) {
+      serializeSegment(seg0, sg, s, false, true);
+      sh = hashJson(seg0);
+    }
+    if (sh == wsSegHash[s] && (!reset || !sh)) continue;
+    if (segs.isNull()) segs = state.createNestedArray("seg");
+    if (sh) {
+      segs.add(seg0);
+    } else { // removed
+      JsonObject gone = segs.createNestedObject();
+      gone["id"] = s;
+      gone["stop"] = 0;
+    }
+    wsSegHash[s] = sh;
+  }
+
+  if (reset || millis() - wsLastInfo >= WS_INFO_INTERVAL) {
+    JsonObject info = doc.createNestedObject("info");
+    serializeInfo(info);
+    wsLastInfo = millis();
+  }
+
+  if (!state.size() && !doc.containsKey("info") && !wsDeltaAck) { // nothing changed
+    releaseJSONBuffer(&doc);
+    return true;
+  }
+  wsDeltaAck = false;
+  doc["d"] = ++wsDeltaRev;
+  if (reset) doc["f"] = true;
+
+  size_t len = measureJson(doc);
+  AsyncWebSocketMessageBuffer * buffer = ws.makeBuffer(len);
+  if (!buffer) {
+    releaseJSONBuffer(&doc);
+    wsDeltaReset = true; // clients missed this delta
+    return true; //out of memory, resync with the next push
   }
+  serializeJson(doc, (char *)buffer->get(), len +1);
+  releaseJSONBuffer(&doc);
+
+  for (uint8_t i = 0; i < WS_MAX_CLIENTS; i++) {
+    if (!wsClients[i].id || !wsClients[i].delta) continue;
+    AsyncWebSocketClient * c = ws.client(wsClients[i].id);
+    if (c) c->text(buffer);
+  }
+  ws._cleanBuffers();
+  return true;
+}
+
+// one coalesced broadcast: full state+info to clients without deltas, deltas to the others
+static void pushWsUpdate()
+{
+  uint8_t tracked = 0, deltas = 0;
+  for (uint8_t i = 0; i < WS_MAX_CLIENTS; i++) {
+    if (!wsClients[i].id) continue;
+    tracked++;
+    if (wsClients[i].delta) deltas++;
+  }
+
+  bool sent = true;
+  if (!deltas || ws.count() > tracked) { // nobody wants deltas or some clients are untracked
+    sent = sendFullWs(nullptr, false);
+    if (deltas) wsDeltaReset = true;     // delta clients took the full message as their new base
+  } else {
+    if (ws.count() > deltas) sent = sendFullWs(nullptr, true);
+    sent = sendDeltaWs() && sent;
+  }
+  if (!sent) wsUpdatePending = true; // no JSON buffer free, try again with the next push
+}
+
+void sendDataWs(AsyncWebSocketClient * client)
+{
+  if (!ws.count()) return;
+  if (!client) { // broadcasts are sent from handleWs()
+    wsUpdatePending = true;
+    return;
+  }
+  if (isDeltaClient(client->id())) wsDeltaReset = true; // its base changes, keep deltas consistent
+  if (!sendFullWs(client, false)) deferJSONWork(sendDeferredDataWs, client->id()); // all arenas busy, send from the main loop later
 }
 
 #define MAX_LIVE_LEDS_WS 1024 //WLEDSR: support 32x32 matrices max
 
+static void freeLiveFrames()
+{
+  free(wsLiveCur);  wsLiveCur = nullptr;
+  free(wsLivePrev); wsLivePrev = nullptr;
+  wsLiveCount = 0;
+}
+
+// writes the RLE payload to out (if not nullptr) and returns its size
+static size_t encodeLiveFrame(const uint8_t* cur, const uint8_t* prev, uint16_t count, uint8_t* out)
+{
+  size_t pos = 0;
+  uint16_t i = 0;
+  while (i < count) {
+    uint16_t run = 1;
+    if (prev && !memcmp(cur + i*3, prev + i*3, 3)) { // unchanged
+      while (i + run < count && run < 64 && !memcmp(cur + (i+run)*3, prev + (i+run)*3, 3)) run++;
+      if (out) out[pos] = 0xC0 | (run-1);
+      pos++;
+      i += run;
+      continue;
+    }
+    while (i + run < count && run < 64 && !memcmp(cur + (i+run)*3, cur + i*3, 3)) run++;
+    if (run > 1) { // repeated color
+      if (out) {
+        out[pos] = 0x80 | (run-1);
+        memcpy(out + pos + 1, cur + i*3, 3);
+      }
+      pos += 4;
+      i += run;
+      continue;
+    }
+    // literal pixels until a repeated or unchanged one starts
+    uint16_t start = i;
+    run = 0;
+    while (i < count && run < 128) {
+      if (run && i + 1 < count && !memcmp(cur + i*3, cur + (i+1)*3, 3)) break;
+      if (run && prev && !memcmp(cur + i*3, prev + i*3, 3)) break;
+      i++;
+      run++;
+    }
+    if (out) {
+      out[pos] = run-1;
+      memcpy(out + pos + 1, cur + start*3, run*3);
+    }
+    pos += 1 + run*3;
+  }
+  return pos;
+}
+
+static bool sendLiveFrameWs(AsyncWebSocketClient * wsc)
+{
+  uint16_t used = strip.getLengthTotal();
+  uint16_t w = strip.matrixWidth, h = strip.matrixHeight;
+  if (!strip.stripOrMatrixPanel || !w || !h || (uint32_t)w*h > used) { w = used; h = 1; }
+  uint8_t scale = 1;
+  while ((uint32_t)((w + scale-1)/scale) * ((h + scale-1)/scale) > MAX_LIVE_LEDS_WS2) scale++;
+  uint16_t fw = (w + scale-1)/scale, fh = (h + scale-1)/scale;
+  uint16_t count = fw * fh;
+
+  if (count != wsLiveCount) {
+    freeLiveFrames();
+    wsLiveCur  = (uint8_t*)malloc(count*3);
+    wsLivePrev = (uint8_t*)malloc(count*3);
+    if (!wsLiveCur || !wsLivePrev) { freeLiveFrames(); return false; }
+    wsLiveCount = count;
+    wsLiveKey = true;
+  }
+
+  // read the bus output once, averaging scale x scale areas
+  uint8_t *p = wsLiveCur;
+  for (uint16_t fy = 0; fy < fh; fy++) {
+    for (uint16_t fx = 0; fx < fw; fx++) {
+      uint32_t r = 0, g = 0, b = 0, n = 0;
+      for (uint16_t y = fy*scale; y < fy*scale + scale && y < h; y++) {
+        for (uint16_t x = fx*scale; x < fx*scale + scale && x < w; x++) {
+          uint32_t c = strip.getLivePixelColor(x + y*w);
+          r += qadd8(W(c), R(c)); //add white channel to RGB channels as a simple RGBW -> RGB map
+          g += qadd8(W(c), G(c));
+          b += qadd8(W(c), B(c));
+          n++;
+        }
+      }
+      *p++ = r/n;
+      *p++ = g/n;
+      *p++ = b/n;
+    }
+  }
+
+  bool key = wsLiveKey || millis() - wsLiveKeyTime > WS_LIVE_KEYFRAME;
+  const uint8_t *prev = key ? nullptr : wsLivePrev;
+  size_t len = encodeLiveFrame(wsLiveCur, prev, count, nullptr);
+  if (!key && len == (count + 63)/64u) return true; // nothing changed
+
+  AsyncWebSocketMessageBuffer * wsBuf = ws.makeBuffer(WS_LIVE_HEADER + len);
+  if (!wsBuf) return false; //out of memory
+  uint8_t* buffer = wsBuf->get();
+  buffer[0] = 'L';
+  buffer[1] = 2; //version
+  buffer[2] = w & 0xFF;
+  buffer[3] = w >> 8;
+  buffer[4] = h & 0xFF;
+  buffer[5] = h >> 8;
+  buffer[6] = scale;
+  buffer[7] = key;
+  encodeLiveFrame(wsLiveCur, prev, count, buffer + WS_LIVE_HEADER);
+  wsc->binary(wsBuf);
+
+  uint8_t *t = wsLivePrev; wsLivePrev = wsLiveCur; wsLiveCur = t;
+  if (key) wsLiveKeyTime = millis();
+  wsLiveKey = false;
+  return true;
+}
+
 bool sendLiveLedsWs(uint32_t wsClient)
 {
   AsyncWebSocketClient * wsc = ws.client(wsClient);
   if (!wsc || wsc->queueLength() > 0) return false; //only send if queue free
+  if (wsLiveVersion >= 2) return sendLiveFrameWs(wsc);
 
   uint16_t used = strip.getLengthTotal();
   uint16_t n = ((used -1)/MAX_LIVE_LEDS_WS) +1; //only serve every n'th LED if count over MAX_LIVE_LEDS_WS
-  uint16_t bufSize = 2 + (used/n)*3;
+  uint16_t bufSize = 4 + (used/n)*3;
   AsyncWebSocketMessageBuffer * wsBuf = ws.makeBuffer(bufSize);
   if (!wsBuf) return false; //out of memory
   uint8_t* buffer = wsBuf->get();
@@ -148,7 +486,7 @@ bool sendLiveLedsWs(uint32_t wsClient)
   uint16_t pos = 4;
   for (uint16_t i= 0; pos < bufSize -2; i += n)
   {
-    uint32_t c = strip.getPixelColor(i);
+    uint32_t c = strip.getLivePixelColor(i);
     buffer[pos++] = qadd8(W(c), R(c)); //R, add white channel to RGB channels as a simple RGBW -> RGB map
     buffer[pos++] = qadd8(W(c), G(c)); //G
     buffer[pos++] = qadd8(W(c), B(c)); //B
@@ -160,7 +498,13 @@ bool sendLiveLedsWs(uint32_t wsClient)
 
 void handleWs()
 {
-  if (millis() - wsLastLiveTime > WS_LIVE_INTERVAL)
+  if (wsUpdatePending && millis() - wsLastPush >= WS_PUSH_INTERVAL) {
+    wsUpdatePending = false;
+    wsLastPush = millis();
+    pushWsUpdate();
+  }
+
+  if (millis() - wsLastLiveTime > wsLiveInterval)
   {
     #ifdef ESP8266
     ws.cleanupClients(3);
@@ -168,8 +512,16 @@ void handleWs()
     ws.cleanupClients();
     #endif
     bool success = true;
-    if (wsLiveClientId)
+    if (wsLiveClientId) {
       success = sendLiveLedsWs(wsLiveClientId);
+      ws._cleanBuffers(); // free live buffers the client has received
+      // adapt to the client: back off while its queue is not empty, speed up again when it keeps up
+      if (success) wsLiveInterval = MAX(WS_LIVE_INTERVAL, wsLiveInterval - wsLiveInterval/8);
+      else         wsLiveInterval = MIN(WS_LIVE_MAX_INTERVAL, wsLiveInterval + wsLiveInterval/2);
+    } else if (wsLiveCount) {
+      freeLiveFrames();
+      wsLiveInterval = WS_LIVE_INTERVAL;
+    }
     wsLastLiveTime = millis();
     if (!success) wsLastLiveTime -= 20; //try again in 20ms if failed due to non-empty WS queue
   }
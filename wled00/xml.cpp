@@ -400,6 +400,7 @@ void getSettingsJS(byte subPage, char* dest)
     sappend('c',SET_F("CR"),cctFromRgb);
     sappend('v',SET_F("CB"),strip.cctBlending);
     sappend('v',SET_F("FR"),strip.getTargetFps());
+    sappend('c',SET_F("NS"),networkOutputSync);
     sappend('v',SET_F("AW"),strip.autoWhiteMode);
     sappend('v',SET_F("SOMP"),strip.stripOrMatrixPanel);
     sappend('v',SET_F("MXW"),strip.matrixWidth);
@@ -528,6 +529,8 @@ void getSettingsJS(byte subPage, char* dest)
     sappend('c',SET_F("SH"),notifyHue);
     sappend('c',SET_F("SM"),notifyMacro);
     sappend('c',SET_F("S2"),notifyTwice);
+    sappend('c',SET_F("CS"),clockSyncEnabled);
+    sappend('v',SET_F("CP"),clockSyncPriority);
 
     sappend('c',SET_F("NL"),nodeListEnabled);
     sappend('c',SET_F("NB"),nodeBroadcastEnabled);
@@ -541,6 +544,9 @@ void getSettingsJS(byte subPage, char* dest)
     sappend('v',SET_F("DA"),DMXAddress);
     sappend('v',SET_F("DM"),DMXMode);
     sappend('v',SET_F("ET"),realtimeTimeoutMs);
+    sappend('v',SET_F("FT"),e131FrameTimeout);
+    sappend('v',SET_F("JB"),realtimeJitterFrames);
+    sappend('c',SET_F("JI"),realtimeInterpolate);
     sappend('c',SET_F("FB"),arlsForceMaxBri);
     sappend('c',SET_F("RG"),arlsDisableGammaCorrection);
     sappend('v',SET_F("WO"),arlsOffset);